@@ -0,0 +1,2490 @@
+#define CLOSURE_0_0(_name, _rettype)\
+_rettype _name();\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z){\
+  return _name();\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_0_1(_name, _rettype, _r0)\
+_rettype _name(_r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  return _name(r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_0_2(_name, _rettype, _r0, _r1)\
+_rettype _name(_r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  return _name(r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_0_3(_name, _rettype, _r0, _r1, _r2)\
+_rettype _name(_r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  return _name(r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_0_4(_name, _rettype, _r0, _r1, _r2, _r3)\
+_rettype _name(_r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  return _name(r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_0_5(_name, _rettype, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  return _name(r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_0_6(_name, _rettype, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  return _name(r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_0_7(_name, _rettype, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  return _name(r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_0_8(_name, _rettype, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  return _name(r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_0_9(_name, _rettype, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  return _name(r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_1_0(_name, _rettype, _l0)\
+_rettype _name(_l0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_1_1(_name, _rettype, _l0, _r0)\
+_rettype _name(_l0, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_1_2(_name, _rettype, _l0, _r0, _r1)\
+_rettype _name(_l0, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_1_3(_name, _rettype, _l0, _r0, _r1, _r2)\
+_rettype _name(_l0, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_1_4(_name, _rettype, _l0, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_1_5(_name, _rettype, _l0, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_1_6(_name, _rettype, _l0, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_1_7(_name, _rettype, _l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_1_8(_name, _rettype, _l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_1_9(_name, _rettype, _l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_2_0(_name, _rettype, _l0, _l1)\
+_rettype _name(_l0, _l1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_2_1(_name, _rettype, _l0, _l1, _r0)\
+_rettype _name(_l0, _l1, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_2_2(_name, _rettype, _l0, _l1, _r0, _r1)\
+_rettype _name(_l0, _l1, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_2_3(_name, _rettype, _l0, _l1, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_2_4(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_2_5(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_2_6(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_2_7(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_2_8(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_2_9(_name, _rettype, _l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_3_0(_name, _rettype, _l0, _l1, _l2)\
+_rettype _name(_l0, _l1, _l2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_3_1(_name, _rettype, _l0, _l1, _l2, _r0)\
+_rettype _name(_l0, _l1, _l2, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_3_2(_name, _rettype, _l0, _l1, _l2, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_3_3(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_3_4(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_3_5(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_3_6(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_3_7(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_3_8(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_3_9(_name, _rettype, _l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_4_0(_name, _rettype, _l0, _l1, _l2, _l3)\
+_rettype _name(_l0, _l1, _l2, _l3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_4_1(_name, _rettype, _l0, _l1, _l2, _l3, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_4_2(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_4_3(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_4_4(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_4_5(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_4_6(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_4_7(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_4_8(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_4_9(_name, _rettype, _l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_5_0(_name, _rettype, _l0, _l1, _l2, _l3, _l4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_5_1(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_5_2(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_5_3(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_5_4(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_5_5(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_5_6(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_5_7(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_5_8(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_5_9(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_6_0(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_6_1(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_6_2(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_6_3(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_6_4(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_6_5(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_6_6(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_6_7(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_6_8(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_6_9(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_7_0(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_7_1(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_7_2(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_7_3(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_7_4(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_7_5(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_7_6(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_7_7(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_7_8(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_7_9(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_8_0(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_8_1(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_8_2(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_8_3(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_8_4(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_8_5(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_8_6(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_8_7(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_8_8(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_8_9(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
+#define CLOSURE_9_0(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *))n;\
+}
+
+#define CLOSURE_9_1(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0))n;\
+}
+
+#define CLOSURE_9_2(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1))n;\
+}
+
+#define CLOSURE_9_3(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2))n;\
+}
+
+#define CLOSURE_9_4(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3))n;\
+}
+
+#define CLOSURE_9_5(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3, r4);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3, _r4){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4))n;\
+}
+
+#define CLOSURE_9_6(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3, r4, r5);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3, _r4, _r5){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5))n;\
+}
+
+#define CLOSURE_9_7(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3, r4, r5, r6);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6))n;\
+}
+
+#define CLOSURE_9_8(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3, r4, r5, r6, r7);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7))n;\
+}
+
+#define CLOSURE_9_9(_name, _rettype, _l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8)\
+_rettype _name(_l0, _l1, _l2, _l3, _l4, _l5, _l6, _l7, _l8, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+struct _closure_##_name{\
+  _rettype (*_apply)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8);\
+  char *name;\
+  _l0 l0;\
+  _l1 l1;\
+  _l2 l2;\
+  _l3 l3;\
+  _l4 l4;\
+  _l5 l5;\
+  _l6 l6;\
+  _l7 l7;\
+  _l8 l8;\
+};\
+static _rettype _apply_##_name(void *z, _r0 r0, _r1 r1, _r2 r2, _r3 r3, _r4 r4, _r5 r5, _r6 r6, _r7 r7, _r8 r8){\
+  struct _closure_##_name *n = z; \
+  return _name(n->l0, n->l1, n->l2, n->l3, n->l4, n->l5, n->l6, n->l7, n->l8, r0, r1, r2, r3, r4, r5, r6, r7, r8);\
+}\
+static _rettype (**_fill_##_name(struct _closure_##_name* n, heap h, _l0 l0, _l1 l1, _l2 l2, _l3 l3, _l4 l4, _l5 l5, _l6 l6, _l7 l7, _l8 l8))(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8){\
+  n->_apply = _apply_##_name;\
+  n->name = #_name;\
+  n->l0 = l0;\
+  n->l1 = l1;\
+  n->l2 = l2;\
+  n->l3 = l3;\
+  n->l4 = l4;\
+  n->l5 = l5;\
+  n->l6 = l6;\
+  n->l7 = l7;\
+  n->l8 = l8;\
+  return (_rettype (**)(void *, _r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8))n;\
+}
+
@@ -183,45 +183,53 @@ static int ata_io_loop(struct ata *dev, int cmd, void *buf, u64 nsectors)
     }
 }
 
+/* The largest transfer a 48-bit command takes, written as a count of 0 */
+#define ATA_MAX_SECTORS 65536
+
+/* Larger requests are made as successive commands. */
 void ata_io_cmd(void *_dev, int cmd, void *buf, range blocks, status_handler s)
 {
     struct ata *dev = (struct ata *) _dev;
     const char *err;
 
-    u64 lba = blocks.start;
-    u64 nsectors = range_span(blocks);
-    if (nsectors == 0) {
+    if (range_span(blocks) == 0) {
         const char *err = "ata_io_cmd: zero blocks I/O";
         apply(s, timm("result", "%s", err));
         return;
     }
-    assert(nsectors <= 65536);
-    if (nsectors == 65536)
-        nsectors = 0;
-    ata_debug("%s: cmd 0x%x, blocks %R, sectors %d\n",
-        __func__, cmd, blocks, nsectors);
-
-    // wait for device to become ready
-    if (ata_wait(dev, 0) < 0)
-        goto timeout;
-
-    // set LBA
-    ata_out8(dev, ATA_COUNT, nsectors >> 8);
-    ata_out8(dev, ATA_COUNT, nsectors);
-    ata_out8(dev, ATA_CYL_MSB, lba >> 40);
-    ata_out8(dev, ATA_CYL_LSB, lba >> 32);
-    ata_out8(dev, ATA_SECTOR, lba >> 24);
-    ata_out8(dev, ATA_CYL_MSB, lba >> 16);
-    ata_out8(dev, ATA_CYL_LSB, lba >> 8);
-    ata_out8(dev, ATA_SECTOR, lba);
-    ata_out8(dev, ATA_DRIVE, ATA_D_LBA | ATA_DEV(dev->unit));
-
-    // send I/O command
-    ata_out8(dev, ATA_COMMAND, cmd);
-
-    // read/write data
-    if (ata_io_loop(dev, cmd, buf, range_span(blocks)) < 0)
-        goto timeout;
+
+    while (blocks.start < blocks.end) {
+        u64 lba = blocks.start;
+        u64 nsectors = MIN(range_span(blocks), ATA_MAX_SECTORS);
+        ata_debug("%s: cmd 0x%x, blocks %R, sectors %d\n",
+            __func__, cmd, blocks, nsectors);
+
+        // wait for device to become ready
+        if (ata_wait(dev, 0) < 0)
+            goto timeout;
+
+        // set LBA
+        u64 count = nsectors == ATA_MAX_SECTORS ? 0 : nsectors;
+        ata_out8(dev, ATA_COUNT, count >> 8);
+        ata_out8(dev, ATA_COUNT, count);
+        ata_out8(dev, ATA_CYL_MSB, lba >> 40);
+        ata_out8(dev, ATA_CYL_LSB, lba >> 32);
+        ata_out8(dev, ATA_SECTOR, lba >> 24);
+        ata_out8(dev, ATA_CYL_MSB, lba >> 16);
+        ata_out8(dev, ATA_CYL_LSB, lba >> 8);
+        ata_out8(dev, ATA_SECTOR, lba);
+        ata_out8(dev, ATA_DRIVE, ATA_D_LBA | ATA_DEV(dev->unit));
+
+        // send I/O command
+        ata_out8(dev, ATA_COMMAND, cmd);
+
+        // read/write data
+        if (ata_io_loop(dev, cmd, buf, nsectors) < 0)
+            goto timeout;
+
+        blocks.start += nsectors;
+        buf += nsectors * ATA_SECTOR_SIZE;
+    }
 
     // ok
     apply(s, 0);
@@ -0,0 +1,181 @@
+#include <runtime.h>
+#include <x86_64.h>
+#include <drivers/blkq.h>
+
+//#define BLKQ_DEBUG
+#ifdef BLKQ_DEBUG
+#define blkq_debug(x, ...) do {rprintf("BLKQ: " x, ##__VA_ARGS__);} while(0)
+#else
+#define blkq_debug(x, ...)
+#endif
+
+struct blkq {
+    heap h;
+    const char *name;           /* for stats, with the index */
+    int index;
+    u64 block_size;
+    u64 max_blocks;             /* per device request */
+    u64 max_segments;
+    block_submit submit;
+    struct list pending;        /* held until the deferqueue runs */
+    boolean scheduled;
+    thunk flush;
+    struct blkq_stats stats;
+};
+
+static vector queues;
+
+/* pages spanned by a buffer, each of which may be a segment of its own */
+static inline u64 buf_segments(void *buf, u64 length)
+{
+    u64 p = u64_from_pointer(buf);
+    return ((p + length - 1) >> PAGELOG) - (p >> PAGELOG) + 1;
+}
+
+static CLOSURE_1_0(blkq_flush, void, blkq);
+static void blkq_flush(blkq q)
+{
+    q->scheduled = false;
+    list l;
+    while ((l = list_get_next(&q->pending))) {
+        list_delete(l);
+        block_request r = struct_from_list(l, block_request, l);
+        blkq_debug("submit %s %R, %d bufs, %ld segments\n", r->write ? "write" : "read",
+                     r->blocks, r->nbufs, r->segments);
+        q->stats.submitted++;
+        if (++q->stats.inflight > q->stats.max_inflight)
+            q->stats.max_inflight = q->stats.inflight;
+        r->submitted = now();
+        apply(q->submit, r);
+    }
+}
+
+/* Join a pending request that ends where this one starts. */
+static boolean blkq_merge(blkq q, boolean write, void *buf, range blocks, u64 segments,
+                            status_handler sh)
+{
+    list_foreach(&q->pending, l) {
+        block_request r = struct_from_list(l, block_request, l);
+        if (r->write != write || r->blocks.end != blocks.start ||
+            r->nbufs == BLKQ_MAX_BUFS ||
+            r->segments + segments > q->max_segments ||
+            range_span(r->blocks) + range_span(blocks) > q->max_blocks)
+            continue;
+        block_buf b = &r->bufs[r->nbufs++];
+        b->buf = buf;
+        b->length = range_span(blocks) * q->block_size;
+        b->sh = sh;
+        r->blocks.end = blocks.end;
+        r->segments += segments;
+        q->stats.merged++;
+        return true;
+    }
+    return false;
+}
+
+static void blkq_queue(blkq q, boolean write, void *buf, range blocks, status_handler sh)
+{
+    u64 segments = buf_segments(buf, range_span(blocks) * q->block_size);
+    if (blkq_merge(q, write, buf, blocks, segments, sh))
+        return;
+
+    block_request r = allocate(q->h, sizeof(struct block_request));
+    assert(r != INVALID_ADDRESS);
+    r->write = write;
+    r->blocks = blocks;
+    r->segments = segments;
+    r->nbufs = 1;
+    r->bufs[0].buf = buf;
+    r->bufs[0].length = range_span(blocks) * q->block_size;
+    r->bufs[0].sh = sh;
+    list_push_back(&q->pending, &r->l);
+    if (!q->scheduled) {
+        q->scheduled = true;
+        if (!enqueue(deferqueue, q->flush))
+            halt("%s: unable to grow deferqueue\n", __func__);
+    }
+}
+
+void blkq_io(blkq q, boolean write, void *buf, range blocks, status_handler sh)
+{
+    blkq_debug("%s %R, buf %p\n", write ? "write" : "read", blocks, buf);
+    q->stats.requests++;
+
+    /* Whatever the alignment of the buffer, a piece of this many blocks
+       spans no more than max_segments pages. */
+    u64 limit = MIN(q->max_blocks, ((q->max_segments - 1) << PAGELOG) / q->block_size);
+    if (range_span(blocks) <= limit &&
+        buf_segments(buf, range_span(blocks) * q->block_size) <= q->max_segments) {
+        blkq_queue(q, write, buf, blocks, sh);
+        return;
+    }
+
+    q->stats.split++;
+    merge m = allocate_merge(q->h, sh);
+    status_handler k = apply_merge(m);
+    while (blocks.start < blocks.end) {
+        u64 n = MIN(range_span(blocks), limit);
+        blkq_queue(q, write, buf, irange(blocks.start, blocks.start + n), apply_merge(m));
+        buf += n * q->block_size;
+        blocks.start += n;
+    }
+    apply(k, STATUS_OK);
+}
+
+void blkq_complete(blkq q, block_request r, status s)
+{
+    timestamp latency = now() - r->submitted;
+    q->stats.inflight--;
+    q->stats.completed++;
+    q->stats.latency_total += latency;
+    if (latency > q->stats.latency_max)
+        q->stats.latency_max = latency;
+    for (int i = 0; i < r->nbufs; i++)
+        apply(r->bufs[i].sh, s);
+    deallocate(q->h, r, sizeof(struct block_request));
+}
+
+void blkq_get_stats(blkq q, blkq_stats s)
+{
+    runtime_memcpy(s, &q->stats, sizeof(struct blkq_stats));
+}
+
+void print_blkq_stats(void)
+{
+    blkq q;
+    if (!queues)
+        return;
+    vector_foreach(queues, q) {
+        blkq_stats st = &q->stats;
+        rprintf("%s queue %d: %ld requests, %ld submitted, %ld merged, %ld split\n",
+                q->name, q->index, st->requests, st->submitted, st->merged, st->split);
+        rprintf("   depth %ld, max %ld; latency avg %T s, max %T s\n",
+                st->inflight, st->max_inflight,
+                st->completed ? st->latency_total / st->completed : 0, st->latency_max);
+    }
+}
+
+/* max_segments must allow for at least two pages, so that a block
+   straddling a page boundary can be sent. */
+blkq allocate_blkq(heap h, const char *name, int index, u64 block_size, u64 max_blocks,
+                   u64 max_segments, block_submit submit)
+{
+    assert(max_segments >= 2 && max_blocks > 0);
+    blkq q = allocate(h, sizeof(struct blkq));
+    assert(q != INVALID_ADDRESS);
+    q->h = h;
+    q->name = name;
+    q->index = index;
+    q->block_size = block_size;
+    q->max_blocks = max_blocks;
+    q->max_segments = max_segments;
+    q->submit = submit;
+    list_init(&q->pending);
+    q->scheduled = false;
+    q->flush = closure(h, blkq_flush, q);
+    runtime_memset((void *)&q->stats, 0, sizeof(struct blkq_stats));
+    if (!queues)
+        queues = allocate_vector(h, 2);
+    vector_push(queues, q);
+    return q;
+}
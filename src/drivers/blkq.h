@@ -0,0 +1,53 @@
+#pragma once
+
+/* Block request queue for devices that take a scatter-gather list with
+   each request.
+
+   Requests are held until the deferqueue is next run, so that ones for
+   adjacent blocks in the same direction, made in the same pass through
+   the kernel, reach the device as a single request whose segments are
+   the buffers of each in turn. A request beyond the limits of the
+   device is split. Segments are counted as the pages a buffer spans,
+   as a buffer need only be virtually contiguous. */
+
+#define BLKQ_MAX_BUFS 16
+
+typedef struct block_buf {
+    void *buf;
+    u64 length;
+    status_handler sh;
+} *block_buf;
+
+typedef struct block_request {
+    struct list l;
+    boolean write;
+    range blocks;
+    u64 segments;               /* at most */
+    timestamp submitted;
+    int nbufs;
+    struct block_buf bufs[BLKQ_MAX_BUFS];
+} *block_request;
+
+/* hands a request to the device, which calls blkq_complete when done */
+typedef closure_type(block_submit, void, block_request);
+
+typedef struct blkq_stats {
+    u64 requests;               /* as made of the queue */
+    u64 submitted;              /* as sent to the device */
+    u64 merged;                 /* joined onto an adjacent request */
+    u64 split;                  /* too large for one device request */
+    u64 inflight;               /* at the device now */
+    u64 max_inflight;
+    u64 completed;
+    timestamp latency_total;    /* from submission to completion */
+    timestamp latency_max;
+} *blkq_stats;
+
+typedef struct blkq *blkq;
+
+blkq allocate_blkq(heap h, const char *name, int index, u64 block_size, u64 max_blocks,
+                   u64 max_segments, block_submit submit);
+void blkq_io(blkq q, boolean write, void *buf, range blocks, status_handler sh);
+void blkq_complete(blkq q, block_request r, status s);
+void blkq_get_stats(blkq q, blkq_stats s);
+void print_blkq_stats(void);
@@ -58,6 +58,11 @@
 // some other policy
 #define DHCP_DOES_ARP_CHECK 0
 #define LWIP_NETIF_HOSTNAME 1
+#define LWIP_CHECKSUM_CTRL_PER_NETIF 1
+// room for the virtio-net header ahead of the ethernet header
+#define PBUF_LINK_ENCAPSULATION_HLEN 12
+// full-sized segments rather than the 536 byte default
+#define TCP_MSS 1460
 #define MEMP_MEM_MALLOC 1
 typedef unsigned long size_t;
 #define LWIP_NETIF_STATUS_CALLBACK 1
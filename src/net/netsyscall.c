@@ -104,6 +104,19 @@ enum udp_socket_state {
 
 typedef closure_type(lwip_status_handler, void, err_t);
 
+/* File pages queued on a TCP connection by reference. Each holds a pin
+   on its page until the peer acknowledges the byte following it. */
+typedef struct tcp_page_ref {
+    struct list l;
+    fspage page;
+    u32 seq_end;
+} *tcp_page_ref;
+
+typedef struct tcp_page_refs {
+    heap h;
+    struct list refs;           /* oldest first */
+} *tcp_page_refs;
+
 typedef struct sock {
     struct fdesc f;              /* must be first */
     int type;
@@ -120,6 +133,7 @@ typedef struct sock {
 	    struct tcp_pcb *lw;
 	    enum tcp_socket_state state; // half open?
             lwip_status_handler connect_bh;
+            tcp_page_refs page_refs;
 	} tcp;
 	struct {
 	    struct udp_pcb *lw;
@@ -500,6 +514,131 @@ static sysreturn socket_write_tcp_bh(sock s, thread t, void * buf, u64 remain,
     return rv;
 }
 
+static void tcp_page_refs_ack(tcp_page_refs r, u32 lastack)
+{
+    list_foreach(&r->refs, l) {
+        tcp_page_ref pr = struct_from_list(l, tcp_page_ref, l);
+        if ((s32)(lastack - pr->seq_end) < 0)
+            break;
+        list_delete(l);
+        fspage_release(pr->page);
+        deallocate(r->h, pr, sizeof(struct tcp_page_ref));
+    }
+}
+
+static void tcp_page_refs_release(tcp_page_refs r)
+{
+    list_foreach(&r->refs, l) {
+        tcp_page_ref pr = struct_from_list(l, tcp_page_ref, l);
+        list_delete(l);
+        fspage_release(pr->page);
+        deallocate(r->h, pr, sizeof(struct tcp_page_ref));
+    }
+    deallocate(r->h, r, sizeof(struct tcp_page_refs));
+}
+
+static CLOSURE_6_1(socket_sendpage_tcp_bh, sysreturn, sock, thread, vector, u64, u64,
+        io_completion, boolean);
+static sysreturn socket_sendpage_tcp_bh(sock s, thread t, vector pages, u64 offset, u64 length,
+        io_completion completion, boolean blocked)
+{
+    sysreturn rv = 0;
+    err_t err = get_lwip_error(s);
+    net_debug("fd %d, thread %ld, offset %ld, length %ld, blocked %d, lwip err %d\n",
+              s->fd, t->tid, offset, length, blocked, err);
+    assert(length > 0);
+
+    if (err != ERR_OK) {
+        rv = lwip_to_errno(err);
+        goto out;
+    }
+
+    if (s->info.tcp.state != TCP_SOCK_OPEN) {
+        rv = -ENOTCONN;
+        goto out;
+    }
+
+    struct tcp_pcb *lw = s->info.tcp.lw;
+    u64 avail = tcp_sndbuf(lw);
+    if (avail == 0) {
+      full:
+        if (!blocked && (s->f.flags & SOCK_NONBLOCK)) {
+            net_debug(" send buf full and non-blocking, return EAGAIN\n");
+            rv = -EAGAIN;
+            goto out;
+        } else {
+            net_debug(" send buf full, sleep\n");
+            return infinity;           /* block again */
+        }
+    }
+
+    tcp_page_refs r = s->info.tcp.page_refs;
+    if (!r) {
+        r = allocate(s->h, sizeof(struct tcp_page_refs));
+        if (r == INVALID_ADDRESS) {
+            rv = -ENOMEM;
+            goto out;
+        }
+        r->h = s->h;
+        list_init(&r->refs);
+        s->info.tcp.page_refs = r;
+    }
+
+    /* One tcp_write() per page, without TCP_WRITE_FLAG_COPY; lwIP
+       chains references to the page data into its segments. */
+    u64 first = fspage_offset(vector_get(pages, 0));
+    u64 written = 0;
+    while (written < length && avail > 0) {
+        u64 o = offset + written;
+        fspage p = vector_get(pages, (o - first) >> PAGELOG);
+        u64 po = o & MASK(PAGELOG);
+        u64 n = MIN(MIN(PAGESIZE - po, length - written), avail);
+        tcp_page_ref pr = allocate(s->h, sizeof(struct tcp_page_ref));
+        if (pr == INVALID_ADDRESS) {
+            err = ERR_MEM;
+            break;
+        }
+        err = tcp_write(lw, fspage_data(p) + po, n,
+                        written + n < length ? TCP_WRITE_FLAG_MORE : 0);
+        if (err != ERR_OK) {
+            deallocate(s->h, pr, sizeof(struct tcp_page_ref));
+            break;
+        }
+        fspage_hold(p);
+        pr->page = p;
+        pr->seq_end = lw->snd_lbb;
+        list_push_back(&r->refs, &pr->l);
+        written += n;
+        avail -= n;
+    }
+
+    if (written == 0) {
+        if (err == ERR_MEM) {
+            net_debug(" tcp_write() returned ERR_MEM\n");
+            goto full;
+        }
+        net_debug(" tcp_write() lwip error: %d\n", err);
+        rv = lwip_to_errno(err);
+        goto out;
+    }
+
+    err = tcp_output(lw);
+    if (err == ERR_OK) {
+        net_debug(" queued %ld bytes by reference\n", written);
+        rv = written;
+        if (avail == 0)
+            notify_sock(s); /* reset a triggered EPOLLOUT condition */
+    } else {
+        net_debug(" tcp_output() lwip error: %d\n", err);
+        rv = lwip_to_errno(err);
+    }
+  out:
+    fspages_release(pages);
+    if (blocked)
+        blockq_set_completion(s->txbq, completion, t, rv);
+    return rv;
+}
+
 static sysreturn socket_write_udp(sock s, void *source, u64 length)
 {
     err_t err = ERR_OK;
@@ -558,6 +697,23 @@ static sysreturn socket_write(sock s, void *source, u64 length, u64 offset,
     return socket_write_internal(s, source, length, t, bh, completion);
 }
 
+static CLOSURE_1_6(socket_sendpage, sysreturn,
+        sock,
+        vector, u64, u64, thread, boolean, io_completion);
+static sysreturn socket_sendpage(sock s, vector pages, u64 offset, u64 length,
+        thread t, boolean bh, io_completion completion)
+{
+    net_debug("sock %d, offset %ld, length %ld\n", s->fd, offset, length);
+    assert(s->type == SOCK_STREAM);
+    if (s->info.tcp.state != TCP_SOCK_OPEN || length == 0) {
+        fspages_release(pages);
+        return length == 0 ? 0 : -EPIPE;
+    }
+    blockq_action ba = closure(s->h, socket_sendpage_tcp_bh, s, t,
+            pages, offset, length, completion);
+    return blockq_check(s->txbq, !bh ? t : 0, ba);
+}
+
 static CLOSURE_1_2(socket_ioctl, sysreturn, sock, unsigned long, vlist);
 static sysreturn socket_ioctl(sock s, unsigned long request, vlist ap)
 {
@@ -631,6 +787,38 @@ static sysreturn socket_ioctl(sock s, unsigned long request, vlist ap)
 
 #define SOCK_QUEUE_LEN 128
 
+/* A closed socket's pcb stays with these callbacks until the peer has
+   acknowledged every page still queued by reference, and only then is
+   it closed. Data arriving meanwhile is discarded. */
+static err_t tcp_page_refs_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    if (p) {
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+    }
+    return ERR_OK;
+}
+
+static err_t tcp_page_refs_sent(void *arg, struct tcp_pcb *pcb, u16 len)
+{
+    tcp_page_refs r = arg;
+    if (!r)
+        return ERR_OK;
+    tcp_page_refs_ack(r, pcb->lastack);
+    if (list_empty(&r->refs)) {
+        tcp_arg(pcb, 0);
+        tcp_page_refs_release(r);
+        tcp_close(pcb);
+    }
+    return ERR_OK;
+}
+
+static void tcp_page_refs_err(void *arg, err_t err)
+{
+    if (arg)
+        tcp_page_refs_release(arg);
+}
+
 static CLOSURE_1_0(socket_close, sysreturn, sock);
 static sysreturn socket_close(sock s)
 {
@@ -642,8 +830,19 @@ static sysreturn socket_close(sock s)
          * using a stale reference to the socket structure, set the callback
          * argument to NULL. */
         if (s->info.tcp.lw) {
-            tcp_close(s->info.tcp.lw);
-            tcp_arg(s->info.tcp.lw, 0);
+            struct tcp_pcb *lw = s->info.tcp.lw;
+            tcp_page_refs r = s->info.tcp.page_refs;
+            if (r && !list_empty(&r->refs)) {
+                tcp_arg(lw, r);
+                tcp_recv(lw, tcp_page_refs_recv);
+                tcp_sent(lw, tcp_page_refs_sent);
+                tcp_err(lw, tcp_page_refs_err);
+                break;
+            }
+            tcp_close(lw);
+            tcp_arg(lw, 0);
+            if (r)
+                tcp_page_refs_release(r);
         }
         break;
     case SOCK_DGRAM:
@@ -736,6 +935,8 @@ static int allocate_sock(process p, int type, u32 flags, sock * rs)
     init_fdesc(h, &s->f, FDESC_TYPE_SOCKET);
     s->f.read = closure(h, socket_read, s);
     s->f.write = closure(h, socket_write, s);
+    if (type == SOCK_STREAM)
+        s->f.sendpage = closure(h, socket_sendpage, s);
     s->f.close = closure(h, socket_close, s);
     s->f.events = closure(h, socket_events, s);
     s->f.ioctl = closure(h, socket_ioctl, s);
@@ -760,6 +961,7 @@ static int allocate_tcp_sock(process p, struct tcp_pcb *pcb, u32 flags)
 	s->info.tcp.lw = pcb;
 	s->info.tcp.state = TCP_SOCK_CREATED;
         s->info.tcp.connect_bh = 0;
+        s->info.tcp.page_refs = 0;
     }
     return fd;
 }
@@ -884,6 +1086,10 @@ void error_handler_tcp(void* arg, err_t err)
     /* Warning: Don't try to use the pcb. According to lwIP docs, it
        may have been deallocated already. */
     s->info.tcp.lw = 0;
+    if (s->info.tcp.page_refs) {
+        tcp_page_refs_release(s->info.tcp.page_refs);
+        s->info.tcp.page_refs = 0;
+    }
 
     error_message(s, err); // XXX nuke this
 
@@ -911,6 +1117,10 @@ static void lwip_tcp_conn_err(void * z, err_t b) {
 
     /* Don't try to use the pcb, it may have been deallocated already. */
     s->info.tcp.lw = 0;
+    if (s->info.tcp.page_refs) {
+        tcp_page_refs_release(s->info.tcp.page_refs);
+        s->info.tcp.page_refs = 0;
+    }
 
     wakeup_sock(s, WAKEUP_SOCK_EXCEPT);
 }
@@ -922,6 +1132,8 @@ static err_t lwip_tcp_sent(void * arg, struct tcp_pcb * pcb, u16 len)
     }
     sock s = (sock)arg;
     net_debug("fd %d, pcb %p, len %d\n", s->fd, pcb, len);
+    if (s->info.tcp.page_refs)
+        tcp_page_refs_ack(s->info.tcp.page_refs, pcb->lastack);
     wakeup_sock(s, WAKEUP_SOCK_TX);
     return ERR_OK;
 }
@@ -1,21 +1,258 @@
 #include <runtime.h>
 
+/* red-black tree primitives; nodes are intrusive and null-terminated */
+
+static inline boolean node_is_red(rmnode n)
+{
+    return n && n->red;
+}
+
+static rmnode tree_min(rmnode n)
+{
+    while (n->left)
+        n = n->left;
+    return n;
+}
+
+static rmnode tree_max(rmnode n)
+{
+    while (n->right)
+        n = n->right;
+    return n;
+}
+
+static void rotate_left(rangemap rm, rmnode x)
+{
+    rmnode y = x->right;
+    x->right = y->left;
+    if (y->left)
+        y->left->parent = x;
+    y->parent = x->parent;
+    if (!x->parent)
+        rm->root = y;
+    else if (x == x->parent->left)
+        x->parent->left = y;
+    else
+        x->parent->right = y;
+    y->left = x;
+    x->parent = y;
+}
+
+static void rotate_right(rangemap rm, rmnode x)
+{
+    rmnode y = x->left;
+    x->left = y->right;
+    if (y->right)
+        y->right->parent = x;
+    y->parent = x->parent;
+    if (!x->parent)
+        rm->root = y;
+    else if (x == x->parent->right)
+        x->parent->right = y;
+    else
+        x->parent->left = y;
+    y->right = x;
+    x->parent = y;
+}
+
+static void insert_fixup(rangemap rm, rmnode z)
+{
+    rmnode p;
+    while ((p = z->parent) && p->red) {
+        rmnode g = p->parent;
+        if (p == g->left) {
+            rmnode u = g->right;
+            if (node_is_red(u)) {
+                p->red = false;
+                u->red = false;
+                g->red = true;
+                z = g;
+                continue;
+            }
+            if (z == p->right) {
+                z = p;
+                rotate_left(rm, z);
+                p = z->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_right(rm, g);
+        } else {
+            rmnode u = g->left;
+            if (node_is_red(u)) {
+                p->red = false;
+                u->red = false;
+                g->red = true;
+                z = g;
+                continue;
+            }
+            if (z == p->left) {
+                z = p;
+                rotate_right(rm, z);
+                p = z->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_left(rm, g);
+        }
+    }
+    rm->root->red = false;
+}
+
+static void transplant(rangemap rm, rmnode u, rmnode v)
+{
+    if (!u->parent)
+        rm->root = v;
+    else if (u == u->parent->left)
+        u->parent->left = v;
+    else
+        u->parent->right = v;
+    if (v)
+        v->parent = u->parent;
+}
+
+/* x may be null, so its parent is tracked separately in xp */
+static void remove_fixup(rangemap rm, rmnode x, rmnode xp)
+{
+    while (x != rm->root && !node_is_red(x)) {
+        if (x == xp->left) {
+            rmnode w = xp->right;
+            if (w->red) {
+                w->red = false;
+                xp->red = true;
+                rotate_left(rm, xp);
+                w = xp->right;
+            }
+            if (!node_is_red(w->left) && !node_is_red(w->right)) {
+                w->red = true;
+                x = xp;
+                xp = x->parent;
+                continue;
+            }
+            if (!node_is_red(w->right)) {
+                w->left->red = false;
+                w->red = true;
+                rotate_right(rm, w);
+                w = xp->right;
+            }
+            w->red = xp->red;
+            xp->red = false;
+            if (w->right)
+                w->right->red = false;
+            rotate_left(rm, xp);
+        } else {
+            rmnode w = xp->left;
+            if (w->red) {
+                w->red = false;
+                xp->red = true;
+                rotate_right(rm, xp);
+                w = xp->left;
+            }
+            if (!node_is_red(w->left) && !node_is_red(w->right)) {
+                w->red = true;
+                x = xp;
+                xp = x->parent;
+                continue;
+            }
+            if (!node_is_red(w->left)) {
+                w->right->red = false;
+                w->red = true;
+                rotate_left(rm, w);
+                w = xp->left;
+            }
+            w->red = xp->red;
+            xp->red = false;
+            if (w->left)
+                w->left->red = false;
+            rotate_right(rm, xp);
+        }
+        x = rm->root;
+    }
+    if (x)
+        x->red = false;
+}
+
+void rangemap_remove_node(rangemap rm, rmnode z)
+{
+    rmnode x, xp;
+    boolean removed_red;
+
+    if (z->left && z->right) {
+        /* splice in the successor, which has no left child */
+        rmnode y = tree_min(z->right);
+        removed_red = y->red;
+        x = y->right;
+        if (y->parent == z) {
+            xp = y;
+        } else {
+            xp = y->parent;
+            transplant(rm, y, x);
+            y->right = z->right;
+            y->right->parent = y;
+        }
+        transplant(rm, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->red = z->red;
+    } else {
+        removed_red = z->red;
+        x = z->left ? z->left : z->right;
+        xp = z->parent;
+        transplant(rm, z, x);
+    }
+
+    if (!removed_red)
+        remove_fixup(rm, x, xp);
+    z->parent = z->left = z->right = 0;
+}
+
+rmnode rangemap_first_node(rangemap rm)
+{
+    return rm->root ? tree_min(rm->root) : INVALID_ADDRESS;
+}
+
+rmnode rangemap_next_node(rangemap rm, rmnode n)
+{
+    if (n->right)
+        return tree_min(n->right);
+    while (n->parent && n == n->parent->right)
+        n = n->parent;
+    return n->parent ? n->parent : INVALID_ADDRESS;
+}
+
+rmnode rangemap_prev_node(rangemap rm, rmnode n)
+{
+    if (n->left)
+        return tree_max(n->left);
+    while (n->parent && n == n->parent->left)
+        n = n->parent;
+    return n->parent ? n->parent : INVALID_ADDRESS;
+}
+
 boolean rangemap_insert(rangemap rm, rmnode n)
 {
-    list_foreach(&rm->root, l) {
-        rmnode curr = struct_from_list(l, rmnode, l);
+    rmnode parent = 0;
+    rmnode *link = &rm->root;
+
+    /* the in-order neighbors of the insertion point are all on the
+       descent path, so checking each visited node catches any overlap */
+    while (*link) {
+        rmnode curr = *link;
         range i = range_intersection(curr->r, n->r);
         if (range_span(i)) {
             /* XXX bark for now until we know we have all potential cases handled... */
             msg_warn("attempt to insert %p (%R) but overlap with %p (%R)\n", n, n->r, curr, curr->r);
             return false;
         }
-        if (curr->r.start > n->r.start) {
-            list_insert_before(l, &n->l);
-            return true;
-        }
+        parent = curr;
+        link = n->r.start < curr->r.start ? &curr->left : &curr->right;
     }
-    list_insert_before(&rm->root, &n->l);
+
+    n->parent = parent;
+    n->left = n->right = 0;
+    n->red = true;
+    *link = n;
+    insert_fixup(rm, n);
     return true;
 }
 
@@ -29,16 +266,15 @@ boolean rangemap_reinsert(rangemap rm, rmnode n, range k)
 boolean rangemap_remove_range(rangemap rm, range k)
 {
     boolean match = false;
-    list l = list_get_next(&rm->root);
+    rmnode curr = rangemap_lookup_at_or_next(rm, k.start);
 
-    while (l && l != &rm->root) {
-        rmnode curr = struct_from_list(l, rmnode, l);
-        list next = list_get_next(l);
+    while (curr != INVALID_ADDRESS && curr->r.start < k.end) {
+        rmnode next = rangemap_next_node(rm, curr);
         range i = range_intersection(curr->r, k);
 
         /* no intersection */
         if (range_empty(i)) {
-            l = next;
+            curr = next;
             continue;
         }
 
@@ -47,10 +283,13 @@ boolean rangemap_remove_range(rangemap rm, range k)
         /* complete overlap (delete) */
         if (range_equal(curr->r, i)) {
             rangemap_remove_node(rm, curr);
-            l = next;
+            curr = next;
             continue;
         }
 
+        /* Trims below never move a node past its neighbors, so the
+           tree ordering is preserved without reinsertion. */
+
         /* check for tail trim */
         if (curr->r.start < i.start) {
             /* check for hole */
@@ -67,14 +306,14 @@ boolean rangemap_remove_range(rangemap rm, range k)
                 rn->r.end = curr->r.end;
                 rn->value = curr->value; /* XXX this is perhaps most dubious */
                 msg_warn("unexpected hole trim: curr %R, key %R\n", curr->r, k);
-                list_insert_after(l, &rn->l);
+                rangemap_insert(rm, rn);
 #endif
             }
             curr->r.end = i.start;
         } else if (curr->r.end > i.end) { /* head trim */
             curr->r.start = i.end;
         }
-        l = next;               /* valid even if we inserted one */
+        curr = next;
     }
 
     return match;
@@ -82,10 +321,14 @@ boolean rangemap_remove_range(rangemap rm, range k)
 
 rmnode rangemap_lookup(rangemap rm, u64 point)
 {
-    list_foreach(&rm->root, i) {
-        rmnode curr = struct_from_list(i, rmnode, l);
-        if (point_in_range(curr->r, point))
+    rmnode curr = rm->root;
+    while (curr) {
+        if (point < curr->r.start)
+            curr = curr->left;
+        else if (point < curr->r.end)
             return curr;
+        else
+            curr = curr->right;
     }
     return INVALID_ADDRESS;
 }
@@ -93,21 +336,32 @@ rmnode rangemap_lookup(rangemap rm, u64 point)
 /* return either an exact match or the neighbor to the right */
 rmnode rangemap_lookup_at_or_next(rangemap rm, u64 point)
 {
-    list_foreach(&rm->root, i) {
-        rmnode curr = struct_from_list(i, rmnode, l);
-        if (point_in_range(curr->r, point) ||
-            curr->r.start > point)
+    rmnode curr = rm->root;
+    rmnode next = INVALID_ADDRESS;
+    while (curr) {
+        if (point < curr->r.start) {
+            next = curr;
+            curr = curr->left;
+        } else if (point < curr->r.end) {
             return curr;
+        } else {
+            curr = curr->right;
+        }
     }
-    return INVALID_ADDRESS;
+    return next;
 }
 
-/* can be called with rh == 0 for true/false match */
+/* can be called with rh == 0 for true/false match
+
+   The handler may reinsert the node it is given or insert new nodes;
+   as with the former list walk, the successor is taken before the
+   handler runs, so nodes inserted behind it are not visited. */
 boolean rangemap_range_lookup(rangemap rm, range q, rmnode_handler nh)
 {
     boolean match = false;
-    list_foreach(&rm->root, i) {
-        rmnode curr = struct_from_list(i, rmnode, l);
+    rmnode curr = rangemap_lookup_at_or_next(rm, q.start);
+    while (curr != INVALID_ADDRESS && curr->r.start < q.end) {
+        rmnode next = rangemap_next_node(rm, curr);
         range i = range_intersection(curr->r, q);
 
         if (!range_empty(i)) {
@@ -116,6 +370,7 @@ boolean rangemap_range_lookup(rangemap rm, range q, rmnode_handler nh)
                 return true;
             apply(nh, curr);
         }
+        curr = next;
     }
     return match;
 }
@@ -124,8 +379,8 @@ boolean rangemap_range_find_gaps(rangemap rm, range q, range_handler rh)
 {
     boolean match = false;
     u64 lastedge = q.start;
-    list_foreach(&rm->root, l) {
-        rmnode curr = struct_from_list(l, rmnode, l);
+    rmnode curr = rangemap_lookup_at_or_next(rm, q.start);
+    while (curr != INVALID_ADDRESS && curr->r.start < q.end) {
         u64 edge = curr->r.start;
         range i = range_intersection(irange(lastedge, edge), q);
         if (range_span(i)) {
@@ -133,6 +388,7 @@ boolean rangemap_range_find_gaps(rangemap rm, range q, range_handler rh)
             apply(rh, i);
         }
         lastedge = curr->r.end;
+        curr = rangemap_next_node(rm, curr);
     }
 
     /* check for a gap between the last node and q.end */
@@ -147,13 +403,13 @@ boolean rangemap_range_find_gaps(rangemap rm, range q, range_handler rh)
 rangemap allocate_rangemap(heap h)
 {
     rangemap rm = allocate(h, sizeof(struct rangemap));
+    if (rm == INVALID_ADDRESS)
+        return rm;
     rm->h = h;
-    list_init(&rm->root);
+    rm->root = 0;
     return rm;
 }
 
 void deallocate_rangemap(rangemap r)
 {
 }
-
-
@@ -1,7 +1,11 @@
 #pragma once
+/* Ranges are kept in a red-black tree ordered by range start. Since
+   ranges in a map never overlap, ordering by start alone is enough to
+   find the node containing a point, or all nodes intersecting a
+   range, in O(log n). */
 typedef struct rangemap {
     heap h;
-    struct list root;
+    struct rmnode *root;
 } *rangemap;
 
 // [start, end)
@@ -11,7 +15,10 @@ typedef struct range {
 
 typedef struct rmnode {
     range r;
-    struct list l;
+    struct rmnode *parent;
+    struct rmnode *left;
+    struct rmnode *right;
+    boolean red;
 } *rmnode;
 
 #define irange(__s, __e)  (range){__s, __e}        
@@ -28,6 +35,10 @@ rmnode rangemap_lookup(rangemap rm, u64 point);
 rmnode rangemap_lookup_at_or_next(rangemap rm, u64 point);
 boolean rangemap_range_lookup(rangemap rm, range q, rmnode_handler nh);
 boolean rangemap_range_find_gaps(rangemap rm, range q, range_handler rh);
+void rangemap_remove_node(rangemap rm, rmnode n);
+rmnode rangemap_first_node(rangemap rm);
+rmnode rangemap_next_node(rangemap rm, rmnode n);
+rmnode rangemap_prev_node(rangemap rm, rmnode n);
 rangemap allocate_rangemap(heap h);
 void deallocate_rangemap(rangemap rm);
 
@@ -44,34 +55,8 @@ static inline void rmnode_set_range(rmnode n, range r)
 static inline void rmnode_init(rmnode n, range r)
 {
     rmnode_set_range(n, r);
-    list_init(&n->l);
-}
-
-static inline rmnode rangemap_prev_node(rangemap rm, rmnode n)
-{
-    if (n->l.prev == &rm->root)
-        return INVALID_ADDRESS;
-    return struct_from_list(n->l.prev, rmnode, l);
-}
-
-static inline rmnode rangemap_next_node(rangemap rm, rmnode n)
-{
-    if (n->l.next == &rm->root)
-        return INVALID_ADDRESS;
-    return struct_from_list(n->l.next, rmnode, l);
-}
-
-static inline rmnode rangemap_first_node(rangemap rm)
-{
-    if (rm->root.next == &rm->root)
-        return INVALID_ADDRESS;
-    else
-        return struct_from_list(rm->root.next, rmnode, l);
-}
-
-static inline void rangemap_remove_node(rangemap rm, rmnode n)
-{
-    list_delete(&n->l);
+    n->parent = n->left = n->right = 0;
+    n->red = false;
 }
 
 static inline range range_intersection(range a, range b)
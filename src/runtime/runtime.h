@@ -167,6 +167,8 @@ physical physical_from_virtual(void *x);
 void dump_ptes(void *x);
 void update_map_flags(u64 vaddr, u64 length, u64 flags);
 void zero_mapped_pages(u64 vaddr, u64 length);
+typedef closure_type(mapping_handler, void, u64 /* vaddr */, physical, u64 /* pte flags */);
+void foreach_mapped_page(u64 vaddr, u64 length, mapping_handler mh);
 void unmap_pages_with_handler(u64 virtual, u64 length, range_handler rh);
 static inline void unmap_pages(u64 virtual, u64 length)
 {
@@ -174,6 +176,9 @@ static inline void unmap_pages(u64 virtual, u64 length)
 }
 
 void remap_pages(u64 vaddr_new, u64 vaddr_old, u64 length, heap h);
+boolean fat_region_free(u64 vaddr);
+u64 split_fat_pages(u64 vaddr, u64 length, heap h);
+u64 split_fat_boundaries(u64 vaddr, u64 length, heap h);
 
 typedef closure_type(buffer_handler, void, buffer);
 typedef closure_type(block_io, void, void *, range, status_handler);
@@ -1,26 +1,40 @@
 #include <runtime.h>
 
 #define EMPTY ((void *)0)
+#define DELETED INVALID_ADDRESS
+
+#define TABLE_MIN_BUCKETS 8
+
+/* slots of the old array drained on each insert while resizing */
+#define TABLE_MIGRATE_STEP 16
+
+/* Probe chains are terminated by a never-used slot, so live and
+   deleted slots together are kept below 3/4 of the array. */
+static inline boolean over_threshold(int used, int buckets)
+{
+    return used * 4 > buckets * 3;
+}
+
+/* Past 5/8, the next array is allocated and cleared a piece at a time
+   by each insert, to be ready by the time the threshold is reached. */
+static inline boolean over_prepare_threshold(int used, int buckets)
+{
+    return used * 8 > buckets * 5;
+}
 
 void table_check(table t, char *n)
 {
-    void *last;
-    for(int i = 0; i<t->buckets; i++){
-        entry j = t->entries[i];
-        last = j;
-        while(j) {
-            if (j == INVALID_ADDRESS) {
-                rprintf("badness 8000 %p %s %p\n", t, n, last);
-                //rprintf("build: %p\n", __builtin_return_address(1));
-                halt("zig why no format");
-            }
-            last = j;
-            j = j->next;
-        }
+    int live = 0;
+    for (int i = 0; i < table_slots(t); i++) {
+        if (table_slot(t, i))
+            live++;
+    }
+    if (live != t->count) {
+        rprintf("badness 8000 %p %s count %d live %d\n", t, n, t->count, live);
+        halt("table count mismatch");
     }
 }
 
-
 table allocate_table(heap h, u64 (*key_function)(void *x), boolean (*equals_function)(void *x, void *y))
 {
     table new = allocate(h, sizeof(struct table));
@@ -28,86 +42,184 @@ table allocate_table(heap h, u64 (*key_function)(void *x), boolean (*equals_func
     table t = tablev(new);
     t->h = h;
     t->count = 0;
-    t->buckets = 4;
-    t->entries = allocate_zero(h, t->buckets * sizeof(void *));
+    t->used = 0;
+    t->buckets = TABLE_MIN_BUCKETS;
+    t->entries = allocate_zero(h, t->buckets * sizeof(struct entry));
+    if (t->entries == INVALID_ADDRESS) halt("allocate table entries failed\n");
+    t->old_entries = 0;
+    t->old_buckets = 0;
+    t->migrate_index = 0;
+    t->next_entries = 0;
+    t->next_buckets = 0;
+    t->zero_index = 0;
     t->key_function = key_function;
     t->equals_function = equals_function;
     return(new);
 }
 
+void deallocate_table(table z)
+{
+    table t = valueof(z);
+    if (t->old_entries)
+        deallocate(t->h, t->old_entries, t->old_buckets * sizeof(struct entry));
+    if (t->next_entries)
+        deallocate(t->h, t->next_entries, t->next_buckets * sizeof(struct entry));
+    deallocate(t->h, t->entries, t->buckets * sizeof(struct entry));
+    deallocate(t->h, t, sizeof(struct table));
+}
+
+/* Fibonacci hashing: identity keys have their low bits driven to zero
+   by alignment, which would otherwise cluster badly under linear
+   probing. */
 static inline key position(int buckets, key x)
 {
-    return(x&(buckets-1));
+    return((x * 0x9e3779b97f4a7c15ull) >> 32) & (buckets - 1);
 }
 
+static entry find_entry(table t, entry entries, int buckets, key k, void *c)
+{
+    for (key p = position(buckets, k); ; p = (p + 1) & (buckets - 1)) {
+        entry e = entries + p;
+        if (e->v == EMPTY) {
+            if (e->c != DELETED)
+                return 0;
+        } else if (e->k == k && t->equals_function(e->c, c)) {
+            return e;
+        }
+    }
+}
 
 void *table_find (table z, void *c)
 {
     table t = valueof(z);
     assert(t);
     key k = t->key_function(c);
-    for (entry i = t->entries[position(t->buckets, k)]; i; i = i->next){
-        if ((i->k == k) && t->equals_function(i->c, c))
-            return(i->v);
-    }
-    return(EMPTY);
+    entry e = find_entry(t, t->entries, t->buckets, k, c);
+    if (!e && t->old_entries)
+        e = find_entry(t, t->old_entries, t->old_buckets, k, c);
+    return e ? e->v : EMPTY;
 }
 
+/* place a key known to be absent from the table */
+static void insert_entry(table t, key k, void *c, void *v)
+{
+    key p = position(t->buckets, k);
+    entry e;
+    while ((e = t->entries + p)->v != EMPTY)
+        p = (p + 1) & (t->buckets - 1);
+    if (e->c != DELETED)
+        t->used++;
+    e->k = k;
+    e->c = c;
+    e->v = v;
+}
 
-static void resize_table(table z, int buckets)
+/* A migrated slot is left deleted rather than empty, so that probe
+   chains through it still reach the entries yet to move. */
+static void migrate_entries(table t, int slots)
 {
-    table t = valueof(z);
-    entry *nentries = allocate_zero(t->h, buckets * sizeof(void *));
-    for(int i = 0; i<t->buckets; i++){
-        entry j = t->entries[i];
-        while(j) {
-            entry n = j->next;
-            key km = position(buckets, j->k);
-            j->next = nentries[km];
-            nentries[km] = j;
-            j = n;
+    while (slots-- > 0 && t->migrate_index < t->old_buckets) {
+        entry e = t->old_entries + t->migrate_index++;
+        if (e->v != EMPTY) {
+            insert_entry(t, e->k, e->c, e->v);
+            e->c = DELETED;
+            e->v = EMPTY;
         }
     }
-    t->entries = nentries;
-    t->buckets = buckets;
-    table_check(t, "resize");
+    if (t->migrate_index == t->old_buckets) {
+        deallocate(t->h, t->old_entries, t->old_buckets * sizeof(struct entry));
+        t->old_entries = 0;
+        t->old_buckets = 0;
+        t->migrate_index = 0;
+    }
+}
+
+/* Size the new array to be at most 3/8 full once all live entries
+   have moved over, leaving room for the migration to finish well
+   before it needs to resize again. This shrinks tables left mostly
+   empty by deletions. */
+static void prepare_resize(table t)
+{
+    /* allowing for the inserts made while it is cleared */
+    int count = t->count + t->buckets / 8 + 1;
+    int buckets = TABLE_MIN_BUCKETS;
+    while (count * 8 > buckets * 3)
+        buckets <<= 1;
+
+    t->next_entries = allocate(t->h, buckets * sizeof(struct entry));
+    if (t->next_entries == INVALID_ADDRESS)
+        halt("couldn't allocate table entries\n");
+    t->next_buckets = buckets;
+    t->zero_index = 0;
+}
+
+/* Clear enough of the next array to have it done by the time the
+   current one reaches the threshold. */
+static void zero_next_entries(table t, boolean all)
+{
+    int left = t->next_buckets - t->zero_index;
+    int inserts = t->buckets * 3 / 4 - t->used;
+    int n = (all || inserts <= 1) ? left : MIN(left, (left + inserts - 1) / inserts);
+    zero(t->next_entries + t->zero_index, n * sizeof(struct entry));
+    t->zero_index += n;
+}
+
+static void install_next_entries(table t)
+{
+    assert(!t->old_entries && t->zero_index == t->next_buckets);
+    t->old_entries = t->entries;
+    t->old_buckets = t->buckets;
+    t->migrate_index = 0;
+    t->entries = t->next_entries;
+    t->buckets = t->next_buckets;
+    t->used = 0;
+    t->next_entries = 0;
+    t->next_buckets = 0;
+    t->zero_index = 0;
+}
+
+/* Called ahead of each insert of a new key. Only one migration is in
+   flight at a time, so should the threshold be reached with one still
+   going, it is finished here. */
+static void table_grow_step(table t)
+{
+    boolean full = over_threshold(t->used + 1, t->buckets);
+    if (t->old_entries) {
+        migrate_entries(t, full ? t->old_buckets : TABLE_MIGRATE_STEP);
+        if (!full)
+            return;
+    }
+    if (!t->next_entries) {
+        if (!full && !over_prepare_threshold(t->used + 1, t->buckets))
+            return;
+        prepare_resize(t);
+    }
+    zero_next_entries(t, full);
+    if (t->zero_index == t->next_buckets)
+        install_next_entries(t);
 }
 
 void table_set (table z, void *c, void *v)
 {
     table t = valueof(z);
-    //    rprintf("set: %p %p %p\n", z, t->entries, __builtin_return_address(0));
     key k = t->key_function(c);
-    key p = position(t->buckets, k);
-    entry *e = t->entries + p;
-    for (; *e; e = &(*e)->next) {
-        if (((*e)->k == k) && t->equals_function((*e)->c, c)) {
-            if (v == EMPTY) {
-                t->count--;
-                entry z = *e;
-                *e = (*e)->next;
-                table_check(t, "remove");
-                deallocate(t->h, z, sizeof(struct entry));
-            } else (*e)->v = v;
-            return;
+    entry e = find_entry(t, t->entries, t->buckets, k, c);
+    if (!e && t->old_entries)
+        e = find_entry(t, t->old_entries, t->old_buckets, k, c);
+
+    if (e) {
+        if (v == EMPTY) {
+            t->count--;
+            e->c = DELETED;
         }
+        e->v = v;
+        return;
     }
 
     if (v != EMPTY) {
-        // xxx - shouldnt need to zero - messing about
-        entry n = valueof(allocate_zero(t->h, sizeof(struct entry)));
-
-        if (n == INVALID_ADDRESS) {
-            halt("couldn't allocate table entry\n");
-        }
-
-        n->k = k;
-        n->c = c; 
-        n->v = v;
-        *e = n;
-        
-        if (t->count++ > t->buckets) 
-            resize_table(t, t->buckets*2);
+        table_grow_step(t);
+        insert_entry(t, k, c, v);
+        t->count++;
     }
 }
 
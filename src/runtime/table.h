@@ -4,21 +4,37 @@ typedef struct table *table;
 typedef u64 key;
 
 table allocate_table(heap h, key (*key_function)(void *x), boolean (*equal_function)(void *x, void *y));
+void deallocate_table(table t);
 int table_elements(table t);
 
 
+/* Open addressing with linear probing; entries are stored inline in
+   the slot array. A slot is live when v is non-empty. A deleted slot
+   keeps c set to INVALID_ADDRESS so that probe chains stay intact.
+
+   Growth is incremental: once the array is 5/8 full, each insert
+   clears a piece of the next slot array. That is installed once
+   cleared, leaving the previous one in old_entries, from which each
+   subsequent insert migrates a few slots until it is drained and
+   freed. */
 typedef struct entry {
-    void *v;
     key k;
     void *c;
-    struct entry *next;        
+    void *v;
 } *entry;
 
 struct table {
     heap h;
     int buckets;
     int count;
-    entry *entries;
+    int used;                   /* live or deleted slots in entries */
+    entry entries;
+    entry old_entries;
+    int old_buckets;
+    int migrate_index;
+    entry next_entries;         /* being cleared, not yet in use */
+    int next_buckets;
+    int zero_index;
     key (*key_function)(void *x);
     boolean (*equals_function)(void *x, void *y);
 };
@@ -30,12 +46,26 @@ void table_set (table t, void *c, void *v);
 #define eZ(x,y) ((entry) x)->y
 
 #define tablev(__z) ((table)valueof(__z))
-// much threadsafe...think about start
+
+static inline int table_slots(table t)
+{
+    return t->buckets + (t->old_entries ? t->old_buckets : 0);
+}
+
+/* return the live entry at slot index i, spanning both slot arrays */
+static inline entry table_slot(table t, int i)
+{
+    entry e = i < t->buckets ? t->entries + i : t->old_entries + (i - t->buckets);
+    return e->v ? e : 0;
+}
+
+/* Removing entries (table_set with a zero value) within the loop
+   body is safe; inserting new keys is not. */
 #define table_foreach(__t, __k, __v)\
-    for (int __i = 0 ; __i< tablev(__t)->buckets; __i++) \
-        for (void *__k, *__v, *__j = (tablev(__t)->entries[__i]), *__next;    \
-             __j && (__next =  eZ((__j), next) , __k = eZ(__j, c), __v = eZ(__j, v)); \
-             __j = __next)
+    for (int __i = 0 ; __i < table_slots(tablev(__t)); __i++) \
+        for (void *__k, *__v, *__j = table_slot(tablev(__t), __i);    \
+             __j && (__k = eZ(__j, c), __v = eZ(__j, v));                \
+             __j = 0)
 
 static inline boolean pointer_equal(void *a, void* b)
 {
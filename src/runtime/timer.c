@@ -6,83 +6,267 @@
 #define timer_debug(x, ...)
 #endif
 
+/* Timers are kept on a hierarchical wheel. Expiry times are counted in
+   ticks of 2^TIMER_TICK_ORDER timestamp units, about 15us. Level 0 has
+   a slot for each of the next 64 ticks, and each level above has 64
+   slots of 64 times the span of those below. A timer goes in the lowest
+   level whose current span holds its expiry, and is cascaded down as
+   the wheel comes around to its slot, so insertion and removal are
+   constant time and a timer fires within a tick of its expiry.
+
+   A bitmap per level marks the slots in use. The next expiry is found
+   from these without walking empty slots, and the wheel jumps straight
+   over idle stretches, so nothing needs to run between expiries. */
+
+#define TIMER_TICK_ORDER        16
+#define TIMER_LEVEL_ORDER       6
+#define TIMER_LEVEL_SLOTS       (1 << TIMER_LEVEL_ORDER)
+#define TIMER_LEVELS            8       /* covers the rest of a timestamp */
+
+/* slot values for timers off the wheel */
+#define TIMER_EXPIRED           (-1)
+#define TIMER_FIRING            (-2)
+
 struct timer {
+    struct list l;
     thunk t;
     timestamp w;
     timestamp interval;
+    timestamp slack;
+    u64 tick;
+    int slot;
     boolean disable;
 };
 
-// should pass a timer around
-static pqueue timers;
+static struct list wheel[TIMER_LEVELS * TIMER_LEVEL_SLOTS];
+static u64 occupied[TIMER_LEVELS];
+static u64 wheel_tick;          /* ticks before this have been serviced */
+static timestamp armed;         /* expiry last handed out by timer_next */
+static boolean rearm;
 static heap theap;
 
-/* The lower time expiry is the higher priority. */
-static boolean timer_compare(void *za, void *zb)
+/* Of the times within [w, w + slack], take the one with the most low
+   zero bits, so that timers with overlapping windows share a tick. */
+static timestamp timer_coalesce(timestamp w, timestamp slack)
 {
-    timer a = za;
-    timer b = zb;
-    return(a->w > b->w);
+    timestamp end = w + slack;
+    if (slack == 0 || w == 0)
+        return w;
+    if (end < w)
+        end = infinity;
+    return end & ~MASK(msb((w - 1) ^ end));
 }
 
-void remove_timer(timer t)
+static void timer_set_expiry(timer t)
 {
-    t->disable = true;
+    timestamp e = timer_coalesce(t->w, t->slack);
+    t->tick = e > infinity - MASK(TIMER_TICK_ORDER) ? infinity >> TIMER_TICK_ORDER :
+        (e + MASK(TIMER_TICK_ORDER)) >> TIMER_TICK_ORDER;
 }
 
-timer register_timer(timestamp interval, thunk n)
+static boolean wheel_empty(void)
 {
-    timer t=(timer)allocate(theap, sizeof(struct timer));
+    for (int level = 0; level < TIMER_LEVELS; level++)
+        if (occupied[level])
+            return false;
+    return true;
+}
 
-    t->t= n;
-    t->interval = 0;
-    t->disable = false;
-    t->w = now() + interval;
-    pqueue_insert(timers, t);
-    timer_debug("register one-shot timer: %p %p\n", t, t->interval);
-    return(t);
+static void timer_insert(timer t)
+{
+    u64 tick = MAX(t->tick, wheel_tick);
+    int level = tick == wheel_tick ? 0 : (int)msb(tick ^ wheel_tick) / TIMER_LEVEL_ORDER;
+    int slot = (tick >> (level * TIMER_LEVEL_ORDER)) & MASK(TIMER_LEVEL_ORDER);
+    t->slot = level * TIMER_LEVEL_SLOTS + slot;
+    list_push_back(&wheel[t->slot], &t->l);
+    occupied[level] |= U64_FROM_BIT(slot);
+    if ((t->tick << TIMER_TICK_ORDER) < armed)
+        rearm = true;
 }
 
-timer register_periodic_timer(timestamp interval, thunk n)
+static void timer_unlink(timer t)
+{
+    list_delete(&t->l);
+    if (t->slot >= 0 && list_empty(&wheel[t->slot]))
+        occupied[t->slot / TIMER_LEVEL_SLOTS] &= ~U64_FROM_BIT(t->slot % TIMER_LEVEL_SLOTS);
+}
+
+/* The lowest level in use holds the earliest timers. Returns the slot
+   index, or -1 if the wheel is empty. */
+static int wheel_first_slot(u64 *tick)
+{
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        int shift = level * TIMER_LEVEL_ORDER;
+        u64 cur = (wheel_tick >> shift) & MASK(TIMER_LEVEL_ORDER);
+        u64 pending = occupied[level] & ~MASK(cur);
+        if (pending) {
+            u64 slot = msb(pending & -pending);
+            *tick = ((wheel_tick >> (shift + TIMER_LEVEL_ORDER)) << (shift + TIMER_LEVEL_ORDER)) |
+                (slot << shift);
+            return level * TIMER_LEVEL_SLOTS + slot;
+        }
+    }
+    return -1;
+}
+
+static void wheel_cascade(int slot)
+{
+    struct list *head = &wheel[slot];
+    occupied[slot / TIMER_LEVEL_SLOTS] &= ~U64_FROM_BIT(slot % TIMER_LEVEL_SLOTS);
+    while (!list_empty(head)) {
+        timer t = struct_from_list(list_begin(head), timer, l);
+        list_delete(&t->l);
+        timer_insert(t);
+    }
+}
+
+/* Move the wheel up to tick, which must not pass the next event, and
+   bring down any slot whose span starts there. */
+static void wheel_move(u64 tick)
+{
+    wheel_tick = tick;
+    for (int level = TIMER_LEVELS - 1; level > 0; level--) {
+        int shift = level * TIMER_LEVEL_ORDER;
+        if ((tick & MASK(shift)) == 0)
+            wheel_cascade(level * TIMER_LEVEL_SLOTS + ((tick >> shift) & MASK(TIMER_LEVEL_ORDER)));
+    }
+}
+
+/* Fire the level 0 slot at wheel_tick. The wheel moves on first so
+   that timers set from the handlers go in a later slot. */
+static void wheel_expire_tick(void)
+{
+    struct list expired;
+    struct list *head = &wheel[wheel_tick & MASK(TIMER_LEVEL_ORDER)];
+    list_init(&expired);
+    occupied[0] &= ~U64_FROM_BIT(wheel_tick & MASK(TIMER_LEVEL_ORDER));
+    while (!list_empty(head)) {
+        timer t = struct_from_list(list_begin(head), timer, l);
+        list_delete(&t->l);
+        list_push_back(&expired, &t->l);
+        t->slot = TIMER_EXPIRED;
+    }
+    wheel_move(wheel_tick + 1);
+
+    while (!list_empty(&expired)) {
+        timer t = struct_from_list(list_begin(&expired), timer, l);
+        list_delete(&t->l);
+        t->slot = TIMER_FIRING;
+        apply(t->t);
+        if (t->interval && !t->disable) {
+            t->w += t->interval;
+            timer_set_expiry(t);
+            timer_insert(t);
+        } else {
+            deallocate(theap, t, sizeof(struct timer));
+        }
+    }
+}
+
+static timer timer_add(timestamp here, timestamp w, timestamp interval, timestamp slack, thunk n)
 {
-    timer t=(timer)allocate(theap, sizeof(struct timer));
+    timer t = allocate(theap, sizeof(struct timer));
+    if (t == INVALID_ADDRESS)
+        return t;
     t->t = n;
+    t->w = w;
+    t->interval = interval;
+    t->slack = slack;
     t->disable = false;
-    t->interval = interval;    
-    t->w = now() + t->interval;
-    pqueue_insert(timers, t);
-    timer_debug("register periodic %p %p\n", t, t->interval);
-    return(t);
+    timer_set_expiry(t);
+    if (wheel_empty())
+        wheel_tick = MAX(wheel_tick, here >> TIMER_TICK_ORDER);
+    timer_insert(t);
+    return t;
 }
 
-/* Presently called with ints off. Address thread safety with
-   pqueue before using with ints enabled.
-*/
-timestamp timer_check()
+/* A timer is freed once removed, or after a one-shot timer fires, so
+   its owner must drop any reference from the handler. */
+void remove_timer(timer t)
 {
-    timestamp here = 0;
-    timer t = 0;
-
-    while ((t = pqueue_peek(timers)) &&
-           (here = now(), t->w < here)) {
-            pqueue_pop(timers);
-            if(!t->disable) {
-                apply(t->t);
-                if (t->interval) {
-                    t->w += t->interval;
-                    pqueue_insert(timers, t);
-                }
-            } else {
-                deallocate(theap, t, sizeof(struct timer));
-                t = 0;
-            }
-        }
-    if (t) {
-    	timestamp dt = t->w - here;
-    	timer_debug("check returning dt: %d\n", dt);
-    	return dt;
+    if (t->slot == TIMER_FIRING) {
+        t->disable = true;
+        return;
     }
-    return infinity;
+    timer_unlink(t);
+    deallocate(theap, t, sizeof(struct timer));
+}
+
+/* The handler may run up to slack after the interval, allowing it to
+   share a wakeup with timers nearby. */
+timer register_timer_slack(timestamp interval, timestamp slack, thunk n)
+{
+    timestamp here = now();
+    timer t = timer_add(here, here + interval, 0, slack, n);
+    timer_debug("register one-shot timer: %p %p slack %p\n", t, interval, slack);
+    return t;
+}
+
+timer register_timer(timestamp interval, thunk n)
+{
+    return register_timer_slack(interval, 0, n);
+}
+
+timer register_periodic_timer(timestamp interval, thunk n)
+{
+    timestamp here = now();
+    timer t = timer_add(here, here + interval, interval, 0, n);
+    timer_debug("register periodic %p %p\n", t, interval);
+    return t;
+}
+
+/* Time from here until the next expiry, or infinity if there are no
+   timers, for arming the runloop timer. */
+timestamp timer_next(timestamp here)
+{
+    u64 tick;
+    int slot = wheel_first_slot(&tick);
+    rearm = false;
+    if (slot < 0) {
+        armed = infinity;
+        return infinity;
+    }
+
+    /* above level 0 the slot start is only a cascade point */
+    if (slot >= TIMER_LEVEL_SLOTS) {
+        tick = infinity;
+        list_foreach(&wheel[slot], l)
+            tick = MIN(tick, struct_from_list(l, timer, l)->tick);
+    }
+    armed = tick << TIMER_TICK_ORDER;
+    timer_debug("next expiry at %T\n", armed);
+    return armed > here ? armed - here : 0;
+}
+
+/* Runs the timers due at here and returns the time to the next. */
+timestamp timer_service(timestamp here)
+{
+    u64 here_tick = here >> TIMER_TICK_ORDER;
+    u64 tick;
+
+    /* either a level 0 slot to fire or a span above to bring down */
+    while (wheel_first_slot(&tick) >= 0 && tick <= here_tick) {
+        if (tick == wheel_tick)
+            wheel_expire_tick();
+        else
+            wheel_move(tick);
+    }
+    if (wheel_tick <= here_tick)
+        wheel_move(here_tick + 1);
+    return timer_next(here);
+}
+
+/* Presently called with ints off. */
+timestamp timer_check()
+{
+    return timer_service(now());
+}
+
+/* Set when a timer is added ahead of what the runloop timer was last
+   armed for. */
+boolean timer_rearm_needed(void)
+{
+    return rearm;
 }
 
 timestamp parse_time(string b)
@@ -127,8 +311,9 @@ void print_timestamp(string b, timestamp t)
 
 void initialize_timers(kernel_heaps kh)
 {
-    heap h = heap_general(kh);
-    assert(!timers);
-    timers = allocate_pqueue(h, timer_compare);
-    theap = h;
+    assert(!theap);
+    for (int i = 0; i < TIMER_LEVELS * TIMER_LEVEL_SLOTS; i++)
+        list_init(&wheel[i]);
+    armed = infinity;
+    theap = heap_general(kh);
 }
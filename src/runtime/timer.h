@@ -3,12 +3,16 @@ typedef u64 timestamp;
 typedef struct timer *timer;
 
 timer register_timer(timestamp, thunk n);
+timer register_timer_slack(timestamp interval, timestamp slack, thunk n);
 timer register_periodic_timer(timestamp interval, thunk n);
 void remove_timer(timer t);
 void initialize_timers(kernel_heaps kh);
 timestamp parse_time();
 void print_timestamp(buffer, timestamp);
+timestamp timer_next(timestamp here);
+timestamp timer_service(timestamp here);
 timestamp timer_check();
+boolean timer_rearm_needed(void);
 void runloop_timer(timestamp duration);
 timestamp now();
 timestamp uptime();
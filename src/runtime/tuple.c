@@ -164,20 +164,26 @@ void encode_symbol(buffer dest, table dictionary, symbol s)
     }
 }
 
-void encode_tuple(buffer dest, table dictionary, tuple t);
-void encode_value(buffer dest, table dictionary, value v)
+static void encode_tuple_internal(buffer dest, table dictionary, tuple t, tuple_filter filter);
+
+static void encode_value_internal(buffer dest, table dictionary, value v, tuple_filter filter)
 {
     if (!v) {
         push_header(dest, immediate, type_buffer, 0);
     }
     else if (tagof(v) == tag_tuple) {
-        encode_tuple(dest, dictionary, (tuple)v);
+        encode_tuple_internal(dest, dictionary, (tuple)v, filter);
     } else {
         push_header(dest, immediate, type_buffer, buffer_length((buffer)v));
         push_buffer(dest, (buffer)v);
     }
 }
 
+void encode_value(buffer dest, table dictionary, value v)
+{
+    encode_value_internal(dest, dictionary, v, 0);
+}
+
 // could close over encoder!
 // these are special cases of a slightly more general scheme
 void encode_eav(buffer dest, table dictionary, tuple e, symbol a, value v)
@@ -201,15 +207,38 @@ void encode_eav(buffer dest, table dictionary, tuple e, symbol a, value v)
     encode_value(dest, dictionary, v);
 }
 
-// immediate only
-void encode_tuple(buffer dest, table dictionary, tuple t)
+static void encode_tuple_internal(buffer dest, table dictionary, tuple t, tuple_filter filter)
 {
-    push_header(dest, immediate, type_tuple, t->count);
+    u64 count = 0;
+    if (filter) {
+        table_foreach (t, n, v) {
+            if (apply(filter, t, n, v))
+                count++;
+        }
+    } else {
+        count = t->count;
+    }
+    push_header(dest, immediate, type_tuple, count);
     srecord(dictionary, t);
     table_foreach (t, n, v) {
+        if (filter && !apply(filter, t, n, v))
+            continue;
         encode_symbol(dest, dictionary, n);
-        encode_value(dest, dictionary, v);
-    }        
+        encode_value_internal(dest, dictionary, v, filter);
+    }
+}
+
+// immediate only
+void encode_tuple(buffer dest, table dictionary, tuple t)
+{
+    encode_tuple_internal(dest, dictionary, t, 0);
+}
+
+/* Encode t and everything reachable from it, leaving out the
+   attributes for which the filter returns false. */
+void encode_tuple_filtered(buffer dest, table dictionary, tuple t, tuple_filter filter)
+{
+    encode_tuple_internal(dest, dictionary, t, filter);
 }
 
 void init_tuples(heap h)
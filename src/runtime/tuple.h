@@ -10,6 +10,10 @@ void print_root(buffer b, tuple t);
 
 void encode_tuple(buffer dest, table dictionary, tuple t);
 
+/* return false to leave an attribute out of the encoding */
+typedef closure_type(tuple_filter, boolean, tuple, symbol, value);
+void encode_tuple_filtered(buffer dest, table dictionary, tuple t, tuple_filter filter);
+
 
 // h is for the bodies, the space for symbols and tuples are both implicit
 void *decode_value(heap h, tuple dictionary, buffer source);
@@ -28,6 +28,11 @@ struct fsfile {
     filesystem fs;
     u64 length;
     tuple md;
+    rangemap pages;             /* cached pages by file offset */
+    u64 ra_next;                /* offset a sequential read would resume at */
+    u64 ra_pages;               /* current read-ahead window */
+    boolean writeback;          /* page write-back in flight */
+    vector sync_waiters;        /* status_handlers awaiting write-back of all pages */
 };
 
 u64 fsfile_get_length(fsfile f)
@@ -63,6 +68,12 @@ static void filesystem_flush_log(filesystem fs)
     log_flush(fs->tl);
 }
 
+/* A window of zero, the default, writes the log out on every flush. */
+void filesystem_set_log_commit(filesystem fs, timestamp window, u64 bytes)
+{
+    log_set_commit(fs->tl, window, bytes);
+}
+
 /* XXX don't ignore status
        set fs dirty bit and flush at end of fs operation
 */
@@ -138,9 +149,8 @@ static fs_dma_buf fs_allocate_dma_buffer(filesystem fs, extent e, range i)
     u64 nblocks = padlength / blocksize;
     db->blocks = irange(start_block, start_block + nblocks);
 
-    /* determine power-of-2 allocation size */
-    u64 alloc_order = find_order(pad(padlength, fs->dma->pagesize));
-    db->alloc_size = 1ull << alloc_order;
+    /* whole pages, so a large read doesn't take up to twice its size */
+    db->alloc_size = pad(padlength, fs->dma->pagesize);
 #ifndef BOOT
     db->buf = allocate(fs->dma, db->alloc_size);
     if (db->buf == INVALID_ADDRESS) {
@@ -237,9 +247,20 @@ static void filesystem_read_complete(heap h, io_status_handler c, buffer b, stat
     unwrap_buffer(h, b);
 }
 
+#ifndef BOOT
+static void cache_read(filesystem fs, fsfile f, buffer target, u64 length, u64 offset,
+                       status_handler sh);
+#endif
+
 static void filesystem_read_internal(filesystem fs, fsfile f, buffer b, u64 length, u64 offset,
                                      status_handler sh)
 {
+#ifndef BOOT
+    if (fs->cache.limit) {
+        cache_read(fs, f, b, length, offset, sh);
+        return;
+    }
+#endif
     merge m = allocate_merge(fs->h, sh);
     status_handler k = apply_merge(m); // hold a reference until we're sure we've issued everything
     u64 file_length = fsfile_get_length(f);
@@ -350,7 +371,14 @@ static void fs_write_extent_read_block(filesystem fs, fs_dma_buf db, u64 offset_
     apply(fs->r, buf, r, sh);
 }
 
-static void fs_write_extent(filesystem fs, buffer source, merge m, range q, rmnode node)
+static CLOSURE_4_1(fs_write_extent, void,
+                   filesystem, buffer, merge, range,
+                   rmnode);
+static void fs_write_extent(filesystem fs,
+                            buffer source,
+                            merge m,
+                            range q,
+                            rmnode node)
 {
     range i = range_intersection(q, node->r);
     u64 source_offset = i.start - q.start;
@@ -400,6 +428,679 @@ static void fs_write_extent(filesystem fs, buffer source, merge m, range q, rmno
     fs_write_extent_aligned(fs, db, source_start, sh, STATUS_OK);
 }
 
+#ifndef BOOT
+/* Page cache
+
+   File data is cached in page-sized buffers, kept in each fsfile's
+   page map by file offset, so that repeated reads are served without
+   block I/O. All pages sit on one LRU list; when the cache would grow
+   past its limit, clean pages are reclaimed from the cold end and
+   dirty ones found on the way are queued for write-back.
+
+   Writes are copied into the cache and reach the disk on fsync, on
+   eviction or once dirty data exceeds half of the limit. Storage for
+   them isn't allocated until write-back, which covers a run of pages
+   at once, so that a file written in small pieces still gets large
+   extents. A limit of zero bypasses the cache. */
+
+#define CACHE_RA_MIN_PAGES 4
+#define CACHE_RA_MAX_PAGES 64
+#define CACHE_WRITEBACK_MAX_PAGES 64
+
+typedef struct cache_page {
+    struct rmnode node;         /* file range of the page */
+    struct list l;              /* position in fs->cache_lru */
+    fsfile f;
+    void *data;
+    vector waiters;             /* status_handlers awaiting fill */
+    boolean ready;              /* data is valid */
+    boolean dirty;
+    boolean writeback;          /* part of a write-back in flight */
+    u32 pins;                   /* references handed out by filesystem_get_pages */
+} *cache_page;
+
+static inline cache_page cache_lookup(fsfile f, u64 offset)
+{
+    return (cache_page)rangemap_lookup(f->pages, offset);
+}
+
+static inline void cache_touch(filesystem fs, cache_page p)
+{
+    list_delete(&p->l);
+    list_push_back(&fs->cache_lru, &p->l);
+}
+
+static void cache_add_waiter(filesystem fs, cache_page p, status_handler sh)
+{
+    if (!p->waiters)
+        p->waiters = allocate_vector(fs->h, 4);
+    vector_push(p->waiters, sh);
+}
+
+static void cache_wake(cache_page p, status s)
+{
+    vector w = p->waiters;
+    if (!w)
+        return;
+    p->waiters = 0;
+    status_handler sh;
+    vector_foreach(w, sh)
+        apply(sh, s);
+    deallocate_vector(w);
+}
+
+static void cache_drop_page(filesystem fs, cache_page p)
+{
+    rangemap_remove_node(p->f->pages, &p->node);
+    list_delete(&p->l);
+    if (p->dirty)
+        fs->cache.dirty -= PAGESIZE;
+    fs->cache.size -= PAGESIZE;
+    deallocate(fs->dma, p->data, PAGESIZE);
+    deallocate(fs->h, p, sizeof(struct cache_page));
+}
+
+static cache_page cache_first_dirty(fsfile f)
+{
+    for (rmnode n = rangemap_first_node(f->pages); n != INVALID_ADDRESS;
+         n = rangemap_next_node(f->pages, n)) {
+        if (((cache_page)n)->dirty)
+            return (cache_page)n;
+    }
+    return INVALID_ADDRESS;
+}
+
+static inline boolean cache_run_adjacent(cache_page p, rmnode n)
+{
+    return n != INVALID_ADDRESS && ((cache_page)n)->dirty &&
+        (n->r.end == p->node.r.start || n->r.start == p->node.r.end);
+}
+
+static void cache_writeback(filesystem fs, fsfile f, cache_page p);
+static boolean fill_holes(fsfile f, range q, merge m);
+
+static void cache_sync_continue(filesystem fs, fsfile f, status s)
+{
+    cache_page p;
+    if (is_ok(s) && (p = cache_first_dirty(f)) != INVALID_ADDRESS) {
+        cache_writeback(fs, f, p);
+        return;
+    }
+    vector w = f->sync_waiters;
+    f->sync_waiters = 0;
+    status_handler sh;
+    vector_foreach(w, sh)
+        apply(sh, s);
+    deallocate_vector(w);
+}
+
+/* A cached write extends the file in memory only. The length is logged
+   as far as the data below it has been written back, so that a file
+   found after a crash doesn't extend over holes where cached data was
+   lost. */
+static void cache_log_length(filesystem fs, fsfile f)
+{
+    u64 length = fsfile_get_length(f);
+    for (rmnode n = rangemap_first_node(f->pages); n != INVALID_ADDRESS && n->r.start < length;
+         n = rangemap_next_node(f->pages, n)) {
+        cache_page p = (cache_page)n;
+        if (p->dirty || p->writeback) {
+            length = n->r.start;
+            break;
+        }
+    }
+    value v = table_find(f->md, sym(filelength));
+    if (v && u64_from_value(v) >= length)
+        return;
+    v = value_from_u64(fs->h, length);
+    table_set(f->md, sym(filelength), v);
+    filesystem_write_eav(fs, f->md, sym(filelength), v, ignore_status);
+}
+
+static CLOSURE_4_1(cache_writeback_complete, void, filesystem, fsfile, vector, buffer, status);
+static void cache_writeback_complete(filesystem fs, fsfile f, vector run, buffer b, status s)
+{
+    tfs_debug("cache_writeback_complete: %d pages, status %v\n", vector_length(run), s);
+    if (!is_ok(s))
+        msg_err("write-back failed: %v\n", s);
+    cache_page p;
+    vector_foreach(run, p) {
+        p->writeback = false;
+        if (!is_ok(s) && !p->dirty) {
+            p->dirty = true;
+            fs->cache.dirty += PAGESIZE;
+        }
+    }
+    deallocate_vector(run);
+    deallocate_buffer(b);
+    f->writeback = false;
+    if (is_ok(s))
+        cache_log_length(fs, f);
+    if (f->sync_waiters)
+        cache_sync_continue(fs, f, s);
+}
+
+/* Write back the run of contiguous dirty pages around p. Neighboring
+   pages may share a disk block, and the read-modify-write of one would
+   race with a write to the other, so a file has at most one write-back
+   in flight. The run is copied out, leaving its pages free to take new
+   writes in the meantime. Extents are allocated for the parts of the
+   run that aren't yet backed by storage, whole pages at a time, as an
+   append may have dirtied a page before the file length takes it in.
+   Their records, and then the file length (cache_log_length), go out
+   with the next log flush, which fsync waits for once write-back is
+   done. */
+static void cache_writeback(filesystem fs, fsfile f, cache_page p)
+{
+    assert(!f->writeback);
+    cache_page first = p;
+    int npages = 1;
+    rmnode n;
+    while (npages < CACHE_WRITEBACK_MAX_PAGES &&
+           cache_run_adjacent(first, (n = rangemap_prev_node(f->pages, &first->node)))) {
+        first = (cache_page)n;
+        npages++;
+    }
+    for (cache_page last = p; npages < CACHE_WRITEBACK_MAX_PAGES &&
+             cache_run_adjacent(last, (n = rangemap_next_node(f->pages, &last->node)));
+         npages++)
+        last = (cache_page)n;
+
+    range q = irange(first->node.r.start, first->node.r.start + (npages << PAGELOG));
+    vector run = allocate_vector(fs->h, npages);
+    buffer b = allocate_buffer(fs->h, range_span(q));
+    n = &first->node;
+    for (int i = 0; i < npages; i++, n = rangemap_next_node(f->pages, n)) {
+        cache_page rp = (cache_page)n;
+        buffer_write(b, rp->data, PAGESIZE);
+        rp->dirty = false;
+        rp->writeback = true;
+        vector_push(run, rp);
+    }
+    fs->cache.dirty -= range_span(q);
+    fs->cache.writebacks += npages;
+    f->writeback = true;
+    tfs_debug("cache_writeback: %R\n", q);
+
+    merge m = allocate_merge(fs->h, closure(fs->h, cache_writeback_complete, fs, f, run, b));
+    status_handler k = apply_merge(m);
+    merge m_meta = allocate_merge(fs->h, ignore_status);
+    status_handler k_meta = apply_merge(m_meta);
+    if (!fill_holes(f, q, m_meta))
+        apply(apply_merge(m), timm("result", "unable to allocate extents"));
+    apply(k_meta, STATUS_OK);
+    rangemap_range_lookup(f->extentmap, q, closure(fs->h, fs_write_extent, fs, b, m, q));
+    apply(k, STATUS_OK);
+}
+
+/* Reclaim clean pages from the cold end of the LRU until another page
+   fits under the limit. Dirty pages are queued for write-back and
+   become reclaimable once it completes. */
+static void cache_evict(filesystem fs)
+{
+    list_foreach(&fs->cache_lru, l) {
+        if (fs->cache.size + PAGESIZE <= fs->cache.limit)
+            return;
+        cache_page p = struct_from_list(l, cache_page, l);
+        if (!p->ready || p->writeback || p->pins)
+            continue;
+        if (p->dirty) {
+            if (!p->f->writeback)
+                cache_writeback(fs, p->f, p);
+            continue;
+        }
+        cache_drop_page(fs, p);
+        fs->cache.evictions++;
+    }
+}
+
+/* start writing back the coldest dirty pages */
+static void cache_writeback_cold(filesystem fs)
+{
+    list_foreach(&fs->cache_lru, l) {
+        if (fs->cache.dirty <= fs->cache.limit / 4)
+            return;
+        cache_page p = struct_from_list(l, cache_page, l);
+        if (p->dirty && !p->f->writeback)
+            cache_writeback(fs, p->f, p);
+    }
+}
+
+static void cache_mark_dirty(filesystem fs, cache_page p)
+{
+    if (p->dirty)
+        return;
+    p->dirty = true;
+    fs->cache.dirty += PAGESIZE;
+    if (fs->cache.dirty > fs->cache.limit / 2)
+        cache_writeback_cold(fs);
+}
+
+/* The cache may briefly exceed its limit if nothing can be reclaimed. */
+static cache_page cache_alloc_page(filesystem fs, fsfile f, u64 offset)
+{
+    cache_evict(fs);
+    cache_page p = allocate(fs->h, sizeof(struct cache_page));
+    if (p == INVALID_ADDRESS)
+        return p;
+    p->data = allocate_zero(fs->dma, PAGESIZE);
+    if (p->data == INVALID_ADDRESS) {
+        msg_err("failed to allocate cache page\n");
+        deallocate(fs->h, p, sizeof(struct cache_page));
+        return INVALID_ADDRESS;
+    }
+    rmnode_init(&p->node, irange(offset, offset + PAGESIZE));
+    assert(rangemap_insert(f->pages, &p->node));
+    list_push_back(&fs->cache_lru, &p->l);
+    p->f = f;
+    p->waiters = 0;
+    p->ready = false;
+    p->dirty = false;
+    p->writeback = false;
+    p->pins = 0;
+    fs->cache.size += PAGESIZE;
+    return p;
+}
+
+static CLOSURE_6_1(cache_fill_extent_complete, void, filesystem, fs_dma_buf, vector, u64, range, status_handler, status);
+static void cache_fill_extent_complete(filesystem fs, fs_dma_buf db, vector run, u64 run_start, range i,
+                                       status_handler sh, status s)
+{
+    if (is_ok(s)) {
+        void *source = db->buf + db->start_offset;
+        u64 offset = i.start;
+        while (offset < i.end) {
+            cache_page p = vector_get(run, (offset - run_start) >> PAGELOG);
+            u64 page_offset = offset & MASK(PAGELOG);
+            u64 length = MIN(PAGESIZE - page_offset, i.end - offset);
+            runtime_memcpy(p->data + page_offset, source, length);
+            source += length;
+            offset += length;
+        }
+    }
+    fs_deallocate_dma_buffer(fs, db);
+    apply(sh, s);
+}
+
+static CLOSURE_4_1(cache_fill_extent, void, filesystem, vector, merge, range, rmnode);
+static void cache_fill_extent(filesystem fs, vector run, merge m, range q, rmnode node)
+{
+    range i = range_intersection(q, node->r);
+    fs_dma_buf db = fs_allocate_dma_buffer(fs, (extent)node, i);
+    if (db == INVALID_ADDRESS) {
+        apply(apply_merge(m), timm("result", "unable to allocate dma buffer"));
+        return;
+    }
+    tfs_debug("cache_fill_extent: q %R, ex %R, blocks %R\n", q, node->r, db->blocks);
+    apply(fs->r, db->buf, db->blocks, closure(fs->h, cache_fill_extent_complete,
+                                              fs, db, run, q.start, i, apply_merge(m)));
+}
+
+static CLOSURE_3_1(cache_fill_complete, void, filesystem, fsfile, vector, status);
+static void cache_fill_complete(filesystem fs, fsfile f, vector run, status s)
+{
+    cache_page p;
+    vector_foreach(run, p) {
+        /* extents may linger past a truncation */
+        u64 end = p->node.r.end;
+        u64 eof = MAX(p->node.r.start, fsfile_get_length(f));
+        if (eof < end)
+            runtime_memset(p->data + (eof - p->node.r.start), 0, end - eof);
+        p->ready = is_ok(s);
+        cache_wake(p, s);
+        if (!p->ready)
+            cache_drop_page(fs, p);
+    }
+    deallocate_vector(run);
+}
+
+/* Fill a run of contiguous, newly allocated pages with one block
+   request per extent. Holes are left as allocated, zeroed. */
+static void cache_fill_run(filesystem fs, fsfile f, vector run, u64 start)
+{
+    range q = irange(start, start + (vector_length(run) << PAGELOG));
+    merge m = allocate_merge(fs->h, closure(fs->h, cache_fill_complete, fs, f, run));
+    status_handler k = apply_merge(m);
+    rangemap_range_lookup(f->extentmap, q, closure(fs->h, cache_fill_extent, fs, run, m, q));
+    apply(k, STATUS_OK);
+}
+
+/* Sequential readers get a read-ahead window that doubles with each
+   consecutive read up to CACHE_RA_MAX_PAGES; a seek resets it. It is
+   only replenished once half of it has been consumed, so that
+   read-ahead goes out in large requests. Returns the page-aligned end
+   of the range to populate. */
+static u64 cache_readahead(fsfile f, range q)
+{
+    u64 end = pad(q.end, PAGESIZE);
+    if (q.start != f->ra_next) {
+        f->ra_pages = 0;
+    } else {
+        f->ra_pages = f->ra_pages ? MIN(f->ra_pages << 1, CACHE_RA_MAX_PAGES) :
+            CACHE_RA_MIN_PAGES;
+    }
+    f->ra_next = q.end;
+
+    u64 limit = pad(fsfile_get_length(f), PAGESIZE);
+    u64 mark = end + ((f->ra_pages >> 1) << PAGELOG);
+    if (f->ra_pages == 0 || (mark < limit && cache_lookup(f, mark) != INVALID_ADDRESS))
+        return end;
+    return MIN(end + (f->ra_pages << PAGELOG), limit);
+}
+
+/* Returns the handler to apply once a demand page is ready. */
+typedef closure_type(cache_page_handler, status_handler, cache_page, range);
+
+/* Look up or allocate the pages covering q, along with any read-ahead
+   pages up to end, and start filling the missing ones. Each demand page
+   is passed to ph with the part of q it holds. */
+static void cache_populate(filesystem fs, fsfile f, range q, u64 end, merge m,
+                           cache_page_handler ph)
+{
+    vector run = 0;
+    u64 run_start = 0;
+
+    for (u64 po = q.start & ~MASK(PAGELOG); po < end; po += PAGESIZE) {
+        boolean demand = po < q.end;
+        cache_page p = cache_lookup(f, po);
+        if (p == INVALID_ADDRESS) {
+            p = cache_alloc_page(fs, f, po);
+            if (p == INVALID_ADDRESS) {
+                if (demand)
+                    apply(apply_merge(m), timm("result", "page cache allocation failed"));
+                break;
+            }
+            if (demand)
+                fs->cache.misses++;
+            else
+                fs->cache.readahead++;
+            if (!run) {
+                run = allocate_vector(fs->h, (end - po) >> PAGELOG);
+                run_start = po;
+            }
+            vector_push(run, p);
+        } else {
+            if (run) {
+                cache_fill_run(fs, f, run, run_start);
+                run = 0;
+            }
+            if (!demand)
+                continue;
+            fs->cache.hits++;
+            cache_touch(fs, p);
+        }
+        if (!demand)
+            continue;
+
+        status_handler c = apply(ph, p, range_intersection(q, p->node.r));
+        if (p->ready)
+            apply(c, STATUS_OK);
+        else
+            cache_add_waiter(fs, p, c);
+    }
+    if (run)
+        cache_fill_run(fs, f, run, run_start);
+}
+
+static CLOSURE_5_1(cache_read_page_complete, void, cache_page, void *, range, buffer, status_handler, status);
+static void cache_read_page_complete(cache_page p, void *dest, range i, buffer target,
+                                     status_handler sh, status s)
+{
+    if (is_ok(s)) {
+        runtime_memcpy(dest, p->data + (i.start - p->node.r.start), range_span(i));
+        fetch_and_add(&target->end, range_span(i));
+    }
+    apply(sh, s);
+}
+
+static CLOSURE_4_2(cache_read_page, status_handler, filesystem, buffer, range, merge, cache_page, range);
+static status_handler cache_read_page(filesystem fs, buffer target, range q, merge m,
+                                      cache_page p, range i)
+{
+    void *dest = buffer_ref(target, i.start - q.start);
+    return closure(fs->h, cache_read_page_complete, p, dest, i, target, apply_merge(m));
+}
+
+static void cache_read(filesystem fs, fsfile f, buffer target, u64 length, u64 offset,
+                       status_handler sh)
+{
+    u64 file_length = fsfile_get_length(f);
+    if (offset >= file_length || length == 0) {
+        apply(sh, STATUS_OK);
+        return;
+    }
+    range q = irange(offset, offset + MIN(length, file_length - offset));
+    merge m = allocate_merge(fs->h, sh);
+    status_handler k = apply_merge(m);
+    cache_populate(fs, f, q, cache_readahead(f, q), m,
+                   closure(fs->h, cache_read_page, fs, target, q, m));
+    apply(k, STATUS_OK);
+}
+
+/* Pinned pages
+
+   Cached pages may be lent out by reference, e.g. to queue file data on
+   a TCP connection without copying it. A pinned page is never evicted,
+   though it still follows writes to the file, and a truncation zeroes
+   rather than drops it. */
+
+static CLOSURE_4_1(cache_pin_page, void, vector, int, cache_page, status_handler, status);
+static void cache_pin_page(vector pages, int index, cache_page p, status_handler sh, status s)
+{
+    if (is_ok(s)) {
+        p->pins++;
+        vector_set(pages, index, p);
+    }
+    apply(sh, s);
+}
+
+static CLOSURE_4_2(cache_pin_demand, status_handler, filesystem, vector, u64, merge, cache_page, range);
+static status_handler cache_pin_demand(filesystem fs, vector pages, u64 start, merge m,
+                                       cache_page p, range i)
+{
+    int index = (p->node.r.start - start) >> PAGELOG;
+    return closure(fs->h, cache_pin_page, pages, index, p, apply_merge(m));
+}
+
+static CLOSURE_2_1(cache_pin_complete, void, vector, fspages_handler, status);
+static void cache_pin_complete(vector pages, fspages_handler h, status s)
+{
+    if (is_ok(s)) {
+        apply(h, s, pages);
+        return;
+    }
+    fspages_release(pages);
+    apply(h, s, 0);
+}
+
+/* Pin the cached pages holding [offset, offset + length), clipped to
+   the end of file, reading in any that are missing. The handler gets a
+   vector of the pages in file order and owns their pins. */
+void filesystem_get_pages(filesystem fs, tuple t, u64 offset, u64 length, fspages_handler h)
+{
+    fsfile f = table_find(fs->files, t);
+    if (!f) {
+        apply(h, timm("result", "no such file %t", t), 0);
+        return;
+    }
+    if (!fs->cache.limit) {
+        apply(h, timm("result", "page cache disabled"), 0);
+        return;
+    }
+    u64 file_length = fsfile_get_length(f);
+    range q = irange(offset, offset + MIN(length, offset < file_length ? file_length - offset : 0));
+    u64 start = q.start & ~MASK(PAGELOG);
+    int npages = range_empty(q) ? 0 : (pad(q.end, PAGESIZE) - start) >> PAGELOG;
+    vector pages = allocate_vector(fs->h, npages);
+    for (int i = 0; i < npages; i++)
+        vector_push(pages, 0);
+    merge m = allocate_merge(fs->h, closure(fs->h, cache_pin_complete, pages, h));
+    status_handler k = apply_merge(m);
+    if (npages)
+        cache_populate(fs, f, q, cache_readahead(f, q), m,
+                       closure(fs->h, cache_pin_demand, fs, pages, start, m));
+    apply(k, STATUS_OK);
+}
+
+void *fspage_data(fspage p)
+{
+    return p->data;
+}
+
+u64 fspage_offset(fspage p)
+{
+    return p->node.r.start;
+}
+
+void fspage_hold(fspage p)
+{
+    p->pins++;
+}
+
+void fspage_release(fspage p)
+{
+    assert(p->pins > 0);
+    p->pins--;
+}
+
+/* release the pins remaining in a vector from filesystem_get_pages */
+void fspages_release(vector pages)
+{
+    cache_page p;
+    vector_foreach(pages, p) {
+        if (p)
+            fspage_release(p);
+    }
+    deallocate_vector(pages);
+}
+
+static CLOSURE_5_1(cache_write_page, void, filesystem, cache_page, void *, range, status_handler, status);
+static void cache_write_page(filesystem fs, cache_page p, void *source, range i,
+                             status_handler sh, status s)
+{
+    if (is_ok(s)) {
+        runtime_memcpy(p->data + (i.start - p->node.r.start), source, range_span(i));
+        cache_mark_dirty(fs, p);
+    }
+    apply(sh, s);
+}
+
+/* Copy a write into the cache. An uncached page that is only partly
+   overwritten and holds file data elsewhere is read in first. */
+static void cache_write(filesystem fs, fsfile f, buffer source, range q, status_handler sh)
+{
+    u64 file_length = fsfile_get_length(f);
+    merge m = allocate_merge(fs->h, sh);
+    status_handler k = apply_merge(m);
+
+    for (u64 po = q.start & ~MASK(PAGELOG); po < q.end; po += PAGESIZE) {
+        range i = range_intersection(q, irange(po, po + PAGESIZE));
+        cache_page p = cache_lookup(f, po);
+        if (p == INVALID_ADDRESS) {
+            p = cache_alloc_page(fs, f, po);
+            if (p == INVALID_ADDRESS) {
+                apply(apply_merge(m), timm("result", "page cache allocation failed"));
+                break;
+            }
+            boolean head = i.start > po && po < file_length;
+            boolean tail = i.end < p->node.r.end && i.end < file_length;
+            if (head || tail) {
+                vector run = allocate_vector(fs->h, 1);
+                vector_push(run, p);
+                cache_fill_run(fs, f, run, po);
+            } else {
+                p->ready = true;
+            }
+        } else {
+            cache_touch(fs, p);
+        }
+
+        status_handler c = closure(fs->h, cache_write_page, fs, p,
+                                   buffer_ref(source, i.start - q.start), i, apply_merge(m));
+        if (p->ready)
+            apply(c, STATUS_OK);
+        else
+            cache_add_waiter(fs, p, c);
+    }
+    apply(k, STATUS_OK);
+}
+
+/* zero cached data past a new end of file and drop idle pages beyond it */
+static void cache_truncate(filesystem fs, fsfile f, u64 length)
+{
+    rmnode n = rangemap_lookup_at_or_next(f->pages, length & ~MASK(PAGELOG));
+    while (n != INVALID_ADDRESS) {
+        rmnode next = rangemap_next_node(f->pages, n);
+        cache_page p = (cache_page)n;
+        if (p->ready) {
+            if (n->r.start >= length && !p->writeback && !p->waiters && !p->pins) {
+                cache_drop_page(fs, p);
+            } else {
+                u64 z = MAX(n->r.start, length);
+                runtime_memset(p->data + (z - n->r.start), 0, n->r.end - z);
+            }
+        }
+        n = next;
+    }
+}
+
+/* write back all dirty pages of the file, then apply sh */
+static void cache_sync_file(filesystem fs, fsfile f, status_handler sh)
+{
+    if (!f->sync_waiters)
+        f->sync_waiters = allocate_vector(fs->h, 2);
+    vector_push(f->sync_waiters, sh);
+    if (!f->writeback)
+        cache_sync_continue(fs, f, STATUS_OK);
+}
+
+static inline boolean cache_file_dirty(fsfile f)
+{
+    return f->writeback || cache_first_dirty(f) != INVALID_ADDRESS;
+}
+
+static CLOSURE_2_1(cache_sync_complete, void, filesystem, status_handler, status);
+static void cache_sync_complete(filesystem fs, status_handler completion, status s)
+{
+    if (!is_ok(s) || log_flush_complete(fs->tl, completion))
+        apply(completion, s);
+}
+
+void filesystem_sync(filesystem fs, status_handler completion)
+{
+    merge m = allocate_merge(fs->h, closure(fs->h, cache_sync_complete, fs, completion));
+    status_handler k = apply_merge(m);
+    table_foreach(fs->files, t, f) {
+        (void)t;
+        if (cache_file_dirty(f))
+            cache_sync_file(fs, f, apply_merge(m));
+    }
+    apply(k, STATUS_OK);
+}
+
+void filesystem_set_cache_limit(filesystem fs, u64 limit)
+{
+    limit &= ~MASK(PAGELOG);
+    if (limit == 0 && fs->cache.size != 0) {
+        msg_err("page cache in use; not disabling\n");
+        return;
+    }
+    fs->cache.limit = limit;
+    if (limit)
+        cache_evict(fs);
+}
+
+void filesystem_get_cache_stats(filesystem fs, pagecache_stats s)
+{
+    runtime_memcpy(s, &fs->cache, sizeof(struct pagecache_stats));
+}
+#endif
+
+void filesystem_get_extent_stats(filesystem fs, extent_stats s)
+{
+    runtime_memcpy(s, &fs->extent_stats, sizeof(struct extent_stats));
+}
+
 // wrap in an interface
 static tuple soft_create(filesystem fs, tuple t, symbol a, merge m)
 {
@@ -416,10 +1117,9 @@ static tuple soft_create(filesystem fs, tuple t, symbol a, merge m)
 
    The life an extent depends on a particular allocation of contiguous
    storage space. The extent is tied to this allocated area (nominally
-   page size). Only the extent data length may be updated; the file
-   offset, block start and allocation size are immutable. As an
-   optimization, adjacent extents on the disk could be joined into
-   larger extents with only a meta update.
+   page size). The file offset and block start are immutable; the data
+   length may grow up to the allocation, and the allocation may grow
+   into free storage that follows it (see extend_extent).
 
 */
 
@@ -451,18 +1151,14 @@ static extent create_extent(fsfile f, range r, merge m)
     if (ex == INVALID_ADDRESS)
         halt("out of memory\n");
     assert(rangemap_insert(f->extentmap, &ex->node));
-
-    // XXX encode this as an immediate bitstring
-    tuple e = timm("length", "%ld", length);
-    string offset = aprintf(h, "%ld", block_start);
-    table_set(e, sym(offset), offset);
-    string allocated = aprintf(h, "%ld", alloc_bytes);
-    table_set(e, sym(allocated), allocated);
-    symbol offs = intern_u64(r.start);
-
-    tuple extents = soft_create(f->fs, f->md, sym(extents), m);
-    table_set(extents, offs, e);
-    filesystem_write_eav(f->fs, extents, offs, e, apply_merge(m));
+    f->fs->extent_stats.extents++;
+    f->fs->extent_stats.created++;
+    f->fs->extent_stats.storage += alloc_bytes;
+
+    /* the extents tuple only marks the tuple as a file; the extents
+       themselves are logged as records of their own */
+    soft_create(f->fs, f->md, sym(extents), m);
+    log_write_extent(f->fs->tl, f->md, r, block_start, alloc_bytes, apply_merge(m));
     return ex;
 }
 
@@ -482,9 +1178,35 @@ static inline boolean ingest_parse_int(tuple value, symbol s, u64 * i)
     return retval;
 }
 
-void ingest_extent(fsfile f, symbol off, tuple value)
+/* Storage for extents read from the log is reserved once the whole log
+   has been read; see reserve_extents. */
+void ingest_extent(fsfile f, range r, u64 block_start, u64 allocated)
 {
-    tfs_debug("ingest_extent: f %p, off %b, value %v\n", f, symbol_string(off), value);
+    tfs_debug("ingest_extent: f %p, r %R, block_start 0x%lx, allocated %ld\n",
+              f, r, block_start, allocated);
+    extent ex = (extent)rangemap_lookup(f->extentmap, r.start);
+    if (ex != INVALID_ADDRESS && ex->node.r.start == r.start) {
+        /* grown since it was last recorded */
+        assert(ex->block_start == block_start);
+        rangemap_remove_node(f->extentmap, &ex->node);
+        ex->node.r = r;
+        assert(rangemap_insert(f->extentmap, &ex->node));
+        f->fs->extent_stats.storage += allocated - ex->allocated;
+        ex->allocated = allocated;
+        return;
+    }
+    ex = allocate_extent(f->fs->h, r, block_start, allocated);
+    if (ex == INVALID_ADDRESS)
+        halt("out of memory\n");
+    assert(rangemap_insert(f->extentmap, &ex->node));
+    f->fs->extent_stats.extents++;
+    f->fs->extent_stats.storage += allocated;
+}
+
+/* extents as logged before extent records, one tuple of decimal strings each */
+void ingest_extent_tuple(fsfile f, symbol off, tuple value)
+{
+    tfs_debug("ingest_extent_tuple: f %p, off %b, value %v\n", f, symbol_string(off), value);
     u64 length, file_offset, block_start, allocated;
     assert(off);
     assert(parse_int(alloca_wrap(symbol_string(off)), 10, &file_offset));
@@ -493,63 +1215,115 @@ void ingest_extent(fsfile f, symbol off, tuple value)
     assert(ingest_parse_int(value, sym(allocated), &allocated));
     tfs_debug("   file offset %ld, length %ld, block_start 0x%lx, allocated %ld\n",
               file_offset, length, block_start, allocated);
-#ifndef BOOT
-    if (!id_heap_set_area(f->fs->storage, block_start, allocated, true, true)) {
-        /* soft error... */
-        msg_err("unable to reserve storage at start 0x%lx, len 0x%lx\n",
-                block_start, allocated);
-    }
-#endif
-    range r = irange(file_offset, file_offset + length);
-    extent ex = allocate_extent(f->fs->h, r, block_start, allocated);
-    if (ex == INVALID_ADDRESS)
-        halt("out of memory\n");
-    assert(rangemap_insert(f->extentmap, &ex->node));
+    /* these are read after the whole log, so any record of the same
+       extent is more recent */
+    rmnode n = rangemap_lookup(f->extentmap, file_offset);
+    if (n != INVALID_ADDRESS && n->r.start == file_offset)
+        return;
+    ingest_extent(f, irange(file_offset, file_offset + length), block_start, allocated);
 }
 
-boolean set_extent_length(fsfile f, extent ex, u64 length, merge m)
+void fsfile_foreach_extent(fsfile f, extent_handler eh)
 {
-    tfs_debug("set_extent_length: range %R, allocated %ld, new length %ld\n",
-              ex->node.r, ex->allocated, length);
-    if (length > ex->allocated) {
-        tfs_debug("failed: new length %ld > ex->allocated %ld\n",
-                  length, ex->allocated);
-        return false;
+    for (rmnode n = rangemap_first_node(f->extentmap); n != INVALID_ADDRESS;
+         n = rangemap_next_node(f->extentmap, n)) {
+        extent ex = (extent)n;
+        apply(eh, n->r, ex->block_start, ex->allocated);
     }
+}
 
-    range r = ex->node.r;
-    r.end = ex->node.r.start + length;
-
-    if (rangemap_range_lookup(f->extentmap, r, 0)) {
-        tfs_debug("failed: collides with existing extent\n");
-        return false;
+/* Grow the allocation of an extent to hold length bytes by taking the
+   storage that immediately follows it, if that is free. It is at least
+   doubled, up to MAX_EXTENT_SIZE, so that appends don't grow it a page
+   at a time. */
+static boolean grow_allocation(filesystem fs, extent ex, u64 length)
+{
+#ifdef BOOT
+    return false;
+#else
+    u64 allocated = ex->allocated;
+    u64 base = ex->block_start + allocated;
+    u64 need = pad(length, MIN_EXTENT_SIZE);
+    u64 want = MIN(MAX(need, allocated << 1), MAX_EXTENT_SIZE);
+    if (!id_heap_set_area(fs->storage, base, want - allocated, true, true)) {
+        if (want == need ||
+            !id_heap_set_area(fs->storage, base, need - allocated, true, true))
+            return false;
+        want = need;
     }
+    fs->extent_stats.storage += want - allocated;
+    ex->allocated = want;
+    return true;
+#endif
+}
 
-    tuple extents = table_find(f->md, sym(extents));
-    if (!extents) {
-        tfs_debug("failed: can't find extents in f->md\n");
+/* Grow an extent in place so that it ends at file offset end, which
+   must not run into the next extent. */
+static boolean extend_extent(fsfile f, extent ex, u64 end, merge m)
+{
+    filesystem fs = f->fs;
+    u64 length = end - ex->node.r.start;
+    tfs_debug("extend_extent: range %R, allocated %ld, new length %ld\n",
+              ex->node.r, ex->allocated, length);
+
+    if (length > MAX_EXTENT_SIZE)
         return false;
-    }
 
-    symbol offs = intern_u64(r.start);
-    tuple extent_tuple = table_find(extents, offs);
-    if (!extent_tuple) {
-        tfs_debug("failed: can't find extent tuple\n");
+    u64 allocated = ex->allocated;
+    if (length > allocated && !grow_allocation(fs, ex, length)) {
+        tfs_debug("failed: storage following extent in use\n");
         return false;
     }
 
     /* re-insert in rangemap */
     rangemap_remove_node(f->extentmap, &ex->node);
+    ex->node.r.end = end;
+    assert(rangemap_insert(f->extentmap, &ex->node));
+    fs->extent_stats.extended++;
+    log_write_extent(fs->tl, f->md, ex->node.r, ex->block_start, ex->allocated, apply_merge(m));
+    return true;
+}
 
-    if (!rangemap_insert(f->extentmap, &ex->node)) {
-        tfs_debug("failed: rangemap_insert failed\n");
-        return false;
+/* Back a hole in the file with storage, by growing the extent that
+   ends where the hole starts if possible, and otherwise with new
+   extents of up to MAX_EXTENT_SIZE. */
+static boolean fill_hole(fsfile f, range r, merge m)
+{
+    if (r.start > 0) {
+        extent prev = (extent)rangemap_lookup(f->extentmap, r.start - 1);
+        if (prev != INVALID_ADDRESS && prev->node.r.end == r.start) {
+            u64 end = MIN(r.end, prev->node.r.start + MAX_EXTENT_SIZE);
+            if (end > r.start && extend_extent(f, prev, end, m))
+                r.start = end;
+        }
     }
 
-    /* update length in tuple and log */
-    string v = aprintf(f->fs->h, "%ld", length);
-    table_set(extent_tuple, sym(length), v);
-    filesystem_write_eav(f->fs, extents, offs, extent_tuple, apply_merge(m));
+    while (r.start < r.end) {
+        /* create_extent will allocate a minimum of pagesize */
+        u64 length = MIN(MAX_EXTENT_SIZE, range_span(r));
+        range e = irange(r.start, r.start + length);
+        if (create_extent(f, e, m) == INVALID_ADDRESS)
+            return false;
+        tfs_debug("   new extent %R\n", e);
+        r.start += length;
+    }
+    return true;
+}
+
+/* make sure that q is entirely backed by extents */
+static boolean fill_holes(fsfile f, range q, merge m)
+{
+    u64 curr = q.start;
+    rmnode node = rangemap_lookup_at_or_next(f->extentmap, q.start);
+    while (curr < q.end) {
+        u64 limit = node != INVALID_ADDRESS ? MIN(node->r.start, q.end) : q.end;
+        if (curr < limit && !fill_hole(f, irange(curr, limit), m))
+            return false;
+        if (node == INVALID_ADDRESS)
+            break;
+        curr = node->r.end;
+        node = rangemap_next_node(f->extentmap, node);
+    }
     return true;
 }
 
@@ -576,49 +1350,40 @@ static void filesystem_write_data_complete(fsfile f, tuple t, range q, merge m_m
     }
 
     if (fsfile_get_length(f) < q.end) {
-        /* XXX bother updating resident filelength tuple? */
         fsfile_set_length(f, q.end);
-        filesystem_write_eav(fs, t, sym(filelength), value_from_u64(fs->h, q.end), apply_merge(m_meta));
+#ifndef BOOT
+        /* logged by cache_log_length once written back */
+        if (!fs->cache.limit)
+#endif
+        {
+            /* the resident tuple is kept current for log compaction */
+            value v = value_from_u64(fs->h, q.end);
+            table_set(t, sym(filelength), v);
+            filesystem_write_eav(fs, t, sym(filelength), v, apply_merge(m_meta));
+        }
     }
 
     filesystem_flush_log(fs);
     apply(m_sh, STATUS_OK);
 }
 
-/* Holes over the query range will be filled with extents before later
-   being filled with content. However, there are at least two
-   differing ways that we can do this function:
-
-   1) Use only single page-sized extents when writing. The reasons are
-      two-fold: With our storage allocator, larger, non power-of-2
-      sizes will lead to more wasted allocated space, and larger,
-      varied allocations leads to more fragmentation of storage space.
-
-      This comes at the cost of meta for every page worth of file
-      data. However, extent meta for contiguous areas can be
-      aggregated. This is aided by the storage allocator issuing
-      allocations in-order when possible. (Note that we can add a
-      "release" function to the id heap to complement reserve. This
-      would allow us to arbitrarily deallocate blocks - and not
-      necessarily in allocation alignments (as with reserve).)
-
-   2) An alternative approach is to break large extent requests into
-      allocation sizes that can be filled completely, descending in
-      order. This would address the wasted allocated space issue but
-      not the fragmentation issue.
-
-   In any case, the attempt is to isolate the logic for mapping a
-   write to a series of extents to this function alone. So any
-   implementation of the above methods merely takes place in the logic
-   below.
-*/
+/* Holes over the query range are filled with extents before being
+   filled with content. An extent that ends where a hole begins is
+   grown over it while the storage after it is free, so that a file
+   written sequentially ends up in extents of MAX_EXTENT_SIZE rather
+   than one per write. Any remainder gets new extents, each allocated
+   in a power of 2; larger, varied allocations would fragment the
+   storage space.
+
+   With the page cache, the data is only copied into the cache here, and
+   holes are filled when it is written back (see cache_writeback). By
+   then, a run of small writes has been gathered into one allocation. */
 
 /* XXX This needs to additionally block if a log flush is in flight. */
 void filesystem_write(filesystem fs, tuple t, buffer b, u64 offset, io_status_handler ish)
 {
     u64 len = buffer_length(b);
     range q = irange(offset, offset + len);
-    u64 curr = offset;
 
     fsfile f;
     if (!(f = table_find(fs->files, t))) {
@@ -628,8 +1393,6 @@ void filesystem_write(filesystem fs, tuple t, buffer b, u64 offset, io_status_ha
 
     tfs_debug("filesystem_write: tuple %p, buffer %p, q %R\n", t, b, q);
 
-    rmnode node = rangemap_lookup_at_or_next(f->extentmap, q.start);
-
     /* meta merge completion is gated by data merge completion, thus the initial m_meta apply */
     merge m_meta = allocate_merge(fs->h, closure(fs->h, filesystem_write_meta_complete, q, ish));
     merge m_data = allocate_merge(fs->h, closure(fs->h, filesystem_write_data_complete,
@@ -637,46 +1400,19 @@ void filesystem_write(filesystem fs, tuple t, buffer b, u64 offset, io_status_ha
 
     /* hold data merge open until all extent operations have been initiated */
     status_handler sh = apply_merge(m_data);
-    do {
-        /* detect and fill any hole before extent (or to end) */
-        u64 limit = node != INVALID_ADDRESS ? node->r.start : q.end;
-        if (curr < limit) {
-            range hole = irange(curr, limit);
-            range fill = range_intersection(q, hole);
-
-            /* XXX optimization: check for a preceding extent and
-               inflate if possible */
-
-            /* just doing min-sized extents for now */
-            s64 remain = range_span(fill);
-
-            do {
-                /* create_extent will allocate a minimum of pagesize */
-                u64 length = MIN(MAX_EXTENT_SIZE, remain);
-                range r = irange(curr, curr + length);
-                extent ex = create_extent(f, r, m_meta);
-                if (ex == INVALID_ADDRESS) {
-                    msg_err("failed to create extent\n");
-                    goto fail;
-                }
-                tfs_debug("   writing new extent %R\n", r);
-                fs_write_extent(f->fs, b, m_data, q, &ex->node);
-                curr += length;
-                remain -= length;
-            } while (remain > 0);
-        }
+#ifndef BOOT
+    if (fs->cache.limit) {
+        cache_write(fs, f, b, q, apply_merge(m_data));
+        apply(sh, STATUS_OK);
+        return;
+    }
+#endif
 
-        if (node != INVALID_ADDRESS) {
-            /* overwrite any overlap with extent */
-            range i = range_intersection(q, node->r);
-            if (range_span(i)) {
-                tfs_debug("   updating extent at %R (intersection %R)\n", node->r, i);
-                fs_write_extent(f->fs, b, m_data, q, node);
-            }
-            curr = node->r.end;
-            node = rangemap_next_node(f->extentmap, node);
-        }
-    } while(curr < q.end);
+    if (!fill_holes(f, q, m_meta)) {
+        msg_err("failed to create extent\n");
+        goto fail;
+    }
+    rangemap_range_lookup(f->extentmap, q, closure(fs->h, fs_write_extent, fs, b, m_data, q));
 
     /* all data I/O has been queued */
     apply(sh, STATUS_OK);
@@ -688,26 +1424,129 @@ void filesystem_write(filesystem fs, tuple t, buffer b, u64 offset, io_status_ha
     return;
 }
 
+#ifndef BOOT
+/* Direct writes
+
+   A write of whole sectors from a sector-aligned buffer, as made by
+   O_DIRECT, goes to the extents straight from the caller's memory,
+   without the page cache, a DMA bounce buffer or block reads. Any
+   other write, or one over pages present in the page cache, takes the
+   path of filesystem_write, where a partial page is merged into the
+   cache rather than read back from disk each time. The caller's buffer
+   must stay in place until completion. */
+
+/* bounds the descriptor chain of a single request */
+#define DIRECT_WRITE_CHUNK (64 * KB)
+
+static CLOSURE_4_1(fs_write_extent_direct, void, filesystem, buffer, merge, range, rmnode);
+static void fs_write_extent_direct(filesystem fs, buffer source, merge m, range q, rmnode node)
+{
+    extent e = (extent)node;
+    range i = range_intersection(q, node->r);
+    u64 absolute = e->block_start + i.start - node->r.start;
+
+    /* extents that meet other than on a sector boundary */
+    if (((absolute | i.start | i.end) & (fs->blocksize - 1)) != 0) {
+        fs_write_extent(fs, source, m, q, node);
+        return;
+    }
+
+    tfs_debug("fs_write_extent_direct: q %R, ex %R, i %R, block_start 0x%lx\n",
+              q, node->r, i, e->block_start);
+    for (u64 o = i.start; o < i.end; o += DIRECT_WRITE_CHUNK) {
+        u64 n = MIN(i.end - o, DIRECT_WRITE_CHUNK);
+        u64 block = (absolute + o - i.start) / fs->blocksize;
+        apply(fs->w, buffer_ref(source, o - q.start),
+              irange(block, block + n / fs->blocksize), apply_merge(m));
+    }
+}
+
+static boolean cache_range_present(fsfile f, range q)
+{
+    rmnode n = rangemap_lookup_at_or_next(f->pages, q.start & ~MASK(PAGELOG));
+    return n != INVALID_ADDRESS && n->r.start < q.end;
+}
+
+/* Drop clean pages filled from disk while the write was in flight. */
+static CLOSURE_3_1(filesystem_write_direct_complete, void, fsfile, range, status_handler, status);
+static void filesystem_write_direct_complete(fsfile f, range q, status_handler sh, status s)
+{
+    rmnode n = rangemap_lookup_at_or_next(f->pages, q.start & ~MASK(PAGELOG));
+    while (n != INVALID_ADDRESS && n->r.start < q.end) {
+        rmnode next = rangemap_next_node(f->pages, n);
+        cache_page p = (cache_page)n;
+        if (p->ready && !p->dirty && !p->writeback && !p->waiters && !p->pins)
+            cache_drop_page(f->fs, p);
+        n = next;
+    }
+    apply(sh, s);
+}
+
+void filesystem_write_direct(filesystem fs, tuple t, buffer b, u64 offset, io_status_handler ish)
+{
+    u64 len = buffer_length(b);
+    range q = irange(offset, offset + len);
+    fsfile f = table_find(fs->files, t);
+
+    if (!f || len == 0 ||
+        ((offset | len | u64_from_pointer(buffer_ref(b, 0))) & (fs->blocksize - 1)) != 0 ||
+        cache_range_present(f, q)) {
+        filesystem_write(fs, t, b, offset, ish);
+        return;
+    }
+
+    tfs_debug("filesystem_write_direct: tuple %p, buffer %p, q %R\n", t, b, q);
+    fs->cache.direct += len;
+    merge m_meta = allocate_merge(fs->h, closure(fs->h, filesystem_write_meta_complete, q, ish));
+    merge m_data = allocate_merge(fs->h, closure(fs->h, filesystem_write_data_complete,
+                                                 f, t, q, m_meta, apply_merge(m_meta)));
+    status_handler sh = apply_merge(m_data);
+    if (!fill_holes(f, q, m_meta)) {
+        msg_err("failed to create extent\n");
+        apply(sh, timm("result", "write failed"));
+        return;
+    }
+    merge m = allocate_merge(fs->h, closure(fs->h, filesystem_write_direct_complete,
+                                            f, q, apply_merge(m_data)));
+    status_handler k = apply_merge(m);
+    rangemap_range_lookup(f->extentmap, q, closure(fs->h, fs_write_extent_direct, fs, b, m, q));
+    apply(k, STATUS_OK);
+    apply(sh, STATUS_OK);
+}
+#endif
+
 boolean filesystem_truncate(filesystem fs, fsfile f, u64 len,
         status_handler completion)
 {
     if (fsfile_get_length(f) == len) {
         return true;
     }
+#ifndef BOOT
+    if (len < fsfile_get_length(f))
+        cache_truncate(fs, f, len);
+#endif
     fsfile_set_length(f, len);
-    filesystem_write_eav(fs, f->md, sym(filelength), value_from_u64(fs->h, len),
-            completion);
+    value v = value_from_u64(fs->h, len);
+    table_set(f->md, sym(filelength), v);
+    filesystem_write_eav(fs, f->md, sym(filelength), v, completion);
     filesystem_flush_log(fs);
     return false;
 }
 
 boolean filesystem_flush(filesystem fs, tuple t, status_handler completion)
 {
-    /* A write() call returns after everything is sent to disk, so nothing to
-     * do here. The only work that might be pending is when directory entries
-     * are modified, see do_mkentry(); to deal with that, flush the filesystem
+    /* Cached writes to the file are written back first. Otherwise, the
+     * only work that might be pending is when directory entries are
+     * modified, see do_mkentry(); to deal with that, flush the filesystem
      * log.
      */
+#ifndef BOOT
+    fsfile f = table_find(fs->files, t);
+    if (f && cache_file_dirty(f)) {
+        cache_sync_file(fs, f, closure(fs->h, cache_sync_complete, fs, completion));
+        return false;
+    }
+#endif
     return log_flush_complete(fs->tl, completion);
 }
 
@@ -718,6 +1557,13 @@ fsfile allocate_fsfile(filesystem fs, tuple md)
     f->fs = fs;
     f->md = md;
     f->length = 0;
+#ifndef BOOT
+    f->pages = allocate_rangemap(fs->h);
+#endif
+    f->ra_next = 0;
+    f->ra_pages = 0;
+    f->writeback = false;
+    f->sync_waiters = 0;
     table_set(fs->files, f->md, f);
     return f;
 }
@@ -773,6 +1619,8 @@ static void fs_set_dir_entry(filesystem fs, tuple parent, symbol name_sym,
     }
     tuple c = children(parent);
     table_set(c, name_sym, child);
+    if (child)
+        table_set(fs->ephemeral, child, 0);
     if (sh) {
         filesystem_write_eav(fs, c, name_sym, child, sh);
         filesystem_flush_log(fs);
@@ -796,6 +1644,8 @@ static void do_mkentry(filesystem fs, tuple parent, const char *name, tuple entr
     if (persistent) {
         filesystem_write_eav(fs, c, name_sym, entry, ignore_status);
         filesystem_flush_log(fs);
+    } else {
+        table_set(fs->ephemeral, entry, entry);
     }
 
     fixup_directory(parent, entry);
@@ -884,7 +1734,16 @@ fs_status filesystem_creat(filesystem fs, tuple cwd, const char *fp, boolean per
     fsfile f = allocate_fsfile(fs, dir);
     fsfile_set_length(f, 0);
 
-    return filesystem_mkentry(fs, cwd, fp, dir, persistent, false);
+    fs_status s = filesystem_mkentry(fs, cwd, fp, dir, persistent, false);
+
+    /* The entry goes out within its directory, where the log doesn't look
+       for files; a record of the file's own makes it one on mount, even
+       if no write to it is ever written back. */
+    if (s == FS_STATUS_OK && persistent) {
+        filesystem_write_eav(fs, dir, sym(filelength), off, ignore_status);
+        filesystem_flush_log(fs);
+    }
+    return s;
 }
 
 void filesystem_delete(filesystem fs, tuple cwd, const char *fp,
@@ -941,8 +1800,33 @@ fsfile fsfile_from_node(filesystem fs, tuple n)
 }
 
 static CLOSURE_2_1(log_complete, void, filesystem_complete, filesystem, status);
+#ifndef BOOT
+static CLOSURE_1_3(reserve_extent, void, filesystem, range, u64, u64);
+static void reserve_extent(filesystem fs, range r, u64 block_start, u64 allocated)
+{
+    if (!id_heap_set_area(fs->storage, block_start, allocated, true, true)) {
+        /* soft error... */
+        msg_err("unable to reserve storage at start 0x%lx, len 0x%lx\n",
+                block_start, allocated);
+    }
+}
+
+/* take the storage of every extent read from the log out of the free pool */
+static void reserve_extents(filesystem fs)
+{
+    extent_handler eh = closure(fs->h, reserve_extent, fs);
+    table_foreach(fs->files, t, f) {
+        (void) t;
+        fsfile_foreach_extent((fsfile)f, eh);
+    }
+}
+#endif
+
 static void log_complete(filesystem_complete fc, filesystem fs, status s)
 {
+#ifndef BOOT
+    reserve_extents(fs);
+#endif
     fixup_directory(fs->root, fs->root);
     apply(fc, fs, s);
 }
@@ -964,6 +1848,7 @@ void create_filesystem(heap h,
     ignore_io_status = closure(h, ignore_io_body);
     fs->files = allocate_table(h, identity_key, pointer_equal);
     fs->extents = allocate_table(h, identity_key, pointer_equal);
+    fs->ephemeral = allocate_table(h, identity_key, pointer_equal);
     fs->dma = dma;
     fs->r = read;
     fs->h = h;
@@ -971,6 +1856,9 @@ void create_filesystem(heap h,
     fs->root = root;
     fs->alignment = alignment;
     fs->blocksize = SECTOR_SIZE;
+    runtime_memset((void *)&fs->cache, 0, sizeof(struct pagecache_stats));
+    runtime_memset((void *)&fs->extent_stats, 0, sizeof(struct extent_stats));
+    list_init(&fs->cache_lru);
 #ifndef BOOT
     fs->storage = create_id_heap(h, 0, infinity, SECTOR_SIZE);
     assert(fs->storage != INVALID_ADDRESS);
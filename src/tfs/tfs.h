@@ -12,6 +12,36 @@ extern io_status_handler ignore_io_status;
 #define MIN_EXTENT_SIZE PAGESIZE
 #define MAX_EXTENT_SIZE (1 * MB)
 
+#define PAGECACHE_DEFAULT_LIMIT (64 * MB)
+
+/* log group commit: how long a flush waits for more records, and how
+   many bytes of them make it go out at once */
+#define LOG_COMMIT_DEFAULT_WINDOW_US 250
+#define LOG_COMMIT_DEFAULT_BYTES (64 * KB)
+
+typedef struct pagecache_stats {
+    u64 limit;                  /* bytes; zero if the cache is disabled */
+    u64 size;                   /* bytes cached */
+    u64 dirty;                  /* bytes awaiting write-back */
+    u64 hits;                   /* pages read without I/O */
+    u64 misses;                 /* pages read on demand */
+    u64 readahead;              /* pages read ahead of demand */
+    u64 evictions;
+    u64 writebacks;
+    u64 direct;                 /* bytes written around the cache */
+} *pagecache_stats;
+
+typedef struct extent_stats {
+    u64 extents;                /* extents in use */
+    u64 created;
+    u64 extended;               /* grown in place over a following hole */
+    u64 storage;                /* bytes allocated to extents */
+} *extent_stats;
+
+/* a pinned page cache page */
+typedef struct cache_page *fspage;
+typedef closure_type(fspages_handler, void, status, vector);
+
 void create_filesystem(heap h,
                        u64 alignment,
                        u64 size,
@@ -25,9 +55,21 @@ void create_filesystem(heap h,
 // status
 void filesystem_read(filesystem fs, tuple t, void *dest, u64 offset, u64 length, io_status_handler completion);
 void filesystem_write(filesystem fs, tuple t, buffer b, u64 offset, io_status_handler completion);
+void filesystem_write_direct(filesystem fs, tuple t, buffer b, u64 offset, io_status_handler completion);
 boolean filesystem_truncate(filesystem fs, fsfile f, u64 len,
         status_handler completion);
 boolean filesystem_flush(filesystem fs, tuple t, status_handler completion);
+void filesystem_sync(filesystem fs, status_handler completion);
+void filesystem_set_cache_limit(filesystem fs, u64 limit);
+void filesystem_get_cache_stats(filesystem fs, pagecache_stats s);
+void filesystem_get_extent_stats(filesystem fs, extent_stats s);
+void filesystem_set_log_commit(filesystem fs, timestamp window, u64 bytes);
+void filesystem_get_pages(filesystem fs, tuple t, u64 offset, u64 length, fspages_handler h);
+void *fspage_data(fspage p);
+u64 fspage_offset(fspage p);
+void fspage_hold(fspage p);
+void fspage_release(fspage p);
+void fspages_release(vector pages);
 u64 fsfile_get_length(fsfile f);
 void fsfile_set_length(fsfile f, u64);
 fsfile fsfile_from_node(filesystem fs, tuple n);
@@ -20,6 +20,7 @@ typedef struct filesystem {
     int alignment;
     table files; // maps tuple to fsfile
     table extents; // maps extents
+    table ephemeral; // entries created with persistent=false, never logged
     closure_type(log, void, tuple);
     heap dma;
     block_io r;
@@ -27,18 +28,28 @@ typedef struct filesystem {
     log tl;
     tuple root;
     bytes blocksize;
+    struct pagecache_stats cache;
+    struct extent_stats extent_stats;
+    struct list cache_lru;      /* cached pages, least recently used first */
 } *filesystem;
 
-void ingest_extent(fsfile f, symbol foff, tuple value);
+void ingest_extent(fsfile f, range r, u64 block_start, u64 allocated);
+void ingest_extent_tuple(fsfile f, symbol foff, tuple value);
+
+/* file range, block start, bytes allocated */
+typedef closure_type(extent_handler, void, range, u64, u64);
+void fsfile_foreach_extent(fsfile f, extent_handler eh);
 
 log log_create(heap h, filesystem fs, status_handler sh);
 void log_write(log tl, tuple t, status_handler sh);
 void log_write_eav(log tl, tuple e, symbol a, value v, status_handler sh);
+void log_write_extent(log tl, tuple t, range r, u64 block_start, u64 allocated, status_handler sh);
 
 #define INITIAL_LOG_SIZE (512*KB)
 void read_log(log tl, u64 offset, u64 size, status_handler sh);
 void log_flush(log tl);
 boolean log_flush_complete(log tl, status_handler completion);
+void log_set_commit(log tl, timestamp window, u64 bytes);
 void flush(filesystem fs, status_handler);
     
 typedef closure_type(buffer_status, buffer, status);
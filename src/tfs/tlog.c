@@ -10,166 +10,423 @@
 #define END_OF_LOG 1
 #define TUPLE_AVAILABLE 2
 #define END_OF_SEGMENT 3
+#define LOG_EXTENSION_LINK 4    /* varint sector offset, varint sector count */
+#define TUPLE_SNAPSHOT 5        /* whole tree, files nested within it */
+#define EXTENT_RECORD 6         /* varint file tuple index, file offset,
+                                   length, sector start, sectors allocated */
+
+/* The log is a chain of segments. The first sits at the start of the
+   filesystem with a fixed size of INITIAL_LOG_SIZE; every other one is
+   allocated from fs->storage when its predecessor fills and is reached
+   through a LOG_EXTENSION_LINK frame at the end of that predecessor.
+   Records are only ever appended to the last segment, the tail. */
+#define LOG_SEGMENT_SIZE INITIAL_LOG_SIZE
+
+/* room held at the end of each segment for a link and END_OF_LOG */
+#define LOG_LINK_RESERVE 32
+
+/* compact once the records in the chain exceed this multiple of the
+   last snapshot */
+#define LOG_COMPACT_RATIO 4
+
+typedef struct log_segment {
+    u64 offset;                 /* bytes from start of fs */
+    u64 size;
+    buffer staging;             /* only kept while there is more to write */
+    u64 flushed;                /* bytes of staging known to be on disk */
+} *log_segment;
 
 typedef struct log {
     filesystem fs;
-    u64 remainder;
-    buffer staging;
-    vector completions;
+    vector segments;            /* in chain order */
+    log_segment tail;
+    buffer record;              /* scratch for encoding one record */
+    vector completions;         /* waiting on records not yet in a flush */
+    vector flush_completions;   /* waiting on the flush in progress */
+    int flush_index;            /* next segment to consider for writing */
+    boolean flushing;
+    timestamp commit_window;
+    u64 commit_bytes;
+    u64 pending;                /* bytes of records since the last flush */
+    timer commit_timer;
+    thunk commit_timeout;
     table dictionary;
-    u64 offset;
-    int dirty;              /* cas boolean */
+    u64 used;                   /* bytes of records in the chain */
+    u64 snapshot_size;
+#ifndef BOOT
+    vector reclaim;             /* segments released by compaction */
+    tuple_filter snapshot_filter;
+#endif
+    boolean dirty;
     heap h;
 } *log;
 
-static CLOSURE_1_1(log_write_completion, void, vector, status);
-static void log_write_completion(vector v, status s)
+static log_segment allocate_log_segment(log tl, u64 offset, u64 size)
 {
-    // reclaim the buffer now and the vector...make it a whole thing
-    status_handler i;
-    int len = vector_length(v);
-    for (int count = 0; count < len; count++) {
-        i = vector_delete(v, 0);
-        apply(i, s);
-    }
+    log_segment seg = allocate(tl->h, sizeof(struct log_segment));
+    assert(seg != INVALID_ADDRESS);
+    seg->offset = offset;
+    seg->size = size;
+    seg->staging = 0;
+    seg->flushed = 0;
+    vector_push(tl->segments, seg);
+    return seg;
 }
 
-// xxx  currently we cant take writes during the flush
+static inline boolean segment_dirty(log_segment seg)
+{
+    return seg->staging && seg->staging->end != seg->flushed;
+}
 
 /* XXX it's not right to just stick SECTOR_{SIZE,OFFSET} everywhere...
    and add block_log2 to fs */
-range log_block_range(log tl, u64 length)
+static range log_block_range(log_segment seg, u64 offset, u64 length)
 {
-    return irange(tl->offset >> SECTOR_OFFSET,
-                  (tl->offset + pad(length, tl->fs->blocksize)) >> SECTOR_OFFSET);
+    return irange((seg->offset + offset) >> SECTOR_OFFSET,
+                  (seg->offset + offset + length) >> SECTOR_OFFSET);
 }
 
-/* XXX we're just writing the whole log - instead write only from
-   block of buffer start forward */
-void log_flush(log tl)
+#ifndef BOOT
+static void log_reclaim(log tl)
+{
+    log_segment seg;
+    vector_foreach(tl->reclaim, seg) {
+        tlog_debug("reclaim segment at 0x%lx, size 0x%lx\n", seg->offset, seg->size);
+        deallocate_u64(tl->fs->storage, seg->offset, seg->size);
+        if (seg->staging)
+            deallocate_buffer(seg->staging);
+        deallocate(tl->h, seg, sizeof(struct log_segment));
+    }
+    deallocate_vector(tl->reclaim);
+    tl->reclaim = 0;
+}
+#endif
+
+static void log_flush_start(log tl);
+
+static void log_flush_finish(log tl, status s)
+{
+    vector v = tl->flush_completions;
+    tl->flush_completions = 0;
+    tl->flushing = false;
+    tlog_debug("flush finished, status %v\n", s);
+#ifndef BOOT
+    /* segments dropped by a compaction stay allocated until the new
+       head has made it to disk */
+    if (tl->reclaim && is_ok(s))
+        log_reclaim(tl);
+#endif
+    status_handler sh;
+    vector_foreach(v, sh)
+        apply(sh, s);
+    deallocate_vector(v);
+
+    /* records appended while the flush was in progress have waited
+       long enough */
+    if (tl->dirty)
+        log_flush_start(tl);
+}
+
+static void log_flush_next(log tl);
+
+static CLOSURE_5_1(log_segment_write_complete, void, log, log_segment, u64, void *, u64, status);
+static void log_segment_write_complete(log tl, log_segment seg, u64 end, void *buf, u64 length, status s)
 {
-    if (!__sync_bool_compare_and_swap(&tl->dirty, 1, 0))
+    deallocate(tl->h, buf, length);
+    if (!is_ok(s)) {
+        log_flush_finish(tl, s);
         return;
+    }
+    seg->flushed = end;
+    if (seg != tl->tail && !segment_dirty(seg)) {
+        /* nothing is appended after a link */
+        deallocate_buffer(seg->staging);
+        seg->staging = 0;
+    }
+    log_flush_next(tl);
+}
 
-    tlog_debug("log_flush: log %p dirty\n", tl);
-    buffer b = tl->staging;
-    push_u8(b, END_OF_LOG);
-#ifdef TLOG_DEBUG
-    u64 z = tl->staging->end;
-    tl->staging->start = 0;
-    tl->staging->end = 1024;
-    rprintf("staging contains:\n%X\n", b);
-    tl->staging->end = z;
+/* Write the next dirty segment, going from the tail backwards so that
+   a segment is always on disk before the link leading to it. Only the
+   blocks from the last flushed position onwards are written, and they
+   go out from a copy so that appends may continue during the write. */
+static void log_flush_next(log tl)
+{
+    while (tl->flush_index > 0) {
+        log_segment seg = vector_get(tl->segments, --tl->flush_index);
+        if (!segment_dirty(seg))
+            continue;
+
+        buffer b = seg->staging;
+        u64 start = seg->flushed & ~(tl->fs->blocksize - 1);
+        u64 n = b->end - start;
+        u64 length = pad(n + 1, tl->fs->blocksize);
+        u8 *buf = allocate(tl->h, length);
+        assert(buf != INVALID_ADDRESS);
+        runtime_memcpy(buf, b->contents + start, n);
+        buf[n] = END_OF_LOG;
+        runtime_memset(buf + n + 1, 0, length - (n + 1));
+        tlog_debug("flush segment at 0x%lx: bytes %ld to %ld\n", seg->offset, start, b->end);
+        apply(tl->fs->w, buf, log_block_range(seg, start, length),
+              closure(tl->h, log_segment_write_complete, tl, seg, b->end, buf, length));
+        return;
+    }
+    log_flush_finish(tl, STATUS_OK);
+}
+
+static void encode_extent(buffer b, u64 file, range r, u64 block_start, u64 allocated)
+{
+    push_u8(b, EXTENT_RECORD);
+    push_varint(b, file);
+    push_varint(b, r.start);
+    push_varint(b, range_span(r));
+    push_varint(b, block_start >> SECTOR_OFFSET);
+    push_varint(b, allocated >> SECTOR_OFFSET);
+}
+
+#ifndef BOOT
+static CLOSURE_3_3(log_snapshot_filter, boolean, filesystem, symbol, symbol, tuple, symbol, value);
+static boolean log_snapshot_filter(filesystem fs, symbol dot, symbol dotdot, tuple t, symbol a, value v)
+{
+    /* directory self and parent links are put back by fixup_directory()
+       on mount, and non-persistent entries are never logged */
+    if (a == dot || a == dotdot)
+        return false;
+    return table_find(fs->ephemeral, v) == 0;
+}
+
+/* the tuple recorded first, which a mount splats onto the fs root */
+static tuple log_root(log tl)
+{
+    table_foreach(tl->dictionary, k, v) {
+        if (u64_from_pointer(v) == 1)
+            return k;
+    }
+    return 0;
+}
+
+static CLOSURE_2_3(log_compact_extent, void, buffer, u64, range, u64, u64);
+static void log_compact_extent(buffer b, u64 file, range r, u64 block_start, u64 allocated)
+{
+    encode_extent(b, file, r, block_start, allocated);
+}
+
+/* Replace the chain with a snapshot of the tuple tree, encoded with a
+   fresh dictionary into a new segment, followed by a record for each
+   extent of the files within it, and rewrite the head of the first
+   segment to link to it. Records not yet flushed are dropped, as
+   the resident tree already reflects them; their waiters complete with
+   the flush of the snapshot. */
+static void log_compact(log tl)
+{
+    tuple root = log_root(tl);
+    if (!root)
+        return;
+
+    table dictionary = allocate_table(tl->h, identity_key, pointer_equal);
+    buffer r = tl->record;
+    push_u8(r, TUPLE_SNAPSHOT);
+    encode_tuple_filtered(r, dictionary, root, tl->snapshot_filter);
+    table_foreach(tl->fs->files, t, f) {
+        u64 file = u64_from_pointer(table_find(dictionary, t));
+        if (file)
+            fsfile_foreach_extent((fsfile)f, closure(tl->h, log_compact_extent, r, file));
+    }
+    u64 n = buffer_length(r);
+
+    /* leave room for appends after the snapshot */
+    u64 size = pad(n + LOG_SEGMENT_SIZE / 2, LOG_SEGMENT_SIZE);
+    u64 offset = allocate_u64(tl->fs->storage, size);
+    if (offset == u64_from_pointer(INVALID_ADDRESS)) {
+        msg_err("unable to allocate log segment for compaction\n");
+        buffer_clear(r);
+        deallocate_table(dictionary);
+        return;
+    }
+    tlog_debug("compact: %ld bytes of records to %ld byte snapshot at 0x%lx\n",
+               tl->used, n, offset);
+
+    if (!tl->reclaim)
+        tl->reclaim = allocate_vector(tl->h, vector_length(tl->segments));
+    log_segment head = vector_get(tl->segments, 0);
+    for (int i = 1; i < vector_length(tl->segments); i++)
+        vector_push(tl->reclaim, vector_get(tl->segments, i));
+    deallocate_vector(tl->segments);
+    tl->segments = allocate_vector(tl->h, 2);
+    vector_push(tl->segments, head);
+
+    if (head->staging)
+        deallocate_buffer(head->staging);
+    head->staging = allocate_buffer(tl->h, LOG_LINK_RESERVE);
+    head->flushed = 0;
+    push_u8(head->staging, LOG_EXTENSION_LINK);
+    push_varint(head->staging, offset >> SECTOR_OFFSET);
+    push_varint(head->staging, size >> SECTOR_OFFSET);
+
+    log_segment seg = allocate_log_segment(tl, offset, size);
+    seg->staging = allocate_buffer(tl->h, size);
+    buffer_write(seg->staging, buffer_ref(r, 0), n);
+    buffer_clear(r);
+    tl->tail = seg;
+
+    deallocate_table(tl->dictionary);
+    tl->dictionary = dictionary;
+    tl->used = tl->snapshot_size = n;
+}
+#endif
+
+static void log_flush_start(log tl)
+{
+    tlog_debug("log_flush_start: log %p, %ld bytes pending\n", tl, tl->pending);
+    if (tl->commit_timer) {
+        remove_timer(tl->commit_timer);
+        tl->commit_timer = 0;
+    }
+    tl->dirty = false;
+    tl->pending = 0;
+    tl->flushing = true;
+#ifndef BOOT
+    if (vector_length(tl->segments) > 1 &&
+        tl->used > MAX(LOG_SEGMENT_SIZE, LOG_COMPACT_RATIO * tl->snapshot_size))
+        log_compact(tl);
 #endif
+    tl->flush_completions = tl->completions;
+    tl->completions = allocate_vector(tl->h, 10);
+    tl->flush_index = vector_length(tl->segments);
+    log_flush_next(tl);
+}
+
+static CLOSURE_1_0(log_commit_timeout, void, log);
+static void log_commit_timeout(log tl)
+{
+    tl->commit_timer = 0;
+    if (!tl->flushing && tl->dirty)
+        log_flush_start(tl);
+}
 
-    void * buf = b->contents;
-    u64 length = b->end;
-    range r = log_block_range(tl, length);
-    apply(tl->fs->w, buf, r, closure(tl->h, log_write_completion, tl->completions));
-    b->end -= 1;                /* next write removes END_OF_LOG */
-//    rprintf("was %d now %d\n", b->start, b->end);
-//    b->start = b->end;          /* pick up next write here */
+/* Group commit: a flush request waits up to commit_window for more
+   records to join the same write, unless commit_bytes of records are
+   already pending. Records appended while a write is in flight go out
+   together as soon as it completes. A zero window flushes at once. */
+void log_flush(log tl)
+{
+    if (tl->flushing || !tl->dirty)
+        return;
+    if (tl->commit_window && tl->pending < tl->commit_bytes) {
+        if (!tl->commit_timer)
+            tl->commit_timer = register_timer(tl->commit_window, tl->commit_timeout);
+        return;
+    }
+    log_flush_start(tl);
+}
+
+void log_set_commit(log tl, timestamp window, u64 bytes)
+{
+    tl->commit_window = window;
+    tl->commit_bytes = bytes;
 }
 
 boolean log_flush_complete(log tl, status_handler completion)
 {
-    if (!tl->dirty) {
-        return true;
+    if (tl->dirty) {
+        vector_push(tl->completions, completion);
+        log_flush(tl);
+        return false;
+    }
+    if (tl->flushing) {
+        vector_push(tl->flush_completions, completion);
+        return false;
     }
-    vector_push(tl->completions, completion);
-    log_flush(tl);
+    return true;
+}
+
+/* Chain a new segment, with room for a record of n bytes, onto the tail. */
+static boolean log_extend(log tl, u64 n)
+{
+#ifdef BOOT
     return false;
+#else
+    u64 size = MAX(LOG_SEGMENT_SIZE, pad(n + LOG_LINK_RESERVE, tl->fs->blocksize));
+    u64 offset = allocate_u64(tl->fs->storage, size);
+    if (offset == u64_from_pointer(INVALID_ADDRESS))
+        return false;
+    tlog_debug("extend: new segment at 0x%lx, size 0x%lx\n", offset, size);
+    buffer b = tl->tail->staging;
+    push_u8(b, LOG_EXTENSION_LINK);
+    push_varint(b, offset >> SECTOR_OFFSET);
+    push_varint(b, size >> SECTOR_OFFSET);
+    log_segment seg = allocate_log_segment(tl, offset, size);
+    seg->staging = allocate_buffer(tl->h, size);
+    tl->tail = seg;
+    return true;
+#endif
 }
 
-void log_write_eav(log tl, tuple e, symbol a, value v, status_handler sh)
+/* move the encoded record onto the tail */
+static void log_append(log tl, status_handler sh)
 {
-    tlog_debug("log_write_eav: tl %p, e %p (%t), a \"%b\", v %v\n", tl, e, e, symbol_string(a), v);
-    /* XXX make log extendable */
-    if (tl->staging->end > INITIAL_LOG_SIZE - 32)
+    buffer r = tl->record;
+    u64 n = buffer_length(r);
+    if (tl->tail->staging->end + n + LOG_LINK_RESERVE > tl->tail->size &&
+        !log_extend(tl, n))
         halt("log full\n");
-    push_u8(tl->staging, TUPLE_AVAILABLE);
-    encode_eav(tl->staging, tl->dictionary, e, a, v);
+    buffer_write(tl->tail->staging, buffer_ref(r, 0), n);
+    buffer_clear(r);
+    tl->used += n;
+    tl->pending += n;
     vector_push(tl->completions, sh);
     tl->dirty = true;
 }
 
+void log_write_eav(log tl, tuple e, symbol a, value v, status_handler sh)
+{
+    tlog_debug("log_write_eav: tl %p, e %p (%t), a \"%b\", v %v\n", tl, e, e, symbol_string(a), v);
+    push_u8(tl->record, TUPLE_AVAILABLE);
+    encode_eav(tl->record, tl->dictionary, e, a, v);
+    log_append(tl, sh);
+}
+
 void log_write(log tl, tuple t, status_handler sh)
 {
     tlog_debug("log_write: tl %p, t %p (%t)\n", tl, t, t);
-    if (tl->staging->end > INITIAL_LOG_SIZE - 32)
-        halt("log full\n");
-    push_u8(tl->staging, TUPLE_AVAILABLE);
+    push_u8(tl->record, TUPLE_AVAILABLE);
     // this should be incremental on root!
-    encode_tuple(tl->staging, tl->dictionary, t);
-    vector_push(tl->completions, sh);
-    tl->dirty = true;
+    encode_tuple(tl->record, tl->dictionary, t);
+    log_append(tl, sh);
 }
 
-CLOSURE_2_1(log_read_complete, void, log, status_handler, status);
-void log_read_complete(log tl, status_handler sh, status s)
+/* Extents are logged as numbers against the dictionary index of the
+   file tuple rather than as tuples of their own, so that replay needs
+   no symbols or string parsing. A later record for the same file
+   offset replaces an earlier one. Files that aren't logged have
+   nothing to record. */
+void log_write_extent(log tl, tuple t, range r, u64 block_start, u64 allocated, status_handler sh)
 {
-    buffer b = tl->staging;
-    u8 frame = 0;
-
-    tlog_debug("log_read_complete: buffer len %d, status %v\n", buffer_length(b), s);
-    if (!is_ok(s)) {
-        apply(sh, s);
+    tlog_debug("log_write_extent: tl %p, t %p, r %R, block_start 0x%lx, allocated %ld\n",
+               tl, t, r, block_start, allocated);
+    u64 file = u64_from_pointer(table_find(tl->dictionary, t));
+    if (!file) {
+        apply(sh, STATUS_OK);
         return;
     }
+    encode_extent(tl->record, file, r, block_start, allocated);
+    log_append(tl, sh);
+}
 
-    /* this is crap, but just fix for now due to time */
-
-    // log extension - length at the beginnin and pointer at the end
-    for (; frame = pop_u8(b), frame == TUPLE_AVAILABLE || frame == END_OF_SEGMENT;) {
-        if (frame == END_OF_SEGMENT) {
-            tlog_debug("-> segment boundary\n");
-            continue;
-        }
-        tuple dv = decode_value(tl->h, tl->dictionary, b);
-        tlog_debug("   decoded %p\n", dv);
-        if (tagof(dv) != tag_tuple)
-            continue;
-
-        fsfile f = 0;
-        u64 filelength = infinity;
-        tuple t = (tuple)dv;
-
-        table_foreach(t, k, v) {
-            if (k == sym(extents)) {
-                tlog_debug("extents: %p\n", v);
-                /* don't know why this needs to be in fs, it's really tlog-specific */
-                if (!(f = table_find(tl->fs->extents, v))) {
-                    f = allocate_fsfile(tl->fs, t);
-                    table_set(tl->fs->extents, v, f);
-                    tlog_debug("   created fsfile %p\n", f);
-                } else {
-                    tlog_debug("   found fsfile %p\n", f);
-                }
-            } else if (k == sym(filelength)) {
-                filelength = u64_from_value(v);
-            }
-        }
-        
-        if (f && filelength != infinity) {
-            tlog_debug("   update fsfile length to %ld\n", filelength);
-            fsfile_set_length(f, filelength);
-        }
-    }
-
-    if (frame == END_OF_LOG) {
-        *(u8*)(b->contents + b->start - 1) = END_OF_SEGMENT;
-    }
-    /* mark end of log */
-    b->end = b->start;
-    b->start = 0;
-    tlog_debug("   log parse finished, end now at %d\n", b->end);
+static void log_read_segment(log tl, u64 offset, u64 size, buffer b, status_handler sh);
 
+static void log_read_finish(log tl, status_handler sh)
+{
     /* XXX this will only work for reading the log a single time
        through, but at present we're not using any incremental log updates */
     table_foreach(tl->fs->extents, t, f) {
         table_foreach(t, off, e) {
             tlog_debug("   tlog ingesting sym %b, val %p\n", symbol_string(off), e);
-            ingest_extent((fsfile)f, off, e);
+            ingest_extent_tuple((fsfile)f, off, e);
+#ifndef BOOT
+            /* superseded by extent records from here on */
+            table_set(t, off, 0);
+#endif
         }
     }
 
@@ -192,22 +449,175 @@ void log_read_complete(log tl, status_handler sh, status s)
         if (tagof(v) == tag_tuple || tagof(v) == tag_symbol)
             table_set(newdict, v, k);
     }
-    // deallocate_table(tl->dictionary);
+    /* later records against the root apply to the tuple it was splatted onto */
+    if (logroot) {
+        table_set(newdict, logroot, 0);
+        table_set(newdict, tl->fs->root, pointer_from_u64(1));
+    }
+    deallocate_table(tl->dictionary);
     tl->dictionary = newdict;
 #endif
 
     apply(sh, 0);
-    // something really strange is going on with the value of frame
-    //    if (frame != END_OF_LOG) halt("bad log tag %p\n", frame);    
+}
+
+/* the fsfile for file tuple t with extents tuple x, created on first sight */
+static fsfile log_fsfile(log tl, tuple t, tuple x)
+{
+    tlog_debug("extents: %p\n", x);
+    /* don't know why this needs to be in fs, it's really tlog-specific */
+    fsfile f = table_find(tl->fs->extents, x);
+    if (!f) {
+        f = allocate_fsfile(tl->fs, t);
+        table_set(tl->fs->extents, x, f);
+        tlog_debug("   created fsfile %p\n", f);
+    } else {
+        tlog_debug("   found fsfile %p\n", f);
+    }
+    return f;
+}
+
+static void log_ingest_tuple(log tl, tuple t)
+{
+    fsfile f = 0;
+    u64 filelength = infinity;
+
+    table_foreach(t, k, v) {
+        if (k == sym(extents)) {
+            f = log_fsfile(tl, t, v);
+        } else if (k == sym(filelength)) {
+            filelength = u64_from_value(v);
+        }
+    }
+
+    if (f && filelength != infinity) {
+        tlog_debug("   update fsfile length to %ld\n", filelength);
+        fsfile_set_length(f, filelength);
+    }
+}
+
+static boolean log_ingest_extent(log tl, buffer b)
+{
+    u64 file = pop_varint(b);
+    u64 start = pop_varint(b);
+    u64 length = pop_varint(b);
+    u64 block_start = pop_varint(b) << SECTOR_OFFSET;
+    u64 allocated = pop_varint(b) << SECTOR_OFFSET;
+    tuple t = table_find(tl->dictionary, pointer_from_u64(file));
+    tuple x = t ? table_find(t, sym(extents)) : 0;
+    if (!x) {
+        msg_err("extent record for unknown file 0x%lx\n", file);
+        return false;
+    }
+    ingest_extent(log_fsfile(tl, t, x), irange(start, start + length), block_start, allocated);
+    return true;
+}
+
+/* a snapshot carries files within the tree rather than as records of their own */
+static void log_ingest_tree(log tl, tuple t)
+{
+    log_ingest_tuple(tl, t);
+    table_foreach(t, k, v) {
+        (void) k;
+        if (tagof(v) == tag_tuple)
+            log_ingest_tree(tl, v);
+    }
+}
+
+CLOSURE_3_1(log_read_complete, void, log, log_segment, status_handler, status);
+void log_read_complete(log tl, log_segment seg, status_handler sh, status s)
+{
+    buffer b = seg->staging;
+    u64 position = 0;
+    u64 snapshot = infinity;
+    u8 frame = 0;
+
+    tlog_debug("log_read_complete: segment at 0x%lx, status %v\n", seg->offset, s);
+    if (!is_ok(s)) {
+        buffer_clear(b);
+        apply(sh, s);
+        return;
+    }
+
+    /* this is crap, but just fix for now due to time */
+    while (b->start < b->end) {
+        position = b->start;
+        frame = pop_u8(b);
+        if (frame == END_OF_SEGMENT) {
+            tlog_debug("-> segment boundary\n");
+            continue;
+        }
+        if (frame == LOG_EXTENSION_LINK) {
+            u64 offset = pop_varint(b) << SECTOR_OFFSET;
+            u64 size = pop_varint(b) << SECTOR_OFFSET;
+            tlog_debug("-> link to segment at 0x%lx, size 0x%lx\n", offset, size);
+            tl->used += position;
+            seg->flushed = b->start;
+            seg->staging = 0;
+#ifndef BOOT
+            if (!id_heap_set_area(tl->fs->storage, offset, size, true, true)) {
+                msg_err("unable to reserve log segment at 0x%lx, len 0x%lx\n",
+                        offset, size);
+            }
+#endif
+            log_read_segment(tl, offset, size, b, sh);
+            return;
+        }
+        if (frame == EXTENT_RECORD) {
+            if (!log_ingest_extent(tl, b))
+                break;
+            /* the extents written out with a snapshot count towards it */
+            if (snapshot != infinity)
+                tl->snapshot_size = b->start - snapshot;
+            continue;
+        }
+        if (frame != TUPLE_AVAILABLE && frame != TUPLE_SNAPSHOT)
+            break;
+
+        tuple dv = decode_value(tl->h, tl->dictionary, b);
+        tlog_debug("   decoded %p\n", dv);
+        snapshot = infinity;
+        if (tagof(dv) != tag_tuple)
+            continue;
+        if (frame == TUPLE_SNAPSHOT) {
+            snapshot = position;
+            tl->snapshot_size = b->start - position;
+            log_ingest_tree(tl, dv);
+        } else
+            log_ingest_tuple(tl, dv);
+    }
+
+    /* the tail continues from the end of log mark, overwriting it */
+    b->end = (frame == TUPLE_AVAILABLE || frame == TUPLE_SNAPSHOT ||
+              frame == EXTENT_RECORD) ? b->start : position;
+    b->start = 0;
+    seg->flushed = b->end;
+    tl->used += b->end;
+    tlog_debug("   log parse finished, end now at %d\n", b->end);
+    log_read_finish(tl, sh);
+}
+
+/* b, if given, is the buffer of the previous segment to reuse */
+static void log_read_segment(log tl, u64 offset, u64 size, buffer b, status_handler sh)
+{
+    log_segment seg = allocate_log_segment(tl, offset, size);
+    if (b && b->length < size) {
+        deallocate_buffer(b);
+        b = 0;
+    }
+    if (!b)
+        b = allocate_buffer(tl->h, size);
+    b->start = 0;
+    b->end = size;
+    seg->staging = b;
+    tl->tail = seg;
+    status_handler tlc = closure(tl->h, log_read_complete, tl, seg, sh);
+    apply(tl->fs->r, b->contents, log_block_range(seg, 0, size), tlc);
 }
 
 void read_log(log tl, u64 offset, u64 size, status_handler sh)
 {
-    tl->staging = allocate_buffer(tl->h, size);
-    status_handler tlc = closure(tl->h, log_read_complete, tl, sh);
-    range r = log_block_range(tl, tl->staging->length);
-//    rprintf("blocks %R\n", r);
-    apply(tl->fs->r, tl->staging->contents, r, tlc);
+    log_read_segment(tl, offset, size, 0, sh);
 }
 
 log log_create(heap h, filesystem fs, status_handler sh)
@@ -215,12 +625,27 @@ log log_create(heap h, filesystem fs, status_handler sh)
     tlog_debug("log_create: heap %p, fs %p, sh %p\n", h, fs, sh);
     log tl = allocate(h, sizeof(struct log));
     tl->h = h;
-    tl->offset = 0;
     tl->fs = fs;
+    tl->segments = allocate_vector(h, 4);
+    tl->tail = 0;
+    tl->record = allocate_buffer(h, 128);
     tl->completions = allocate_vector(h, 10);
+    tl->flush_completions = 0;
+    tl->flush_index = 0;
+    tl->flushing = false;
+    tl->commit_window = 0;
+    tl->commit_bytes = 0;
+    tl->pending = 0;
+    tl->commit_timer = 0;
+    tl->commit_timeout = closure(h, log_commit_timeout, tl);
     tl->dictionary = allocate_table(h, identity_key, pointer_equal);
+    tl->used = 0;
+    tl->snapshot_size = 0;
+#ifndef BOOT
+    tl->reclaim = 0;
+    tl->snapshot_filter = closure(h, log_snapshot_filter, fs, sym_this("."), sym_this(".."));
+#endif
     tl->dirty = false;
-    tl->staging = 0;
     fs->tl = tl;
     read_log(tl, 0, INITIAL_LOG_SIZE, sh);
     return tl;
@@ -72,7 +72,13 @@ static inline char * blockq_name(blockq bq)
 #define blockq_debug(x, ...)
 #endif
 
-CLOSURE_1_0(blockq_wake_one, void, blockq);
+static CLOSURE_1_0(blockq_timeout, void, blockq);
+static void blockq_timeout(blockq bq)
+{
+    /* the timer is freed after this returns */
+    bq->timeout = 0;
+    blockq_wake_one(bq);
+}
 
 static inline void blockq_disable_timer(blockq bq)
 {
@@ -90,10 +96,10 @@ static inline void blockq_restart_timer_locked(blockq bq)
         return;
 
     blockq_debug("for \"%s\"\n", blockq_name(bq));
-    /* timer facility doesn't presently give us a better way... */
     if (bq->timeout)
         remove_timer(bq->timeout);
-    bq->timeout = register_timer(bq->timeout_interval, closure(bq->h, blockq_wake_one, bq));
+    bq->timeout = register_timer_slack(bq->timeout_interval, USER_TIMER_SLACK,
+                                       closure(bq->h, blockq_timeout, bq));
 }
 
 static void blockq_apply_completion_locked(blockq bq)
@@ -77,6 +77,7 @@ static void build_exec_stack(process p, thread t, Elf64_Ehdr * e, void *start, u
         {AT_PHNUM, e->e_phnum},
         {AT_PAGESZ, PAGESIZE},
         {AT_RANDOM, u64_from_pointer(s)},
+        {AT_SYSINFO_EHDR, vdso_address()},
         {AT_ENTRY, u64_from_pointer(start)},
     };
     for (int i = 0; i < sizeof(auxp) / sizeof(auxp[0]); i++) {
@@ -129,78 +130,393 @@ void load_interp_complete(thread t, kernel_heaps kh, buffer b)
     start_process(t, load_elf(b, where, heap_pages(kh), heap_physical(kh), true));
 }
 
-process exec_elf(buffer ex, process kp)
+/* Create the process and its first thread for a program, given its ELF
+   header followed by the program headers, and work out where it
+   goes. */
+static thread exec_setup(process kp, Elf64_Ehdr *e, tuple *interp, u64 *load_offset, u64 *load_start)
 {
     // is process md always root?
     // set cwd
     unix_heaps uh = kp->uh;
     kernel_heaps kh = (kernel_heaps)uh;
     tuple root = kp->process_root;
-    filesystem fs = kp->fs;
-    process proc = create_process(uh, root, fs);
+    process proc = create_process(uh, root, kp->fs);
     thread t = create_thread(proc);
-    tuple interp = 0;
-    Elf64_Ehdr *e = (Elf64_Ehdr *)buffer_ref(ex, 0);
     boolean aslr = table_find(root, sym(noaslr)) == 0;
 
     proc->brk = 0;
+    *interp = 0;
 
     exec_debug("exec_elf enter\n");
 
-    u64 load_start = infinity;
+    u64 start = infinity;
     u64 load_end = 0;
     foreach_phdr(e, p) {
         if (p->p_type == PT_INTERP) {
             char *n = (void *)e + p->p_offset;
-            interp = resolve_path(root, split(heap_general(kh), alloca_wrap_buffer(n, runtime_strlen(n)), '/'));
-            if (!interp) 
+            *interp = resolve_path(root, split(heap_general(kh), alloca_wrap_buffer(n, runtime_strlen(n)), '/'));
+            if (!*interp)
                 halt("couldn't find program interpreter %s\n", n);
         } else if (p->p_type == PT_LOAD) {
-            if (p->p_vaddr < load_start)
-                load_start = p->p_vaddr;
+            if (p->p_vaddr < start)
+                start = p->p_vaddr;
             u64 segend = p->p_vaddr + p->p_memsz;
             if (segend > load_end)
                 load_end = segend;
         }
     }
 
-    if (interp)
-        exec_debug("interp: %t\n", interp);
+    if (*interp)
+        exec_debug("interp: %t\n", *interp);
 
-    u64 load_offset = 0;
-    if (e->e_type == ET_DYN && interp) {
+    u64 offset = 0;
+    if (e->e_type == ET_DYN && *interp) {
         /* Have some PIE */
-        load_offset = DEFAULT_PROG_ADDR;
+        offset = DEFAULT_PROG_ADDR;
         if (aslr) {
             /* XXX Replace 27 with limit derived from kernel start. */
-            load_offset += (random_u64() & ~MASK(PAGELOG)) & MASK(27);
+            offset += (random_u64() & ~MASK(PAGELOG)) & MASK(27);
         }
-        exec_debug("placing PIE at 0x%lx\n", load_offset);
-        load_start += load_offset;
-        load_end += load_offset;
+        exec_debug("placing PIE at 0x%lx\n", offset);
+        start += offset;
+        load_end += offset;
     }
 
     exec_debug("load start 0x%lx, end 0x%lx, offset 0x%lx\n",
-               load_start, load_end, load_offset);
-    void * entry = load_elf(ex, load_offset, heap_pages(kh), heap_physical(kh), true);
+               start, load_end, offset);
     /* if aslr, introduce 4M of variation to heap start ... kinda arbitrary */
     u64 brk_offset = aslr ? (random_u64() & (MASK(22) & ~MASK(PAGELOG))) : 0;
     proc->brk = pointer_from_u64(pad(load_end, PAGESIZE) + brk_offset);
-    exec_debug("entry %p, brk 0x%p\n", entry, proc->brk);
+    exec_debug("brk 0x%p\n", proc->brk);
+
+    *load_offset = offset;
+    *load_start = start;
+    return t;
+}
+
+process exec_elf(buffer ex, process kp)
+{
+    kernel_heaps kh = (kernel_heaps)kp->uh;
+    Elf64_Ehdr *e = (Elf64_Ehdr *)buffer_ref(ex, 0);
+    tuple interp;
+    u64 load_offset, load_start;
+    thread t = exec_setup(kp, e, &interp, &load_offset, &load_start);
 
-    build_exec_stack(proc, t, e, entry, load_start, root);
+    void * entry = load_elf(ex, load_offset, heap_pages(kh), heap_physical(kh), true);
+    exec_debug("entry %p\n", entry);
+    build_exec_stack(t->p, t, e, entry, load_start, kp->process_root);
 
     if (interp) {
         exec_debug("reading interp...\n");
-        filesystem_read_entire(fs, interp, heap_backed(kh),
+        filesystem_read_entire(kp->fs, interp, heap_backed(kh),
                                closure(heap_general(kh), load_interp_complete, t, kh),
                                closure(heap_general(kh), load_interp_fail));
-        return proc;
+        return t->p;
     }
 
     exec_debug("starting process...\n");
     start_process(t, entry);
     add_elf_syms(ex);
-    return proc;    
+    return t->p;
+}
+
+/* Programs are otherwise loaded from the page cache, so that starting
+   a large binary needn't wait on reading all of it. Only the first
+   page, with the ELF and program headers, is read up front. Read-only
+   segments are mapped from the file to be paged in as they're used;
+   segments written to at startup - data, and anything with bss - have
+   their file part copied in before the program starts, while their bss
+   is left to anonymous faults. Symbols are read in afterwards. The
+   whole file is still read in if there is no page cache, or if the
+   headers don't lie within the first page. */
+
+static CLOSURE_3_2(elf_header_pages, void, filesystem, tuple, buffer_handler, status, vector);
+static void elf_header_pages(filesystem fs, tuple file, buffer_handler bh, status s, vector pages)
+{
+    heap h = heap_general(get_kernel_heaps());
+    u64 length = MIN(PAGESIZE, fsfile_get_length(fsfile_from_node(fs, file)));
+    buffer b = allocate_buffer(h, PAGESIZE);
+    if (is_ok(s)) {
+        fspage pg = vector_length(pages) > 0 ? vector_get(pages, 0) : 0;
+        if (pg)
+            buffer_write(b, fspage_data(pg), length);
+        fspages_release(pages);
+    }
+    apply(bh, b);
+}
+
+/* Checks that all of the headers needed to map the file were read. */
+static boolean elf_headers_complete(buffer hdr)
+{
+    Elf64_Ehdr *e = buffer_ref(hdr, 0);
+    u64 length = buffer_length(hdr);
+    if (length < sizeof(Elf64_Ehdr) ||
+        e->e_phoff + (u64)e->e_phnum * e->e_phentsize > length)
+        return false;
+    foreach_phdr(e, p) {
+        if (p->p_type == PT_INTERP && p->p_offset + p->p_filesz > length)
+            return false;
+        /* file pages can only be mapped at the same page offset */
+        if (p->p_type == PT_LOAD && ((p->p_vaddr ^ p->p_offset) & MASK(PAGELOG)))
+            return false;
+    }
+    return true;
+}
+
+static inline u64 elf_page_flags(Elf64_Phdr *p)
+{
+    u64 flags = PAGE_USER;
+    if ((p->p_flags & PF_X) == 0)
+        flags |= PAGE_NO_EXEC;
+    if ((p->p_flags & PF_W))
+        flags |= PAGE_WRITABLE;
+    return flags;
+}
+
+static CLOSURE_5_2(elf_segment_pages, void, u64, u64, u64, u64, status_handler, status, vector);
+static void elf_segment_pages(u64 vstart, u64 fstart, u64 length, u64 flags, status_handler sh,
+                              status s, vector pages)
+{
+    if (is_ok(s)) {
+        fspage pg;
+        vector_foreach(pages, pg) {
+            u64 o = fspage_offset(pg);
+            runtime_memcpy(pointer_from_u64(vstart + o - fstart), fspage_data(pg),
+                           MIN(PAGESIZE, fstart + length - o));
+        }
+        fspages_release(pages);
+        update_map_flags(vstart, pad(length, PAGESIZE), flags);
+    }
+    apply(sh, s);
+}
+
+/* copy the file part of a segment, already page aligned, into memory */
+static void load_elf_segment(process p, tuple file, u64 vstart, u64 fstart, u64 length,
+                             u64 flags, status_handler sh)
+{
+    kernel_heaps kh = (kernel_heaps)p->uh;
+    u64 len = pad(length, PAGESIZE);
+    u64 phys = allocate_u64(heap_physical(kh), len);
+    if (phys == INVALID_PHYSICAL) {
+        apply(sh, timm("result", "failed to allocate %ld bytes for program segment", len));
+        return;
+    }
+    map(vstart, phys, len, PAGE_USER | PAGE_WRITABLE | PAGE_NO_EXEC, heap_pages(kh));
+    zero(pointer_from_u64(vstart), len);
+    filesystem_get_pages(p->fs, file, fstart, length,
+                         closure(heap_general(kh), elf_segment_pages, vstart, fstart, length, flags, sh));
+}
+
+static void map_elf_segments(process p, tuple file, Elf64_Ehdr *e, u64 offset, merge m)
+{
+    foreach_phdr(e, ph) {
+        if (ph->p_type != PT_LOAD)
+            continue;
+        if (ph->p_memsz < ph->p_filesz)
+            halt("load_elf with p->p_memsz (%ld) < p->p_filesz (%ld)\n",
+                 ph->p_memsz, ph->p_filesz);
+        u64 trim = ph->p_vaddr & MASK(PAGELOG);
+        u64 vstart = (ph->p_vaddr + offset) & ~MASK(PAGELOG);
+        u64 fstart = ph->p_offset - trim;
+        u64 file_len = pad(ph->p_filesz + trim, PAGESIZE);
+        u64 mem_len = pad(ph->p_memsz + trim, PAGESIZE);
+        int prot = PROT_READ;
+        if ((ph->p_flags & PF_W))
+            prot |= PROT_WRITE;
+        if ((ph->p_flags & PF_X))
+            prot |= PROT_EXEC;
+
+        if (!(ph->p_flags & PF_W) && ph->p_memsz == ph->p_filesz) {
+            exec_debug("mapping segment at 0x%lx, length 0x%lx, file offset 0x%lx\n",
+                       vstart, file_len, fstart);
+            mmap_private(p, vstart, file_len, prot, file, fstart);
+            continue;
+        }
+
+        if (ph->p_filesz == 0)
+            file_len = 0;
+        else
+            load_elf_segment(p, file, vstart, fstart, ph->p_filesz + trim, elf_page_flags(ph),
+                             apply_merge(m));
+        if (mem_len > file_len)
+            mmap_private(p, vstart + file_len, mem_len - file_len, prot, 0, 0);
+    }
+}
+
+static CLOSURE_1_2(elf_syms_section_read, void, status_handler, status, bytes);
+static void elf_syms_section_read(status_handler sh, status s, bytes length)
+{
+    apply(sh, s);
+}
+
+static CLOSURE_1_1(elf_syms_read, void, buffer, status);
+static void elf_syms_read(buffer image, status s)
+{
+    if (!is_ok(s)) {
+        msg_err("failed to read program symbols: %v\n", s);
+        deallocate_buffer(image);
+        return;
+    }
+    add_elf_syms(image);
 }
 
+/* With the section headers read, the string and symbol tables are
+   read in after them, making up an image of their own with just what
+   elf_symbols looks at. The image is kept, as the symbol table refers
+   to names within it. */
+static CLOSURE_4_2(elf_syms_headers_read, void, filesystem, tuple, buffer, void *, status, bytes);
+static void elf_syms_headers_read(filesystem fs, tuple file, buffer hdr, void *shdrs,
+                                  status s, bytes length)
+{
+    heap h = heap_general(get_kernel_heaps());
+    Elf64_Ehdr *e = buffer_ref(hdr, 0);
+    u64 shsize = (u64)e->e_shnum * e->e_shentsize;
+    if (!is_ok(s) || length < shsize)
+        goto out;
+
+    u64 total = sizeof(Elf64_Ehdr) + shsize;
+    for (int i = 0; i < e->e_shnum; i++) {
+        Elf64_Shdr *sh = shdrs + i * e->e_shentsize;
+        if (sh->sh_type == SHT_SYMTAB || sh->sh_type == SHT_STRTAB)
+            total += sh->sh_size;
+    }
+
+    buffer image = allocate_buffer(heap_backed(get_kernel_heaps()), total);
+    buffer_write(image, e, sizeof(Elf64_Ehdr));
+    buffer_write(image, shdrs, shsize);
+    Elf64_Ehdr *ie = buffer_ref(image, 0);
+    ie->e_shoff = sizeof(Elf64_Ehdr);
+
+    merge m = allocate_merge(h, closure(h, elf_syms_read, image));
+    status_handler k = apply_merge(m);
+    u64 where = sizeof(Elf64_Ehdr) + shsize;
+    for (int i = 0; i < e->e_shnum; i++) {
+        Elf64_Shdr *sh = buffer_ref(image, ie->e_shoff + i * e->e_shentsize);
+        if (sh->sh_type != SHT_SYMTAB && sh->sh_type != SHT_STRTAB)
+            continue;
+        filesystem_read(fs, file, buffer_ref(image, where), sh->sh_size, sh->sh_offset,
+                        closure(h, elf_syms_section_read, apply_merge(m)));
+        sh->sh_offset = where;
+        where += sh->sh_size;
+    }
+    buffer_produce(image, total - buffer_length(image));
+    apply(k, STATUS_OK);
+  out:
+    deallocate(h, shdrs, shsize);
+    deallocate_buffer(hdr);
+}
+
+/* takes hdr */
+static void load_elf_syms(filesystem fs, tuple file, buffer hdr)
+{
+    heap h = heap_general(get_kernel_heaps());
+    Elf64_Ehdr *e = buffer_ref(hdr, 0);
+    u64 shsize = (u64)e->e_shnum * e->e_shentsize;
+    if (e->e_shoff == 0 || shsize == 0 || e->e_shstrndx >= e->e_shnum) {
+        deallocate_buffer(hdr);
+        return;
+    }
+    void *shdrs = allocate(h, shsize);
+    if (shdrs == INVALID_ADDRESS) {
+        deallocate_buffer(hdr);
+        return;
+    }
+    filesystem_read(fs, file, shdrs, shsize, e->e_shoff,
+                    closure(h, elf_syms_headers_read, fs, file, hdr, shdrs));
+}
+
+static CLOSURE_2_1(exec_interp_mapped, void, thread, void *, status);
+static void exec_interp_mapped(thread t, void *entry, status s)
+{
+    if (!is_ok(s))
+        halt("loading interp failed: %v\n", s);
+    start_process(t, entry);
+}
+
+static CLOSURE_2_1(exec_interp_headers, void, thread, tuple, buffer);
+static void exec_interp_headers(thread t, tuple interp, buffer hdr)
+{
+    kernel_heaps kh = (kernel_heaps)t->p->uh;
+    heap h = heap_general(kh);
+    if (!elf_headers_complete(hdr)) {
+        deallocate_buffer(hdr);
+        filesystem_read_entire(t->p->fs, interp, heap_backed(kh),
+                               closure(h, load_interp_complete, t, kh),
+                               closure(h, load_interp_fail));
+        return;
+    }
+
+    u64 where = allocate_u64(heap_virtual_huge(kh), HUGE_PAGESIZE);
+    Elf64_Ehdr *e = buffer_ref(hdr, 0);
+    merge m = allocate_merge(h, closure(h, exec_interp_mapped, t, pointer_from_u64(e->e_entry + where)));
+    status_handler k = apply_merge(m);
+    map_elf_segments(t->p, interp, e, where, m);
+    deallocate_buffer(hdr);
+    apply(k, STATUS_OK);
+}
+
+static CLOSURE_5_1(exec_program_mapped, void, thread, tuple, tuple, void *, buffer, status);
+static void exec_program_mapped(thread t, tuple file, tuple interp, void *entry, buffer hdr, status s)
+{
+    filesystem fs = t->p->fs;
+    heap h = heap_general((kernel_heaps)t->p->uh);
+    if (!is_ok(s))
+        halt("loading program failed: %v\n", s);
+
+    if (interp) {
+        exec_debug("reading interp...\n");
+        deallocate_buffer(hdr);
+        buffer_handler bh = closure(h, exec_interp_headers, t, interp);
+        filesystem_get_pages(fs, interp, 0, PAGESIZE, closure(h, elf_header_pages, fs, interp, bh));
+        return;
+    }
+
+    exec_debug("starting process...\n");
+    start_process(t, entry);
+    load_elf_syms(fs, file, hdr);
+}
+
+static CLOSURE_1_1(exec_read_complete, void, process, buffer);
+static void exec_read_complete(process kp, buffer b)
+{
+    exec_elf(b, kp);
+}
+
+static CLOSURE_3_1(exec_headers_complete, void, process, tuple, status_handler, buffer);
+static void exec_headers_complete(process kp, tuple file, status_handler fail, buffer hdr)
+{
+    kernel_heaps kh = (kernel_heaps)kp->uh;
+    heap h = heap_general(kh);
+    if (!elf_headers_complete(hdr)) {
+        deallocate_buffer(hdr);
+        filesystem_read_entire(kp->fs, file, heap_backed(kh), closure(h, exec_read_complete, kp), fail);
+        return;
+    }
+
+    Elf64_Ehdr *e = buffer_ref(hdr, 0);
+    tuple interp;
+    u64 load_offset, load_start;
+    thread t = exec_setup(kp, e, &interp, &load_offset, &load_start);
+    void *entry = pointer_from_u64(e->e_entry + load_offset);
+    exec_debug("entry %p\n", entry);
+    build_exec_stack(t->p, t, e, entry, load_start, kp->process_root);
+
+    merge m = allocate_merge(h, closure(h, exec_program_mapped, t, file, interp, entry, hdr));
+    status_handler k = apply_merge(m);
+    map_elf_segments(t->p, file, e, load_offset, m);
+    apply(k, STATUS_OK);
+}
+
+void exec_elf_file(process kp, tuple file, status_handler fail)
+{
+    kernel_heaps kh = (kernel_heaps)kp->uh;
+    heap h = heap_general(kh);
+    struct pagecache_stats cs;
+    filesystem_get_cache_stats(kp->fs, &cs);
+    if (cs.limit == 0) {
+        filesystem_read_entire(kp->fs, file, heap_backed(kh), closure(h, exec_read_complete, kp), fail);
+        return;
+    }
+    buffer_handler bh = closure(h, exec_headers_complete, kp, file, fail);
+    filesystem_get_pages(kp->fs, file, 0, PAGESIZE, closure(h, elf_header_pages, kp->fs, file, bh));
+}
@@ -5,15 +5,25 @@
 #define VMAP_FLAG_ANONYMOUS     2
 #define VMAP_FLAG_WRITABLE      4
 #define VMAP_FLAG_EXEC          8
+#define VMAP_FLAG_SHARED        16
 
+/* A file mapping is paged in from the page cache on access: file
+   offset = vaddr + file_delta. */
 typedef struct vmap {
     struct rmnode node;
     u64 flags;
+    tuple file;
+    u64 file_delta;
 } *vmap;
 
 static boolean vmap_attr_equal(vmap a, vmap b)
 {
-    return a->flags == b->flags;
+    return a->flags == b->flags && a->file == b->file && a->file_delta == b->file_delta;
+}
+
+static inline boolean vmap_is_file(vmap vm)
+{
+    return vm->file != 0;
 }
 
 /* Page faults may be caused by:
@@ -37,11 +47,30 @@ static boolean vmap_attr_equal(vmap a, vmap b)
        runqueue / interrupt processing scheme, we need to put the
        proper locks in place
 
-     - we can easily build a free list of physical pages
-
-       - also note that, given that id deallocations don't need to
-         match their source allocations, we can take any size
-         deallocation and bust it up into single pages to cache
+     - pages come from the free list and zeroed pool in
+       x86_64/physpages.c; as id deallocations don't need to match
+       their source allocations, any size deallocation is busted up
+       into single pages to cache there
+
+   - a fault maps a 2M page where the vmap covers the whole aligned
+     region, or otherwise the unmapped 4K pages in a small window
+     around the faulting address (fault-around)
+
+   - a fault on a file mapping maps pages of the page cache directly,
+     read-only unless the mapping is shared and the access a write;
+     the page stays pinned for as long as it is mapped. A write to a
+     private mapping gets a copy of the page (copy-on-write). If the
+     data must be read in first, a fault from user mode puts the
+     thread to sleep until it arrives, and one from a syscall waits in
+     place (see kernel_wait_in_fault); a fault from a bottom half
+     can't wait and fails. Syscalls that take a user buffer fault it in
+     up front (fault_in_user_range), so that they fail with -EFAULT
+     before doing any work if the data can't be had, and their bottom
+     halves find it present
+
+   - an O_DIRECT write holds the user buffer until it completes
+     (hold_user_buffer): the device reads it through a kernel mapping,
+     and pages unmapped meanwhile are freed only once it's done
 
    - map() needs to be safe at interrupt and non-interrupt levels
 
@@ -52,6 +81,66 @@ static boolean vmap_attr_equal(vmap a, vmap b)
      onto the stack when invoking the exception handler
 */
 
+/* anonymous fault service times, in power of two nanosecond buckets,
+   for faults given a pre-zeroed page, faults that zeroed their own and
+   faults that mapped a 2M page */
+#define FAULT_HISTOGRAM_BUCKETS 32
+#define FAULT_PREZEROED 0
+#define FAULT_ZEROED    1
+#define FAULT_HUGE      2
+static u64 fault_histogram[3][FAULT_HISTOGRAM_BUCKETS];
+
+static struct {
+    u64 huge;                   /* 2M pages mapped */
+    u64 small;                  /* 4K pages mapped, including... */
+    u64 around;                 /* ...those mapped ahead of access */
+    u64 splits;                 /* 2M pages split by munmap / mprotect */
+    u64 file_mapped;            /* page cache pages mapped */
+    u64 file_copied;            /* private copies of file pages */
+    u64 file_waits;             /* faults that waited on file data */
+} fault_counts;
+
+static u64 fault_around_pages = FAULT_AROUND_DEFAULT_PAGES;
+static boolean fault_huge_pages = true;
+
+static inline void fault_histogram_add(int kind, timestamp t)
+{
+    u64 ns = sec_from_timestamp(t) * BILLION + nsec_from_timestamp(t);
+    int b = ns ? msb(ns) + 1 : 0;
+    fault_histogram[kind][MIN(b, FAULT_HISTOGRAM_BUCKETS - 1)]++;
+}
+
+void print_fault_stats(void)
+{
+    struct physpages_stats s;
+    physpages_get_stats(&s);
+    rprintf("anonymous faults: %ld pre-zeroed, %ld zeroed on fault\n",
+            s.zeroed_hits, s.zeroed_misses);
+    rprintf("physical pages: %ld batch refills, %ld zeroed idle, %ld recycled\n",
+            s.batch_refills, s.idle_zeroed, s.recycled);
+    rprintf("mappings: %ld 2M, %ld 4K (%ld by fault-around), %ld 2M split\n",
+            fault_counts.huge, fault_counts.small, fault_counts.around,
+            fault_counts.splits);
+    rprintf("file faults: %ld cache pages mapped, %ld copied on write, %ld waited on read\n",
+            fault_counts.file_mapped, fault_counts.file_copied, fault_counts.file_waits);
+    rprintf("fault latency     pre-zeroed  zeroed on fault          2M\n");
+    for (int i = 0; i < FAULT_HISTOGRAM_BUCKETS; i++) {
+        if (fault_histogram[FAULT_PREZEROED][i] || fault_histogram[FAULT_ZEROED][i] ||
+            fault_histogram[FAULT_HUGE][i])
+            rprintf("   < %10ld ns %10ld %16ld %11ld\n", 1ull << i,
+                    fault_histogram[FAULT_PREZEROED][i], fault_histogram[FAULT_ZEROED][i],
+                    fault_histogram[FAULT_HUGE][i]);
+    }
+}
+
+/* around_pages is rounded down to a power of two; 0 or 1 maps only
+   the faulting page */
+void mmap_set_fault_policy(u64 around_pages, boolean huge_pages)
+{
+    fault_around_pages = around_pages > 1 ? U64_FROM_BIT(msb(around_pages)) : 1;
+    fault_huge_pages = huge_pages;
+}
+
 static inline u64 page_map_flags(u64 vmflags)
 {
     u64 flags = PAGE_NO_FAT | PAGE_USER;
@@ -62,6 +151,354 @@ static inline u64 page_map_flags(u64 vmflags)
     return flags;
 }
 
+static boolean fault_map_page(u64 vaddr, u64 flags, heap pages, boolean *zeroed)
+{
+    u64 paddr = allocate_fault_page(zeroed);
+    if (paddr == INVALID_PHYSICAL)
+        return false;
+    /* a read-only page can't be cleared once mapped (CR0.WP) */
+    if (!*zeroed && !(flags & PAGE_WRITABLE)) {
+        zero_physical(paddr, PAGESIZE);
+        *zeroed = true;
+    }
+    map(vaddr, paddr, PAGESIZE, flags, pages);
+    if (!*zeroed)
+        zero(pointer_from_u64(vaddr), PAGESIZE);
+    fault_counts.small++;
+    return true;
+}
+
+/* Map the unmapped pages of the vmap in the aligned window around a
+   fault, on the bet that a program touching one page of a fresh
+   mapping will soon touch its neighbors. Gives up quietly if memory
+   runs short; those pages are left to fault on their own. */
+static void fault_around(vmap vm, u64 vaddr, u64 flags, heap pages)
+{
+    u64 window = fault_around_pages * PAGESIZE;
+    u64 start = MAX(vaddr & ~(window - 1), vm->node.r.start);
+    u64 end = MIN((vaddr & ~(window - 1)) + window, vm->node.r.end);
+    for (u64 v = start; v < end; v += PAGESIZE) {
+        boolean zeroed;
+        if (v == vaddr || physical_from_virtual(pointer_from_u64(v)) != INVALID_PHYSICAL)
+            continue;
+        if (!fault_map_page(v, flags, pages, &zeroed))
+            return;
+        fault_counts.around++;
+    }
+}
+
+/* Back the whole 2M region around the fault with a single 2M page if
+   the vmap covers all of it, nothing is yet mapped there and an
+   aligned physical 2M block is to be had. munmap and mprotect split it
+   back into 4K pages should they later cover only part of it. */
+static boolean fault_huge_page(vmap vm, u64 vaddr, u64 flags, heap pages)
+{
+    u64 v = vaddr & ~MASK(PAGELOG_2M);
+    if (!fault_huge_pages || v < vm->node.r.start || v + PAGESIZE_2M > vm->node.r.end ||
+        !fat_region_free(v))
+        return false;
+
+    heap physical = heap_physical(get_kernel_heaps());
+    u64 paddr = allocate_u64(physical, PAGESIZE_2M);
+    if (paddr == INVALID_PHYSICAL)
+        return false;
+    /* id heap allocations are only aligned relative to the start of
+       their range */
+    if (paddr & MASK(PAGELOG_2M)) {
+        deallocate_u64(physical, paddr, PAGESIZE_2M);
+        return false;
+    }
+    if (flags & PAGE_WRITABLE) {
+        map(v, paddr, PAGESIZE_2M, flags & ~PAGE_NO_FAT, pages);
+        zero(pointer_from_u64(v), PAGESIZE_2M);
+    } else {
+        zero_physical(paddr, PAGESIZE_2M);
+        map(v, paddr, PAGESIZE_2M, flags & ~PAGE_NO_FAT, pages);
+    }
+    fault_counts.huge++;
+    return true;
+}
+
+static CLOSURE_1_2(file_page_dirty_complete, void, buffer, status, bytes);
+static void file_page_dirty_complete(buffer b, status s, bytes length)
+{
+    if (!is_ok(s))
+        msg_err("failed to write back mapped file page: %v\n", s);
+    deallocate(b->h, b, sizeof(struct buffer));
+}
+
+/* Mark a shared page dirty by writing it onto itself, which also has
+   the filesystem allocate any extent it lacks. Only the part within
+   the file is written; stores past the end don't extend it. */
+static void file_page_dirty(process p, tuple file, fspage pg)
+{
+    u64 length = fsfile_get_length(fsfile_from_node(p->fs, file));
+    u64 offset = fspage_offset(pg);
+    if (offset >= length)
+        return;
+    heap h = heap_general(get_kernel_heaps());
+    buffer b = wrap_buffer(h, fspage_data(pg), MIN(PAGESIZE, length - offset));
+    filesystem_write(p->fs, file, b, offset, closure(h, file_page_dirty_complete, b));
+}
+
+/* An O_DIRECT write has the device read the user buffer while the
+   thread sleeps, and another thread may unmap it meanwhile. The
+   buffer's pages are mapped again at a kernel address for the I/O,
+   and pages the process lets go of while any such I/O is in flight
+   are only freed once none is. Returns the kernel address of buf, or
+   INVALID_ADDRESS if part of the buffer isn't present. */
+void *hold_user_buffer(process p, void *buf, u64 length)
+{
+    kernel_heaps kh = get_kernel_heaps();
+    u64 start = u64_from_pointer(buf) & ~MASK(PAGELOG);
+    u64 len = pad(u64_from_pointer(buf) + length, PAGESIZE) - start;
+    u64 va = allocate_u64(heap_virtual_page(kh), len);
+    if (va == INVALID_PHYSICAL)
+        return INVALID_ADDRESS;
+    for (u64 off = 0; off < len; off += PAGESIZE) {
+        physical paddr = physical_from_virtual(pointer_from_u64(start + off));
+        if (paddr == INVALID_PHYSICAL) {
+            if (off)
+                unmap(va, off, heap_pages(kh));
+            deallocate_u64(heap_virtual_page(kh), va, len);
+            return INVALID_ADDRESS;
+        }
+        map(va + off, paddr, PAGESIZE, PAGE_NO_EXEC, heap_pages(kh));
+    }
+    p->dma_holds++;
+    return pointer_from_u64(va + (u64_from_pointer(buf) & MASK(PAGELOG)));
+}
+
+void release_user_buffer(process p, void *kbuf, u64 length)
+{
+    kernel_heaps kh = get_kernel_heaps();
+    u64 va = u64_from_pointer(kbuf) & ~MASK(PAGELOG);
+    u64 len = pad(u64_from_pointer(kbuf) + length, PAGESIZE) - va;
+    unmap(va, len, heap_pages(kh));
+    deallocate_u64(heap_virtual_page(kh), va, len);
+
+    assert(p->dma_holds > 0);
+    if (--p->dma_holds > 0)
+        return;
+    for (range *r = buffer_ref(p->held_physical, 0);
+         (void *)r < buffer_ref(p->held_physical, buffer_length(p->held_physical)); r++)
+        release_physical_pages(*r);
+    buffer_clear(p->held_physical);
+    fspage pg;
+    vector_foreach(p->held_pages, pg)
+        fspage_release(pg);
+    buffer_clear(p->held_pages);
+}
+
+static void user_release_physical(process p, range r)
+{
+    if (p->dma_holds)
+        buffer_write(p->held_physical, &r, sizeof(range));
+    else
+        release_physical_pages(r);
+}
+
+static void user_release_fspage(process p, fspage pg)
+{
+    if (p->dma_holds)
+        vector_push(p->held_pages, pg);
+    else
+        fspage_release(pg);
+}
+
+/* Map a pinned page cache page at vaddr, taking over the pin, or a
+   private copy of it for a write to a private mapping. */
+static boolean map_file_page(process p, vmap vm, u64 vaddr, fspage pg, boolean write)
+{
+    heap pages = heap_pages(get_kernel_heaps());
+    u64 flags = page_map_flags(vm->flags);
+
+    /* a write to a read-only mapping faults again, on protection */
+    if (!(vm->flags & VMAP_FLAG_WRITABLE))
+        write = false;
+    if (write && !(vm->flags & VMAP_FLAG_SHARED)) {
+        boolean zeroed;
+        u64 paddr = allocate_fault_page(&zeroed);
+        if (paddr == INVALID_PHYSICAL) {
+            user_release_fspage(p, pg);
+            return false;
+        }
+        map(vaddr, paddr, PAGESIZE, flags, pages);
+        runtime_memcpy(pointer_from_u64(vaddr), fspage_data(pg), PAGESIZE);
+        user_release_fspage(p, pg);
+        fault_counts.file_copied++;
+        return true;
+    }
+
+    if (write)
+        file_page_dirty(p, vm->file, pg);
+    else
+        flags &= ~PAGE_WRITABLE;
+    map(vaddr, physical_from_virtual(fspage_data(pg)), PAGESIZE, flags, pages);
+    table_set(p->file_pages, pointer_from_u64(vaddr), pg);
+    fault_counts.file_mapped++;
+    return true;
+}
+
+typedef struct file_fault {
+    heap h;
+    process p;
+    thread t;                   /* to wake, if it went to sleep */
+    tuple file;
+    u64 file_delta;
+    u64 vaddr;
+    boolean write;
+    boolean blocked;
+    cpuinfo waiting;            /* in kernel_wait_in_fault */
+    volatile boolean done;
+    boolean ok;
+} *file_fault;
+
+static CLOSURE_1_2(file_fault_complete, void, file_fault, status, vector);
+static void file_fault_complete(file_fault ff, status s, vector pages)
+{
+    process p = ff->p;
+    boolean ok = is_ok(s);
+    if (ok) {
+        fspage pg;
+        vector_foreach(pages, pg) {
+            if (!pg)
+                continue;
+            u64 v = fspage_offset(pg) - ff->file_delta;
+            vmap vm = (vmap)rangemap_lookup(p->vmaps, v);
+            /* unmapped, remapped or faulted in by another thread
+               while the read was in progress */
+            if (vm == INVALID_ADDRESS || vm->file != ff->file || vm->file_delta != ff->file_delta ||
+                physical_from_virtual(pointer_from_u64(v)) != INVALID_PHYSICAL) {
+                fspage_release(pg);
+                continue;
+            }
+            if (!map_file_page(p, vm, v, pg, ff->write && v == ff->vaddr) && v == ff->vaddr)
+                ok = false;
+        }
+        deallocate_vector(pages);
+
+        /* past the end of file */
+        vmap vm = (vmap)rangemap_lookup(p->vmaps, ff->vaddr);
+        if (ok && vm != INVALID_ADDRESS && vm->file == ff->file &&
+            physical_from_virtual(pointer_from_u64(ff->vaddr)) == INVALID_PHYSICAL) {
+            boolean zeroed;
+            ok = fault_map_page(ff->vaddr, page_map_flags(vm->flags),
+                                heap_pages(get_kernel_heaps()), &zeroed);
+        }
+    }
+
+    if (!ff->blocked) {
+        /* the waiter frees ff once it sees done */
+        cpuinfo waiting = ff->waiting;
+        ff->ok = ok;
+        ff->done = true;
+        if (waiting && waiting != current_cpu())
+            wakeup_cpu(waiting);
+        return;
+    }
+    /* the thread would only fault again */
+    if (!ok)
+        halt("unable to fault in file page at 0x%lx: %v\n", ff->vaddr, s);
+    if (ff->t)
+        thread_wakeup_fault(ff->t);
+    deallocate(ff->h, ff, sizeof(struct file_fault));
+}
+
+/* Not-present fault on a file mapping. The pages of the fault-around
+   window are requested from the page cache, which will usually have
+   them, or some of them, already. */
+static boolean file_fault_page(process p, vmap vm, u64 vaddr, context frame, boolean write)
+{
+    heap h = heap_general(get_kernel_heaps());
+    u64 v = vaddr & ~MASK(PAGELOG);
+    u64 window = fault_around_pages * PAGESIZE;
+    u64 start = MAX(v & ~(window - 1), vm->node.r.start);
+    u64 end = MIN((v & ~(window - 1)) + window, vm->node.r.end);
+
+    file_fault ff = allocate(h, sizeof(struct file_fault));
+    if (ff == INVALID_ADDRESS)
+        return false;
+    ff->h = h;
+    ff->p = p;
+    ff->t = current;
+    ff->file = vm->file;
+    ff->file_delta = vm->file_delta;
+    ff->vaddr = v;
+    ff->write = write;
+    ff->blocked = false;
+    ff->waiting = 0;
+    ff->done = false;
+    ff->ok = false;
+    filesystem_get_pages(p->fs, vm->file, start + vm->file_delta, end - start,
+                         closure(h, file_fault_complete, ff));
+    if (ff->done) {
+        boolean ok = ff->ok;
+        deallocate(h, ff, sizeof(struct file_fault));
+        return ok;
+    }
+
+    fault_counts.file_waits++;
+    if (fault_in_syscall(frame)) {
+        ff->waiting = current_cpu();
+        kernel_wait_in_fault(&ff->done);
+        boolean ok = ff->ok;
+        deallocate(h, ff, sizeof(struct file_fault));
+        return ok;
+    }
+
+    ff->blocked = true;
+    if (frame != current->frame) {
+        msg_err("file mapping at 0x%lx accessed from bottom half, page not in cache\n", vaddr);
+        ff->t = 0;
+        return false;
+    }
+    thread_sleep_fault(current);
+}
+
+/* Fault in the not-present file pages of a user buffer from a
+   syscall, before it does anything with the buffer, waiting for any
+   reads. Returns false if part of the buffer is unmapped or its data
+   can't be had, for the syscall to fail with -EFAULT. File pages stay
+   pinned while mapped, so the syscall's own accesses, and those of its
+   bottom halves, then find them present. */
+boolean fault_in_user_range(void *buf, u64 length)
+{
+    process p = current->p;
+    u64 vaddr = u64_from_pointer(buf);
+    if (length == 0)
+        return true;
+    if (vaddr + length < vaddr)
+        return false;
+    for (u64 v = vaddr & ~MASK(PAGELOG); v < vaddr + length; v += PAGESIZE) {
+        if (physical_from_virtual(pointer_from_u64(v)) != INVALID_PHYSICAL)
+            continue;
+        vmap vm = (vmap)rangemap_lookup(p->vmaps, v);
+        if (vm == INVALID_ADDRESS)
+            return false;
+        /* anonymous pages are had without waiting */
+        if (vmap_is_file(vm) && !file_fault_page(p, vm, v, running_frame, false))
+            return false;
+    }
+    return true;
+}
+
+/* Write to a present, read-only page of a writable file mapping:
+   either a shared cache page to be dirtied or one to copy. Anything
+   else mapped there, like a private copy, was only made read-only by
+   mprotect. */
+static boolean file_write_fault(process p, vmap vm, u64 vaddr)
+{
+    u64 v = vaddr & ~MASK(PAGELOG);
+    fspage pg = table_find(p->file_pages, pointer_from_u64(v));
+    if (!pg) {
+        update_map_flags(v, PAGESIZE, page_map_flags(vm->flags));
+        return true;
+    }
+    table_set(p->file_pages, pointer_from_u64(v), 0);
+    return map_file_page(p, vm, v, pg, true);
+}
+
 boolean unix_fault_page(u64 vaddr, context frame)
 {
     process p = current->p;
@@ -75,6 +512,9 @@ boolean unix_fault_page(u64 vaddr, context frame)
             return false;
         }
 
+        if (vmap_is_file(vm))
+            return file_fault_page(p, vm, vaddr, frame, (error_code & FRAME_ERROR_PF_RW) != 0);
+
         u32 flags = VMAP_FLAG_MMAP | VMAP_FLAG_ANONYMOUS;
         if ((vm->flags & flags) != flags) {
             msg_err("vaddr 0x%lx matched vmap with invalid flags (0x%x)\n",
@@ -82,24 +522,35 @@ boolean unix_fault_page(u64 vaddr, context frame)
             return false;
         }
 
-        /* XXX make free list */
-        u64 paddr = allocate_u64(heap_physical(kh), PAGESIZE);
-        if (paddr == INVALID_PHYSICAL) {
+        timestamp start = now();
+        u64 mapflags = page_map_flags(vm->flags);
+        heap pages = heap_pages(kh);
+        if (fault_huge_page(vm, vaddr, mapflags, pages)) {
+            fault_histogram_add(FAULT_HUGE, now() - start);
+            return true;
+        }
+
+        boolean zeroed;
+        u64 vaddr_aligned = vaddr & ~MASK(PAGELOG);
+        if (!fault_map_page(vaddr_aligned, mapflags, pages, &zeroed)) {
             msg_err("cannot get physical page; OOM\n");
             return false;
         }
-        u64 vaddr_aligned = vaddr & ~MASK(PAGELOG);
-        map(vaddr_aligned, paddr, PAGESIZE, page_map_flags(vm->flags), heap_pages(kh));
-        zero(pointer_from_u64(vaddr_aligned), PAGESIZE);
+        fault_around(vm, vaddr_aligned, mapflags, pages);
+        fault_histogram_add(zeroed ? FAULT_PREZEROED : FAULT_ZEROED, now() - start);
         return true;
     } else {
+        vmap vm = (vmap)rangemap_lookup(p->vmaps, vaddr);
+        if ((error_code & FRAME_ERROR_PF_RW) && vm != INVALID_ADDRESS && vmap_is_file(vm) &&
+            (vm->flags & VMAP_FLAG_WRITABLE))
+            return file_write_fault(p, vm, vaddr);
+
         /* page protection violation */
         rprintf("\nPage protection violation\naddr 0x%lx, rip 0x%lx, "
                 "error %s%s%s\n", vaddr, frame[FRAME_RIP],
                 (error_code & FRAME_ERROR_PF_RW) ? "W" : "R",
                 (error_code & FRAME_ERROR_PF_US) ? "U" : "S",
                 (error_code & FRAME_ERROR_PF_ID) ? "I" : "D");
-        vmap vm = (vmap)rangemap_lookup(p->vmaps, vaddr);
         if (vm == INVALID_ADDRESS) {
             rprintf("no vmap found address\n");
         } else {
@@ -112,6 +563,10 @@ boolean unix_fault_page(u64 vaddr, context frame)
                 rprintf("writable ");
             if (vm->flags & VMAP_FLAG_EXEC)
                 rprintf("executable ");
+            if (vm->flags & VMAP_FLAG_SHARED)
+                rprintf("shared ");
+            if (vmap_is_file(vm))
+                rprintf("file ");
             rprintf("\n");
         }
 
@@ -125,13 +580,15 @@ boolean unix_fault_page(u64 vaddr, context frame)
     }
 }
 
-static vmap allocate_vmap(heap h, rangemap rm, range r, u64 flags)
+static vmap allocate_vmap(heap h, rangemap rm, range r, u64 flags, tuple file, u64 file_delta)
 {
     vmap vm = allocate(h, sizeof(struct vmap));
     if (vm == INVALID_ADDRESS)
         return vm;
     rmnode_init(&vm->node, r);
     vm->flags = flags;
+    vm->file = file;
+    vm->file_delta = file_delta;
     if (!rangemap_insert(rm, &vm->node)) {
         deallocate(h, vm, sizeof(struct vmap));
         return INVALID_ADDRESS;
@@ -139,6 +596,16 @@ static vmap allocate_vmap(heap h, rangemap rm, range r, u64 flags)
     return vm;
 }
 
+static CLOSURE_2_3(file_move_page, void, process, u64, u64, physical, u64);
+static void file_move_page(process p, u64 delta, u64 vaddr, physical paddr, u64 flags)
+{
+    fspage pg = table_find(p->file_pages, pointer_from_u64(vaddr));
+    if (pg) {
+        table_set(p->file_pages, pointer_from_u64(vaddr), 0);
+        table_set(p->file_pages, pointer_from_u64(vaddr + delta), pg);
+    }
+}
+
 sysreturn mremap(void *old_address, u64 old_size, u64 new_size, int flags, void * new_address)
 {
     kernel_heaps kh = get_kernel_heaps();
@@ -190,13 +657,22 @@ sysreturn mremap(void *old_address, u64 old_size, u64 new_size, int flags, void
     rangemap_remove_node(p->vmaps, &old_vm->node);
 
     /* create new vm with old attributes */
-    vmap vm = allocate_vmap(heap_general(kh), p->vmaps, irange(vnew, vnew + maplen), vmflags);
+    vmap vm = allocate_vmap(heap_general(kh), p->vmaps, irange(vnew, vnew + maplen), vmflags,
+                            old_vm->file, old_vm->file_delta + old_addr - vnew);
     if (vm == INVALID_ADDRESS) {
         msg_err("failed to allocate vmap\n");
         deallocate_u64(vh, vnew, maplen);
         return -ENOMEM;
     }
 
+    /* cache pages move along with the mapping; the rest of the file
+       is faulted in as usual */
+    if (vmap_is_file(vm)) {
+        foreach_mapped_page(old_addr, old_size, closure(transient, file_move_page, p, vnew - old_addr));
+        remap_pages(vnew, old_addr, old_size, pages);
+        return sysreturn_from_pointer(vnew);
+    }
+
     /* balance of physical allocation */
     u64 dlen = maplen - old_size;
     u64 dphys = allocate_u64(physical, dlen);
@@ -216,8 +692,10 @@ sysreturn mremap(void *old_address, u64 old_size, u64 new_size, int flags, void
     u64 mapflags = page_map_flags(vmflags);
     thread_log(current, "   mapping and zeroing new portion at 0x%lx, page flags 0x%lx",
                vnew + old_size, mapflags);
-    map(vnew + old_size, dphys, dlen, mapflags, pages);
+    map(vnew + old_size, dphys, dlen, mapflags | PAGE_WRITABLE, pages);
     zero(pointer_from_u64(vnew + old_size), dlen);
+    if (!(mapflags & PAGE_WRITABLE))
+        update_map_flags(vnew + old_size, dlen, mapflags);
 
     return sysreturn_from_pointer(vnew);
 }
@@ -250,11 +728,13 @@ static void mmap_read_complete(thread t, u64 where, u64 mmap_len, boolean mapped
     // mutal misalignment?...discontiguous backing?
     u64 length_padded = pad(length, PAGESIZE);
     u64 p = physical_from_virtual(buffer_ref(b, 0));
+    /* filled while writable (CR0.WP), then given mapflags */
+    u64 fillflags = mapflags | PAGE_WRITABLE;
     if (mapped) {
-        update_map_flags(where, length, mapflags);
+        update_map_flags(where, length, fillflags);
         runtime_memcpy(pointer_from_u64(where), buffer_ref(b, 0), length);
     } else {
-        map(where, p, length_padded, mapflags, pages);
+        map(where, p, length_padded, fillflags, pages);
     }
 
     if (length < length_padded)
@@ -263,11 +743,13 @@ static void mmap_read_complete(thread t, u64 where, u64 mmap_len, boolean mapped
     if (length_padded < mmap_len) {
         u64 bss = pad(mmap_len, PAGESIZE) - length_padded;
         if (!mapped)
-            map(where + length_padded, allocate_u64(physical, bss), bss, mapflags, pages);
+            map(where + length_padded, allocate_u64(physical, bss), bss, fillflags, pages);
         else
-            update_map_flags(where + length_padded, bss, mapflags);
+            update_map_flags(where + length_padded, bss, fillflags);
         zero(pointer_from_u64(where + length_padded), bss);
     }
+    if (!(mapflags & PAGE_WRITABLE))
+        update_map_flags(where, pad(mmap_len, PAGESIZE), mapflags);
 
     if (mapped) {
         deallocate_buffer(b);
@@ -354,13 +836,13 @@ static void vmap_attribute_update_intersection(heap h, rangemap pvmap, vmap q, r
         assert(rangemap_reinsert(pvmap, node, rhl));
 
         /* create node for intersection */
-        vmap mh = allocate_vmap(h, pvmap, ri, newflags);
+        vmap mh = allocate_vmap(h, pvmap, ri, newflags, match->file, match->file_delta);
         assert(mh != INVALID_ADDRESS);
         
         if (tail) {
             /* create node at tail end */
             range rt = { ri.end, rtend };
-            vmap mt = allocate_vmap(h, pvmap, rt, match->flags);
+            vmap mt = allocate_vmap(h, pvmap, rt, match->flags, match->file, match->file_delta);
             assert(mt != INVALID_ADDRESS);
         }
     } else if (tail) {
@@ -369,7 +851,7 @@ static void vmap_attribute_update_intersection(heap h, rangemap pvmap, vmap q, r
         assert(rangemap_reinsert(pvmap, node, rt));
 
         /* create node for intersection */
-        vmap mt = allocate_vmap(h, pvmap, ri, newflags);
+        vmap mt = allocate_vmap(h, pvmap, ri, newflags, match->file, match->file_delta);
         assert(mt != INVALID_ADDRESS);
     } else {
         /* key (range) remains the same, no need to reinsert */
@@ -377,6 +859,30 @@ static void vmap_attribute_update_intersection(heap h, rangemap pvmap, vmap q, r
     }
 }
 
+/* A 2M page only partly covered by an unmap or attribute change is
+   first broken up into 4K pages. */
+static void split_huge_boundaries(range r)
+{
+    fault_counts.splits += split_fat_boundaries(r.start, range_span(r),
+                                                heap_pages(get_kernel_heaps()));
+}
+
+/* Writes to file pages must still fault, to dirty or copy them. */
+static CLOSURE_2_1(vmap_update_map_flags, void, range, u64, rmnode);
+static void vmap_update_map_flags(range q, u64 flags, rmnode node)
+{
+    range ri = range_intersection(q, node->r);
+    if (vmap_is_file((vmap)node))
+        flags &= ~PAGE_WRITABLE;
+    update_map_flags(ri.start, range_span(ri), flags);
+}
+
+static CLOSURE_1_1(gap_update_map_flags, void, u64, range);
+static void gap_update_map_flags(u64 flags, range r)
+{
+    update_map_flags(r.start, range_span(r), flags);
+}
+
 static void vmap_attribute_update(heap h, rangemap pvmap, vmap q)
 {
     range rq = q->node.r;
@@ -387,7 +893,10 @@ static void vmap_attribute_update(heap h, rangemap pvmap, vmap q)
     rmnode_handler nh = closure(h, vmap_attribute_update_intersection, h, pvmap, q);
     rangemap_range_lookup(pvmap, rq, nh);
 
-    update_map_flags(rq.start, range_span(rq), page_map_flags(q->flags));
+    split_huge_boundaries(rq);
+    u64 flags = page_map_flags(q->flags);
+    rangemap_range_lookup(pvmap, rq, closure(h, vmap_update_map_flags, rq, flags));
+    rangemap_range_find_gaps(pvmap, rq, closure(h, gap_update_map_flags, flags));
 }
 
 sysreturn mprotect(void * addr, u64 len, int prot)
@@ -414,6 +923,8 @@ sysreturn mprotect(void * addr, u64 len, int prot)
     struct vmap q;
     q.node.r = r;
     q.flags = new_vmflags;
+    q.file = 0;
+    q.file_delta = 0;
 
     vmap_attribute_update(h, pvmap, &q);
     return 0;
@@ -440,6 +951,8 @@ static void vmap_paint_intersection(heap h, rangemap pvmap, vmap q, rmnode node)
     if (range_equal(ri, rn)) {
         /* key (range) remains the same, no need to reinsert */
         match->flags = q->flags;
+        match->file = q->file;
+        match->file_delta = q->file_delta;
         return;
     }
 
@@ -456,7 +969,7 @@ static void vmap_paint_intersection(heap h, rangemap pvmap, vmap q, rmnode node)
         if (tail) {
             /* create node at tail end */
             range rt = { ri.end, rtend };
-            vmap mt = allocate_vmap(h, pvmap, rt, match->flags);
+            vmap mt = allocate_vmap(h, pvmap, rt, match->flags, match->file, match->file_delta);
             assert(mt != INVALID_ADDRESS);
         }
     } else if (tail) {
@@ -469,7 +982,7 @@ static void vmap_paint_intersection(heap h, rangemap pvmap, vmap q, rmnode node)
 static CLOSURE_3_1(vmap_paint_gap, void, heap, rangemap, vmap, range);
 static void vmap_paint_gap(heap h, rangemap pvmap, vmap q, range r)
 {
-    vmap mt = allocate_vmap(h, pvmap, r, q->flags);
+    vmap mt = allocate_vmap(h, pvmap, r, q->flags, q->file, q->file_delta);
     assert(mt != INVALID_ADDRESS);
 }
 
@@ -486,6 +999,7 @@ static void vmap_paint(heap h, rangemap pvmap, vmap q)
     range_handler rh = closure(h, vmap_paint_gap, h, pvmap, q);
     rangemap_range_find_gaps(pvmap, rq, rh);
 
+    split_huge_boundaries(rq);
     update_map_flags(rq.start, range_span(rq), page_map_flags(q->flags));
 }
 
@@ -528,6 +1042,8 @@ static boolean mmap_reserve_range(process p, range q)
     return true;
 }
 
+static void process_unmap_range(process p, range q);
+
 static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 offset)
 {
     process p = current->p;
@@ -547,6 +1063,15 @@ static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 o
         vmflags |= VMAP_FLAG_EXEC;
     if ((prot & PROT_WRITE))
         vmflags |= VMAP_FLAG_WRITABLE;
+    if ((flags & MAP_SHARED))
+        vmflags |= VMAP_FLAG_SHARED;
+
+    file f = 0;
+    if (!(flags & MAP_ANONYMOUS)) {
+        if (offset & MASK(PAGELOG))
+            return -EINVAL;
+        f = resolve_fd(p, fd);
+    }
 
     /* Don't really try to honor a hint, only fixed. */
     boolean fixed = (flags & MAP_FIXED) != 0;
@@ -560,6 +1085,7 @@ static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 o
         /* A specified address is only allowed in certain areas. Programs may specify
            a fixed address to augment some existing mapping. */
         range q = irange(where, where + len);
+        process_unmap_range(p, q);
         if (!mmap_reserve_range(p, q)) {
             if (fixed) {
                 thread_log(current, "   fail: fixed address range %R outside of lowmem or virtual_page heap\n", q);
@@ -584,10 +1110,17 @@ static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 o
         }
     }
 
+    /* File pages are faulted in from the page cache, if there is one. */
+    struct pagecache_stats cs;
+    filesystem_get_cache_stats(p->fs, &cs);
+    boolean demand_paged = f && cs.limit > 0;
+
     /* Paint into process vmap */
     struct vmap q;
     q.flags = vmflags;
     q.node.r = irange(where, where + len);
+    q.file = demand_paged ? f->n : 0;
+    q.file_delta = offset - where;
     vmap_paint(h, p->vmaps, &q);
 
     if (flags & MAP_ANONYMOUS) {
@@ -597,7 +1130,14 @@ static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 o
         return where;
     }
 
-    file f = resolve_fd(current->p, fd);
+    if (demand_paged) {
+        thread_log(current, "   file target: 0x%lx, len: 0x%lx, offset 0x%lx", where, len, offset);
+        /* pages left from a fixed mapping over memory outside any vmap */
+        if (fixed)
+            unmap_pages(where, len);
+        return where;
+    }
+
     thread_log(current, "  read file at 0x%lx, %s map, blocking...", where, mapped ? "existing" : "new");
 
     heap mh = heap_backed(kh);
@@ -607,11 +1147,44 @@ static sysreturn mmap(void *target, u64 size, int prot, int flags, int fd, u64 o
     runloop();
 }
 
-static CLOSURE_1_1(dealloc_phys_page, void, heap, range);
-static void dealloc_phys_page(heap physical, range r)
+/* Set up a private mapping at a fixed address for the kernel's own use,
+   such as a program segment: of the given file from offset, to be
+   paged in on access, or anonymous if file is 0. */
+void mmap_private(process p, u64 vaddr, u64 length, int prot, tuple file, u64 offset)
+{
+    struct vmap q;
+    q.flags = VMAP_FLAG_MMAP | (file ? 0 : VMAP_FLAG_ANONYMOUS);
+    if ((prot & PROT_EXEC))
+        q.flags |= VMAP_FLAG_EXEC;
+    if ((prot & PROT_WRITE))
+        q.flags |= VMAP_FLAG_WRITABLE;
+    q.node.r = irange(vaddr, vaddr + pad(length, PAGESIZE));
+    q.file = file;
+    q.file_delta = offset - vaddr;
+    vmap_paint(heap_general(get_kernel_heaps()), p->vmaps, &q);
+}
+
+static CLOSURE_1_1(dealloc_phys_page, void, process, range);
+static void dealloc_phys_page(process p, range r)
 {
-    if (!id_heap_set_area(physical, r.start, range_span(r), true, false))
-        msg_err("some of physical range %R not allocated in heap\n", r);
+    user_release_physical(p, r);
+}
+
+/* A shared page mapped writable may have been written since it was
+   dirtied, so it is dirtied again before letting go of it. Pages not
+   from the cache are private copies or lie past the end of file. */
+static CLOSURE_3_3(file_unmap_page, void, process, tuple, boolean, u64, physical, u64);
+static void file_unmap_page(process p, tuple file, boolean shared, u64 vaddr, physical paddr, u64 flags)
+{
+    fspage pg = table_find(p->file_pages, pointer_from_u64(vaddr));
+    if (!pg) {
+        user_release_physical(p, irange(paddr, paddr + PAGESIZE));
+        return;
+    }
+    table_set(p->file_pages, pointer_from_u64(vaddr), 0);
+    if (shared && (flags & PAGE_WRITABLE))
+        file_page_dirty(p, file, pg);
+    user_release_fspage(p, pg);
 }
 
 static CLOSURE_2_1(process_unmap_intersection, void, process, range, rmnode);
@@ -638,7 +1211,8 @@ static void process_unmap_intersection(process p, range rq, rmnode node)
         if (tail) {
             /* create node for tail end */
             range rt = { ri.end, rtend };
-            vmap mt = allocate_vmap(heap_general(kh), p->vmaps, rt, match->flags);
+            vmap mt = allocate_vmap(heap_general(kh), p->vmaps, rt, match->flags,
+                                    match->file, match->file_delta);
             assert(mt != INVALID_ADDRESS);
         }
     } else if (tail) {
@@ -652,7 +1226,14 @@ static void process_unmap_intersection(process p, range rq, rmnode node)
 
     /* unmap any mapped pages and return to physical heap */
     u64 len = range_span(ri);
-    unmap_pages_with_handler(ri.start, len, closure(heap_general(kh), dealloc_phys_page, heap_physical(kh)));
+    if (vmap_is_file(match)) {
+        foreach_mapped_page(ri.start, len, closure(transient, file_unmap_page, p, match->file,
+                                                   (match->flags & VMAP_FLAG_SHARED) != 0));
+        unmap_pages(ri.start, len);
+    } else {
+        split_huge_boundaries(ri);
+        unmap_pages_with_handler(ri.start, len, closure(heap_general(kh), dealloc_phys_page, p));
+    }
 
     /* return virtual mapping to heap, if any ... assuming a vmap cannot span heaps!
        XXX: this shouldn't be a lookup per, so consider stashing a link to varea or heap in vmap
@@ -686,6 +1267,55 @@ static sysreturn munmap(void *addr, u64 length)
     return 0;
 }
 
+static CLOSURE_2_3(file_sync_page, void, process, tuple, u64, physical, u64);
+static void file_sync_page(process p, tuple file, u64 vaddr, physical paddr, u64 flags)
+{
+    fspage pg = table_find(p->file_pages, pointer_from_u64(vaddr));
+    if (pg && (flags & PAGE_WRITABLE))
+        file_page_dirty(p, file, pg);
+}
+
+static CLOSURE_3_1(msync_vmap, void, process, range, boolean *, rmnode);
+static void msync_vmap(process p, range q, boolean *dirty, rmnode node)
+{
+    vmap vm = (vmap)node;
+    if (!vmap_is_file(vm) || !(vm->flags & VMAP_FLAG_SHARED))
+        return;
+    range ri = range_intersection(q, node->r);
+    foreach_mapped_page(ri.start, range_span(ri), closure(transient, file_sync_page, p, vm->file));
+    *dirty = true;
+}
+
+static CLOSURE_1_1(msync_complete, void, thread, status);
+static void msync_complete(thread t, status s)
+{
+    set_syscall_return(t, is_ok(s) ? 0 : -EIO);
+    thread_wakeup(t);
+}
+
+/* Stores through shared mappings are already in the page cache; this
+   just makes sure the pages are marked dirty and, for MS_SYNC, waits
+   for them to be written out. */
+static sysreturn msync(void *addr, u64 length, int flags)
+{
+    process p = current->p;
+    thread_log(current, "msync: addr %p, size 0x%lx, flags 0x%x", addr, length, flags);
+
+    u64 where = u64_from_pointer(addr);
+    if ((where & MASK(PAGELOG)) || (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) ||
+        ((flags & MS_ASYNC) && (flags & MS_SYNC)))
+        return -EINVAL;
+
+    boolean dirty = false;
+    range q = irange(where, where + pad(length, PAGESIZE));
+    rangemap_range_lookup(p->vmaps, q, closure(transient, msync_vmap, p, q, &dirty));
+    if (!dirty || !(flags & MS_SYNC))
+        return 0;
+
+    filesystem_sync(p->fs, closure(heap_general(get_kernel_heaps()), msync_complete, current));
+    thread_sleep(current);
+}
+
 /* kernel start */
 extern void * START;
 
@@ -697,6 +1327,10 @@ void mmap_process_init(process p)
     heap h = heap_general((kernel_heaps)p->uh);
     p->vareas = allocate_rangemap(h);
     p->vmaps = allocate_rangemap(h);
+    p->file_pages = allocate_table(h, identity_key, pointer_equal);
+    p->dma_holds = 0;
+    p->held_physical = allocate_buffer(h, 4 * sizeof(range));
+    p->held_pages = allocate_vector(h, 4);
     assert(p->vareas != INVALID_ADDRESS && p->vmaps != INVALID_ADDRESS);
 
     /* It may be more elegant to put these into a table... */
@@ -735,5 +1369,6 @@ void register_mmap_syscalls(struct syscall *map)
     register_syscall(map, mremap, mremap);
     register_syscall(map, munmap, munmap);
     register_syscall(map, mprotect, mprotect);
+    register_syscall(map, msync, msync);
     register_syscall(map, madvise, syscall_ignore);
 }
@@ -55,6 +55,8 @@ void notify_dispatch(notify_set s, u32 events)
     if (!l)
         return;
 
+    notify_entry taker = 0;
+
     /* XXX not using list foreach because of intermediate
        deletes... make a macro for that */
     do {
@@ -64,10 +66,20 @@ void notify_dispatch(notify_set s, u32 events)
         /* no guarantee that a transition is represented here; event
            handler needs to keep track itself if edge trigger is used */
         assert(n->eh);
-        apply(n->eh, events & n->eventmask);
+        if (!(n->eventmask & EPOLLEXCLUSIVE)) {
+            apply(n->eh, events & n->eventmask);
+        } else if (!taker) {
+            if (apply(n->eh, events & n->eventmask))
+                taker = n;
+        }
 
         l = next;
     } while(l != &s->entries);
+
+    if (taker) {
+        list_delete(&taker->l);
+        list_insert_before(&s->entries, &taker->l);
+    }
     /* XXX release mutex */
 }
 
@@ -1,7 +1,8 @@
 typedef struct notify_set *notify_set;
 typedef struct notify_entry *notify_entry;
 
-typedef closure_type(event_handler, void, u32 events);
+/* An event_handler returns true if it handed the events to a waiter. */
+typedef closure_type(event_handler, boolean, u32 events);
 
 /* NOTIFY_EVENTS_RELEASE is a special value of events to signal to the
    event_handler that a notify_set is being deallocated.
@@ -17,6 +18,9 @@ notify_entry notify_add(notify_set s, u32 eventmask, event_handler eh);
 
 void notify_remove(notify_set s, notify_entry e);
 
+/* Entries added with EPOLLEXCLUSIVE in their eventmask share events:
+   dispatch stops offering them once one has taken the events, and that
+   entry moves to the back so the next events go to another first. */
 void notify_dispatch(notify_set s, u32 events);
 
 void notify_release(notify_set s);
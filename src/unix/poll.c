@@ -17,7 +17,10 @@ typedef struct epollfd {
     epoll e;
     boolean registered;
     boolean zombie;		/* freed or masked by oneshot */
+    boolean onready;		/* queued on e->ready_head */
     notify_entry notify_handle;
+    fdesc f;			/* valid while registered */
+    struct list ready_list;
 } *epollfd;
 
 typedef struct epoll_blocked *epoll_blocked;
@@ -54,8 +57,8 @@ struct epoll_blocked {
 
 struct epoll {
     struct fdesc f;             /* must be first */
-    // xxx - multiple threads can block on the same e with epoll_wait
-    struct list blocked_head;
+    struct list blocked_head;	/* waiters, oldest first */
+    struct list ready_head;	/* epollfds with events pending (epoll only) */
     vector events;		/* epollfds indexed by fd */
     int nfds;
     bitmap fds;			/* fds being watched / epollfd registered */
@@ -84,6 +87,8 @@ static epollfd alloc_epollfd(epoll e, int fd, u32 eventmask, u64 data)
     efd->refcnt = 1;
     efd->registered = false;
     efd->zombie = false;
+    efd->onready = false;
+    efd->f = 0;
     vector_set(e->events, fd, efd);
     bitmap_set(e->fds, fd, 1);
     if (fd >= e->nfds)
@@ -123,6 +128,10 @@ static void free_epollfd(epollfd efd)
     bitmap_set(e->fds, fd, 0);
     assert(efd->refcnt > 0);
     efd->zombie = true;
+    if (efd->onready) {
+        list_delete(&efd->ready_list);
+        efd->onready = false;
+    }
     if (efd->registered)
         unregister_epollfd(efd);
     release_epollfd(efd);
@@ -139,6 +148,7 @@ boolean register_epollfd(epollfd efd, event_handler eh)
         return false; // XXX
     fdesc f = resolve_fd(current->p, efd->fd);
     efd->registered = true;
+    efd->f = f;
     fetch_and_add(&efd->refcnt, 1);
     epoll_debug("fd %d, eventmask 0x%x, handler %p\n", efd->fd, efd->eventmask, eh);
     efd->notify_handle = notify_add(f->ns, efd->eventmask | (EPOLLERR | EPOLLHUP), eh);
@@ -177,6 +187,7 @@ sysreturn epoll_create(int flags)
     init_fdesc(h, &e->f, FDESC_TYPE_EPOLL);
     e->f.close = closure(h, epoll_close, e);
     list_init(&e->blocked_head);
+    list_init(&e->ready_head);
     e->events = allocate_vector(h, 8);
     if (e->events == INVALID_ADDRESS) {
 	rv = -ENOMEM;
@@ -227,6 +238,10 @@ static void epoll_blocked_finish(epoll_blocked w, boolean timedout)
 #endif
     heap h = heap_general(get_kernel_heaps());
 
+    /* the timer is freed after firing */
+    if (timedout)
+        w->timeout = 0;
+
     if (w->sleeping) {
         w->sleeping = false;
         thread_wakeup(w->t);
@@ -259,18 +274,16 @@ static void epoll_blocked_finish(epoll_blocked w, boolean timedout)
 	epoll_debug("   syscall return %ld\n", rv);
 	set_syscall_return(w->t, rv);
 
-	/* We'll let the timeout run to expiry until we can be sure
-	   that we have a race-free way to disable the timer if waking
-	   on an event.
-
-	   XXX This will have to be revisited, for we'll accumulate a
-	   bunch of zombie epoll_blocked and timer objects until they
-	   start timing out.
-	*/
-#ifdef EPOLL_DEBUG
-	if (w->timeout && !timedout)
-	    epoll_debug("      timer remains; refcount %ld\n", w->refcnt);
-#endif
+	/* Drop the reference held by the timeout, cancelling it if
+	   woken on an event. */
+	if (timedout) {
+	    epoll_blocked_release(w);
+	} else if (w->timeout) {
+	    epoll_debug("      removing timer; refcount %ld\n", w->refcnt);
+	    remove_timer(w->timeout);
+	    w->timeout = 0;
+	    epoll_blocked_release(w);
+	}
 	epoll_blocked_release(w);
     } else if (timedout) {
 	epoll_debug("   timer expiry after syscall return; ignored\n");
@@ -296,45 +309,113 @@ static inline u32 report_from_notify_events(epollfd efd, u32 events)
     return edge_detect ? ~efd->lastevents & events : events;
 }
 
-static CLOSURE_1_1(epoll_wait_notify, void, epollfd, u32);
-static void epoll_wait_notify(epollfd efd, u32 events)
+/* Fill the waiter's buffer from the ready list. Each epollfd is polled
+   again for its current state, for the events that queued it may have
+   since been consumed. Level-triggered fds that are still ready are
+   moved to requeue, to go back on the ready list and be polled again on
+   the next wait, so the cost of a wait depends only on the number of
+   fds with events pending and not on the number registered. Returns
+   true if events for target were reported. */
+static boolean epoll_report_ready(epoll e, epoll_blocked w, list requeue, epollfd target)
 {
-    list l = list_get_next(&efd->e->blocked_head);
+    buffer b = w->user_events;
+    boolean reported = false;
+    list l;
+
+    while ((b->length - b->end) >= sizeof(struct epoll_event) &&
+           (l = list_get_next(&e->ready_head))) {
+        epollfd efd = struct_from_list(l, epollfd, ready_list);
+        list_delete(l);
+        efd->onready = false;
+        if (efd->zombie || !efd->registered)
+            continue;
+
+        u32 report = report_from_notify_events(efd, apply(efd->f->events) & efd->eventmask);
+        if (!report)
+            continue;
+
+        struct epoll_event *ev = buffer_ref(b, b->end);
+        ev->data = efd->data;
+        ev->events = report;
+        b->end += sizeof(struct epoll_event);
+        epoll_debug("   fd %d, epoll_event %p, data 0x%lx, events 0x%x\n",
+                    efd->fd, ev, ev->data, ev->events);
+        if (efd == target)
+            reported = true;
+
+        if (efd->eventmask & EPOLLONESHOT) {
+            efd->zombie = true;
+        } else if (!(efd->eventmask & EPOLLET)) {
+            list_push_back(requeue, l);
+            efd->onready = true;
+        }
+
+        /* now that we've reported these events, update last */
+        efd->lastevents |= report;
+    }
+    return reported;
+}
+
+static void epoll_requeue(epoll e, list requeue)
+{
+    list l;
+    while ((l = list_get_next(requeue))) {
+        list_delete(l);
+        list_push_back(&e->ready_head, l);
+    }
+}
+
+/* Hand the ready list out to the threads sleeping in epoll_wait, oldest
+   first, going on to the next waiter while events remain. Level-triggered
+   fds return to the ready list only after the pass, so one event wakes
+   one thread. Returns true if efd's events went to a waiter. */
+static boolean epoll_distribute(epoll e, epollfd efd)
+{
+    struct list requeue;
+    boolean taken = false;
+
+    list_init(&requeue);
+    list_foreach(&e->blocked_head, l) {
+        if (list_empty(&e->ready_head))
+            break;
+        epoll_blocked w = struct_from_list(l, epoll_blocked, blocked_list);
+        if (!w->sleeping)
+            continue;
+        if (epoll_report_ready(e, w, &requeue, efd))
+            taken = true;
+        if (w->user_events->end)
+            epoll_blocked_finish(w, false);
+    }
+    epoll_requeue(e, &requeue);
+    return taken;
+}
+
+static CLOSURE_1_1(epoll_wait_notify, boolean, epollfd, u32);
+static boolean epoll_wait_notify(epollfd efd, u32 events)
+{
+    epoll e = efd->e;
 
     if (events == NOTIFY_EVENTS_RELEASE) {
+        /* the file is gone; drop the registration like Linux does */
         epoll_debug("efd->fd %d unregistered\n", efd->fd);
         efd->registered = false;
-        return;
+        if (vector_get(e->events, efd->fd) == efd)
+            free_epollfd(efd);
+        return false;
     }
 
-    epoll_blocked w = l ? struct_from_list(l, epoll_blocked, blocked_list) : 0;
     u32 report = report_from_notify_events(efd, events);
     assert(efd->registered);
-    epoll_debug("efd->fd %d, events 0x%x, report 0x%x, blocked %p, zombie %d\n",
-                efd->fd, events, report, w, efd->zombie);
-
-    /* XXX need to do some work to properly dole out to multiple epoll_waits (threads)... */
-    if (report && w && !efd->zombie) {
-	if (w->user_events && (w->user_events->length - w->user_events->end)) {
-	    struct epoll_event *e = buffer_ref(w->user_events, w->user_events->end);
-	    e->data = efd->data;
-	    e->events = report;
-	    w->user_events->end += sizeof(struct epoll_event);
-	    epoll_debug("   epoll_event %p, data 0x%lx, events 0x%x\n", e, e->data, e->events);
-
-            /* XXX check this */
-	    if (efd->eventmask & EPOLLONESHOT)
-		efd->zombie = true;
-
-            /* now that we've reported these events, update last */
-            efd->lastevents |= report;
-	} else {
-            /* XXX here we should advance to the next blocked head, probably */
-	    epoll_debug("   user_events null or full\n");
-	    return;
-	}
-	epoll_blocked_finish(w, false);
+    epoll_debug("efd->fd %d, events 0x%x, report 0x%x, onready %d, zombie %d\n",
+                efd->fd, events, report, efd->onready, efd->zombie);
+    if (!report || efd->zombie)
+        return false;
+
+    if (!efd->onready) {
+        list_push_back(&e->ready_head, &efd->ready_list);
+        efd->onready = true;
     }
+    return epoll_distribute(e, efd);
 }
 
 static epoll_blocked alloc_epoll_blocked(epoll e)
@@ -347,7 +428,7 @@ static epoll_blocked alloc_epoll_blocked(epoll e)
     w->e = e;
     w->sleeping = false;
     w->timeout = 0;
-    list_insert_after(&e->blocked_head, &w->blocked_list); /* push */
+    list_push_back(&e->blocked_head, &w->blocked_list);
     return w;
 }
 
@@ -361,8 +442,12 @@ static void check_fdesc(fdesc f)
    - notify on a match only once until condition is reset (EPOLLET)
    - notify once before removing the registration, handled upstream (EPOLLONESHOT)
    - notify only one matching waiter, even across multiple epoll instances (EPOLLEXCLUSIVE)
-     - XXX Not implemented; will require tracking reported events on a per fd - not per
-           registration - basis.
+     - an instance with no thread waiting still queues the events, so as
+       with Linux more than one may see them; events consumed by then are
+       filtered out when the ready list is polled
+
+   Threads waiting on the same instance each get their own share of the
+   ready list; see epoll_distribute.
 */
 sysreturn epoll_wait(int epfd,
                struct epoll_event *events,
@@ -380,27 +465,10 @@ sysreturn epoll_wait(int epfd,
     w->user_events = wrap_buffer(h, events, maxevents * sizeof(struct epoll_event));
     w->user_events->end = 0;
 
-    bitmap_foreach_set(e->fds, fd) {
-	epollfd efd = vector_get(e->events, fd);
-	assert(efd);
-        assert(efd->fd == fd);
-
-        if (efd->zombie)
-            continue;
-
-        fdesc f = resolve_fd_noret(current->p, efd->fd);
-        if (!f) {
-            epoll_debug("   x fd %d\n", efd->fd);
-            free_epollfd(efd);
-            continue;
-        }
-
-        /* event transitions may in some cases need to be polled for
-           (e.g. due to change in lwIP internal state), so request a check */
-        if (efd->registered)
-            check_fdesc(f);
-    }
-
+    struct list requeue;
+    list_init(&requeue);
+    epoll_report_ready(e, w, &requeue, 0);
+    epoll_requeue(e, &requeue);
     int eventcount = w->user_events->end/sizeof(struct epoll_event);
     if (timeout == 0 || w->user_events->end) {
 	epoll_debug("   immediate return; eventcount %d\n", eventcount);
@@ -409,7 +477,8 @@ sysreturn epoll_wait(int epfd,
     }
 
     if (timeout > 0) {
-	w->timeout = register_timer(milliseconds(timeout), closure(h, epoll_blocked_finish, w, true));
+	w->timeout = register_timer_slack(milliseconds(timeout), USER_TIMER_SLACK,
+                                          closure(h, epoll_blocked_finish, w, true));
 	fetch_and_add(&w->refcnt, 1);
 	epoll_debug("   registered timer %p\n", w->timeout);
     }
@@ -436,11 +505,9 @@ static sysreturn epoll_add_fd(epoll e, int fd, u32 events, u64 data)
     assert(f);
     register_epollfd(efd, closure(heap_general(get_kernel_heaps()), epoll_wait_notify, efd));
 
-    /* apply check if we have a waiter */
-    if (!list_empty(&efd->e->blocked_head)) {
-        epoll_debug("   posting check for blocked waiter\n");
-        check_fdesc(f);
-    }
+    /* sources only notify on transitions, so queue the fd now if it's
+       already ready; this also completes a blocked waiter */
+    epoll_wait_notify(efd, apply(f->events) & efd->eventmask);
 
     return 0;
 }
@@ -456,15 +523,19 @@ static sysreturn remove_fd(epoll e, int fd)
     return 0;
 }
 
+#define EPOLLEXCLUSIVE_OK_BITS (EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLRDBAND |      \
+                                EPOLLWRNORM | EPOLLWRBAND | EPOLLERR | EPOLLHUP |   \
+                                EPOLLWAKEUP | EPOLLET | EPOLLEXCLUSIVE)
+
 sysreturn epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
 {
     epoll e = resolve_fd(current->p, epfd);    
     epoll_debug("epoll fd %d, op %d, fd %d\n", epfd, op, fd);
     fdesc f = resolve_fd(current->p, fd);
 
-    /* EPOLLEXCLUSIVE not yet implemented */
-    if (event->events & EPOLLEXCLUSIVE) {
-        msg_err("add: EPOLLEXCLUSIVE not supported\n");
+    /* as Linux: exclusive only on add, and only with these flags */
+    if ((event->events & EPOLLEXCLUSIVE) &&
+        (op != EPOLL_CTL_ADD || (event->events & ~EPOLLEXCLUSIVE_OK_BITS))) {
         return set_syscall_error(current, EINVAL);
     }
 
@@ -498,15 +569,15 @@ sysreturn epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
 #define POLLFDMASK_WRITE	(EPOLLOUT | EPOLLHUP | EPOLLERR)
 #define POLLFDMASK_EXCEPT	(EPOLLPRI)
 
-static CLOSURE_1_1(select_notify, void, epollfd, u32);
-static void select_notify(epollfd efd, u32 events)
+static CLOSURE_1_1(select_notify, boolean, epollfd, u32);
+static boolean select_notify(epollfd efd, u32 events)
 {
     list l = list_get_next(&efd->e->blocked_head);
 
     if (events == NOTIFY_EVENTS_RELEASE) {
         epoll_debug("efd->fd %d unregistered\n", efd->fd);
         efd->registered = false;
-        return;
+        return false;
     }
 
     epoll_blocked w = l ? struct_from_list(l, epoll_blocked, blocked_list) : 0;
@@ -534,8 +605,10 @@ static void select_notify(epollfd efd, u32 events)
 	    fetch_and_add(&w->retcount, count);
 	    epoll_debug("   event on %d, events 0x%x\n", efd->fd, events);
 	    epoll_blocked_finish(w, false);
+	    return true;
 	}
     }
+    return false;
 }
 
 static epoll select_get_epoll()
@@ -548,6 +621,7 @@ static epoll select_get_epoll()
 	    return INVALID_ADDRESS;
  	e = (epoll)f;
 	list_init(&e->blocked_head);
+	list_init(&e->ready_head);
 	e->events = allocate_vector(h, 8);
 	assert(e->events != INVALID_ADDRESS);
 	e->fds = allocate_bitmap(h, infinity);
@@ -685,7 +759,8 @@ static sysreturn select_internal(int nfds,
     }
 
     if (timeout != infinity) {
-	w->timeout = register_timer(timeout, closure(h, epoll_blocked_finish, w, true));
+	w->timeout = register_timer_slack(timeout, USER_TIMER_SLACK,
+                                          closure(h, epoll_blocked_finish, w, true));
 	fetch_and_add(&w->refcnt, 1);
 	epoll_debug("   registered timer %p\n", w->timeout);
     }
@@ -711,15 +786,15 @@ sysreturn select(int nfds,
     return select_internal(nfds, readfds, writefds, exceptfds, timeout ? time_from_timeval(timeout) : infinity, 0);
 }
 
-static CLOSURE_1_1(poll_notify, void, epollfd, u32);
-static void poll_notify(epollfd efd, u32 events)
+static CLOSURE_1_1(poll_notify, boolean, epollfd, u32);
+static boolean poll_notify(epollfd efd, u32 events)
 {
     list l = list_get_next(&efd->e->blocked_head);
 
     if (events == NOTIFY_EVENTS_RELEASE) {
         epoll_debug("efd->fd %d unregistered\n", efd->fd);
         efd->registered = false;
-        return;
+        return false;
     }
 
     epoll_blocked w = l ? struct_from_list(l, epoll_blocked, blocked_list) : 0;
@@ -733,7 +808,9 @@ static void poll_notify(epollfd efd, u32 events)
         pfd->revents = events;
         epoll_debug("   event on %d (%d), events 0x%x\n", efd->fd, pfd->fd, pfd->revents);
         epoll_blocked_finish(w, false);
+        return true;
     }
+    return false;
 }
 
 static sysreturn poll_internal(struct pollfd *fds, nfds_t nfds,
@@ -834,7 +911,8 @@ check_rv_timeout:
     }
 
     if (timeout != infinity) {
-        w->timeout = register_timer(timeout, closure(h, epoll_blocked_finish, w, true));
+        w->timeout = register_timer_slack(timeout, USER_TIMER_SLACK,
+                                          closure(h, epoll_blocked_finish, w, true));
         fetch_and_add(&w->refcnt, 1);
         epoll_debug("   registered timer %p\n", w->timeout);
     }
@@ -35,7 +35,6 @@ sysreturn close(int fd);
 void register_other_syscalls(struct syscall *map)
 {
     register_syscall(map, rt_sigreturn, 0);
-    register_syscall(map, msync, 0);
     register_syscall(map, shmget, 0);
     register_syscall(map, shmat, 0);
     register_syscall(map, shmctl, 0);
@@ -233,7 +232,6 @@ void register_other_syscalls(struct syscall *map)
     register_syscall(map, clock_adjtime, 0);
     register_syscall(map, syncfs, 0);
     register_syscall(map, setns, 0);
-    register_syscall(map, getcpu, 0);
     register_syscall(map, process_vm_readv, 0);
     register_syscall(map, process_vm_writev, 0);
     register_syscall(map, kcmp, 0);
@@ -450,6 +448,12 @@ static sysreturn iov_internal(file f, io op, struct iovec *iov, int iovcnt)
     if (!op || iovcnt < 0) {
         return set_syscall_error(current, EINVAL);
     }
+    if (!fault_in_user_range(iov, iovcnt * sizeof(struct iovec)))
+        return set_syscall_error(current, EFAULT);
+    for (int i = 0; i < iovcnt; i++) {
+        if (!fault_in_user_range(iov[i].iov_base, iov[i].iov_len))
+            return set_syscall_error(current, EFAULT);
+    }
     heap h = heap_general(get_kernel_heaps());
     struct iov_progress *progress = allocate(h, sizeof(struct iov_progress));
     runtime_memset((void *)progress, 0, sizeof(*progress));
@@ -462,6 +466,8 @@ sysreturn read(int fd, u8 *dest, bytes length)
     fdesc f = resolve_fd(current->p, fd);
     if (!f->read)
         return set_syscall_error(current, EINVAL);
+    if (!fault_in_user_range(dest, length))
+        return set_syscall_error(current, EFAULT);
     io_completion completion = closure(heap_general(get_kernel_heaps()),
             syscall_io_complete);
 
@@ -474,6 +480,8 @@ sysreturn pread(int fd, u8 *dest, bytes length, s64 offset)
     fdesc f = resolve_fd(current->p, fd);
     if (!f->read || offset < 0)
         return set_syscall_error(current, EINVAL);
+    if (!fault_in_user_range(dest, length))
+        return set_syscall_error(current, EFAULT);
     io_completion completion = closure(heap_general(get_kernel_heaps()),
             syscall_io_complete);
 
@@ -492,6 +500,8 @@ sysreturn write(int fd, u8 *body, bytes length)
     fdesc f = resolve_fd(current->p, fd);
     if (!f->write)
         return set_syscall_error(current, EINVAL);
+    if (!fault_in_user_range(body, length))
+        return set_syscall_error(current, EFAULT);
     io_completion completion = closure(heap_general(get_kernel_heaps()),
             syscall_io_complete);
 
@@ -510,6 +520,8 @@ sysreturn pwrite(int fd, u8 *body, bytes length, s64 offset)
     fdesc f = resolve_fd(current->p, fd);
     if (!f->write || offset < 0)
         return set_syscall_error(current, EINVAL);
+    if (!fault_in_user_range(body, length))
+        return set_syscall_error(current, EFAULT);
 
     io_completion completion = closure(heap_general(get_kernel_heaps()),
             syscall_io_complete);
@@ -567,40 +579,137 @@ static void file_op_complete(thread t, file f, fsfile fsf,
     apply(completion, t, rv);
 }
 
-static CLOSURE_5_2(sendfile_complete, void,
-        heap, file, int *, void *, bytes,
-        thread, sysreturn);
-static void sendfile_complete(heap h, file in, int *offset, void *buf,
-        bytes len, thread t, sysreturn rv)
+/* sendfile() moves data in chunks of this size. If the output supports
+   sendpage, each chunk is pinned in the page cache and handed over by
+   reference; otherwise it goes through a single bounce buffer. */
+#define SENDFILE_CHUNK_SIZE (64 * KB)
+
+typedef struct sendfile_state {
+    heap h;
+    thread t;
+    file in;
+    fdesc out;
+    s64 *offset;
+    u64 read_offset;
+    u64 remain;
+    u64 sent;
+    u64 chunk;                  /* length of the chunk in progress */
+    void *buf;                  /* bounce buffer, if not using sendpage */
+    boolean running;            /* sendfile_continue() is on the stack */
+    boolean again;
+    boolean done;
+    io_completion write_complete;
+} *sendfile_state;
+
+static void sendfile_finish(sendfile_state st, sysreturn rv)
+{
+    if (st->sent > 0) {
+        if (!st->offset)
+            st->in->offset += st->sent;
+        else
+            *st->offset += st->sent;
+        rv = st->sent;
+    }
+    if (st->buf)
+        deallocate(st->h, st->buf, SENDFILE_CHUNK_SIZE);
+    set_syscall_return(st->t, rv);
+    thread_wakeup(st->t);
+    if (st->running)
+        st->done = true;
+    else
+        deallocate(st->h, st, sizeof(struct sendfile_state));
+}
+
+static void sendfile_next(sendfile_state st);
+
+/* Completions may arrive synchronously; loop here rather than recursing
+   once per chunk. */
+static void sendfile_continue(sendfile_state st)
 {
-    if (rv > 0) {
-        if (!offset) {
-            in->offset += rv;
-        } else {
-             *offset += rv;
-        }
+    if (st->running) {
+        st->again = true;
+        return;
     }
-    deallocate(h, buf, len);
-    set_syscall_return(t, rv);
-    thread_wakeup(t);
+    st->running = true;
+    do {
+        st->again = false;
+        sendfile_next(st);
+    } while (st->again);
+    st->running = false;
+    if (st->done)
+        deallocate(st->h, st, sizeof(struct sendfile_state));
 }
 
-static CLOSURE_6_2(sendfile_read_complete, void, heap, thread, file, fdesc, int*, void*, status, bytes);
-static void sendfile_read_complete(heap h, thread t, file in, fdesc out, int* offset, void* buf, status s, bytes length)
+static CLOSURE_1_2(sendfile_write_complete, void, sendfile_state, thread, sysreturn);
+static void sendfile_write_complete(sendfile_state st, thread t, sysreturn rv)
 {
-    sysreturn rv;
-    io_completion completion = closure(h, sendfile_complete, h, in, offset,
-            buf, length);
-    if (is_ok(s)) {
-        rv = apply(out->write, buf, length, 0, t, true, completion);
+    if (rv <= 0) {
+        sendfile_finish(st, rv);
+        return;
+    }
+    st->sent += rv;
+    st->read_offset += rv;
+    st->remain -= rv;
+    if (st->remain == 0) {
+        sendfile_finish(st, 0);
+        return;
+    }
+    sendfile_continue(st);
+}
+
+static inline void sendfile_write_chunk(sendfile_state st, sysreturn rv)
+{
+    if (rv != infinity)
+        apply(st->write_complete, st->t, rv);
+}
+
+static CLOSURE_1_2(sendfile_read_complete, void, sendfile_state, status, bytes);
+static void sendfile_read_complete(sendfile_state st, status s, bytes length)
+{
+    if (!is_ok(s) || length == 0) {
+        sendfile_finish(st, is_ok(s) ? 0 : -EIO);
+        return;
+    }
+    sendfile_write_chunk(st, apply(st->out->write, st->buf, length, infinity, st->t,
+                                   true, st->write_complete));
+}
+
+static CLOSURE_1_2(sendfile_pages_complete, void, sendfile_state, status, vector);
+static void sendfile_pages_complete(sendfile_state st, status s, vector pages)
+{
+    if (!is_ok(s)) {
+        sendfile_finish(st, -EIO);
+        return;
+    }
+    /* the file may have shrunk since the chunk was sized */
+    u64 length = 0;
+    if (vector_length(pages) > 0) {
+        fspage last = vector_get(pages, vector_length(pages) - 1);
+        length = MIN(st->chunk, fspage_offset(last) + PAGESIZE - st->read_offset);
+    }
+    if (length == 0) {
+        fspages_release(pages);
+        sendfile_finish(st, 0);
+        return;
+    }
+    sendfile_write_chunk(st, apply(st->out->sendpage, pages, st->read_offset, length,
+                                   st->t, true, st->write_complete));
+}
+
+static void sendfile_next(sendfile_state st)
+{
+    st->chunk = MIN(st->remain, SENDFILE_CHUNK_SIZE);
+    if (!st->buf) {
+        filesystem_get_pages(st->t->p->fs, st->in->n, st->read_offset, st->chunk,
+                             closure(st->h, sendfile_pages_complete, st));
     } else {
-        rv = -EIO;
+        filesystem_read(st->t->p->fs, st->in->n, st->buf, st->chunk, st->read_offset,
+                        closure(st->h, sendfile_read_complete, st));
     }
-    apply(completion, t, rv);
 }
 
 // in_fd need to a regular file.
-static sysreturn sendfile(int out_fd, int in_fd, int *offset, bytes count)
+static sysreturn sendfile(int out_fd, int in_fd, s64 *offset, bytes count)
 {
     file infile = resolve_fd(current->p, in_fd);
     fdesc outfile = resolve_fd(current->p, out_fd);
@@ -613,25 +722,42 @@ static sysreturn sendfile(int out_fd, int in_fd, int *offset, bytes count)
 
     if (!infile->f.read || !outfile->write)
         return set_syscall_error(current, EINVAL);
-    
-    if ((infile->offset + count) > infile->length)
-        return set_syscall_error(current, EINVAL);
-    
-    void *buf = allocate(h, count);
-    u64 read_offset = 0;
-    if(!offset) {
-        read_offset = infile->offset;
-    } else  {
-        read_offset = *offset;
+
+    u64 read_offset = offset ? *offset : infile->offset;
+    if (read_offset >= infile->length || count == 0)
+        return set_syscall_return(current, 0);
+
+    sendfile_state st = allocate(h, sizeof(struct sendfile_state));
+    if (st == INVALID_ADDRESS)
+        return set_syscall_error(current, ENOMEM);
+    st->h = h;
+    st->t = current;
+    st->in = infile;
+    st->out = outfile;
+    st->offset = offset;
+    st->read_offset = read_offset;
+    st->remain = MIN(count, infile->length - read_offset);
+    st->sent = 0;
+    st->buf = 0;
+    st->running = false;
+    st->again = false;
+    st->done = false;
+    st->write_complete = closure(h, sendfile_write_complete, st);
+
+    struct pagecache_stats cs;
+    filesystem_get_cache_stats(current->p->fs, &cs);
+    if (!outfile->sendpage || !cs.limit) {
+        st->buf = allocate(h, SENDFILE_CHUNK_SIZE);
+        if (st->buf == INVALID_ADDRESS) {
+            deallocate(h, st, sizeof(struct sendfile_state));
+            return set_syscall_error(current, ENOMEM);
+        }
     }
 
-    filesystem_read(current->p->fs, infile->n, buf, count, read_offset,
-                closure(h, sendfile_read_complete, h, current, infile, outfile, offset, buf));
+    sendfile_continue(st);
     thread_sleep(current);
-    return set_syscall_return(current,count); // bogus
 }
 
-
 static CLOSURE_2_6(file_read, sysreturn,
         file, fsfile,
         void *, u64, u64, thread, boolean, io_completion);
@@ -667,6 +793,14 @@ static sysreturn file_read(file f, fsfile fsf, void *dest, u64 length,
     }
 }
 
+static CLOSURE_4_2(direct_write_complete, void, process, void *, u64, io_status_handler, status, bytes);
+static void direct_write_complete(process p, void *kbuf, u64 length, io_status_handler ish,
+                                  status s, bytes count)
+{
+    release_user_buffer(p, kbuf, length);
+    apply(ish, s, count);
+}
+
 #define PAD_WRITES 0
 
 static CLOSURE_2_6(file_write, sysreturn,
@@ -682,6 +816,26 @@ static sysreturn file_write(file f, fsfile fsf, void *dest, u64 length,
                length, f->length);
     heap h = heap_general(get_kernel_heaps());
 
+    /* The writer sleeps until completion, so an O_DIRECT write can go
+       to disk from its own pages; the filesystem falls back to the
+       buffered path unless the write is sector aligned. The pages are
+       faulted in here and held, through a kernel mapping of their own,
+       until the write completes, as another thread could unmap them
+       meanwhile. */
+    if ((f->f.flags & O_DIRECT) && !is_special(f->n) && !bh) {
+        for (u64 p = u64_from_pointer(dest) & ~MASK(PAGELOG);
+             p < u64_from_pointer(dest) + length; p += PAGESIZE)
+            (void)*(volatile u8 *)pointer_from_u64(p);
+        void *kbuf = hold_user_buffer(t->p, dest, length);
+        if (kbuf != INVALID_ADDRESS) {
+            io_status_handler ish = closure(h, file_op_complete, t, f, fsf, is_file_offset,
+                                            completion);
+            filesystem_write_direct(t->p->fs, f->n, wrap_buffer(h, kbuf, length), offset,
+                                    closure(h, direct_write_complete, t->p, kbuf, length, ish));
+            thread_sleep(t);
+        }
+    }
+
     u64 final_length = PAD_WRITES ? pad(length, SECTOR_SIZE) : length;
     void *buf = allocate(h, final_length);
 
@@ -693,8 +847,8 @@ static sysreturn file_write(file f, fsfile fsf, void *dest, u64 length,
        block read) */
 
     /* copy from userspace, XXX: check pointer safety */
-    runtime_memset(buf, 0, final_length);
     runtime_memcpy(buf, dest, length);
+    runtime_memset(buf + length, 0, final_length - length);
 
     buffer b = wrap_buffer(h, buf, final_length);
     thread_log(t, "%s: b_ref: %p", __func__, buffer_ref(b, 0));
@@ -1712,9 +1866,40 @@ void exit(int code)
     runloop();
 }
 
+static void print_fs_stats(filesystem fs)
+{
+    struct pagecache_stats cs;
+    struct extent_stats es;
+    filesystem_get_cache_stats(fs, &cs);
+    filesystem_get_extent_stats(fs, &es);
+    rprintf("extents: %ld in use, %ld created, %ld extended in place, %ld KB allocated\n",
+            es.extents, es.created, es.extended, es.storage >> 10);
+    rprintf("page cache: %ld hits, %ld misses, %ld read ahead, %ld evicted, %ld written back, "
+            "%ld KB written around\n", cs.hits, cs.misses, cs.readahead, cs.evictions,
+            cs.writebacks, cs.direct >> 10);
+}
+
+static CLOSURE_3_1(exit_group_sync_complete, void, int, tuple, filesystem, status);
+static void exit_group_sync_complete(int code, tuple root, filesystem fs, status s)
+{
+    if (!is_ok(s))
+        msg_err("filesystem sync failed: %v\n", s);
+    if (table_find(root, sym(queuestats)))
+        print_queue_stats();
+    if (table_find(root, sym(faultstats)))
+        print_fault_stats();
+    if (table_find(root, sym(fsstats)))
+        print_fs_stats(fs);
+    vm_exit(code);
+}
+
 sysreturn exit_group(int status)
 {
-    vm_exit(status);
+    /* cached file data goes away with the VM, so write it back first */
+    filesystem_sync(current->p->fs, closure(heap_general(get_kernel_heaps()),
+                                            exit_group_sync_complete, status,
+                                            current->p->process_root, current->p->fs));
+    thread_sleep(current);
 }
 
 sysreturn pipe2(int fds[2], int flags)
@@ -1744,10 +1929,19 @@ sysreturn sched_getaffinity(int pid, u64 cpusetsize, cpu_set_t *mask)
 {
     if (!mask || cpusetsize < sizeof(mask->mask[0]))
         return set_syscall_error(current, EINVAL);
-    mask->mask[0] = 1;      /* always cpu 0 */
+    mask->mask[0] = MASK(total_processors);
     return sizeof(mask->mask[0]);
 }
 
+sysreturn getcpu(unsigned int *cpu, unsigned int *node, void *tcache)
+{
+    if (cpu)
+        *cpu = current_cpu()->id;
+    if (node)
+        *node = 0;
+    return 0;
+}
+
 sysreturn prctl(int option, u64 arg2, u64 arg3, u64 arg4, u64 arg5)
 {
     thread_log(current, "prctl: option %d, arg2 0x%lx, arg3 0x%lx, arg4 0x%lx, arg5 0x%lx",
@@ -1844,6 +2038,7 @@ void register_file_syscalls(struct syscall *map)
     register_syscall(map, fchdir, fchdir);
     register_syscall(map, newfstatat, newfstatat);
     register_syscall(map, sched_getaffinity, sched_getaffinity);
+    register_syscall(map, getcpu, getcpu);
     register_syscall(map, sched_setaffinity, syscall_ignore);
     register_syscall(map, getuid, syscall_ignore);
     register_syscall(map, geteuid, syscall_ignore);
@@ -1867,18 +2062,21 @@ struct syscall {
 static struct syscall _linux_syscalls[SYS_MAX];
 struct syscall *linux_syscalls = _linux_syscalls;
 
-static context syscall_frame;
+static context syscall_frames[MAX_CPUS];
 
 static void syscall_debug()
 {
+    kern_lock();
     u64 *f = current->frame;
     int call = f[FRAME_VECTOR];
     if (call < 0 || call >= sizeof(_linux_syscalls) / sizeof(_linux_syscalls[0])) {
         thread_log(current, "invalid syscall %d", call);
         set_syscall_return(current, -ENOSYS);
+        kern_unlock();
         return;
     }
     current->syscall = call;
+    current->wakeable = true;
     void *debugsyscalls = table_find(current->p->process_root, sym(debugsyscalls));
     struct syscall *s = current->p->syscalls + call;
     if (debugsyscalls) {
@@ -1895,12 +2093,13 @@ static void syscall_debug()
         /* exchange frames so that a fault won't clobber the syscall
            context, but retain the fault handler that has current enclosed */
         context saveframe = running_frame;
-        running_frame = syscall_frame;
+        running_frame = syscall_frames[current_cpu()->id];
         running_frame[FRAME_FAULT_HANDLER] = f[FRAME_FAULT_HANDLER];
 
         res = h(f[FRAME_RDI], f[FRAME_RSI], f[FRAME_RDX], f[FRAME_R10], f[FRAME_R8], f[FRAME_R9]);
         if (debugsyscalls)
             thread_log(current, "direct return: %ld, rsp 0x%lx", res, f[FRAME_RSP]);
+        process_deferqueue();
         proc_enter_user(current->p);
         running_frame = saveframe;
     } else if (debugsyscalls) {
@@ -1911,6 +2110,8 @@ static void syscall_debug()
     }
     set_syscall_return(current, res);
     current->syscall = -1;
+    current->wakeable = false;
+    kern_unlock();
 }
 
 boolean syscall_notrace(int syscall)
@@ -1921,6 +2122,13 @@ boolean syscall_notrace(int syscall)
     return (s->flags & SYSCALL_F_NOTRACE) != 0;
 }
 
+/* A fault taken with this frame came from within a syscall top half,
+   as opposed to a bottom half or interrupt handler. */
+boolean fault_in_syscall(context frame)
+{
+    return frame == syscall_frames[current_cpu()->id];
+}
+
 // should hang off the thread context, but the assembly handler needs
 // to find it.
 void *syscall;
@@ -1931,7 +2139,8 @@ void init_syscalls()
     // debug the synthesized version later, at least we have the table dispatch
     heap h = heap_general(get_kernel_heaps());
     syscall = syscall_debug;
-    syscall_frame = allocate_frame(h);
+    for (int i = 0; i < MAX_CPUS; i++)
+        syscall_frames[i] = allocate_frame(h);
 }
 
 void _register_syscall(struct syscall *m, int n, sysreturn (*f)(), const char *name)
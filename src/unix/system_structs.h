@@ -140,6 +140,7 @@ typedef struct iovec {
 #define AT_EGID         14              /* Effective gid */
 #define AT_CLKTCK       17              /* Frequency of times() */
 #define AT_RANDOM       25   
+#define AT_SYSINFO_EHDR 33              /* vdso image */
 #define AT_FDCWD        -100            /* openat should use the current working directory.*/
 
 #define AT_SYMLINK_NOFOLLOW 0x100       /* Do not follow symbolic links.  */
@@ -148,6 +149,7 @@ typedef struct iovec {
 #define AT_NO_AUTOMOUNT     0x800       /* Suppress terminal automount traversal */
 #define AT_EMPTY_PATH       0x1000      /* Allow empty relative pathname */
 
+#define MAP_SHARED	0x01
 #define MAP_FIXED 0x10
 #define MAP_ANONYMOUS 0x20
 #define MAP_PRIVATE	0x02
@@ -156,6 +158,10 @@ typedef struct iovec {
 #define MAP_STACK	0x20000
 #define MAP_32BIT	0x40
 
+#define MS_ASYNC	1
+#define MS_INVALIDATE	2
+#define MS_SYNC		4
+
 #define PROT_READ       0x1
 #define PROT_WRITE      0x2
 #define PROT_EXEC       0x4
@@ -168,6 +174,15 @@ typedef struct iovec {
 
 typedef int clockid_t;
 
+#define CLOCK_REALTIME                  0
+#define CLOCK_MONOTONIC                 1
+#define CLOCK_PROCESS_CPUTIME_ID        2
+#define CLOCK_THREAD_CPUTIME_ID         3
+#define CLOCK_MONOTONIC_RAW             4
+#define CLOCK_REALTIME_COARSE           5
+#define CLOCK_MONOTONIC_COARSE          6
+#define CLOCK_BOOTTIME                  7
+
 struct timespec {
 	u64 ts_sec;
 	u64 ts_nsec;
@@ -364,7 +379,7 @@ struct epoll_event {
 #define EPOLLWRBAND	0x00000200
 #define EPOLLMSG	0x00000400
 #define EPOLLRDHUP	0x00002000
-#define EPOLLEXCLUSIVE	(1u << 29)
+#define EPOLLEXCLUSIVE	(1u << 28)
 #define EPOLLWAKEUP	(1u << 29)
 #define EPOLLONESHOT	(1u << 30)
 #define EPOLLET		(1u << 31)
@@ -1,7 +1,5 @@
 #include <unix_internal.h>
 
-thread current;
-
 CLOSURE_1_1(default_fault_handler, context, thread, context);
 
 static u64 futex_key_function(void *x)
@@ -91,7 +89,7 @@ static fut soft_create_futex(process p, u64 key)
     // of course this is supossed to be serialized
     if (!(f = table_find(p->futices, pointer_from_u64(key)))) {
         f = allocate(h, sizeof(struct fut));
-        f->waiters = allocate_queue(h, 32);
+        f->waiters = allocate_growable_queue(h, 32);
         f->t = 0;
         table_set(p->futices, pointer_from_u64(key), f);
     }
@@ -101,6 +99,7 @@ static fut soft_create_futex(process p, u64 key)
 static void futex_thread_wakeup(fut f, thread t) {
     if (f->t){
         remove_timer(f->t);
+        f->t = 0;
     }
     thread_wakeup(t);
 }
@@ -123,17 +122,20 @@ static int futex_wake(fut f, int val, boolean verbose, int *uaddr)
     return result;
 }
 
-static CLOSURE_1_0(futex_timeout, void, thread);
-static void futex_timeout(thread t)
+static CLOSURE_2_0(futex_timeout, void, fut, thread);
+static void futex_timeout(fut f, thread t)
 {
+    /* the timer is freed after this returns; if it was replaced by a
+       later waiter's, that one is simply left to run */
+    f->t = 0;
     set_syscall_return(t, ETIMEDOUT);
     thread_wakeup(t);
 }
 
 void register_futex_timer(thread t, fut f, const struct timespec* req)
 {
-   f->t = register_timer(time_from_timespec(req),
-		closure(heap_general(get_kernel_heaps()), futex_timeout, t));
+   f->t = register_timer_slack(time_from_timespec(req), USER_TIMER_SLACK,
+		closure(heap_general(get_kernel_heaps()), futex_timeout, f, t));
 }
 
 static sysreturn futex(int *uaddr, int futex_op, int val,
@@ -291,14 +293,36 @@ void thread_log_internal(thread t, const char *desc, ...)
 CLOSURE_1_0(run_thread, void, thread);
 void run_thread(thread t)
 {
-    current = t;
+    current_cpu()->current_thread = t;
+    t->wakeable = false;
     thread_log(t, "run frame %p, RIP=%p", t->frame, t->frame[FRAME_RIP]);
     proc_enter_user(current->p);
     running_frame = t->frame;
     running_frame[FRAME_FLAGS] |= U64_FROM_BIT(FLAG_INTERRUPT);
+    process_deferqueue();
+    kern_unlock();
     IRETURN(running_frame);
 }
 
+/* run_thread returns by sysret, as from a syscall, which doesn't
+   restore rcx and r11; a thread stopped in the middle of user code is
+   resumed with all of its registers. */
+static CLOSURE_1_0(run_thread_fault, void, thread);
+static void run_thread_fault(thread t)
+{
+    current_cpu()->current_thread = t;
+    t->wakeable = false;
+    thread_log(t, "resume after fault, RIP=%p", t->frame[FRAME_RIP]);
+    proc_enter_user(current->p);
+    running_frame = t->frame;
+    running_frame[FRAME_FLAGS] |= U64_FROM_BIT(FLAG_INTERRUPT);
+    running_frame[FRAME_SS] = 0x23;
+    running_frame[FRAME_CS] = 0x1b;
+    process_deferqueue();
+    kern_unlock();
+    interrupt_exit();
+}
+
 // it might be easier, if a little skeezy, to use the return value
 // to genericize the handling of suspended threads. given that there
 // are already conventions (i.e. negative errors) on the interface
@@ -309,10 +333,47 @@ void thread_sleep(thread t)
     runloop();
 }
 
+/* A thread is scheduled at most once per stay in the kernel. Another
+   waker, such as a timeout racing the event it guards, finds it queued
+   or already back in user mode, and on SMP would otherwise have a
+   second cpu run the same frame. */
+static boolean thread_claim_wakeup(thread t)
+{
+    if (!t->wakeable) {
+        thread_log(current, "wakeup %ld->%ld ignored, already scheduled", current->tid, t->tid);
+        return false;
+    }
+    t->wakeable = false;
+    return true;
+}
+
 void thread_wakeup(thread t)
 {
     thread_log(current, "wakeup %ld->%ld %p", current->tid, t->tid, t->frame[FRAME_RIP]);
-    enqueue(runqueue, t->run);
+    if (thread_claim_wakeup(t))
+        schedule_thread(t->run);
+}
+
+/* For a thread stopped by a page fault in user mode that must wait,
+   e.g. on file data being read in. The fault is taken on its own
+   stack, which must stay free for further faults, so the runloop is
+   entered on the syscall stack, unused while the thread was out of
+   the kernel. */
+void thread_sleep_fault(thread t)
+{
+    thread_log(t, "sleep on fault, RIP=%p", t->frame[FRAME_RIP]);
+    t->wakeable = true;
+    switch_stack(current_cpu()->syscall_stack_top, runloop);
+    while (1);                  /* not reached */
+}
+
+/* resume a thread put to sleep by thread_sleep_fault, retrying the
+   faulting instruction */
+void thread_wakeup_fault(thread t)
+{
+    thread_log(current, "wakeup from fault %ld->%ld %p", current->tid, t->tid, t->frame[FRAME_RIP]);
+    if (thread_claim_wakeup(t))
+        schedule_thread(t->run_fault);
 }
 
 thread create_thread(process p)
@@ -331,6 +392,8 @@ thread create_thread(process p)
     zero(t->frame, sizeof(t->frame));
     t->frame[FRAME_FAULT_HANDLER] = u64_from_pointer(closure(h, default_fault_handler, t));
     t->run = closure(h, run_thread, t);
+    t->run_fault = closure(h, run_thread_fault, t);
+    t->wakeable = true;         /* for its first run */
     vector_push(p->threads, t);
     return t;
 }
@@ -6,6 +6,7 @@ void init_fdesc(heap h, fdesc f, int type)
 {
     f->read = 0;
     f->write = 0;
+    f->sendpage = 0;
     f->close = 0;
     f->events = 0;
     f->ioctl = 0;
@@ -257,7 +258,7 @@ process init_unix(kernel_heaps kh, tuple root, filesystem fs)
 	goto alloc_fail;
     set_syscall_handler(syscall_enter);
     process kernel_process = create_process(uh, root, fs);
-    current = create_thread(kernel_process);
+    current_cpu()->current_thread = create_thread(kernel_process);
     running_frame = current->frame;
 
     /* Install a fault handler for use when anonymous pages are
@@ -272,7 +273,7 @@ process init_unix(kernel_heaps kh, tuple root, filesystem fs)
     fault_handler fallback_handler = closure(h, default_fault_handler, current);
     install_fallback_fault_handler(fallback_handler);
 
-    init_vdso(heap_physical(kh), heap_pages(kh));
+    init_vdso(kh);
     register_special_files(kernel_process);
     init_syscalls();
     register_file_syscalls(linux_syscalls);
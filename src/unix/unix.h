@@ -9,11 +9,15 @@ process init_unix(kernel_heaps kh, tuple root, filesystem fs);
 process create_process(unix_heaps uh, tuple root, filesystem fs);
 thread create_thread(process p);
 process exec_elf(buffer ex, process kernel_process);
+void exec_elf_file(process kernel_process, tuple file, status_handler fail);
 
 void proc_enter_user(process p);
 void proc_enter_system(process p);
 void proc_pause(process p);
 void proc_resume(process p);
 
+#define FAULT_AROUND_DEFAULT_PAGES 16
+void mmap_set_fault_policy(u64 around_pages, boolean huge_pages);
+
 timestamp proc_utime(process p);
 timestamp proc_stime(process p);
@@ -19,7 +19,7 @@ sysreturn nanosleep(const struct timespec* req, struct timespec* rem)
     // nanosleep is interpretable and the remaining
     // time is put in rem, but for now this is non interpretable
     // and we sleep for the whole duration before waking up.
-    register_timer(time_from_timespec(req),
+    register_timer_slack(time_from_timespec(req), USER_TIMER_SLACK,
 		closure(heap_general(get_kernel_heaps()), nanosleep_timeout, current, 0));
     thread_sleep(current); 
     return 0;
@@ -120,6 +120,8 @@ typedef struct thread {
     char name[16]; /* thread name */
 
     thunk run;
+    thunk run_fault;            /* resumes after thread_sleep_fault */
+    boolean wakeable;           /* in the kernel or asleep, and not yet scheduled */
     queue log[64];
 } *thread;
 
@@ -127,6 +129,12 @@ typedef closure_type(io_completion, void, thread t, sysreturn rv);
 typedef closure_type(io, sysreturn, void *buf, u64 length, u64 offset, thread t,
         boolean bh, io_completion completion);
 
+/* Output the file data held in a vector of pinned page cache pages,
+   starting at file offset "offset", without copying it. The callee
+   takes over the vector and the pins on its pages. */
+typedef closure_type(sendpage_io, sysreturn, vector pages, u64 offset, u64 length,
+        thread t, boolean bh, io_completion completion);
+
 #include <notify.h>
 
 #define FDESC_TYPE_REGULAR      1
@@ -139,6 +147,7 @@ typedef closure_type(io, sysreturn, void *buf, u64 length, u64 offset, thread t,
 
 typedef struct fdesc {
     io read, write;
+    sendpage_io sendpage;       /* optional */
     closure_type(events, u32);
     closure_type(ioctl, sysreturn, unsigned long request, vlist ap);
 
@@ -184,12 +193,17 @@ typedef struct process {
     vector files;
     rangemap vareas;               /* available address space */
     rangemap vmaps;                /* process mappings */
+    table file_pages;              /* page cache pages mapped, by virtual address */
+    u64 dma_holds;                 /* user buffers held for O_DIRECT I/O */
+    buffer held_physical;          /* ranges let go of meanwhile, freed after */
+    vector held_pages;             /* likewise, page cache pages */
     boolean sysctx;
     timestamp utime, stime;
     timestamp start_time;
 } *process;
 
-extern thread current;
+/* the thread last run on this cpu */
+#define current ((thread)current_cpu()->current_thread)
 
 static inline unix_heaps get_unix_heaps()
 {
@@ -215,9 +229,11 @@ u64 allocate_fd_gte(process p, u64 min, void *f);
 
 void deallocate_fd(process p, int fd);
 
-void init_vdso(heap, heap);
+void init_vdso(kernel_heaps kh);
+u64 vdso_address(void);
 
 void mmap_process_init(process p);
+void mmap_private(process p, u64 vaddr, u64 length, int prot, tuple file, u64 offset);
 
 static inline timestamp time_from_timeval(const struct timeval *t)
 {
@@ -252,6 +268,7 @@ void _register_syscall(struct syscall *m, int n, sysreturn (*f)(), const char *n
 
 void configure_syscalls(process p);
 boolean syscall_notrace(int syscall);
+boolean fault_in_syscall(context frame);
 
 void register_file_syscalls(struct syscall *);
 void register_net_syscalls(struct syscall *);
@@ -269,12 +286,18 @@ boolean pipe_init(unix_heaps uh);
 extern sysreturn syscall_ignore();
 context default_fault_handler(thread t, context frame);
 boolean unix_fault_page(u64 vaddr, context frame);
+boolean fault_in_user_range(void *buf, u64 length);
+void *hold_user_buffer(process p, void *buf, u64 length);
+void release_user_buffer(process p, void *kbuf, u64 length);
+void print_fault_stats(void);
 
 void thread_log_internal(thread t, const char *desc, ...);
 #define thread_log(__t, __desc, ...) thread_log_internal(__t, __desc, ##__VA_ARGS__)
 // this should always be current
 void thread_sleep(thread) __attribute__((noreturn));
 void thread_wakeup(thread);
+void thread_sleep_fault(thread) __attribute__((noreturn));
+void thread_wakeup_fault(thread);
 
 static inline sysreturn set_syscall_return(thread t, sysreturn val)
 {
@@ -334,6 +357,10 @@ typedef struct blockq {
 
 typedef closure_type(blockq_action, sysreturn, boolean);
 
+/* timeouts set on behalf of user threads may run this late, letting
+   nearby expiries share a wakeup */
+#define USER_TIMER_SLACK microseconds(50)
+
 blockq allocate_blockq(heap h, char * name, u64 size, timestamp timeout_interval);
 void deallocate_blockq(blockq bq);
 sysreturn blockq_check(blockq bq, thread t, blockq_action a);
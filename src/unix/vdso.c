@@ -1,9 +1,13 @@
-/* Right now we're only implementing vsyscalls, but we'll nominally
-   put everything under a vdso umbrella */
+/* The vdso image built from vdso_image.c is mapped once, with the vvar
+   pages below it, at an address shared by every process and passed in
+   AT_SYSINFO_EHDR. The legacy vsyscall vectors jump into the same
+   functions. */
 
 #include <unix_internal.h>
 #include <page.h>
 #include <synth.h>
+#include <elf64.h>
+#include <vdso.h>
 
 static void *vsyscall_base = (void *)0xffffffffff600000ull;
 
@@ -11,59 +15,71 @@ static void *vsyscall_base = (void *)0xffffffffff600000ull;
 #define VSYSCALL_OFFSET_VTIME           0x400
 #define VSYSCALL_OFFSET_VGETCPU         0x800
 
-sysreturn vsyscall_gettimeofday(struct timeval *x, void *tz);
-sysreturn vsyscall_time(time_t *tloc);
-sysreturn vsyscall_getcpu(u32 * cpu, u32 * node, void * tcache /* deprecated */);
+/* see vdso_blob.s */
+extern char vdso_image[];
+extern char vdso_image_end[];
 
-/* see linker_script */
-extern void * vdso_start;
-extern void * vdso_end;
+static u64 vdso_base;
 
-void init_vdso(heap physical_pages, heap pages)
+u64 vdso_address(void)
 {
-    /* build vsyscall vectors */
-    map(u64_from_pointer(vsyscall_base), allocate_u64(physical_pages, PAGESIZE), PAGESIZE, PAGE_USER, pages);
-    buffer b = alloca_wrap_buffer(vsyscall_base, PAGESIZE);
-    b->end = VSYSCALL_OFFSET_VGETTIMEOFDAY;
-    mov_32_imm(b, 0, u64_from_pointer(vsyscall_gettimeofday));
-    jump_indirect(b, 0);
-
-    b->end = VSYSCALL_OFFSET_VTIME;
-    mov_32_imm(b, 0, u64_from_pointer(vsyscall_time));
-    jump_indirect(b, 0);
-
-    b->end = VSYSCALL_OFFSET_VGETCPU;
-    mov_32_imm(b, 0, u64_from_pointer(vsyscall_getcpu));
-    jump_indirect(b, 0);
-
-    /* allow user execution for vsyscall pages */
-    u64 vs = u64_from_pointer(&vdso_start);
-    u64 ve = u64_from_pointer(&vdso_end);
-    u64 len = pad(ve - vs, PAGESIZE);
-    update_map_flags(vs, len, PAGE_USER);
+    return vdso_base;
 }
 
-sysreturn __attribute__((section (".vdso"))) vsyscall_gettimeofday(struct timeval *x, void *tz)
+static CLOSURE_2_4(vsyscall_target, void, const char *, u64 *, char *, u64, u64, u8);
+static void vsyscall_target(const char *want, u64 *target, char *name, u64 value, u64 size, u8 info)
 {
-    /* XXX a vdso-safe version of "timeval_from_time(x, now())" will
-       need to be implemented... for now just fall back to the syscall */
-    sysreturn rv;
-    asm("syscall" : "=a" (rv) : "0" (SYS_gettimeofday), "D" (x), "S" (tz) : "memory");
-    return rv;
+    int len = runtime_strlen(want);
+    if (runtime_strlen(name) == len && runtime_memcmp(name, want, len) == 0)
+        *target = vdso_base + value;
 }
 
-sysreturn __attribute__((section (".vdso"))) vsyscall_time(time_t *tloc)
+static void vsyscall_entry(heap h, buffer image, u64 offset, const char *name)
 {
-    sysreturn rv;
-    asm("syscall" : "=a" (rv) : "0" (SYS_time), "D" (tloc) : "memory");
-    return rv;
+    u64 target = 0;
+    elf_symbols(image, closure(h, vsyscall_target, name, &target));
+    assert(target);
+    buffer b = alloca_wrap_buffer(vsyscall_base, PAGESIZE);
+    b->end = offset;
+    mov_64_imm(b, 0, target);
+    jump_indirect(b, 0);
 }
 
-sysreturn __attribute__((section (".vdso"))) vsyscall_getcpu(u32 * cpu, u32 * node, void * tcache /* deprecated */)
+void init_vdso(kernel_heaps kh)
 {
-    if (cpu)
-        *cpu = 0;
-    if (node)
-        *node = 0;
-    return 0;
+    heap h = heap_general(kh);
+    heap pages = heap_pages(kh);
+    u64 image_len = vdso_image_end - vdso_image;
+    u64 len = VVAR_PAGES * PAGESIZE + pad(image_len, PAGESIZE);
+    u64 va = allocate_u64(heap_virtual_page(kh), len);
+    assert(va != INVALID_PHYSICAL);
+
+    /* kernel writes go through the backed heap's own mapping */
+    vdso_dat vd = allocate_zero(heap_backed(kh), PAGESIZE);
+    assert(vd != INVALID_ADDRESS);
+    map(va + VVAR_DAT_OFFSET, physical_from_virtual(vd), PAGESIZE,
+        PAGE_USER | PAGE_NO_EXEC, pages);
+    u64 clock = vdso_clock_init(vd);
+    if (clock != INVALID_PHYSICAL) {
+        u64 flags = PAGE_USER | PAGE_NO_EXEC;
+        if (vd->clock_src == VDSO_CLOCK_HPET)
+            flags |= PAGE_DEV_FLAGS & ~PAGE_WRITABLE;
+        map(va + VVAR_CLOCK_OFFSET, clock, PAGESIZE, flags, pages);
+    }
+
+    /* read-only and executable */
+    vdso_base = va + VVAR_PAGES * PAGESIZE;
+    for (u64 off = 0; off < image_len; off += PAGESIZE)
+        map(vdso_base + off, physical_from_virtual(vdso_image + off), PAGESIZE,
+            PAGE_USER, pages);
+
+    /* build vsyscall vectors, writable only until they're written, as
+       the kernel can't store through a read-only mapping (CR0.WP) */
+    map(u64_from_pointer(vsyscall_base), allocate_u64(heap_physical(kh), PAGESIZE),
+        PAGESIZE, PAGE_USER | PAGE_WRITABLE, pages);
+    buffer image = alloca_wrap_buffer(vdso_image, image_len);
+    vsyscall_entry(h, image, VSYSCALL_OFFSET_VGETTIMEOFDAY, "__vdso_gettimeofday");
+    vsyscall_entry(h, image, VSYSCALL_OFFSET_VTIME, "__vdso_time");
+    vsyscall_entry(h, image, VSYSCALL_OFFSET_VGETCPU, "__vdso_getcpu");
+    update_map_flags(u64_from_pointer(vsyscall_base), PAGESIZE, PAGE_USER);
 }
@@ -0,0 +1,25 @@
+#pragma once
+/* Shared between the kernel and the vdso image. The vvar pages are
+   mapped read-only just below the image: first struct vdso_dat, then
+   the page that the clock is read from, either the pvclock record or
+   the HPET registers. The vdso linker script places vvar_page to
+   match. */
+
+#define VVAR_PAGES              2
+#define VVAR_DAT_OFFSET         0
+#define VVAR_CLOCK_OFFSET       4096
+
+/* clock_src */
+#define VDSO_CLOCK_SYSCALL      0
+#define VDSO_CLOCK_PVCLOCK      1
+#define VDSO_CLOCK_HPET         2
+
+#define HPET_MAIN_COUNTER_OFFSET 0xf0
+
+struct vdso_dat {
+    u32 clock_src;
+    u32 pad;
+    u64 rtc_offset;             /* timestamp added to the clock */
+    u64 hpet_period_scaled_32;  /* timestamp per HPET tick, << 32 */
+};
+typedef struct vdso_dat *vdso_dat;
@@ -0,0 +1,122 @@
+/* The vdso itself: a small shared object, built apart from the kernel
+   and carried in its image, which the kernel maps into the process and
+   points to with AT_SYSINFO_EHDR. The clock is read here the same way
+   as now() in the kernel, from the pvclock record or HPET registers
+   that the kernel maps read-only below the image, along with its
+   struct vdso_dat. Anything else goes to the syscall.
+
+   This runs in user mode at whatever address it's mapped, so it may
+   only use position-independent references within the image, and
+   nothing from the kernel but these headers. */
+
+#include <def64.h>
+#include <system_structs.h>
+#include <syscalls.h>
+#include <pvclock.h>
+#include <vdso.h>
+
+/* see vdso.lds */
+extern char vvar_page[] __attribute__((visibility("hidden")));
+
+#define vdso_dat ((volatile struct vdso_dat *)(vvar_page + VVAR_DAT_OFFSET))
+#define vvar_clock (vvar_page + VVAR_CLOCK_OFFSET)
+
+/* each cpu's gdt carries its number in the limit of this segment */
+#define CPUID_SELECTOR 0x3b
+
+static inline s64 vdso_syscall(u64 n, u64 a0, u64 a1)
+{
+    s64 rv;
+    asm volatile("syscall" : "=a" (rv) : "0" (n), "D" (a0), "S" (a1)
+                 : "rcx", "r11", "memory");
+    return rv;
+}
+
+/* Returns 0 if the clock can only be had by syscall. */
+static inline int vdso_now(u64 *t)
+{
+    u64 c;
+    switch (vdso_dat->clock_src) {
+    case VDSO_CLOCK_PVCLOCK: {
+        /* The record is the boot cpu's, but rdtsc reads this cpu's TSC;
+           unless the hypervisor vouches for the TSCs being in step,
+           only the kernel can tell the time here. */
+        u8 flags;
+        u64 nsec = pvclock_read_ns((volatile struct pvclock_vcpu_time_info *)vvar_clock,
+                                   &flags);
+        if (!(flags & PVCLOCK_TSC_STABLE_BIT))
+            return 0;
+        c = pvclock_timestamp(nsec);
+        break;
+    }
+    case VDSO_CLOCK_HPET:
+        c = (((u128)*(volatile u64 *)(vvar_clock + HPET_MAIN_COUNTER_OFFSET)) *
+             vdso_dat->hpet_period_scaled_32) >> 32;
+        break;
+    default:
+        return 0;
+    }
+    *t = vdso_dat->rtc_offset + c;
+    return 1;
+}
+
+int __vdso_clock_gettime(clockid_t clk_id, struct timespec *tp)
+{
+    u64 t;
+    switch (clk_id) {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+    case CLOCK_REALTIME_COARSE:
+    case CLOCK_MONOTONIC_COARSE:
+    case CLOCK_BOOTTIME:
+        if (vdso_now(&t)) {
+            tp->ts_sec = t >> 32;
+            tp->ts_nsec = ((t & 0xffffffffull) * 1000000000ull) >> 32;
+            return 0;
+        }
+    }
+    return vdso_syscall(SYS_clock_gettime, clk_id, u64_from_pointer(tp));
+}
+int clock_gettime(clockid_t, struct timespec *)
+    __attribute__((weak, alias("__vdso_clock_gettime")));
+
+int __vdso_gettimeofday(struct timeval *tv, void *tz)
+{
+    u64 t;
+    if (!vdso_now(&t))
+        return vdso_syscall(SYS_gettimeofday, u64_from_pointer(tv), u64_from_pointer(tz));
+    if (tv) {
+        tv->tv_sec = t >> 32;
+        tv->tv_usec = ((t & 0xffffffffull) * 1000000ull) >> 32;
+    }
+    return 0;
+}
+int gettimeofday(struct timeval *, void *)
+    __attribute__((weak, alias("__vdso_gettimeofday")));
+
+time_t __vdso_time(time_t *tloc)
+{
+    u64 t;
+    if (!vdso_now(&t))
+        return vdso_syscall(SYS_time, u64_from_pointer(tloc), 0);
+    if (tloc)
+        *tloc = t >> 32;
+    return t >> 32;
+}
+time_t time(time_t *)
+    __attribute__((weak, alias("__vdso_time")));
+
+int __vdso_getcpu(u32 *cpu, u32 *node, void *tcache /* deprecated */)
+{
+    if (cpu) {
+        u32 p;
+        asm volatile("lsl %1, %0" : "=r" (p) : "r" (CPUID_SELECTOR));
+        *cpu = p;
+    }
+    if (node)
+        *node = 0;
+    return 0;
+}
+int getcpu(u32 *, u32 *, void *)
+    __attribute__((weak, alias("__vdso_getcpu")));
@@ -50,6 +50,8 @@ status virtqueue_alloc(vtpci dev,
                        thunk *t);
 
 void virtqueue_set_max_queued(virtqueue, int);
+void virtqueue_set_kick_batch(virtqueue vq, u16 kick_batch);
+void virtqueue_set_seg_size_max(virtqueue vq, u32 seg_size_max);
 
 /* The Host uses this in used->flags to advise the Guest: don't kick me
  * when you add a buffer.  It's unreliable, so it's simply an
@@ -65,6 +67,10 @@ physical virtqueue_paddr(struct virtqueue *vq);
 typedef struct vqmsg *vqmsg;
 
 vqmsg allocate_vqmsg(virtqueue vq);
-void deallocate_vqmsg(virtqueue vq, vqmsg m);
 void vqmsg_push(virtqueue vq, vqmsg m, void * addr, u32 len, boolean write);
+void vqmsg_push_pages(virtqueue vq, vqmsg m, void *addr, u64 len, boolean write);
 void vqmsg_commit(virtqueue vq, vqmsg m, vqfinish completion);
+vqmsg allocate_vqmsg_persistent(virtqueue vq, vqfinish completion);
+void vqmsg_post(virtqueue vq, vqmsg m);
+void virtqueue_kick(virtqueue vq);
+u16 virtqueue_entries(virtqueue vq);
@@ -42,12 +42,31 @@
 #include "lwip/etharp.h"
 #include "lwip/dhcp.h"
 #include "lwip/timeouts.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
 #include "netif/ethernet.h"
 #include "virtio_internal.h"
 #include "virtio_net.h"
 
 #include <io.h>
 
+#ifdef VIRTIO_NET_DEBUG
+# define virtio_net_debug rprintf
+#else
+# define virtio_net_debug(...) do { } while(0)
+#endif // defined(VIRTIO_NET_DEBUG)
+
+/* The rx ring is refilled once this many buffers have been consumed. */
+#define RX_REFILL_BATCH_MAX 32
+
+/* transmits queued before the host is notified */
+#define TX_KICK_BATCH 32
+
+/* offset of the checksum field within the tcp header */
+#define TCP_CSUM_OFFSET 16
+
+#define VIRTIO_NET_F_LRO (VIRTIO_NET_F_GUEST_TSO4 | VIRTIO_NET_F_GUEST_TSO6)
+
 typedef struct vnet {
     vtpci dev;
     u16 port;
@@ -57,14 +76,40 @@ typedef struct vnet {
     struct virtqueue *txq;
     struct virtqueue *rxq;
     struct virtqueue *ctl;
-    void *empty; // just a mac..fix, from pre-heap days
+    u16 net_header_len;         /* 12 with mergeable rx buffers, else 10 */
+    u8 checksum_flags;          /* netif checksum flags outside of input */
+
+    /* rx buffers returned by lwIP, ready for reposting */
+    struct list rx_free;
+    u16 rx_ring_size;
+    u16 rx_refill_batch;
+    u16 rx_posted;              /* buffers currently owned by the device */
+    u16 rx_posted_low;          /* lowest occupancy seen on receive */
+    u64 rx_buffers;             /* size of the buffer pool */
+    u64 rx_packets;
+    u64 rx_drops;               /* rejected by the stack */
+    u64 rx_ring_empty;          /* device consumed every posted buffer */
+
+    /* merged packet being assembled from several rx buffers */
+    struct pbuf *rx_head;
+    u16 rx_remaining;
+    u8 rx_hdr_flags;
+    u64 rx_merged;              /* packets spanning more than one buffer */
+    u64 tx_csum_offload;
 } *vnet;
 
+/* for print_virtio_net_stats */
+static vector vnets;
+
+/* Receive buffers carry their descriptor state and completion, set up
+   once at allocation, and are recycled through rx_free when lwIP lets
+   go of them. */
 typedef struct xpbuf
 {
     struct pbuf_custom p;
-    buffer b;
     vnet vn;
+    vqmsg m;
+    struct list l;
 } *xpbuf;
 
 
@@ -78,20 +123,76 @@ static void tx_complete(struct pbuf *p, u64 len)
 }
 
 
+/* With VIRTIO_NET_F_CSUM, leave the tcp checksum to the host: seed
+   the checksum field with the pseudo-header sum and point the header at
+   the segment. lwIP always builds the ethernet, ip and tcp headers of an
+   outgoing segment in its first pbuf. UDP keeps its software checksum,
+   since lwIP fragments large datagrams after summing them. */
+static void tx_offload(vnet vn, struct pbuf *p, struct virtio_net_hdr *h)
+{
+    if (!(vn->dev->features & VIRTIO_NET_F_CSUM) ||
+        p->len < SIZEOF_ETH_HDR + IP_HLEN)
+        return;
+
+    struct eth_hdr *eh = p->payload;
+    if (eh->type != PP_HTONS(ETHTYPE_IP))
+        return;
+
+    struct ip_hdr *iph = p->payload + SIZEOF_ETH_HDR;
+    if (IPH_PROTO(iph) != IP_PROTO_TCP)
+        return;
+
+    u16 iphlen = IPH_HL(iph) * 4;
+    u16 start = SIZEOF_ETH_HDR + iphlen;
+    assert(start + TCP_HLEN <= p->len);
+
+    u16 *a = (u16 *)&iph->src;
+    u32 acc = a[0] + a[1] + a[2] + a[3] +
+        lwip_htons(IP_PROTO_TCP) + lwip_htons(lwip_ntohs(IPH_LEN(iph)) - iphlen);
+    while (acc >> 16)
+        acc = (acc & 0xffff) + (acc >> 16);
+    *(u16 *)(p->payload + start + TCP_CSUM_OFFSET) = acc;
+
+    h->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    h->csum_start = start;
+    h->csum_offset = TCP_CSUM_OFFSET;
+    vn->tx_csum_offload++;
+}
+
 static err_t low_level_output(struct netif *netif, struct pbuf *p)
 {
     vnet vn = netif->state;
+    struct pbuf *q;
+
+    /* The virtio header goes in the headroom reserved by
+       PBUF_LINK_ENCAPSULATION_HLEN, sharing a descriptor with the
+       frame; pbufs without room get a separate header pbuf. */
+    if (pbuf_header(p, vn->net_header_len) == 0) {
+        q = p;
+        pbuf_ref(p);
+    } else {
+        q = pbuf_alloc(PBUF_RAW, vn->net_header_len, PBUF_RAM);
+        if (!q) {
+            LINK_STATS_INC(link.memerr);
+            return ERR_MEM;
+        }
+        pbuf_chain(q, p);
+    }
+
+    struct virtio_net_hdr *h = q->payload;
+    runtime_memset((void *)h, 0, vn->net_header_len);
 
     vqmsg m = allocate_vqmsg(vn->txq);
     assert(m != INVALID_ADDRESS);
-    vqmsg_push(vn->txq, m, vn->empty, NET_HEADER_LENGTH, false);
-
-    pbuf_ref(p);
-
-    for (struct pbuf * q = p; q != NULL; q = q->next)
-        vqmsg_push(vn->txq, m, q->payload, q->len, false);
-
-    vqmsg_commit(vn->txq, m, closure(vn->dev->general, tx_complete, p));
+    for (struct pbuf *i = q; i != NULL; i = i->next)
+        vqmsg_push(vn->txq, m, i->payload, i->len, false);
+
+    /* give lwIP back its view of the frame; the headroom stays ours
+       until completion since lwIP doesn't retransmit a referenced pbuf */
+    if (q == p)
+        pbuf_header(p, -vn->net_header_len);
+    tx_offload(vn, p, h);
+    vqmsg_commit(vn->txq, m, closure(vn->dev->general, tx_complete, q));
     
     MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
     if (((u8_t *)p->payload)[0] & 1) {
@@ -108,52 +209,128 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
     return ERR_OK;
 }
 
+static void rx_refill(vnet vn);
+
 static void receive_buffer_release(struct pbuf *p)
 {
     xpbuf x  = (void *)p;
-    deallocate(x->vn->rxbuffers, x, x->vn->rxbuflen + sizeof(struct xpbuf));
+    vnet vn = x->vn;
+    list_push_back(&vn->rx_free, &x->l);
+    if (vn->rx_ring_size - vn->rx_posted >= vn->rx_refill_batch)
+        rx_refill(vn);
 }
 
-static void post_receive(vnet vn);
+/* Checksums the host has verified, or left partial because the packet
+   never crossed a wire, are not checked again in software. Input runs
+   to completion, so the netif flags are only relaxed for this packet. */
+static void rx_deliver(vnet vn, struct pbuf *p, u8 hdr_flags)
+{
+    if (hdr_flags & (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM))
+        NETIF_SET_CHECKSUM_CTRL(vn->n, vn->checksum_flags &
+                                ~(NETIF_CHECKSUM_CHECK_TCP | NETIF_CHECKSUM_CHECK_UDP));
+    vn->rx_packets++;
+    LINK_STATS_INC(link.recv);
+    if (vn->n->input(p, vn->n) != ERR_OK) {
+        vn->rx_drops++;
+        LINK_STATS_INC(link.drop);
+        pbuf_free(p);
+    }
+    NETIF_SET_CHECKSUM_CTRL(vn->n, vn->checksum_flags);
+}
 
 static CLOSURE_1_1(input, void, xpbuf, u64);
 static void input(xpbuf x, u64 len)
 {
     vnet vn= x->vn;
-    // under what conditions does a virtio queue give us zero?
-    if (x != NULL) {
-        len -= NET_HEADER_LENGTH;
-        assert(len <= x->p.pbuf.len);
-        x->p.pbuf.tot_len = x->p.pbuf.len = len;
-        x->p.pbuf.payload += NET_HEADER_LENGTH;
-        if (vn->n->input(&x->p.pbuf, vn->n) != ERR_OK) {
-            receive_buffer_release(&x->p.pbuf);
+    assert(vn->rx_posted > 0);
+    vn->rx_posted--;
+    if (vn->rx_posted < vn->rx_posted_low)
+        vn->rx_posted_low = vn->rx_posted;
+    if (vn->rx_posted == 0) {
+        /* the host drops anything arriving before the next refill */
+        vn->rx_ring_empty++;
+        virtio_net_debug("%s: rx ring empty (packets %ld, drops %ld, pool %ld)\n",
+                         __func__, vn->rx_packets, vn->rx_drops, vn->rx_buffers);
+    }
+
+    struct pbuf *p = &x->p.pbuf;
+    assert(len <= p->len);
+    if (vn->rx_head) {
+        /* continuation buffers of a merged packet carry no header */
+        p->tot_len = p->len = len;
+        pbuf_cat(vn->rx_head, p);
+        if (--vn->rx_remaining == 0) {
+            rx_deliver(vn, vn->rx_head, vn->rx_hdr_flags);
+            vn->rx_head = 0;
         }
     } else {
-        rprintf ("virtio null\n");
+        struct virtio_net_hdr_mrg_rxbuf *h = p->payload;
+        assert(len >= vn->net_header_len);
+        p->tot_len = p->len = len - vn->net_header_len;
+        p->payload += vn->net_header_len;
+        if ((vn->dev->features & VIRTIO_NET_F_MRG_RXBUF) && h->num_buffers > 1) {
+            vn->rx_head = p;
+            vn->rx_remaining = h->num_buffers - 1;
+            vn->rx_hdr_flags = h->hdr.flags;
+            vn->rx_merged++;
+        } else {
+            rx_deliver(vn, p, h->hdr.flags);
+        }
     }
-    // we need to get a signal from the device side that there was
-    // an underrun here to open up the window
-    post_receive(vn);
-}
 
+    /* buffers still held by the stack are replaced from the pool */
+    if (vn->rx_ring_size - vn->rx_posted >= vn->rx_refill_batch)
+        rx_refill(vn);
+}
 
-static void post_receive(vnet vn)
+static xpbuf allocate_rx_buffer(vnet vn)
 {
     xpbuf x = allocate(vn->rxbuffers, sizeof(struct xpbuf) + vn->rxbuflen);
+    if (x == INVALID_ADDRESS)
+        return x;
     x->vn = vn;
-    x->p.custom_free_function = receive_buffer_release;
-    pbuf_alloced_custom(PBUF_RAW,
-                        vn->rxbuflen,
-                        PBUF_REF,
-                        &x->p,
-                        x+1,
-                        vn->rxbuflen);
-
-    vqmsg m = allocate_vqmsg(vn->rxq);
-    assert(m != INVALID_ADDRESS);
-    vqmsg_push(vn->rxq, m, x+1, vn->rxbuflen, true);
-    vqmsg_commit(vn->rxq, m, closure(vn->dev->general, input, x));
+    x->m = allocate_vqmsg_persistent(vn->rxq, closure(vn->dev->general, input, x));
+    if (x->m == INVALID_ADDRESS) {
+        deallocate(vn->rxbuffers, x, sizeof(struct xpbuf) + vn->rxbuflen);
+        return INVALID_ADDRESS;
+    }
+    vqmsg_push(vn->rxq, x->m, x+1, vn->rxbuflen, true);
+    vn->rx_buffers++;
+    return x;
+}
+
+/* Top up the rx ring to its full size, taking recycled buffers first
+   and growing the pool if lwIP is still holding on to the rest. The
+   batch is made visible to the device with a single kick. */
+static void rx_refill(vnet vn)
+{
+    int posted = 0;
+    while (vn->rx_posted < vn->rx_ring_size) {
+        xpbuf x;
+        list l = list_get_next(&vn->rx_free);
+        if (l) {
+            list_delete(l);
+            x = struct_from_list(l, xpbuf, l);
+        } else {
+            x = allocate_rx_buffer(vn);
+            if (x == INVALID_ADDRESS) {
+                LINK_STATS_INC(link.memerr);
+                break;
+            }
+        }
+        x->p.custom_free_function = receive_buffer_release;
+        pbuf_alloced_custom(PBUF_RAW,
+                            vn->rxbuflen,
+                            PBUF_REF,
+                            &x->p,
+                            x+1,
+                            vn->rxbuflen);
+        vqmsg_post(vn->rxq, x->m);
+        vn->rx_posted++;
+        posted++;
+    }
+    if (posted > 0)
+        virtqueue_kick(vn->rxq);
 }
 
 static void status_callback(struct netif *netif)
@@ -177,38 +354,59 @@ static err_t virtioif_init(struct netif *netif)
         netif->hwaddr[i] =  in8(vn->dev->base + VIRTIO_MSI_DEVICE_CONFIG + i);
     netif->mtu = 1500;
 
+    /* outgoing tcp checksums are filled in by tx_offload */
+    vn->checksum_flags = NETIF_CHECKSUM_ENABLE_ALL;
+    if (vn->dev->features & VIRTIO_NET_F_CSUM)
+        vn->checksum_flags &= ~NETIF_CHECKSUM_GEN_TCP;
+    NETIF_SET_CHECKSUM_CTRL(netif, vn->checksum_flags);
+
     /* device capabilities */
     /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
     netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
 
-    // fix
-    post_receive(vn);
-    post_receive(vn);
-    post_receive(vn);
-    
+    list_init(&vn->rx_free);
+    vn->rx_ring_size = virtqueue_entries(vn->rxq);
+    vn->rx_refill_batch = MAX(1, MIN(vn->rx_ring_size / 4, RX_REFILL_BATCH_MAX));
+    vn->rx_posted = 0;
+    vn->rx_posted_low = vn->rx_ring_size;
+    vn->rx_buffers = vn->rx_packets = vn->rx_drops = vn->rx_ring_empty = 0;
+    vn->rx_head = 0;
+    vn->rx_remaining = 0;
+    vn->rx_merged = vn->tx_csum_offload = 0;
+    rx_refill(vn);
     return ERR_OK;
 }
 
 static void virtio_net_attach(heap general, heap page_allocator, pci_dev d)
 {
-    //u32 badness = VIRTIO_F_BAD_FEATURE | VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM |
-    //    VIRTIO_NET_F_GUEST_TSO4 | VIRTIO_NET_F_GUEST_TSO6 |  VIRTIO_NET_F_GUEST_ECN|
-    //    VIRTIO_NET_F_GUEST_UFO | VIRTIO_NET_F_CTRL_VLAN | VIRTIO_NET_F_MQ;
+    /* HOST_TSO4/6 are left off: lwIP never builds a segment larger
+       than the mss the peer advertised, so there would be nothing for
+       the host to split. */
+    vtpci dev = attach_vtpci(general, page_allocator, d,
+                             VIRTIO_NET_F_MAC | VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM |
+                             VIRTIO_NET_F_MRG_RXBUF | VIRTIO_NET_F_LRO);
+
+    /* large receive needs buffers to merge into, and partial checksums */
+    if ((dev->features & VIRTIO_NET_F_LRO) &&
+        (!(dev->features & VIRTIO_NET_F_MRG_RXBUF) || !(dev->features & VIRTIO_NET_F_GUEST_CSUM)))
+        vtpci_set_features(dev, dev->features & ~VIRTIO_NET_F_LRO);
 
-    vtpci dev = attach_vtpci(general, page_allocator, d, VIRTIO_NET_F_MAC);
     vnet vn = allocate(dev->general, sizeof(struct vnet));
     vn->n = allocate(dev->general, sizeof(struct netif));
-    vn->rxbuflen = NET_HEADER_LENGTH + sizeof(struct eth_hdr) + sizeof(struct eth_vlan_hdr) + 1500;
+    vn->net_header_len = (dev->features & VIRTIO_NET_F_MRG_RXBUF) ?
+        sizeof(struct virtio_net_hdr_mrg_rxbuf) : NET_HEADER_LENGTH;
+    vn->rxbuflen = vn->net_header_len + sizeof(struct eth_hdr) + sizeof(struct eth_vlan_hdr) + 1500;
     vn->rxbuffers = allocate_objcache(dev->general, page_allocator,
 				      vn->rxbuflen + sizeof(struct xpbuf), PAGESIZE_2M);
     /* rx = 0, tx = 1, ctl = 2 by 
        page 53 of http://docs.oasis-open.org/virtio/virtio/v1.0/cs01/virtio-v1.0-cs01.pdf */
     vn->dev = dev;
+    if (!vnets)
+        vnets = allocate_vector(general, 1);
+    vector_push(vnets, vn);
     vtpci_alloc_virtqueue(dev, 1, &vn->txq);
     vtpci_alloc_virtqueue(dev, 0, &vn->rxq);
-    // just need 10 contig bytes really
-    vn->empty = allocate(dev->contiguous, dev->contiguous->pagesize);
-    for (int i = 0; i < NET_HEADER_LENGTH ; i++)  ((u8 *)vn->empty)[i] = 0;
+    virtqueue_set_kick_batch(vn->txq, TX_KICK_BATCH);
     vn->n->state = vn;
     // initialization complete
     vtpci_set_status(dev, VIRTIO_CONFIG_STATUS_DRIVER_OK);
@@ -220,6 +418,20 @@ static void virtio_net_attach(heap general, heap page_allocator, pci_dev d)
               ethernet_input);
 }
 
+void print_virtio_net_stats(void)
+{
+    vnet vn;
+    if (!vnets)
+        return;
+    vector_foreach(vnets, vn) {
+        rprintf("virtio-net %d: rx ring %d, posted %d, lowest %d, empty %ld times; "
+                "pool %ld buffers\n", _i, vn->rx_ring_size, vn->rx_posted,
+                vn->rx_posted_low, vn->rx_ring_empty, vn->rx_buffers);
+        rprintf("   %ld packets received, %ld merged, %ld dropped\n",
+                vn->rx_packets, vn->rx_merged, vn->rx_drops);
+    }
+}
+
 static CLOSURE_2_1(virtio_net_probe, boolean, heap, heap, pci_dev);
 static boolean virtio_net_probe(heap general, heap page_allocator, pci_dev d)
 {
@@ -66,6 +66,15 @@ status vtpci_alloc_virtqueue(vtpci dev,
     return STATUS_OK;
 }
 
+/* Drop features whose dependencies the host didn't offer; the legacy
+   interface accepts a rewrite any time before DRIVER_OK. */
+void vtpci_set_features(vtpci dev, u64 features)
+{
+    assert((features & ~dev->features) == 0);
+    dev->features = features;
+    out32(dev->base + VIRTIO_PCI_GUEST_FEATURES, dev->features);
+}
+
 void vtpci_notify_virtqueue(vtpci dev, u16 queue)
 {
     out16(dev->base + VIRTIO_PCI_QUEUE_NOTIFY, queue);
@@ -88,8 +97,11 @@ vtpci attach_vtpci(heap h, heap page_allocator, pci_dev d, u64 feature_mask)
     vtpci_set_status(dev, VIRTIO_CONFIG_STATUS_ACK);
     vtpci_set_status(dev, VIRTIO_CONFIG_STATUS_DRIVER);
 
-    dev->features = in32(dev->base + VIRTIO_PCI_HOST_FEATURES);
-    out32(dev->base + VIRTIO_PCI_GUEST_FEATURES, dev->features & feature_mask);
+    /* features holds the negotiated set, not everything the host offers;
+       the ring features are handled by virtqueue for every device */
+    feature_mask |= VIRTIO_RING_F_EVENT_IDX | VIRTIO_RING_F_INDIRECT_DESC;
+    dev->features = in32(dev->base + VIRTIO_PCI_HOST_FEATURES) & feature_mask;
+    out32(dev->base + VIRTIO_PCI_GUEST_FEATURES, dev->features);
     vtpci_set_status(dev, VIRTIO_CONFIG_STATUS_FEATURE); 
 
     dev->general = h;
@@ -96,6 +96,7 @@ struct vtpci {
 vtpci attach_vtpci(heap h, heap page_allocator, pci_dev d, u64 feature_mask);
 status vtpci_alloc_virtqueue(vtpci dev, int idx, struct virtqueue **result);
 void vtpci_set_status(vtpci dev, u8 status);
+void vtpci_set_features(vtpci dev, u64 features);
 
 /* VirtIO PCI vendor/device ID. */
 #define VIRTIO_PCI_VENDORID	0x1AF4
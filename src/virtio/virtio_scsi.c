@@ -1,6 +1,7 @@
 #include <runtime.h>
 #include <x86_64.h>
 #include <drivers/storage.h>
+#include <drivers/blkq.h>
 #include <virtio/scsi.h>
 #include <x86_64.h>
 #include <io.h>
@@ -59,8 +60,17 @@ struct virtio_scsi_config {
 #define VIRTIO_SCSI_SENSE_SIZE          96
 #define VIRTIO_SCSI_CDB_SIZE            32
 
+/* requests queued before the host is notified */
+#define VIRTIO_SCSI_KICK_BATCH          16
+
 #define VIRTIO_SCSI_NUM_EVENTS          4
 
+/* a cpu submits to the request queue its id selects */
+#define VIRTIO_SCSI_MAX_QUEUES          MAX_CPUS
+
+/* request queues follow the control and event queues */
+#define VIRTIO_SCSI_REQUEST_QUEUE       2
+
 struct virtio_scsi_event {
     u32 event;
     u8 lun[8];
@@ -96,6 +106,11 @@ struct virtio_scsi_request {
 
 typedef struct virtio_scsi_request *virtio_scsi_request;
 
+typedef struct virtio_scsi_queue {
+    struct virtqueue *requestq;
+    blkq q;
+} *virtio_scsi_queue;
+
 struct virtio_scsi {
     vtpci v;
 
@@ -104,7 +119,8 @@ struct virtio_scsi {
     struct virtqueue *eventq;
     struct virtio_scsi_event events[VIRTIO_SCSI_NUM_EVENTS];
 
-    struct virtqueue *requestq;
+    int nqueues;
+    struct virtio_scsi_queue queues[VIRTIO_SCSI_MAX_QUEUES];
 
     u16 max_target;
     u16 max_lun;
@@ -113,6 +129,8 @@ struct virtio_scsi {
     u16 lun;
     u64 capacity;
     u64 block_size;
+    u32 seg_max;
+    u32 max_sectors;
 };
 
 typedef struct virtio_scsi *virtio_scsi;
@@ -170,32 +188,39 @@ static virtio_scsi_request virtio_scsi_alloc_request(virtio_scsi s, u16 target,
     return r;
 }
 
-static void virtio_scsi_enqueue_request(virtio_scsi s, virtio_scsi_request r, void *buf, u64 length, vsr_complete c)
+static void virtio_scsi_enqueue_bufs(virtio_scsi s, virtqueue vq, virtio_scsi_request r,
+                                     struct block_buf *bufs, int nbufs, vsr_complete c)
 {
     vqfinish f = closure(s->v->general, virtio_scsi_request_complete, c, s, r);
-    virtqueue vq = s->requestq;
     vqmsg m = allocate_vqmsg(vq);
     assert(m != INVALID_ADDRESS);
 
     vqmsg_push(vq, m, &r->req, sizeof(r->req), false);
     if (r->req.cdb[0] == SCSI_CMD_WRITE_16) {
-        if (length > 0)
-            vqmsg_push(vq, m, buf, length, false);          // dataout
+        for (int i = 0; i < nbufs; i++)
+            vqmsg_push_pages(vq, m, bufs[i].buf, bufs[i].length, false);    // dataout
         vqmsg_push(vq, m, &r->resp, sizeof(r->resp), true); // response
     } else {
         vqmsg_push(vq, m, &r->resp, sizeof(r->resp), true); // response
-        if (length > 0)
-            vqmsg_push(vq, m, buf, length, true);           // datain
+        for (int i = 0; i < nbufs; i++)
+            vqmsg_push_pages(vq, m, bufs[i].buf, bufs[i].length, true);     // datain
     }
 
     vqmsg_commit(vq, m, f);
 }
 
+/* Commands other than reads and writes go on the first request queue. */
+static void virtio_scsi_enqueue_request(virtio_scsi s, virtio_scsi_request r, void *buf, u64 length, vsr_complete c)
+{
+    struct block_buf b = { .buf = buf, .length = length };
+    virtio_scsi_enqueue_bufs(s, s->queues[0].requestq, r, &b, length > 0 ? 1 : 0, c);
+}
+
 /*
  * Device driver hooks
  */
-static CLOSURE_3_2(virtio_scsi_io_done, void, status_handler, void *, u64, virtio_scsi, virtio_scsi_request);
-static void virtio_scsi_io_done(status_handler sh, void *buf, u64 len, virtio_scsi s, virtio_scsi_request r)
+static CLOSURE_2_2(virtio_scsi_io_done, void, blkq, block_request, virtio_scsi, virtio_scsi_request);
+static void virtio_scsi_io_done(blkq q, block_request br, virtio_scsi s, virtio_scsi_request r)
 {
     struct virtio_scsi_resp_cmd *resp = &r->resp;
     virtio_scsi_debug("%s: target %d, lun %d, response %d, status %d\n",
@@ -208,32 +233,34 @@ static void virtio_scsi_io_done(status_handler sh, void *buf, u64 len, virtio_sc
         scsi_dump_sense(resp->sense, sizeof(resp->sense));
         st = timm("result", "status %d", resp->status);
     }
-    apply(sh, st);
+    blkq_complete(q, br, st);
 }
 
-static void virtio_scsi_io(virtio_scsi s, u8 cmd, void *buf, range blocks, status_handler sh)
+static CLOSURE_2_1(virtio_scsi_submit, void, virtio_scsi, virtio_scsi_queue, block_request);
+static void virtio_scsi_submit(virtio_scsi s, virtio_scsi_queue sq, block_request br)
 {
+    u8 cmd = br->write ? SCSI_CMD_WRITE_16 : SCSI_CMD_READ_16;
     virtio_scsi_request r = virtio_scsi_alloc_request(s, s->target, s->lun, cmd);
     struct scsi_cdb_readwrite_16 *cdb = (struct scsi_cdb_readwrite_16 *) r->req.cdb;
-    u32 nblocks = range_span(blocks);
-    cdb->addr = htobe64(blocks.start);
+    u32 nblocks = range_span(br->blocks);
+    cdb->addr = htobe64(br->blocks.start);
     cdb->length = htobe32(nblocks);
-    virtio_scsi_debug("%s: cmd %d, blocks %R, addr 0x%016lx, length 0x%08x\n",
-        __func__, cmd, blocks, cdb->addr, cdb->length);
-    virtio_scsi_enqueue_request(s, r, buf, nblocks * s->block_size,
-        closure(s->v->general, virtio_scsi_io_done, sh, buf, nblocks * s->block_size));
+    virtio_scsi_debug("%s: cmd %d, blocks %R, addr 0x%016lx, length 0x%08x, %d bufs\n",
+        __func__, cmd, br->blocks, cdb->addr, cdb->length, br->nbufs);
+    virtio_scsi_enqueue_bufs(s, sq->requestq, r, br->bufs, br->nbufs,
+        closure(s->v->general, virtio_scsi_io_done, sq->q, br));
 }
 
 static CLOSURE_1_3(virtio_scsi_write, void, virtio_scsi, void *, range, status_handler);
 static void virtio_scsi_write(virtio_scsi s, void *buf, range blocks, status_handler sh)
 {
-    virtio_scsi_io(s, SCSI_CMD_WRITE_16, buf, blocks, sh);
+    blkq_io(s->queues[current_cpu()->id % s->nqueues].q, true, buf, blocks, sh);
 }
 
 static CLOSURE_1_3(virtio_scsi_read, void, virtio_scsi, void *, range, status_handler);
 static void virtio_scsi_read(virtio_scsi s, void *buf, range blocks, status_handler sh)
 {
-    virtio_scsi_io(s, SCSI_CMD_READ_16, buf, blocks, sh);
+    blkq_io(s->queues[current_cpu()->id % s->nqueues].q, false, buf, blocks, sh);
 }
 
 static CLOSURE_2_0(virtio_scsi_init_done, void, virtio_scsi, storage_attach);
@@ -271,6 +298,18 @@ static void virtio_scsi_read_capacity_done(storage_attach a, u16 target, u16 lun
     virtio_scsi_debug("%s: target %d, lun %d, block size 0x%lx, capacity 0x%lx\n",
         __func__, target, lun, s->block_size, s->capacity);
 
+    /* max_sectors counts 512-byte sectors */
+    u64 max_blocks = s->max_sectors > 0 ? MAX(((u64)s->max_sectors << 9) / s->block_size, 1) : infinity;
+    for (int i = 0; i < s->nqueues; i++) {
+        virtio_scsi_queue sq = &s->queues[i];
+        /* leave room for the request and response descriptors */
+        u64 max_segments = virtqueue_entries(sq->requestq) - 2;
+        if (s->seg_max > 0)
+            max_segments = MIN(max_segments, s->seg_max);
+        sq->q = allocate_blkq(s->v->general, "virtio-scsi", i, s->block_size, max_blocks,
+                              max_segments, closure(s->v->general, virtio_scsi_submit, s, sq));
+    }
+
     enqueue(runqueue, closure(s->v->general, virtio_scsi_init_done, s, a));
 }
 
@@ -345,7 +384,8 @@ static void virtio_scsi_inquiry_done(storage_attach a, u16 target, u16 lun, virt
     static const char vendor_google[] = "Google";
     if (runtime_memcmp(res->vendor, vendor_google, sizeof(vendor_google) - 1) == 0) {
         virtio_scsi_debug("%s: limiting max queued\n", __func__);
-        virtqueue_set_max_queued(s->requestq, 1);
+        for (int i = 0; i < s->nqueues; i++)
+            virtqueue_set_max_queued(s->queues[i].requestq, 1);
     }
 
     // test unit ready
@@ -401,15 +441,6 @@ static void virtio_scsi_attach(heap general, storage_attach a, heap page_allocat
     virtio_scsi_debug("features 0x%lx\n", s->v->features);
 
 #ifdef VIRTIO_SCSI_DEBUG
-    u32 num_queues = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_NUM_QUEUES);
-    virtio_scsi_debug("num queues %d\n", num_queues);
-
-    u32 seg_max = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_SEG_MAX);
-    virtio_scsi_debug("seg max %d\n", seg_max);
-
-    u32 max_sectors = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_MAX_SECTORS);
-    virtio_scsi_debug("max sectors %d\n", max_sectors);
-
     u32 cmd_per_lun = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_CMD_PER_LUN);
     virtio_scsi_debug("cmd per lun %d\n", cmd_per_lun);
 
@@ -420,6 +451,19 @@ static void virtio_scsi_attach(heap general, storage_attach a, heap page_allocat
     virtio_scsi_debug("max channel %d\n", max_channel);
 #endif
 
+    /* each queue takes the MSI-X vector of its index */
+    u32 num_queues = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_NUM_QUEUES);
+    virtio_scsi_debug("num queues %d\n", num_queues);
+    s->nqueues = MIN((int)MIN(num_queues, VIRTIO_SCSI_MAX_QUEUES),
+                     pci_get_msix_count(s->v->dev) - VIRTIO_SCSI_REQUEST_QUEUE);
+    s->nqueues = MAX(s->nqueues, 1);
+
+    s->seg_max = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_SEG_MAX);
+    virtio_scsi_debug("seg max %d\n", s->seg_max);
+
+    s->max_sectors = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_MAX_SECTORS);
+    virtio_scsi_debug("max sectors %d\n", s->max_sectors);
+
     s->max_target = in16(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_MAX_TARGET);
     virtio_scsi_debug("max target %d\n", s->max_target);
 
@@ -430,8 +474,11 @@ static void virtio_scsi_attach(heap general, storage_attach a, heap page_allocat
     assert(st == STATUS_OK);
     st = vtpci_alloc_virtqueue(s->v, 1, &s->eventq);
     assert(st == STATUS_OK);
-    st = vtpci_alloc_virtqueue(s->v, 2, &s->requestq);
-    assert(st == STATUS_OK);
+    for (int i = 0; i < s->nqueues; i++) {
+        st = vtpci_alloc_virtqueue(s->v, VIRTIO_SCSI_REQUEST_QUEUE + i, &s->queues[i].requestq);
+        assert(st == STATUS_OK);
+        virtqueue_set_kick_batch(s->queues[i].requestq, VIRTIO_SCSI_KICK_BATCH);
+    }
 
     // On reset, the device MUST set sense_size to 96 and cdb_size to 32
     out32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_SCSI_R_SENSE_SIZE, VIRTIO_SCSI_SENSE_SIZE);
@@ -1,4 +1,7 @@
+#include <runtime.h>
+#include <x86_64.h>
 #include <drivers/storage.h>
+#include <drivers/blkq.h>
 #include <io.h>
 
 #include "virtio_internal.h"
@@ -36,6 +39,8 @@ struct virtio_blk_config {
        u32 opt_io_size;
     } topology;
     u8 reserved;
+    u8 unused0;
+    u16 num_queues;
 } __attribute__((packed));
 
 #define VIRTIO_BLK_R_CAPACITY_LOW		(offsetof(struct virtio_blk_config *, capacity))
@@ -51,6 +56,12 @@ struct virtio_blk_config {
 #define VIRTIO_BLK_R_TOPOLOGY_MIN_IO_SIZE	(offsetof(struct virtio_blk_config *, topology) + offsetof(struct virtio_blk_topology *, min_io_size))
 #define VIRTIO_BLK_R_TOPOLOGY_OPT_IO_SIZE	(offsetof(struct virtio_blk_config *, topology) + offsetof(struct virtio_blk_topology *, opt_io_size))
 #define VIRTIO_BLK_R_RESERVED			(offsetof(struct virtio_blk_config *, reserved))
+#define VIRTIO_BLK_R_NUM_QUEUES			(offsetof(struct virtio_blk_config *, num_queues))
+
+/* Feature bits */
+#define VIRTIO_BLK_F_SIZE_MAX   (1 << 1)        /* size_max is the longest segment */
+#define VIRTIO_BLK_F_SEG_MAX    (1 << 2)        /* seg_max is the most segments in a request */
+#define VIRTIO_BLK_F_MQ         (1 << 12)       /* num_queues request queues */
 
 #define VIRTIO_BLK_REQ_HEADER_SIZE      16
 #define VIRTIO_BLK_REQ_STATUS_SIZE      1
@@ -63,17 +74,29 @@ struct virtio_blk_config {
 #define VIRTIO_BLK_S_IOERR      1
 #define VIRTIO_BLK_S_UNSUPP     2
 
+/* requests queued before the host is notified */
+#define STORAGE_KICK_BATCH      16
+
+/* a cpu submits to the queue its id selects */
+#define STORAGE_MAX_QUEUES      MAX_CPUS
+
 #ifdef VIRTIO_BLK_DEBUG
 # define virtio_blk_debug rprintf
 #else
 # define virtio_blk_debug(...) do { } while(0)
 #endif /* defined(VIRTIO_BLK_DEBUG) */
 
+typedef struct storage_queue {
+    struct virtqueue *command;
+    blkq q;
+} *storage_queue;
+
 typedef struct storage {
     vtpci v;
-    struct virtqueue *command;
     u64 capacity;
     u64 block_size;
+    int nqueues;
+    struct storage_queue queues[STORAGE_MAX_QUEUES];
 } *storage;
 
 static virtio_blk_req allocate_virtio_blk_req(storage st, u32 type, u64 sector)
@@ -92,17 +115,34 @@ static void deallocate_virtio_blk_req(storage st, virtio_blk_req req)
                pad(sizeof(struct virtio_blk_req), st->v->contiguous->pagesize));
 }
 
-static CLOSURE_4_1(complete, void, storage, status_handler, u8 *, virtio_blk_req, u64);
-static void complete(storage s, status_handler f, u8 *result, virtio_blk_req req, u64 len)
+static CLOSURE_5_1(complete, void, storage, storage_queue, block_request, u8 *, virtio_blk_req, u64);
+static void complete(storage s, storage_queue sq, block_request r, u8 *result, virtio_blk_req req, u64 len)
 {
     status st = 0;
     // 1 is io error, 2 is unsupported operation
     if (*result) st = timm("result", "%d", *result);
-    apply(f, st);
+    blkq_complete(sq->q, r, st);
     deallocate_virtio_blk_req(s, req);
-    //    s->command->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
-    // used isn't valid?
-    //    rprintf("used: %d\n",  s->command->vq_ring.used->idx);    
+}
+
+/* Buffers were checked for alignment when the request was queued. */
+static CLOSURE_2_1(storage_submit, void, storage, storage_queue, block_request);
+static void storage_submit(storage st, storage_queue sq, block_request r)
+{
+    virtio_blk_debug("virtio_%s: block range %R, %d bufs\n", r->write ? "write" : "read",
+                     r->blocks, r->nbufs);
+    virtio_blk_req req = allocate_virtio_blk_req(st, r->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+                                                 r->blocks.start);
+    virtqueue vq = sq->command;
+    vqmsg m = allocate_vqmsg(vq);
+    assert(m != INVALID_ADDRESS);
+    vqmsg_push(vq, m, req, VIRTIO_BLK_REQ_HEADER_SIZE, false);
+    for (int i = 0; i < r->nbufs; i++)
+        vqmsg_push_pages(vq, m, r->bufs[i].buf, r->bufs[i].length, !r->write);
+    void * statusp = ((void *)req) + VIRTIO_BLK_REQ_HEADER_SIZE;
+    vqmsg_push(vq, m, statusp, VIRTIO_BLK_REQ_STATUS_SIZE, true);
+    vqfinish c = closure(st->v->general, complete, st, sq, r, statusp, req);
+    vqmsg_commit(vq, m, c);
 }
 
 static inline void storage_rw_internal(storage st, boolean write, void * buf,
@@ -118,24 +158,12 @@ static inline void storage_rw_internal(storage st, boolean write, void * buf,
         goto out_inval;
     }
 
-    u64 start_sector = sectors.start;
-    u64 nsectors = range_span(sectors);
-    if (nsectors == 0) {
+    if (range_span(sectors) == 0) {
         err = "length must be > 0";
         goto out_inval;
     }
 
-    virtio_blk_req req = allocate_virtio_blk_req(st, write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
-                                                 start_sector);
-    virtqueue vq = st->command;
-    vqmsg m = allocate_vqmsg(vq);
-    assert(m != INVALID_ADDRESS);
-    vqmsg_push(vq, m, req, VIRTIO_BLK_REQ_HEADER_SIZE, false);
-    vqmsg_push(vq, m, buf, nsectors * st->block_size, !write);
-    void * statusp = ((void *)req) + VIRTIO_BLK_REQ_HEADER_SIZE;
-    vqmsg_push(vq, m, statusp, VIRTIO_BLK_REQ_STATUS_SIZE, true);
-    vqfinish c = closure(st->v->general, complete, st, sh, statusp, req);
-    vqmsg_commit(vq, m, c);
+    blkq_io(st->queues[current_cpu()->id % st->nqueues].q, write, buf, sectors, sh);
     return;
   out_inval:
     msg_err("%s", err);               /* yes, bark */
@@ -157,12 +185,57 @@ static void storage_read(storage st, void * target, range blocks, status_handler
 static void virtio_blk_attach(heap general, storage_attach a, heap page_allocator, heap pages, pci_dev d)
 {
     storage s = allocate(general, sizeof(struct storage));
-    s->v = attach_vtpci(general, page_allocator, d, 0);
+    s->v = attach_vtpci(general, page_allocator, d,
+                        VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_MQ);
 
     s->block_size = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_BLOCK_SIZE);
     s->capacity = (in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_CAPACITY_LOW) |
 		   ((u64) in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_CAPACITY_HIGH) << 32)) * s->block_size;
-    vtpci_alloc_virtqueue(s->v, 0, &s->command);
+
+    /* each queue takes the MSI-X vector of its index */
+    s->nqueues = 1;
+    if (s->v->features & VIRTIO_BLK_F_MQ) {
+        u16 num_queues = in16(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_NUM_QUEUES);
+        virtio_blk_debug("num queues %d\n", num_queues);
+        s->nqueues = MAX(1, MIN(MIN(num_queues, STORAGE_MAX_QUEUES), pci_get_msix_count(s->v->dev)));
+    }
+
+    u32 seg_max = 0, size_max = 0;
+    if (s->v->features & VIRTIO_BLK_F_SEG_MAX) {
+        seg_max = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_SEG_MAX);
+        virtio_blk_debug("seg max %d\n", seg_max);
+    }
+    if (s->v->features & VIRTIO_BLK_F_SIZE_MAX) {
+        size_max = in32(s->v->base + VIRTIO_MSI_DEVICE_CONFIG + VIRTIO_BLK_R_SIZE_MAX);
+        virtio_blk_debug("size max %d\n", size_max);
+    }
+
+    /* The block queue counts segments in pages, each of which takes
+       this many descriptors when size_max is below the page size. */
+    u64 page_descs = size_max > 0 ? (PAGESIZE + size_max - 1) / size_max : 1;
+
+    for (int i = 0; i < s->nqueues; i++) {
+        storage_queue sq = &s->queues[i];
+        status st = vtpci_alloc_virtqueue(s->v, i, &sq->command);
+        assert(st == STATUS_OK);
+        virtqueue_set_kick_batch(sq->command, STORAGE_KICK_BATCH);
+        if (size_max > 0)
+            virtqueue_set_seg_size_max(sq->command, size_max);
+
+        /* leave room for the header and status descriptors */
+        u64 max_segments = virtqueue_entries(sq->command) - 2;
+        if (seg_max > 0)
+            max_segments = MIN(max_segments, seg_max);
+        max_segments /= page_descs;
+        if (max_segments < 2) {
+            msg_err("virtio-blk: seg_max %d, size_max %d too small for a block across pages; "
+                    "not attaching\n", seg_max, size_max);
+            return;
+        }
+        sq->q = allocate_blkq(general, "virtio-blk", i, s->block_size, infinity, max_segments,
+                              closure(general, storage_submit, s, sq));
+    }
+
     // initialization complete
     vtpci_set_status(s->v, VIRTIO_CONFIG_STATUS_DRIVER_OK);
 
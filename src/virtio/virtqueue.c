@@ -74,11 +74,25 @@ struct vring_used {
     struct vring_used_elem ring[0];
 } __attribute__((packed));
 
+/* Most uses here are a chain of 3 or less descriptors. */
+#define VQMSG_DEFAULT_SIZE     3
+
+/* Descriptor table size of each pooled message. Tables live in
+   physically contiguous memory, so a chain can be handed to the host
+   as a single indirect descriptor. */
+#define VQMSG_POOL_DESCS       16
+
 typedef struct vqmsg {
     struct list l;
-    u64 count;
-    buffer descv;               /* XXX should be a variable stride vector */
+    u16 count;                  /* descriptors pushed */
+    u16 max;                    /* capacity of desc */
+    u16 ring_count;             /* ring descriptors used while in flight */
+    boolean persistent;         /* retained by owner across completions */
+    boolean pooled;             /* slot of vq->pool */
+    struct vring_desc *desc;
+    physical desc_phys;         /* INVALID_PHYSICAL unless desc can be indirect */
     vqfinish completion;
+    u64 len;                    /* length reported by the host */
 } *vqmsg;
     
 typedef struct virtqueue {
@@ -94,37 +108,178 @@ typedef struct virtqueue {
     u16 last_used_idx;          /* irq only */
     struct list msgqueue;
     int max_queued;
+    boolean event_idx;          /* VIRTIO_RING_F_EVENT_IDX negotiated */
+    u16 kick_batch;             /* 0: notify as soon as anything is added */
+    u16 kicked_idx;             /* avail->idx at the last notify decision */
+    boolean kick_scheduled;     /* kick_thunk is on the deferqueue */
+    thunk kick_thunk;
+    u64 notifies;
+    u64 notifies_suppressed;    /* host asked not to be kicked */
+    u32 seg_size_max;           /* longest descriptor from vqmsg_push_pages */
+    boolean indirect;           /* VIRTIO_RING_F_INDIRECT_DESC negotiated */
+    struct vqmsg *pool;         /* entries messages, allocated on first use */
+    struct vring_desc *pool_desc;
+    struct list pool_free;
+    u64 pool_misses;            /* messages allocated from the heap */
+    struct list completed;      /* used by the host, awaiting completion */
+    boolean service_scheduled;  /* service is on the bhqueue */
+    thunk service;
     vqmsg msgs[0];
 } *virtqueue;
 
-/* Most uses here are a chain of 3 or less descriptors. */
-#define VQMSG_DEFAULT_SIZE     3
-vqmsg allocate_vqmsg(virtqueue vq)
+/* With EVENT_IDX, each side publishes the index it next wants to hear
+   about just past the other side's ring. */
+#define vring_used_event(vq) ((vq)->avail->ring[(vq)->entries])
+#define vring_avail_event(vq) \
+    (*(volatile u16 *)pointer_from_u64(u64_from_pointer((vq)->used->ring + (vq)->entries)))
+
+/* true if the host asked to be notified once event_idx has been
+   passed on the way from old_idx to new_idx */
+static inline boolean vring_need_event(u16 event_idx, u16 new_idx, u16 old_idx)
+{
+    return (u16)(new_idx - event_idx - 1) < (u16)(new_idx - old_idx);
+}
+
+static void vqmsg_init(vqmsg m)
 {
-    heap h = vq->dev->general;
-    vqmsg m = allocate(h, sizeof(struct vqmsg));
     list_init(&m->l);
     m->count = 0;
-    m->descv = allocate_buffer(h, sizeof(struct vring_desc) * VQMSG_DEFAULT_SIZE);
-    if (m->descv == INVALID_ADDRESS) {
+    m->ring_count = 0;
+    m->completion = 0;          /* fill on queue */
+    m->persistent = false;
+    m->len = 0;
+}
+
+static void vqmsg_pool_table(virtqueue vq, vqmsg m)
+{
+    m->desc = vq->pool_desc + (m - vq->pool) * VQMSG_POOL_DESCS;
+    m->desc_phys = physical_from_virtual(m->desc);
+    m->max = VQMSG_POOL_DESCS;
+}
+
+/* The pool covers as many messages as the ring can hold chains, so
+   the hot paths allocate nothing once it is set up. */
+static boolean virtqueue_alloc_pool(virtqueue vq)
+{
+    heap h = vq->dev->general;
+    vq->pool = allocate(h, vq->entries * sizeof(struct vqmsg));
+    if (vq->pool == INVALID_ADDRESS)
+        goto fail;
+    vq->pool_desc = allocate(vq->dev->contiguous,
+                             vq->entries * VQMSG_POOL_DESCS * sizeof(struct vring_desc));
+    if (vq->pool_desc == INVALID_ADDRESS) {
+        deallocate(h, vq->pool, vq->entries * sizeof(struct vqmsg));
+        goto fail;
+    }
+    for (int i = 0; i < vq->entries; i++) {
+        vqmsg m = vq->pool + i;
+        m->pooled = true;
+        vqmsg_pool_table(vq, m);
+        list_push_back(&vq->pool_free, &m->l);
+    }
+    return true;
+  fail:
+    vq->pool = 0;
+    msg_err("unable to allocate vqmsg pool for vq %p\n", vq);
+    return false;
+}
+
+static vqmsg allocate_vqmsg_heap(virtqueue vq)
+{
+    heap h = vq->dev->general;
+    vqmsg m = allocate(h, sizeof(struct vqmsg));
+    if (m == INVALID_ADDRESS)
+        return m;
+    m->desc = allocate(h, sizeof(struct vring_desc) * VQMSG_DEFAULT_SIZE);
+    if (m->desc == INVALID_ADDRESS) {
         deallocate(h, m, sizeof(struct vqmsg));
         return INVALID_ADDRESS;
     }
-    m->completion = 0;          /* fill on queue */
+    m->max = VQMSG_DEFAULT_SIZE;
+    m->desc_phys = INVALID_PHYSICAL;
+    m->pooled = false;
+    return m;
+}
+
+/* Messages come from the queue's pool, falling back to the heap if
+   it is exhausted. */
+vqmsg allocate_vqmsg(virtqueue vq)
+{
+    vqmsg m = INVALID_ADDRESS;
+    u64 flags = irq_disable_save();
+    if (!vq->pool)
+        virtqueue_alloc_pool(vq);
+    list l = list_get_next(&vq->pool_free);
+    if (l) {
+        list_delete(l);
+        m = struct_from_list(l, vqmsg, l);
+    } else {
+        vq->pool_misses++;
+    }
+    irq_restore(flags);
+
+    if (m == INVALID_ADDRESS) {
+        m = allocate_vqmsg_heap(vq);
+        if (m == INVALID_ADDRESS)
+            return m;
+    }
+    vqmsg_init(m);
+    return m;
+}
+
+/* A persistent message is not freed on completion. Its descriptors
+   and completion are set up once, and the owner re-posts it with
+   vqmsg_post() each time it comes back. It is kept out of the pool. */
+vqmsg allocate_vqmsg_persistent(virtqueue vq, vqfinish completion)
+{
+    vqmsg m = allocate_vqmsg_heap(vq);
+    if (m == INVALID_ADDRESS)
+        return m;
+    vqmsg_init(m);
+    m->completion = completion;
+    m->persistent = true;
     return m;
 }
 
-/* must be safe at interrupt level */
-void deallocate_vqmsg_irq(virtqueue vq, vqmsg m)
+/* must be called with interrupts disabled */
+static void deallocate_vqmsg_irq(virtqueue vq, vqmsg m)
 {
-    deallocate_buffer(m->descv);
-    deallocate(vq->dev->general, m, sizeof(struct vqmsg));
+    heap h = vq->dev->general;
+    if (m->pooled) {
+        /* drop a table that outgrew the pool slot */
+        if (m->desc_phys == INVALID_PHYSICAL) {
+            deallocate(h, m->desc, m->max * sizeof(struct vring_desc));
+            vqmsg_pool_table(vq, m);
+        }
+        list_push_back(&vq->pool_free, &m->l);
+        return;
+    }
+    deallocate(h, m->desc, m->max * sizeof(struct vring_desc));
+    deallocate(h, m, sizeof(struct vqmsg));
+}
+
+/* Long chains move to a heap table and go on the ring descriptor by
+   descriptor. */
+static void vqmsg_grow(virtqueue vq, vqmsg m)
+{
+    heap h = vq->dev->general;
+    u16 max = m->max * 2;
+    struct vring_desc *desc = allocate(h, max * sizeof(struct vring_desc));
+    if (desc == INVALID_ADDRESS)
+        halt("%s: unable to allocate descriptors\n", __func__);
+    runtime_memcpy(desc, m->desc, m->count * sizeof(struct vring_desc));
+    if (m->desc_phys == INVALID_PHYSICAL)
+        deallocate(h, m->desc, m->max * sizeof(struct vring_desc));
+    m->desc = desc;
+    m->desc_phys = INVALID_PHYSICAL;
+    m->max = max;
 }
 
 void vqmsg_push(virtqueue vq, vqmsg m, void * addr, u32 len, boolean write)
 {
-    buffer_extend(m->descv, (m->count + 1) * sizeof(struct vring_desc));
-    struct vring_desc * d = buffer_ref(m->descv, m->count * sizeof(struct vring_desc));
+    if (m->count == m->max)
+        vqmsg_grow(vq, m);
+    struct vring_desc * d = m->desc + m->count;
     d->busaddr = physical_from_virtual(addr);
     d->len = len;
     d->flags = write ? VRING_DESC_F_WRITE : 0;
@@ -132,6 +287,27 @@ void vqmsg_push(virtqueue vq, vqmsg m, void * addr, u32 len, boolean write)
     m->count++;
 }
 
+/* Push a buffer that may span physically discontiguous pages, such as
+   user memory, as one descriptor per physically contiguous run. */
+void vqmsg_push_pages(virtqueue vq, vqmsg m, void *addr, u64 len, boolean write)
+{
+    u64 va = u64_from_pointer(addr);
+    u64 end = va + len;
+    while (va < end) {
+        physical p = physical_from_virtual(pointer_from_u64(va));
+        assert(p != INVALID_PHYSICAL);
+        u64 n = MIN(pad(va + 1, PAGESIZE), end) - va;
+        while (va + n < end && n < vq->seg_size_max &&
+               physical_from_virtual(pointer_from_u64(va + n)) == p + n)
+            n = MIN(n + PAGESIZE, end - va);
+        /* each run goes in pieces of at most seg_size_max */
+        for (u64 e = va + n; va < e; va += n) {
+            n = MIN(e - va, vq->seg_size_max);
+            vqmsg_push(vq, m, pointer_from_u64(va), n, write);
+        }
+    }
+}
+
 static void virtqueue_fill(virtqueue vq);
 static void virtqueue_fill_irq(virtqueue vq);
 
@@ -143,10 +319,86 @@ void vqmsg_commit(virtqueue vq, vqmsg m, vqfinish completion)
     virtqueue_fill(vq);
 }
 
-static CLOSURE_2_0(vq_complete, void, vqfinish, u16);
-static void vq_complete(vqfinish f, u16 len)
+/* Queue a message without making it visible to the device; a batch
+   of posts is published with one virtqueue_kick(). */
+void vqmsg_post(virtqueue vq, vqmsg m)
+{
+    assert(m->completion);
+    u64 flags = irq_disable_save();
+    list_push_back(&vq->msgqueue, &m->l);
+    irq_restore(flags);
+}
+
+static int virtqueue_notify(virtqueue vq);
+
+/* Publish anything queued and notify the host now, regardless of the
+   kick batch. */
+void virtqueue_kick(virtqueue vq)
+{
+    u64 flags = irq_disable_save();
+    virtqueue_fill_irq(vq);
+    if (vq->avail->idx != vq->kicked_idx)
+        virtqueue_notify(vq);
+    irq_restore(flags);
+}
+
+/* Defer notifications until kick_batch descriptor chains have been
+   added or the kernel is about to return to user or go idle, whichever
+   comes first. Added chains are visible to the host immediately, so a
+   host that is already polling the ring picks them up without a kick. */
+void virtqueue_set_kick_batch(virtqueue vq, u16 kick_batch)
+{
+    vq->kick_batch = MIN(kick_batch, vq->entries);
+    virtqueue_debug("%s: vq %p: kick_batch = %d\n", __func__, vq, vq->kick_batch);
+}
+
+static CLOSURE_1_0(virtqueue_deferred_kick, void, virtqueue);
+static void virtqueue_deferred_kick(virtqueue vq)
+{
+    u64 flags = irq_disable_save();
+    vq->kick_scheduled = false;
+    if (vq->avail->idx != vq->kicked_idx)
+        virtqueue_notify(vq);
+    irq_restore(flags);
+}
+
+/* Limit the length of each descriptor from vqmsg_push_pages; below
+   the page size, a page takes more than one. */
+void virtqueue_set_seg_size_max(virtqueue vq, u32 seg_size_max)
+{
+    assert(seg_size_max > 0);
+    vq->seg_size_max = seg_size_max;
+}
+
+u16 virtqueue_entries(virtqueue vq)
+{
+    return vq->entries;
+}
+
+/* Run completions for messages the host has returned, from the
+   bhqueue. One instance per queue is scheduled at a time, so no
+   allocation is made per completion. */
+static CLOSURE_1_0(vq_service, void, virtqueue);
+static void vq_service(virtqueue vq)
 {
-    apply(f, len);
+    while (1) {
+        u64 flags = irq_disable_save();
+        list l = list_get_next(&vq->completed);
+        if (!l) {
+            vq->service_scheduled = false;
+            irq_restore(flags);
+            return;
+        }
+        list_delete(l);
+        vqmsg m = struct_from_list(l, vqmsg, l);
+        vqfinish completion = m->completion;
+        u64 len = m->len;
+        /* the slot is free for reuse by the completion itself */
+        if (!m->persistent)
+            deallocate_vqmsg_irq(vq, m);
+        irq_restore(flags);
+        apply(completion, len);
+    }
 }
 
 static CLOSURE_1_0(vq_interrupt, void, virtqueue);
@@ -158,14 +410,14 @@ static void vq_interrupt(virtqueue vq)
         __func__, vq, vq->entries, vq->last_used_idx, vq->used->idx, vq->desc_idx);
     
     int processed = 0;
+  again:
     while (vq->last_used_idx != vq->used->idx) {
         volatile struct vring_used_elem *uep = vq->used->ring + (vq->last_used_idx & (vq->entries - 1));
         virtqueue_debug_verbose("%s: vq %p: last_used_idx %d, id %d, len %d\n",
             __func__, vq, vq->last_used_idx, uep->id, uep->len);
         u16 head = uep->id;
-        u16 len = uep->len;
+        u32 len = uep->len;
         vqmsg m = vq->msgs[head];
-        vqfinish completion = m->completion;
 
         /* return descriptor(s) to free list */
         int dcount = 1;
@@ -174,18 +426,31 @@ static void vq_interrupt(virtqueue vq)
             d = vq->desc + d->next;
             dcount++;
         }
-        assert(dcount == m->count);
+        assert(dcount == m->ring_count);
         d->next = vq->desc_idx;
         vq->desc_idx = head;
 
         vq->last_used_idx++;
         processed++;
-        fetch_and_add(&vq->free_cnt, m->count);
+        fetch_and_add(&vq->free_cnt, m->ring_count);
         vq->msgs[head] = 0;
-        deallocate_vqmsg_irq(vq, m);
+        m->len = len;
+        list_push_back(&vq->completed, &m->l);
+    }
 
-        /* XXX seems like we could devise a way to avoid another enqueue */
-        enqueue(bhqueue, closure(vq->dev->general, vq_complete, completion, len));
+    /* ask for an interrupt on the next completion, then catch any
+       that slipped in before the host could see the update */
+    if (vq->event_idx) {
+        vring_used_event(vq) = vq->last_used_idx;
+        memory_barrier();
+        if (vq->used->idx != vq->last_used_idx)
+            goto again;
+    }
+
+    if (processed > 0 && !vq->service_scheduled) {
+        vq->service_scheduled = true;
+        if (!enqueue(bhqueue, vq->service))
+            halt("%s: unable to grow bhqueue\n", __func__);
     }
 
     virtqueue_fill_irq(vq);
@@ -202,8 +467,9 @@ status virtqueue_alloc(vtpci dev,
 {
     virtqueue vq;
     u64 d = size * sizeof(struct vring_desc);
-    u64 avail_end = pad(d + sizeof(*vq->avail) + sizeof(vq->avail->ring[0]) * size, align);
-    bytes alloc = avail_end + pad(sizeof(*vq->used) + sizeof(vq->used->ring[0]) * size, align);
+    /* each ring is followed by a u16 event index */
+    u64 avail_end = pad(d + sizeof(*vq->avail) + sizeof(vq->avail->ring[0]) * size + sizeof(u16), align);
+    bytes alloc = avail_end + pad(sizeof(*vq->used) + sizeof(vq->used->ring[0]) * size + sizeof(u16), align);
     vq = allocate(dev->general, sizeof(struct virtqueue) + size * sizeof(vqmsg));
     
     if (vq == INVALID_ADDRESS) 
@@ -217,6 +483,21 @@ status virtqueue_alloc(vtpci dev,
     vq->free_cnt = size;
     list_init(&vq->msgqueue);
     vq->max_queued = 0;
+    vq->event_idx = (dev->features & VIRTIO_RING_F_EVENT_IDX) != 0;
+    vq->kick_batch = 0;
+    vq->kicked_idx = 0;
+    vq->kick_scheduled = false;
+    vq->kick_thunk = closure(dev->general, virtqueue_deferred_kick, vq);
+    vq->notifies = vq->notifies_suppressed = 0;
+    vq->seg_size_max = MASK(32);
+    vq->indirect = (dev->features & VIRTIO_RING_F_INDIRECT_DESC) != 0;
+    vq->pool = 0;
+    vq->pool_desc = 0;
+    list_init(&vq->pool_free);
+    vq->pool_misses = 0;
+    list_init(&vq->completed);
+    vq->service_scheduled = false;
+    vq->service = closure(dev->general, vq_service, vq);
 
     if ((vq->ring_mem = allocate_zero(dev->contiguous, alloc)) != INVALID_ADDRESS) {
         vq->desc = (struct vring_desc *) vq->ring_mem;
@@ -249,14 +530,24 @@ physical virtqueue_paddr(virtqueue vq)
     return (physical_from_virtual(vq->ring_mem));
 }
 
+/* Notify the host of everything added since the last notify, unless
+   it has said it doesn't need to hear about it. */
 static int virtqueue_notify(virtqueue vq)
 {
-    // ensure used->flags update is visible to us
+    // ensure used->flags / avail_event update is visible to us
     // and updated avail->idx is visible to host
     memory_barrier();
-    int should_notify = (vq->used->flags & VRING_USED_F_NO_NOTIFY) == 0;
-    if (should_notify)
+    u16 new_idx = vq->avail->idx;
+    int should_notify = vq->event_idx ?
+        vring_need_event(vring_avail_event(vq), new_idx, vq->kicked_idx) :
+        (vq->used->flags & VRING_USED_F_NO_NOTIFY) == 0;
+    vq->kicked_idx = new_idx;
+    if (should_notify) {
         vtpci_notify_virtqueue(vq->dev, vq->queue_index);
+        vq->notifies++;
+    } else {
+        vq->notifies_suppressed++;
+    }
     return should_notify;
 }
 
@@ -268,9 +559,12 @@ static void virtqueue_fill_irq(virtqueue vq)
     list n = list_get_next(&vq->msgqueue);
 
     u16 added = 0;
+    u16 avail_idx = vq->avail->idx;
     while (n && n != &vq->msgqueue) {
         vqmsg m = struct_from_list(n, vqmsg, l);
-        if (vq->free_cnt < m->count) {
+        u16 ring_count = (vq->indirect && m->count > 1 &&
+                          m->desc_phys != INVALID_PHYSICAL) ? 1 : m->count;
+        if (vq->free_cnt < ring_count) {
             virtqueue_debug_verbose("%s: vq %p: queue full (vq->free_cnt %ld)\n",
                 __func__, vq, vq->free_cnt);
             break;
@@ -286,39 +580,60 @@ static void virtqueue_fill_irq(virtqueue vq)
         u16 head = vq->desc_idx;
         vq->msgs[head] = m;
 
-        for (int i = 0; i < m->count; i++) {
-            struct vring_desc *src = buffer_ref(m->descv, i * sizeof(*src));
+        if (ring_count < m->count) {
+            /* the message's own table becomes the chain */
+            for (int i = 0; i < m->count - 1; i++) {
+                m->desc[i].flags |= VRING_DESC_F_NEXT;
+                m->desc[i].next = i + 1;
+            }
             volatile struct vring_desc *d = vq->desc + vq->desc_idx;
-            d->busaddr = src->busaddr;
-            d->len = src->len;
-            d->flags = src->flags;
-            if (i < m->count - 1)
-                d->flags |= VRING_DESC_F_NEXT;
+            d->busaddr = m->desc_phys;
+            d->len = m->count * sizeof(struct vring_desc);
+            d->flags = VRING_DESC_F_INDIRECT;
             vq->desc_idx = d->next;
-
-            virtqueue_debug_verbose("%s: virtqueue %p: msg %p (count %d): desc->flags 0x%x, desc->next %d\n",
-                __func__, vq, m, m->count, d->flags, d->next);
+        } else {
+            for (int i = 0; i < m->count; i++) {
+                struct vring_desc *src = m->desc + i;
+                volatile struct vring_desc *d = vq->desc + vq->desc_idx;
+                d->busaddr = src->busaddr;
+                d->len = src->len;
+                d->flags = src->flags;
+                if (i < m->count - 1)
+                    d->flags |= VRING_DESC_F_NEXT;
+                vq->desc_idx = d->next;
+
+                virtqueue_debug_verbose("%s: virtqueue %p: msg %p (count %d): desc->flags 0x%x, desc->next %d\n",
+                    __func__, vq, m, m->count, d->flags, d->next);
+            }
         }
+        m->ring_count = ring_count;
 
-        u16 avail_idx = vq->avail->idx & (vq->entries - 1);
-        vq->avail->ring[avail_idx] = head;
+        u16 slot = (avail_idx + added) & (vq->entries - 1);
+        vq->avail->ring[slot] = head;
         virtqueue_debug_verbose("%s: vq %p: msg %p (count %d): avail->ring[%d] = %d\n",
-            __func__, vq, m, m->count, avail_idx, head);
-        fetch_and_add(&vq->free_cnt, -m->count);
+            __func__, vq, m, m->count, slot, head);
+        fetch_and_add(&vq->free_cnt, -ring_count);
         added++;
 
-        // ensure desc and avail ring updates above are visible before updating avail->idx
-        write_barrier();
-        vq->avail->idx++;
-
         list nn = list_get_next(n);
         list_delete(n);
         n = nn;
     }
 
     int notified = 0;
-    if (added > 0)
-        notified = virtqueue_notify(vq);
+    if (added > 0) {
+        /* publish the whole batch with a single avail->idx update;
+           desc and avail ring writes must be visible first */
+        write_barrier();
+        vq->avail->idx = avail_idx + added;
+        if (vq->kick_batch == 0 || (u16)(vq->avail->idx - vq->kicked_idx) >= vq->kick_batch) {
+            notified = virtqueue_notify(vq);
+        } else if (!vq->kick_scheduled) {
+            vq->kick_scheduled = true;
+            if (!enqueue(deferqueue, vq->kick_thunk))
+                halt("%s: unable to grow deferqueue\n", __func__);
+        }
+    }
     (void) notified;
     virtqueue_debug("%s: EXIT: vq %p: added %d, notified %d, desc_idx %d\n",
         __func__, vq, added, notified, vq->desc_idx);
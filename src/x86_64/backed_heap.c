@@ -63,3 +63,73 @@ heap physically_backed(heap meta, heap virtual, heap physical, heap pages, u64 p
     b->h.pagesize = pagesize;
     return (heap)b;
 }
+
+/* Like physically_backed, but the physical pages behind an allocation
+   need not be contiguous, for buffers which are only ever handed to
+   devices as a list of segments. A contiguous run is tried first, as
+   it makes for fewer segments. */
+static void scattered_release(backed b, u64 v, u64 len)
+{
+    u64 end = v + len;
+    while (v < end) {
+        physical p = physical_from_virtual(pointer_from_u64(v));
+        u64 n = b->h.pagesize;
+        while (v + n < end && physical_from_virtual(pointer_from_u64(v + n)) == p + n)
+            n += b->h.pagesize;
+        deallocate_u64(b->physical, p, n);
+        v += n;
+    }
+}
+
+static void physically_scattered_dealloc(heap h, u64 x, bytes length)
+{
+    backed b = (backed)h;
+    u64 padlen = pad(length, h->pagesize);
+    if ((x & (h->pagesize-1))) {
+	msg_err("attempt to free unaligned area at %lx, length %x; leaking\n", x, length);
+	return;
+    }
+
+    scattered_release(b, x, padlen);
+    deallocate(b->virtual, pointer_from_u64(x), padlen);
+    unmap(x, padlen, b->pages);
+}
+
+static u64 physically_scattered_alloc(heap h, bytes length)
+{
+    backed b = (backed)h;
+    u64 len = pad(length, h->pagesize);
+    u64 v = allocate_u64(b->virtual, len);
+    if (v == INVALID_PHYSICAL)
+        return v;
+
+    u64 p = allocate_u64(b->physical, len);
+    if (p != INVALID_PHYSICAL) {
+        map(v, p, len, PAGE_WRITABLE | PAGE_NO_EXEC, b->pages);
+        return v;
+    }
+
+    for (u64 off = 0; off < len; off += h->pagesize) {
+        p = allocate_u64(b->physical, h->pagesize);
+        if (p == INVALID_PHYSICAL) {
+            scattered_release(b, v, off);
+            unmap(v, off, b->pages);
+            deallocate_u64(b->virtual, v, len);
+            return INVALID_PHYSICAL;
+        }
+        map(v + off, p, h->pagesize, PAGE_WRITABLE | PAGE_NO_EXEC, b->pages);
+    }
+    return v;
+}
+
+heap physically_scattered(heap meta, heap virtual, heap physical, heap pages, u64 pagesize)
+{
+    backed b = allocate(meta, sizeof(struct backed));
+    b->h.alloc = physically_scattered_alloc;
+    b->h.dealloc = physically_scattered_dealloc;
+    b->physical = physical;
+    b->virtual = virtual;
+    b->pages = pages;
+    b->h.pagesize = pagesize;
+    return (heap)b;
+}
@@ -1,5 +1,7 @@
 #include <runtime.h>
 #include <x86_64.h>
+#include <pvclock.h>
+#include <vdso.h>
 #include "hpet.h"
 #include "rtc.h"
 
@@ -11,18 +13,6 @@ static timestamp rtc_offset;
 
 #define MSR_KVM_SYSTEM_TIME 0x4b564d01
 
-struct pvclock_vcpu_time_info {
-    u32   version;
-    u32   pad0;
-    u64   tsc_timestamp;
-    u64   system_time;
-    u32   tsc_to_system_mul;
-    s8    tsc_shift;
-    u8    flags;
-    u8    pad[2];
-} __attribute__((__packed__));
-
-
 #define MSR_KVM_WALL_CLOCK 0x4b564d00
 struct pvclock_wall_clock {
     u32   version;
@@ -38,21 +28,7 @@ extern timestamp now_hpet();
 
 timestamp now_kvm()
 {
-    u64 r = rdtsc();
-    u64 delta = r - vclock->tsc_timestamp;
-    if (vclock->tsc_shift < 0) {
-        delta >>= -vclock->tsc_shift;
-    } else {
-        delta <<= vclock->tsc_shift;
-    }
-    // ok - a 64 bit number (?) multiplied by a 32 bit number yields
-    // a 96 bit result, chuck the bottom 32 bits
-    u64 nsec = vclock->system_time +
-            (((u128)delta * vclock->tsc_to_system_mul) >> 32);
-    u64 sec = nsec / BILLION;
-    nsec -= sec * BILLION;
-    timestamp out = seconds(sec) + nanoseconds(nsec);
-    return out;
+    return pvclock_now(vclock);
 }
 
 extern void lapic_runloop_timer(timestamp interval);
@@ -81,6 +57,24 @@ void kern_sleep(timestamp delta)
         asm volatile("pause");
 }
 
+/* The vdso reads the same clock as now(), from the page returned
+   here; it makes the syscall if there is no such page. */
+u64 vdso_clock_init(vdso_dat vd)
+{
+    vd->rtc_offset = rtc_offset;
+    if (clock_function == now_kvm) {
+        vd->clock_src = VDSO_CLOCK_PVCLOCK;
+        return physical_from_virtual((void *)vclock);
+    }
+    if (clock_function == now_hpet) {
+        vd->clock_src = VDSO_CLOCK_HPET;
+        vd->hpet_period_scaled_32 = hpet_period_scaled();
+        return HPET_TABLE_ADDRESS;
+    }
+    vd->clock_src = VDSO_CLOCK_SYSCALL;
+    return INVALID_PHYSICAL;
+}
+
 /* system timer that is reserved for processing the global timer heap */
 void runloop_timer(timestamp duration)
 {
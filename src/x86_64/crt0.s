@@ -9,17 +9,41 @@
         
 global_func _start
 extern  init_service
-extern  running_frame
-extern  syscall_stack_top
 
 %include "frame.inc"
         
 %define FS_MSR 0xc0000100
         
+;; jump to %2 if vector %1 is an exception that pushes an error code:
+;; #DF, #TS, #NP, #SS, #GP, #PF and #AC
+%macro jmp_if_error_code 2
+        cmp %1, 8
+        je %2
+        cmp %1, 17
+        je %2
+        cmp %1, 10
+        jb %%none
+        cmp %1, 14
+        jbe %2
+%%none:
+%endmacro
+
 extern common_handler
 interrupt_common:
         push rbx
-        mov rbx, [running_frame]
+        ;; coming from user mode, the gs base is the user's; the saved cs
+        ;; is behind the vector and, for some exceptions, an error code
+        mov rbx, [rsp+8]
+        jmp_if_error_code rbx, .errcode
+        test qword [rsp+24], 3
+        jmp .fromuser
+.errcode:
+        test qword [rsp+32], 3
+.fromuser:
+        jz .kernelgs
+        swapgs
+.kernelgs:
+        mov rbx, [gs:CPU_RUNNING_FRAME*8]
         mov [rbx+FRAME_RAX*8], rax
         mov [rbx+FRAME_RCX*8], rcx
         mov [rbx+FRAME_RDX*8], rdx
@@ -41,10 +65,7 @@ interrupt_common:
         mov [rbx+FRAME_VECTOR*8], rax
         
         ;;  could avoid this branch with a different inter layout - write as different handler
-        cmp rax, 0xe
-        je geterr
-        cmp rax, 0xd
-        je geterr
+        jmp_if_error_code rax, geterr
         
 getrip:
         pop rax            ; eip
@@ -61,7 +82,7 @@ getrip:
 
 global interrupt_exit
 interrupt_exit:
-        mov rbx, [running_frame]
+        mov rbx, [gs:CPU_RUNNING_FRAME*8]
 
         ; set fs selector to null before writing hidden base (for intel/no-accel)
         mov rax, 0
@@ -92,6 +113,10 @@ interrupt_exit:
         push qword [rbx+FRAME_CS*8]    ; cs
         push qword [rbx+FRAME_RIP*8]   ; rip
         mov rbx, [rbx+FRAME_RBX*8]
+        test qword [rsp+8], 3   ; cs
+        jz .iret
+        swapgs
+.iret:
         iretq
 
 global_func geterr
@@ -123,8 +148,9 @@ vectors:
 extern syscall
 global_func syscall_enter
 syscall_enter:
+        swapgs                  ; always from user mode
         push rax
-        mov rax, [running_frame]
+        mov rax, [gs:CPU_RUNNING_FRAME*8]
         mov [rax+FRAME_RBX*8], rbx
         pop rbx
         mov [rax+FRAME_VECTOR*8], rbx
@@ -144,9 +170,9 @@ syscall_enter:
         mov [rax+FRAME_RIP*8], rcx
         mov rax, syscall
         mov rax, [rax]
-        mov rsp, [syscall_stack_top]
+        mov rsp, [gs:CPU_SYSCALL_STACK*8]
         call rax
-        mov rbx, [running_frame]
+        mov rbx, [gs:CPU_RUNNING_FRAME*8]
         ;; fall through to frame_return
 .end:
 
@@ -180,6 +206,7 @@ frame_return:
         mov rsp, [rax+FRAME_RSP*8]
         mov rcx, [rax+FRAME_RIP*8]
         mov rax, [rax+FRAME_RAX*8]
+        swapgs
         o64 sysret
 .end:
 
@@ -228,16 +255,27 @@ _start:
         hlt
 .end:
 
+        ;; rdi: this cpu's copy of GDT64, rsi: its TSS
 global_func install_gdt64_and_tss
 install_gdt64_and_tss:
-        lgdt [GDT64.Pointer]
-        mov rax, TSS
-        mov [GDT64 + GDT64.TSS + 2], ax
+        mov rax, rsi
+        mov [rdi + GDT64.TSS + 2], ax
         shr rax, 0x10
-        mov [GDT64 + GDT64.TSS + 4], al
-        mov [GDT64 + GDT64.TSS + 7], ah
+        mov [rdi + GDT64.TSS + 4], al
+        mov [rdi + GDT64.TSS + 7], ah
         shr rax, 0x10
-        mov [GDT64 + GDT64.TSS + 8], eax
+        mov [rdi + GDT64.TSS + 8], eax
+        mov byte [rdi + GDT64.TSS + 5], 10001001b ; copies may have the busy bit set
+        sub rsp, 16
+        mov word [rsp], GDT64.Pointer - GDT64 - 1
+        mov [rsp + 2], rdi
+        lgdt [rsp]
+        add rsp, 16
+        push GDT64.Code         ; reload cs from the new table
+        lea rax, [rel .reload]
+        push rax
+        o64 retf
+.reload:
         mov rax, GDT64.TSS
         ltr ax
         ret
@@ -245,6 +283,7 @@ install_gdt64_and_tss:
 
         ;; set this crap up again so we can remove the stage2 one from low memory
 align 16                        ; necessary?
+global_data GDT64
 GDT64:  ; Global Descriptor Table (64-bit).
         ;;  xxx - clean this up with a macro
         .Null: equ $ - GDT64 ; null descriptor
@@ -291,9 +330,22 @@ GDT64:  ; Global Descriptor Table (64-bit).
         db 0                    ; Base [31:24]
         dd 0                    ; Base [63:32]
         dd 0                    ; Reserved
+        .CpuId: equ $ - GDT64   ; limit is the cpu number, for lsl from user mode - 0x38
+        dw 0                    ; Limit (low) [filled in per cpu]
+        dw 0                    ; Base (low).
+        db 0                    ; Base (middle)
+        db 11110010b            ; Access (user read/write).
+        db 00000000b            ; Granularity.
+        db 0                    ; Base (high).
         .Pointer:    ; The GDT-pointer.
         dw $ - GDT64 - 1    ; Limit.
         dq GDT64            ; 64 bit Base.
+.end:
+
+global_data gdt64_size
+gdt64_size:
+        dd GDT64.Pointer - GDT64
+.end:
 
         align 16                ; XXX ??
 global_data TSS
@@ -326,3 +378,85 @@ TSS:                            ; 64 bit TSS
         dw 0                    ; IOPB offset   0x64
         dw 0                    ; reserved      0x66
 .end:
+
+        ;; Secondary core entry, copied to AP_BOOT_PAGE and started in
+        ;; real mode by SIPI. The boot cpu fills in the parameter block
+        ;; after the copy. Cores share the stack at the top of the page,
+        ;; so they pass through here one at a time under the lock, which
+        ;; ap_entry releases once on its own stack.
+        AP_BOOT_PAGE equ 0x8000
+        AP_LOCK equ 0
+        AP_CR0 equ 4
+        AP_CR3 equ 8
+        AP_CR4 equ 12
+        AP_EFER equ 16
+        AP_ENTRY equ 24
+%define AP_ADDR(x) (AP_BOOT_PAGE + (x) - ap_start_begin)
+
+bits 16
+global ap_start_begin
+ap_start_begin:
+        cli
+        xor ax, ax
+        mov ds, ax
+.spin:
+        mov al, 1
+        xchg al, [AP_ADDR(ap_boot_params) + AP_LOCK]
+        test al, al
+        jz .locked
+        pause
+        jmp .spin
+.locked:
+        lgdt [AP_ADDR(ap_gdt.pointer)]
+        mov eax, cr0
+        or eax, 1
+        mov cr0, eax
+        jmp dword 0x08:AP_ADDR(ap_start32)
+
+bits 32
+ap_start32:
+        mov ax, 0x10
+        mov ds, ax
+        mov es, ax
+        mov ss, ax
+        mov eax, [AP_ADDR(ap_boot_params) + AP_CR4]
+        mov cr4, eax
+        mov eax, [AP_ADDR(ap_boot_params) + AP_CR3]
+        mov cr3, eax
+        mov ecx, 0xc0000080     ; EFER
+        mov eax, [AP_ADDR(ap_boot_params) + AP_EFER]
+        xor edx, edx
+        wrmsr
+        mov eax, [AP_ADDR(ap_boot_params) + AP_CR0]
+        mov cr0, eax            ; paging on, into compatibility mode
+        jmp 0x18:AP_ADDR(ap_start64)
+
+bits 64
+ap_start64:
+        mov rsp, AP_BOOT_PAGE + 0x1000
+        mov rax, [AP_ADDR(ap_boot_params) + AP_ENTRY]
+        call rax
+        hlt
+
+align 8
+ap_gdt:
+        dq 0
+        dq 0x00cf9a000000ffff   ; 32 bit code - 0x08
+        dq 0x00cf92000000ffff   ; data - 0x10
+        dq 0x00209a0000000000   ; 64 bit code - 0x18
+.pointer:
+        dw .pointer - ap_gdt - 1
+        dd AP_ADDR(ap_gdt)
+
+align 8
+global ap_boot_params
+ap_boot_params:
+        dd 0                    ; lock
+        dd 0                    ; cr0
+        dd 0                    ; cr3
+        dd 0                    ; cr4
+        dd 0                    ; efer
+        dd 0
+        dq 0                    ; entry
+global ap_start_end
+ap_start_end:
@@ -84,7 +84,6 @@ void *load_elf(buffer elf, u64 offset, heap pages, heap bss, boolean user)
                 flags |= PAGE_NO_EXEC;
             if ((p->p_flags & PF_W))
                 flags |= PAGE_WRITABLE;
-            map(aligned + offset, phy, ssize, flags, pages);
 
             // always zero up to the next aligned page start
             s64 bss_size = p->p_memsz - p->p_filesz;
@@ -92,8 +91,14 @@ void *load_elf(buffer elf, u64 offset, heap pages, heap bss, boolean user)
             if (bss_size < 0)
                 halt("load_elf with p->p_memsz (%ld) < p->p_filesz (%ld)\n",
                      p->p_memsz, p->p_filesz);
-            else if (bss_size == 0)
+            else if (bss_size == 0) {
+                map(aligned + offset, phy, ssize, flags, pages);
                 continue;
+            }
+
+            /* the zeroing below needs a writable mapping (CR0.WP) */
+            u64 fillflags = flags | PAGE_WRITABLE;
+            map(aligned + offset, phy, ssize, fillflags, pages);
 
             u64 bss_start = p->p_vaddr + offset + p->p_filesz;
             u64 initial_len = MIN(bss_size, pad(bss_start, PAGESIZE) - bss_start);
@@ -106,9 +111,12 @@ void *load_elf(buffer elf, u64 offset, heap pages, heap bss, boolean user)
                 u64 psize = pad((bss_size - initial_len), PAGESIZE);
                 u64 phys = allocate_u64(bss, psize);
                 /* XXX other flags for bss? */
-                map(pstart, phys, psize, flags, pages);
+                map(pstart, phys, psize, fillflags, pages);
                 vpzero(pointer_from_u64(pstart), phys, psize);
             }
+            if (!(flags & PAGE_WRITABLE))
+                update_map_flags(aligned + offset, pad(bss_start + bss_size, PAGESIZE) -
+                                 (aligned + offset), flags);
         }
     }
     u64 entry = e->e_entry;
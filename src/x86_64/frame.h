@@ -38,3 +38,7 @@
 #define FRAME_STACK_BOTTOM 28 // ??
 #define FRAME_SAVED_FRAME 29
 #define FRAME_MAX 30
+
+#define CPU_SELF 0              /* per-cpu data at %gs; see struct cpuinfo */
+#define CPU_RUNNING_FRAME 1
+#define CPU_SYSCALL_STACK 2
@@ -2,10 +2,10 @@
 #include <pci.h>
 #include <x86_64.h>
 #include <page.h>
+#include "hpet.h"
 
 extern heap interrupt_vectors;
 static heap timers;
-#define HPET_TABLE_ADDRESS 0xfed00000ull
 #define HPET_MAXIMUM_INCREMENT_PERIOD 0x05F5E100ul /* 100ns */
 
 /* Note: hpet registers allow only 32 and 64 bit accesses */
@@ -163,6 +163,11 @@ void hpet_periodic_timer(timestamp rate, thunk t)
 
 void hpet_runloop_timer(timestamp duration)
 {
+    if (duration == infinity) {
+        if (hpet_interrupts[0])
+            hpet->timers[0].config &= ~TCONF(INT_ENB_CNF);
+        return;
+    }
     timer_config(0, duration, ignore, false);
 }
 
@@ -171,6 +176,12 @@ timestamp now_hpet()
     return (((u128)hpet_main_counter()) * hpet_period_scaled_32) >> 32;
 }
 
+/* timestamp per counter tick, shifted left by 32 */
+timestamp hpet_period_scaled(void)
+{
+    return hpet_period_scaled_32;
+}
+
 boolean init_hpet(heap misc, heap virtual_pagesized, heap pages) {
     void * hpet_page = allocate(virtual_pagesized, PAGESIZE);
     if (hpet_page == INVALID_ADDRESS) {
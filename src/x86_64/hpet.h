@@ -1,6 +1,10 @@
+#pragma once
 
 boolean init_hpet(heap misc, heap virtual_pagesized, heap pages);
 void hpet_timer(timestamp period, thunk t);
 void hpet_runloop_timer(timestamp period);
 void hpet_periodic_timer(timestamp rate, thunk t);
+timestamp hpet_period_scaled(void);
+
+#define HPET_TABLE_ADDRESS 0xfed00000ull
 
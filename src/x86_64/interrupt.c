@@ -136,7 +136,6 @@ char *register_name(u64 s)
 }
 
 static thunk *handlers;
-context running_frame;
 
 void *apic_base = (void *)0xfee00000;
 
@@ -264,34 +263,63 @@ void lapic_eoi()
     write_barrier();
 }
 
-context miscframe;              /* for context save on interrupt */
-context intframe;               /* for context save on exception within interrupt */
-context bhframe;
+u32 lapic_id(void)
+{
+    return apic_read(APIC_APICID) >> 24;
+}
+
+#define ICR_DELIVERY_PENDING 0x1000
+
+void lapic_send_ipi(u32 apic_id, u32 icr)
+{
+    while (apic_read(APIC_ICRL) & ICR_DELIVERY_PENDING)
+        kern_pause();
+    apic_write(APIC_ICRH, apic_id << 24);
+    apic_write(APIC_ICRL, icr);
+}
 
 void kernel_sleep()
 {
-    running_frame = miscframe;
+    running_frame = current_cpu()->miscframe;
     enable_interrupts();
     __asm__("hlt");
     disable_interrupts();
 }
 
-void install_fallback_fault_handler(fault_handler h)
+static fault_handler fallback_handler;
+
+static void set_fallback_fault_handler(cpuinfo ci)
 {
-    assert(miscframe);
-    assert(intframe);
-    miscframe[FRAME_FAULT_HANDLER] = u64_from_pointer(h);
-    intframe[FRAME_FAULT_HANDLER] = u64_from_pointer(h);
-    bhframe[FRAME_FAULT_HANDLER] = u64_from_pointer(h);
+    ci->miscframe[FRAME_FAULT_HANDLER] = u64_from_pointer(fallback_handler);
+    ci->intframe[FRAME_FAULT_HANDLER] = u64_from_pointer(fallback_handler);
+    ci->bhframe[FRAME_FAULT_HANDLER] = u64_from_pointer(fallback_handler);
 }
 
-void * bh_stack_top;
+void install_fallback_fault_handler(fault_handler h)
+{
+    fallback_handler = h;
+    for (int i = 0; i < total_processors; i++) {
+        assert(cpuinfos[i].miscframe);
+        set_fallback_fault_handler(&cpuinfos[i]);
+    }
+}
 
 void common_handler()
 {
+    cpuinfo ci = current_cpu();
     int i = running_frame[FRAME_VECTOR];
-    boolean in_bh = running_frame == bhframe;
-    boolean in_inthandler = running_frame == intframe;
+
+    /* answered without the kernel lock, as the cpu requesting the
+       flush holds it while waiting */
+    if (shootdown_vector && i == shootdown_vector) {
+        service_tlb_flush(ci);
+        lapic_eoi();
+        return;
+    }
+
+    kern_lock();
+    boolean in_bh = running_frame == ci->bhframe;
+    boolean in_inthandler = running_frame == ci->intframe;
     boolean in_usermode = (!in_inthandler && !in_bh) &&
         (running_frame[FRAME_SS] == 0 || running_frame[FRAME_SS] == 0x13);
 
@@ -300,7 +328,7 @@ void common_handler()
     }
 
     if ((i < interrupt_size) && handlers[i]) {
-        frame_push(intframe);   /* catch any spurious exceptions during int handling */
+        frame_push(ci->intframe);   /* catch any spurious exceptions during int handling */
         apply(handlers[i]);
         lapic_eoi();
         frame_pop();
@@ -327,12 +355,28 @@ void common_handler()
     /* if the interrupt didn't occur during bottom half or int handler
        execution, switch context to bottom half processing */
     if (!in_bh && !in_inthandler) {
-        frame_push(bhframe);
-        switch_stack(bh_stack_top, process_bhqueue);
+        frame_push(ci->bhframe);
+        switch_stack(ci->bh_stack_top, process_bhqueue);
     }
 }
 
 heap interrupt_vectors;
+static int apic_error_vector;
+static int apic_timer_vector;
+
+/* per-cpu part of lapic setup, also run on each secondary core */
+void lapic_enable_local(void)
+{
+    // turn on the svr, then enable three lines
+    apic_write(APIC_SPURIOUS, *(unsigned int *)(apic_base + APIC_SPURIOUS) | APIC_SW_ENABLE);
+    apic_write(APIC_LVT_LINT0, APIC_DISABLE);
+    apic_write(APIC_LVT_LINT1, APIC_DISABLE);
+    apic_write(APIC_LVT_ERR, apic_error_vector);
+    if (apic_timer_vector) {
+        apic_write(APIC_TMRDIV, 3 /* 16 */);
+        apic_write(APIC_LVT_TMR, apic_timer_vector); /* one shot */
+    }
+}
 
 // actually allocate the virtual  - put in the tree
 static void enable_lapic(heap pages)
@@ -343,12 +387,8 @@ static void enable_lapic(heap pages)
     map(u64_from_pointer(apic_base), lapic, PAGESIZE, PAGE_DEV_FLAGS, pages);
     // xxx - no one is listening
     create_region(u64_from_pointer(apic_base), PAGESIZE, REGION_VIRTUAL);
-    
-    // turn on the svr, then enable three lines
-    apic_write(APIC_SPURIOUS, *(unsigned int *)(apic_base + APIC_SPURIOUS) | APIC_SW_ENABLE);
-    apic_write(APIC_LVT_LINT0, APIC_DISABLE);
-    apic_write(APIC_LVT_LINT1, APIC_DISABLE);
-    apic_write(APIC_LVT_ERR, allocate_u64(interrupt_vectors, 1));
+    apic_error_vector = allocate_u64(interrupt_vectors, 1);
+    lapic_enable_local();
 }
 
 
@@ -373,10 +413,17 @@ void calibrate_lapic_timer()
 
 void lapic_runloop_timer(timestamp interval)
 {
-    /* interval * apic_timer_cal_sec / second */
-    u32 cnt = (((u128)interval) * apic_timer_cal_sec) >> 32;
+    /* a zero count stops the timer */
+    if (interval == infinity) {
+        apic_write(APIC_TMRINITCNT, 0);
+        return;
+    }
+
+    /* interval * apic_timer_cal_sec / second, going off early rather
+       than not at all when out of range */
+    u64 cnt = (((u128)interval) * apic_timer_cal_sec) >> 32;
     apic_clear(APIC_LVT_TMR, APIC_LVT_INTMASK);
-    apic_write(APIC_TMRINITCNT, cnt);
+    apic_write(APIC_TMRINITCNT, MAX(MIN(cnt, (u32)-1), 1));
 }
 
 static CLOSURE_0_0(int_ignore, void);
@@ -389,6 +436,7 @@ void configure_lapic_timer(heap h)
     apic_write(APIC_LVT_TMR, v); /* one shot */
     register_interrupt(v, closure(h, int_ignore));
     calibrate_lapic_timer();
+    apic_timer_vector = v;
 }
 
 extern u32 interrupt_size;
@@ -396,17 +444,22 @@ extern u32 interrupt_size;
 #define FAULT_STACK_PAGES       8
 #define SYSCALL_STACK_PAGES     8
 
-extern volatile void * TSS;
-static inline void write_tss_u64(int offset, u64 val)
+static inline void write_tss_u64(cpuinfo ci, int offset, u64 val)
 {
-    u64 * vec = (u64 *)(u64_from_pointer(&TSS) + offset);
+    u64 * vec = (u64 *)(u64_from_pointer(ci->tss) + offset);
     *vec = val;
 }
 
-static void set_ist(int i, u64 sp)
+static void set_ist(cpuinfo ci, int i, u64 sp)
 {
     assert(i > 0 && i <= 7);
-    write_tss_u64(0x24 + (i - 1) * 8, sp);
+    write_tss_u64(ci, 0x24 + (i - 1) * 8, sp);
+}
+
+static u64 get_ist(cpuinfo ci, int i)
+{
+    assert(i > 0 && i <= 7);
+    return *(u64 *)(u64_from_pointer(ci->tss) + 0x24 + (i - 1) * 8);
 }
 
 context allocate_frame(heap h)
@@ -424,46 +477,94 @@ void * allocate_stack(heap pages, int npages)
     return base + pages->pagesize * npages - STACK_ALIGNMENT;
 }
 
-void * syscall_stack_top;
-
 #define IST_INTERRUPT 1         /* for all interrupts */
 #define IST_PAGEFAULT 2         /* page fault specific */
 
-void start_interrupts(kernel_heaps kh)
+/* Called from a page fault taken during a syscall that must wait, such
+   as for file data to be read in, until *done is set. Interrupts and
+   bottom halves are served meanwhile, on their own stacks, and the
+   kernel lock is let go between them, as with any sleep under a big
+   lock. Any page fault taken in the meantime uses the fault stack below
+   this one. The cpu halts between interrupts rather than spinning for
+   the length of a disk read; whoever sets *done from another cpu must
+   wake this one with wakeup_cpu(). */
+void kernel_wait_in_fault(volatile boolean *done)
 {
-    // these are simple enough it would be better to just
-    // synthesize them
-    int delta = (u64)&interrupt1 - (u64)&interrupt0;
-    void *start = &interrupt0;
-    heap general = heap_general(kh);
-    heap pages = heap_pages(kh);
+    cpuinfo ci = current_cpu();
+    u64 waitframe[FRAME_MAX];
+    u64 fault_stack = get_ist(ci, IST_PAGEFAULT);
+    u64 sp;
+
+    asm volatile("mov %%rsp, %0" : "=r"(sp));
+    set_ist(ci, IST_PAGEFAULT, (sp - 128) & ~(STACK_ALIGNMENT - 1));
+    zero(waitframe, sizeof(waitframe));
+    waitframe[FRAME_FAULT_HANDLER] = ci->miscframe[FRAME_FAULT_HANDLER];
+    frame_push(waitframe);
+    while (!*done) {
+        kern_unlock();
+        /* interrupts are only taken after the hlt, so one sent in
+           between still wakes it */
+        asm volatile("sti; hlt; cli" ::: "memory");
+        kern_lock();
+    }
+    frame_pop();
+    set_ist(ci, IST_PAGEFAULT, fault_stack);
+}
 
-    /* exception handlers */
-    handlers = allocate_zero(general, interrupt_size * sizeof(thunk));
-    assert(handlers != INVALID_ADDRESS);
+static heap int_general;
+static heap int_pages;
+static u16 *idt_pointer;
 
+/* frames and stacks for one cpu, set into its tss */
+void init_cpu_interrupts(cpuinfo ci)
+{
     /* alternate frame storage */
-    miscframe = allocate_frame(general);
-    intframe = allocate_frame(general);
-    bhframe = allocate_frame(general);
+    ci->miscframe = allocate_frame(int_general);
+    ci->intframe = allocate_frame(int_general);
+    ci->bhframe = allocate_frame(int_general);
+    if (fallback_handler)
+        set_fallback_fault_handler(ci);
 
     /* Page fault alternate stack. */
-    void * fault_stack_top = allocate_stack(pages, FAULT_STACK_PAGES);
+    void * fault_stack_top = allocate_stack(int_pages, FAULT_STACK_PAGES);
     assert(fault_stack_top != INVALID_ADDRESS);
-    set_ist(IST_PAGEFAULT, u64_from_pointer(fault_stack_top));
+    set_ist(ci, IST_PAGEFAULT, u64_from_pointer(fault_stack_top));
 
     /* Interrupt handlers run on their own stack. */
-    void * int_stack_top = allocate_stack(pages, INT_STACK_PAGES);
+    void * int_stack_top = allocate_stack(int_pages, INT_STACK_PAGES);
     assert(int_stack_top != INVALID_ADDRESS);
-    set_ist(IST_INTERRUPT, u64_from_pointer(int_stack_top));
+    set_ist(ci, IST_INTERRUPT, u64_from_pointer(int_stack_top));
 
     /* syscall stack - this can be replaced later by a per-thread kernel stack */
-    syscall_stack_top = allocate_stack(pages, SYSCALL_STACK_PAGES);
-    assert(syscall_stack_top != INVALID_ADDRESS);
+    ci->syscall_stack_top = allocate_stack(int_pages, SYSCALL_STACK_PAGES);
+    assert(ci->syscall_stack_top != INVALID_ADDRESS);
 
     /* Bottom half stack */
-    bh_stack_top = allocate_stack(pages, BH_STACK_PAGES);
-    assert(bh_stack_top != INVALID_ADDRESS);
+    ci->bh_stack_top = allocate_stack(int_pages, BH_STACK_PAGES);
+    assert(ci->bh_stack_top != INVALID_ADDRESS);
+}
+
+void install_idt(void)
+{
+    asm("lidt %0": : "m"(*idt_pointer));
+}
+
+void start_interrupts(kernel_heaps kh)
+{
+    // these are simple enough it would be better to just
+    // synthesize them
+    int delta = (u64)&interrupt1 - (u64)&interrupt0;
+    void *start = &interrupt0;
+    heap general = heap_general(kh);
+    heap pages = heap_pages(kh);
+    int_general = general;
+    int_pages = pages;
+
+    /* exception handlers */
+    handlers = allocate_zero(general, interrupt_size * sizeof(thunk));
+    assert(handlers != INVALID_ADDRESS);
+
+    init_cpu_interrupts(current_cpu());
 
     // architectural - end of exceptions
     u32 vector_start = 0x20;
@@ -477,11 +578,11 @@ void start_interrupts(kernel_heaps kh)
     for (int i = 32; i < interrupt_size; i++)
         write_idt(idt, i, start + i * delta, IST_INTERRUPT);
 
-    u16 *dest = (u16 *)(idt + 2*interrupt_size);
-    dest[0] = 16*interrupt_size -1;
+    idt_pointer = (u16 *)(idt + 2*interrupt_size);
+    idt_pointer[0] = 16*interrupt_size -1;
     
-    *(u64 *)(dest + 1) = (u64)idt;// physical_from_virtual(idt);
-    asm("lidt %0": : "m"(*dest));
+    *(u64 *)(idt_pointer + 1) = (u64)idt;// physical_from_virtual(idt);
+    install_idt();
     enable_lapic(pages);
     if (using_lapic_timer())
         configure_lapic_timer(general);
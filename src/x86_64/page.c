@@ -235,6 +235,12 @@ static boolean force_entry(heap h, page b, u64 v, physical p, int level,
     }
 }
 
+#ifdef STAGE3
+/* Set when a present entry was changed; other cpus are flushed once at
+   the end of the operation rather than for each page. */
+static boolean remote_invalidate;
+#endif
+
 static inline void page_invalidate(u64 v)
 {
 #ifdef PAGE_USE_FLUSH
@@ -244,6 +250,19 @@ static inline void page_invalidate(u64 v)
 #else
     asm volatile("invlpg (%0)" :: "r" (v) : "memory");
 #endif
+#ifdef STAGE3
+    remote_invalidate = true;
+#endif
+}
+
+static inline void page_invalidate_sync(void)
+{
+#ifdef STAGE3
+    if (remote_invalidate) {
+        remote_invalidate = false;
+        tlb_shootdown();
+    }
+#endif
 }
 
 static inline boolean map_page(page base, u64 v, physical p, heap h,
@@ -347,6 +366,77 @@ void update_map_flags(u64 vaddr, u64 length, u64 flags)
     page_debug("vaddr 0x%lx, length 0x%lx, flags 0x%lx\n", vaddr, length, flags);
 
     traverse_entries(vaddr, length, closure(transient, update_pte_flags, flags));
+    page_invalidate_sync();
+}
+
+/* the page directory entry covering vaddr, or 0 if none */
+static u64 *pde_from_virtual(u64 vaddr)
+{
+    u64 e = pagebase()[pindex(vaddr, PT1)];
+    if (!entry_is_present(e))
+        return 0;
+    e = page_from_pte(e)[pindex(vaddr, PT2)];
+    if (!entry_is_present(e))
+        return 0;
+    return page_from_pte(e) + pindex(vaddr, PT3);
+}
+
+/* True if nothing, not even an empty page table, is mapped in the 2M
+   region containing vaddr, so a fat entry may be put there. */
+boolean fat_region_free(u64 vaddr)
+{
+    u64 *pde = pde_from_virtual(vaddr);
+    return !pde || !entry_is_present(*pde);
+}
+
+/* Replace a 2M entry with a page table mapping the same physical pages
+   with the same flags. */
+static boolean split_fat_page(u64 *pde, u64 vaddr, heap h)
+{
+    u64 old = *pde;
+    u64 *pt = allocate_zero(h, PAGESIZE);
+    if (pt == INVALID_ADDRESS)
+        return false;
+    u64 phys = phys_from_pte(old) & ~MASK(PT3);
+    u64 flags = flags_from_pte(old) & ~PAGE_2M_SIZE;
+    for (int i = 0; i < (1 << (PT3 - PT4)); i++)
+        pt[i] = (phys + (i << PT4)) | flags;
+    memory_barrier();
+    *pde = u64_from_pointer(pt) | PAGE_WRITABLE | PAGE_USER | PAGE_PRESENT;
+    page_invalidate(vaddr & ~MASK(PT3));
+    return true;
+}
+
+/* Split any 2M mappings within [vaddr, vaddr + length) into 4K pages,
+   returning the number split. */
+u64 split_fat_pages(u64 vaddr, u64 length, heap h)
+{
+    u64 n = 0;
+    u64 end = vaddr + length;
+    for (u64 v = vaddr & ~MASK(PT3); v < end; v += U64_FROM_BIT(PT3)) {
+        u64 *pde = pde_from_virtual(v);
+        if (pde && entry_is_present(*pde) && entry_is_fat(3, *pde)) {
+            if (!split_fat_page(pde, v, h))
+                halt("split_fat_pages: ran out of page table memory\n");
+            n++;
+        }
+    }
+    page_invalidate_sync();
+    return n;
+}
+
+/* Split only the 2M mappings which straddle either end of the range,
+   ahead of unmapping or changing part of them. */
+u64 split_fat_boundaries(u64 vaddr, u64 length, heap h)
+{
+    u64 n = 0;
+    u64 end = vaddr + length;
+    if (vaddr & MASK(PT3))
+        n += split_fat_pages(vaddr, PAGESIZE, h);
+    /* unless already split above */
+    if ((end & MASK(PT3)) && ((vaddr & MASK(PT3)) == 0 || (end - 1) >> PT3 != vaddr >> PT3))
+        n += split_fat_pages(end - PAGESIZE, PAGESIZE, h);
+    return n;
 }
 
 static CLOSURE_3_3(remap_entry, boolean, u64, u64, heap, int, u64, u64 *);
@@ -401,7 +491,13 @@ void remap_pages(u64 vaddr_new, u64 vaddr_old, u64 length, heap h)
         return;
     assert(range_empty(range_intersection(irange(vaddr_new, vaddr_new + length),
                                           irange(vaddr_old, vaddr_old + length))));
+    /* 2M pages can only move whole and to a 2M aligned address */
+    if ((vaddr_new ^ vaddr_old) & MASK(PT3))
+        split_fat_pages(vaddr_old, length, h);
+    else
+        split_fat_boundaries(vaddr_old, length, h);
     traverse_entries(vaddr_old, length, closure(transient, remap_entry, vaddr_new, vaddr_old, h));
+    page_invalidate_sync();
 }
 
 static CLOSURE_0_3(zero_page, boolean, int, u64, u64 *);
@@ -423,6 +519,22 @@ void zero_mapped_pages(u64 vaddr, u64 length)
     traverse_entries(vaddr, length, closure(transient, zero_page));
 }
 
+static CLOSURE_1_3(visit_mapped_page, boolean, mapping_handler, int, u64, u64 *);
+static boolean visit_mapped_page(mapping_handler mh, int level, u64 vaddr, u64 * entry)
+{
+    u64 e = *entry;
+    if (entry_is_present(e) && entry_is_pte(level, e))
+        apply(mh, vaddr, phys_from_pte(e), flags_from_pte(e));
+    return true;
+}
+
+/* Apply mh to each page mapped within the given area, along with its
+   physical address and pte flags. */
+void foreach_mapped_page(u64 vaddr, u64 length, mapping_handler mh)
+{
+    traverse_entries(vaddr, length, closure(transient, visit_mapped_page, mh));
+}
+
 static CLOSURE_1_3(unmap_page, boolean, range_handler, int, u64, u64 *);
 boolean unmap_page(range_handler rh, int level, u64 vaddr, u64 * entry)
 {
@@ -446,6 +558,7 @@ void unmap_pages_with_handler(u64 virtual, u64 length, range_handler rh)
 {
     assert(!((virtual & PAGEMASK) || (length & PAGEMASK)));
     traverse_entries(virtual, length, closure(transient, unmap_page, rh));
+    page_invalidate_sync();
 }
 
 // error processing
@@ -504,6 +617,7 @@ static void map_range(u64 virtual, physical p, int length, u64 flags, heap h)
 #endif
 
     memory_barrier();
+    page_invalidate_sync();
 }
 
 void map(u64 virtual, physical p, int length, u64 flags, heap h)
@@ -511,6 +625,17 @@ void map(u64 virtual, physical p, int length, u64 flags, heap h)
     map_range(virtual, p, length, flags | PAGE_PRESENT, h);
 }
 
+/* For a page used only by the calling cpu, such as a scratch window:
+   a previous translation is flushed here but not on other cpus. */
+void map_local(u64 virtual, physical p, u64 flags, heap h)
+{
+    boolean invalidate = false;
+    if (!force_entry(h, pagebase(), virtual, p, 1, false, flags | PAGE_PRESENT, &invalidate))
+        halt("map_local: ran out of page table memory\n");
+    if (invalidate)
+        asm volatile("invlpg (%0)" :: "r" (virtual) : "memory");
+}
+
 void unmap(u64 virtual, int length, heap h)
 {
     map_range(virtual, 0, length, 0, h);
@@ -124,6 +124,18 @@ void pci_set_bus_master(pci_dev dev)
     pci_cfgwrite(dev, PCI_COMMAND_REGISTER, 2, command);
 }
 
+/* The number of entries in the MSI-X table, or 0 without MSI-X */
+int pci_get_msix_count(pci_dev dev)
+{
+    u32 cp = pci_cfgread(dev, PCIR_CAPABILITIES_POINTER, 1);
+    while (cp != 0) {
+        if (pci_cfgread(dev, cp, 1) == PCI_CAPABILITY_MSIX)
+            return (pci_cfgread(dev, cp + 2, 2) & 0x7ff) + 1;
+        cp = pci_cfgread(dev, cp + 1, 1);
+    }
+    return 0;
+}
+
 void pci_enable_msix(pci_dev dev)
 {
      u32 cp = pci_cfgread(dev, PCIR_CAPABILITIES_POINTER, 1);
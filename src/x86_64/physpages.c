@@ -0,0 +1,174 @@
+#include <runtime.h>
+#include <x86_64.h>
+#include <page.h>
+
+/* Physical pages for anonymous faults. Pages come off the physical id
+   heap in batches onto a free list, which pages released by munmap
+   also join. Idle cpus zero free pages through a private mapping window
+   and move them to the zeroed pool, and each cpu keeps a magazine of
+   zeroed pages refilled from the pool, so that a fault normally maps a
+   page ready for use without touching the id heap bitmap.
+
+   Everything here runs under the kernel lock. */
+
+#define FREE_LIST_PAGES     1024
+#define REFILL_BATCH        32
+#define IDLE_ZERO_BATCH     16
+
+static heap physical_heap;
+static heap pages;
+static heap virtual_page;
+static heap general;
+
+static u64 free_pages[FREE_LIST_PAGES];
+static int free_count;
+
+static u64 *zeroed_pages;
+static u64 zeroed_count;
+static u64 zeroed_target;
+static u64 zeroed_capacity;
+
+static struct physpages_stats stats;
+
+static boolean refill_free_pages(void)
+{
+    u64 p = allocate_u64(physical_heap, REFILL_BATCH * PAGESIZE);
+    if (p == INVALID_PHYSICAL)
+        return false;
+    /* lowest address on top */
+    for (int i = REFILL_BATCH - 1; i >= 0; i--)
+        free_pages[free_count++] = p + i * PAGESIZE;
+    stats.batch_refills++;
+    return true;
+}
+
+static u64 take_free_page(void)
+{
+    /* a batch may not fit when memory is fragmented */
+    if (free_count == 0 && !refill_free_pages())
+        return allocate_u64(physical_heap, PAGESIZE);
+    return free_pages[--free_count];
+}
+
+/* Returns a page for a fault, setting zeroed if its contents are
+   already zero; otherwise it's up to the caller to clear it once
+   mapped. */
+u64 allocate_fault_page(boolean *zeroed)
+{
+    *zeroed = false;
+    if (zeroed_target == 0)
+        return allocate_u64(physical_heap, PAGESIZE);
+
+    cpuinfo ci = current_cpu();
+    if (ci->page_magazine_count == 0 && zeroed_count > 0) {
+        u64 n = MIN(zeroed_count, PAGE_MAGAZINE_SIZE);
+        zeroed_count -= n;
+        runtime_memcpy(ci->page_magazine, zeroed_pages + zeroed_count, n * sizeof(u64));
+        ci->page_magazine_count = n;
+    }
+    if (ci->page_magazine_count > 0) {
+        stats.zeroed_hits++;
+        *zeroed = true;
+        return ci->page_magazine[--ci->page_magazine_count];
+    }
+    stats.zeroed_misses++;
+    return take_free_page();
+}
+
+void release_physical_pages(range r)
+{
+    if (zeroed_target > 0) {
+        while (range_span(r) > 0 && free_count < FREE_LIST_PAGES) {
+            free_pages[free_count++] = r.start;
+            r.start += PAGESIZE;
+            stats.recycled++;
+        }
+    }
+    if (range_span(r) > 0 &&
+        !id_heap_set_area(physical_heap, r.start, range_span(r), true, false))
+        msg_err("some of physical range %R not allocated in heap\n", r);
+}
+
+static boolean get_zero_window(cpuinfo ci)
+{
+    if (!ci->zero_window) {
+        u64 w = allocate_u64(virtual_page, PAGESIZE);
+        if (w == INVALID_PHYSICAL)
+            return false;
+        ci->zero_window = w;
+    }
+    return true;
+}
+
+static void zero_through_window(cpuinfo ci, u64 p)
+{
+    map_local(ci->zero_window, p, PAGE_WRITABLE | PAGE_NO_EXEC, pages);
+    zero(pointer_from_u64(ci->zero_window), PAGESIZE);
+}
+
+/* Clear physical pages not yet mapped anywhere, such as those about to
+   be mapped read-only to user, which the kernel can't store through
+   with CR0.WP set. */
+void zero_physical(u64 p, u64 length)
+{
+    cpuinfo ci = current_cpu();
+    if (!get_zero_window(ci))
+        halt("%s: no virtual space for zeroing window\n", __func__);
+    for (u64 end = p + length; p < end; p += PAGESIZE)
+        zero_through_window(ci, p);
+}
+
+/* Called by an idle cpu, which zeroes a batch of free pages into the
+   pool. Returns true if the pool still wants more. */
+boolean physpages_zero_idle(void)
+{
+    if (zeroed_count >= zeroed_target)
+        return false;
+
+    cpuinfo ci = current_cpu();
+    if (!get_zero_window(ci))
+        return false;
+
+    for (int i = 0; i < IDLE_ZERO_BATCH && zeroed_count < zeroed_target; i++) {
+        u64 p = take_free_page();
+        if (p == INVALID_PHYSICAL)
+            return false;
+        zero_through_window(ci, p);
+        zeroed_pages[zeroed_count++] = p;
+        stats.idle_zeroed++;
+    }
+    return zeroed_count < zeroed_target;
+}
+
+/* Pages already in the pool beyond a reduced target are kept until
+   used. A target of zero bypasses the free list and magazines. */
+void physpages_set_zeroed_target(u64 npages)
+{
+    if (npages > zeroed_capacity) {
+        u64 *n = allocate(general, npages * sizeof(u64));
+        if (n == INVALID_ADDRESS) {
+            msg_err("unable to allocate zeroed page pool\n");
+            return;
+        }
+        if (zeroed_pages) {
+            runtime_memcpy(n, zeroed_pages, zeroed_count * sizeof(u64));
+            deallocate(general, zeroed_pages, zeroed_capacity * sizeof(u64));
+        }
+        zeroed_pages = n;
+        zeroed_capacity = npages;
+    }
+    zeroed_target = npages;
+}
+
+void physpages_get_stats(physpages_stats s)
+{
+    runtime_memcpy(s, &stats, sizeof(struct physpages_stats));
+}
+
+void init_physpages(kernel_heaps kh)
+{
+    physical_heap = heap_physical(kh);
+    pages = heap_pages(kh);
+    virtual_page = heap_virtual_page(kh);
+    general = heap_general(kh);
+}
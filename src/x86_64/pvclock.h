@@ -0,0 +1,66 @@
+#pragma once
+/* KVM paravirtual clock record, read by the kernel and by the vdso */
+
+struct pvclock_vcpu_time_info {
+    u32   version;
+    u32   pad0;
+    u64   tsc_timestamp;
+    u64   system_time;
+    u32   tsc_to_system_mul;
+    s8    tsc_shift;
+    u8    flags;
+    u8    pad[2];
+} __attribute__((__packed__));
+
+/* flags: the tsc_timestamp of every vcpu's record is taken from one
+   synchronized TSC, so any cpu may read any record */
+#define PVCLOCK_TSC_STABLE_BIT  (1 << 0)
+
+/* System time in nanoseconds, with the record's flags as of the same
+   version. The hypervisor makes the version odd while it updates the
+   record, so the read is retried until the same even version is seen
+   on both sides of it. The lfence keeps rdtsc from being taken ahead
+   of the version load, and is far cheaper than serializing with cpuid,
+   which traps to the hypervisor. */
+static inline u64 pvclock_read_ns(volatile struct pvclock_vcpu_time_info *vclock,
+                                  u8 *flags)
+{
+    u32 version, a, d;
+    u64 nsec;
+    do {
+        version = vclock->version;
+        asm volatile("lfence; rdtsc" : "=a" (a), "=d" (d) :: "memory");
+        u64 delta = (((u64)a) | (((u64)d) << 32)) - vclock->tsc_timestamp;
+        if (vclock->tsc_shift < 0) {
+            delta >>= -vclock->tsc_shift;
+        } else {
+            delta <<= vclock->tsc_shift;
+        }
+        // a 64 bit number multiplied by a 32 bit number yields a 96
+        // bit result, chuck the bottom 32 bits
+        nsec = vclock->system_time +
+            (((u128)delta * vclock->tsc_to_system_mul) >> 32);
+        *flags = vclock->flags;
+        asm volatile("lfence" ::: "memory");
+    } while ((version & 1) || version != vclock->version);
+    return nsec;
+}
+
+static inline u64 pvclock_now_ns(volatile struct pvclock_vcpu_time_info *vclock)
+{
+    u8 flags;
+    return pvclock_read_ns(vclock, &flags);
+}
+
+/* nanoseconds as a timestamp, in 32.32 fixed point seconds */
+static inline u64 pvclock_timestamp(u64 nsec)
+{
+    u64 sec = nsec / 1000000000ull;
+    nsec -= sec * 1000000000ull;
+    return (sec << 32) + (nsec << 32) / 1000000000ull;
+}
+
+static inline u64 pvclock_now(volatile struct pvclock_vcpu_time_info *vclock)
+{
+    return pvclock_timestamp(pvclock_now_ns(vclock));
+}
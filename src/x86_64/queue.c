@@ -18,17 +18,41 @@ void queue_dump(queue q)
     }
 }
 
+/* Growing moves the entries to a larger array, so it mustn't race
+   with other users of the queue. Growable queues are only used from
+   kernel code, under the kernel lock and with interrupts disabled,
+   which keeps them to one cpu at a time. */
+static boolean grow_queue(queue q)
+{
+    u64 size = q->size * 2;
+    void **buf = allocate_zero(q->h, size * sizeof(void *));
+    if (buf == INVALID_ADDRESS)
+        return false;
+    u64 n = q->write - q->read;
+    for (u64 i = 0; i < n; i++)
+        buf[i] = q->buf[(q->read + i) % q->size];
+    deallocate(q->h, q->buf, q->size * sizeof(void *));
+    q->buf = buf;
+    q->read = 0;
+    q->write = n;
+    q->size = size;
+    memory_barrier();
+    return true;
+}
+
 boolean enqueue(queue q, void *n)
 {
     u64 count = fetch_and_add(&q->count, 1);
     u64 write;
     boolean r;
 
-    if (count >= q->size) {
+    if (count >= q->size && (q->size >= q->max_size || !grow_queue(q))) {
         // can't enqueue more elements than the bounds
         fetch_and_add(&q->count, -1);
         return false;
     }
+    if (count >= q->high_water)
+        q->high_water = count + 1;
 
     // rusty 'acquire the ownership' of the next element in the queue
     write = fetch_and_add(&q->write, 1);
@@ -92,21 +116,47 @@ retry:
     return r;
 }
 
-queue allocate_queue(heap h, u64 size)
+u64 queue_high_water(queue q)
 {
-    queue q = allocate(h, sizeof(struct queue) + size * sizeof(void *));
+    return q->high_water;
+}
+
+static queue allocate_queue_internal(heap h, u64 size, u64 max_size)
+{
+    queue q = allocate(h, sizeof(struct queue));
+    if (q == INVALID_ADDRESS)
+        return q;
+    q->buf = allocate_zero(h, size * sizeof(void *));
+    if (q->buf == INVALID_ADDRESS) {
+        deallocate(h, q, sizeof(struct queue));
+        return INVALID_ADDRESS;
+    }
     q->size = size;
+    q->max_size = max_size;
+    q->high_water = 0;
     q->count = 0;
     q->write = q->read = 0;
     q->h = h;
-    zero(q->buf, size * sizeof(void *));
     // XXX: we could do a release ordering here, however let's just use a full
     // barrier for now.
     memory_barrier();
     return q;
 }
 
+queue allocate_queue(heap h, u64 size)
+{
+    return allocate_queue_internal(h, size, size);
+}
+
+/* Doubles in size when full, so enqueue fails only if that allocation
+   does. See grow_queue for the constraints on use. */
+queue allocate_growable_queue(heap h, u64 size)
+{
+    return allocate_queue_internal(h, size, infinity);
+}
+
 void deallocate_queue(queue q)
 {
-    deallocate(q->h, q, sizeof(struct queue) + q->size * sizeof(void *));
+    deallocate(q->h, q->buf, q->size * sizeof(void *));
+    deallocate(q->h, q, sizeof(struct queue));
 }
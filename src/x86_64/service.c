@@ -7,6 +7,7 @@
 #include <symtab.h>
 #include <virtio/virtio.h>
 #include <drivers/storage.h>
+#include <drivers/blkq.h>
 #include <drivers/console.h>
 #include <unix_internal.h>
 
@@ -46,17 +47,31 @@ static u64 bootstrap_alloc(heap h, bytes length)
     return result;
 }
 
-queue runqueue;
 queue bhqueue;
+queue deferqueue;
 
+/* bit per cpu waiting in kernel_sleep for work */
+static volatile u64 idle_cpu_mask;
+
+/* Arm the runloop timer for the next expiry. With no timers pending it
+   is left off, and an idle cpu sleeps until an interrupt arrives. */
 static void timer_update(void)
 {
-    /* minimum runloop period - XXX move to a config header */
-    timestamp timeout = MIN(timer_check(), milliseconds(100) /* XXX config */);
-    runloop_timer(timeout);
+    runloop_timer(timer_check());
 }
 
-extern void interrupt_exit(void);
+/* Work batched up while the kernel was busy, such as device doorbells,
+   is flushed before returning to user or going idle. A timer set ahead
+   of the armed expiry, say from a syscall, is armed here too. */
+void process_deferqueue()
+{
+    thunk t;
+    while((t = dequeue(deferqueue))) {
+        apply(t);
+    }
+    if (timer_rearm_needed())
+        runloop_timer(timer_next(now()));
+}
 
 void process_bhqueue()
 {
@@ -65,37 +80,121 @@ void process_bhqueue()
     while((t = dequeue(bhqueue))) {
         apply(t);
     }
+    process_deferqueue();
 
     timer_update();
 
     /* XXX - and disable before frame pop */
     frame_pop();
+
+    /* the kernel lock is held only while in the kernel */
+    if (running_frame == current_cpu()->miscframe || (running_frame[FRAME_CS] & 3))
+        kern_unlock();
     interrupt_exit();
 }
 
+void print_queue_stats(void)
+{
+    rprintf("queue high water marks: bhqueue %ld, deferqueue %ld\n",
+            queue_high_water(bhqueue), queue_high_water(deferqueue));
+    for (int i = 0; i < total_processors; i++) {
+        rprintf("   cpu %d: runqueue %ld, thread queue %ld\n", i,
+                queue_high_water(cpuinfos[i].run_queue),
+                queue_high_water(cpuinfos[i].thread_queue));
+    }
+    print_blkq_stats();
+    print_virtio_net_stats();
+}
+
+void allocate_cpu_queues(heap h, cpuinfo ci)
+{
+    ci->run_queue = allocate_growable_queue(h, 64);
+    ci->thread_queue = allocate_growable_queue(h, 64);
+    assert(ci->run_queue != INVALID_ADDRESS && ci->thread_queue != INVALID_ADDRESS);
+}
+
+/* Runnable threads go on the local queue. If another cpu is idle, it
+   is woken to take them from there. */
+void schedule_thread(thunk t)
+{
+    cpuinfo ci = current_cpu();
+    if (!enqueue(ci->thread_queue, t))
+        halt("%s: unable to grow thread queue\n", __func__);
+    u64 idle = idle_cpu_mask & ~U64_FROM_BIT(ci->id);
+    if (idle) {
+        int id = lsb(idle);
+        /* claim it so the next wakeup goes elsewhere */
+        __sync_fetch_and_and(&idle_cpu_mask, ~U64_FROM_BIT(id));
+        wakeup_cpu(&cpuinfos[id]);
+    }
+}
+
+static thunk steal_thread(cpuinfo ci)
+{
+    for (int i = 1; i < total_processors; i++) {
+        cpuinfo victim = &cpuinfos[(ci->id + i) % total_processors];
+        thunk t = dequeue(victim->thread_queue);
+        if (t) {
+            ci->steals++;
+            return t;
+        }
+    }
+    return 0;
+}
+
+static boolean work_pending(cpuinfo ci)
+{
+    if (queue_length(ci->run_queue))
+        return true;
+    for (int i = 0; i < total_processors; i++) {
+        if (queue_length(cpuinfos[i].thread_queue))
+            return true;
+    }
+    return false;
+}
+
 void runloop()
 {
+    cpuinfo ci = current_cpu();
+    u64 idle_bit = U64_FROM_BIT(ci->id);
     thunk t;
 
     while(1) {
-        while((t = dequeue(runqueue))) {
+        kern_lock();
+        while((t = dequeue(ci->run_queue)) || (t = dequeue(ci->thread_queue)) ||
+              (t = steal_thread(ci))) {
             apply(t);
             disable_interrupts();
         }
+        process_deferqueue();
+
+        /* Nothing to run, so prepare zeroed pages for faults. This goes
+           a batch at a time, coming back around for any work that was
+           scheduled meanwhile. */
+        if (!work_pending(ci) && physpages_zero_idle())
+            continue;
+
         if (current) {
             proc_pause(current->p);
         }
         timer_update();
-        kernel_sleep();
+
+        /* advertise before the last look for work, so that a thread
+           scheduled in between still gets us woken */
+        __sync_fetch_and_or(&idle_cpu_mask, idle_bit);
+        if (!work_pending(ci)) {
+            kern_unlock();
+            kernel_sleep();
+            kern_lock();
+        }
+        __sync_fetch_and_and(&idle_cpu_mask, ~idle_bit);
         if (current) {
             proc_resume(current->p);
         }
     }
 }
 
-//#define MAX_BLOCK_IO_SIZE PAGE_SIZE
-#define MAX_BLOCK_IO_SIZE (256 * 1024)
-
+/* Drivers split requests beyond the limits of their devices. */
 static CLOSURE_2_3(offset_block_io, void, u64, block_io, void *, range, status_handler);
 static void offset_block_io(u64 offset, block_io io, void *dest, range blocks, status_handler sh)
 {
@@ -103,20 +202,7 @@ static void offset_block_io(u64 offset, block_io io, void *dest, range blocks, s
     u64 ds = offset >> SECTOR_OFFSET;
     blocks.start += ds;
     blocks.end += ds;
-
-    // split I/O to storage driver to PAGESIZE requests
-    heap h = heap_general(&heaps);
-    merge m = allocate_merge(h, sh);
-    status_handler k = apply_merge(m);
-    while (blocks.start < blocks.end) {
-        u64 span = MIN(range_span(blocks), MAX_BLOCK_IO_SIZE >> SECTOR_OFFSET);
-        apply(io, dest, irange(blocks.start, blocks.start + span), apply_merge(m));
-
-        // next block
-        blocks.start += span;
-        dest = (char *) dest + (span << SECTOR_OFFSET);
-    }
-    apply(k, STATUS_OK);
+    apply(io, dest, blocks, sh);
 }
 
 void init_extra_prints(); 
@@ -133,10 +219,13 @@ static void attach_storage(tuple root, u64 fs_offset, block_io r, block_io w, u6
 {
     // with filesystem...should be hidden as functional handlers on the tuplespace
     heap h = heap_general(&heaps);
+    /* storage drivers take buffers as lists of pages */
+    heap dma = physically_scattered(h, heap_virtual_page(&heaps), heap_physical(&heaps),
+                                    heap_pages(&heaps), PAGESIZE);
     create_filesystem(h,
                       SECTOR_SIZE,
                       length,
-                      heap_backed(&heaps),
+                      dma,
                       closure(h, offset_block_io, fs_offset, r),
                       closure(h, offset_block_io, fs_offset, w),
                       root,
@@ -170,7 +259,8 @@ static void read_kernel_syms()
     }
 }
 
-extern void install_gdt64_and_tss();
+extern void *GDT64;
+extern void *TSS;
 
 static boolean try_hw_seed(u64 * seed, boolean rdseed)
 {
@@ -224,12 +314,19 @@ static void __attribute__((noinline)) init_service_new_stack()
     /* Unmap the first page so we catch faults on null pointer references. */
     unmap(0, PAGESIZE, pages);
 
-    runqueue = allocate_queue(misc, 64);
-    bhqueue = allocate_queue(misc, 2048); /* XXX will need something extensible really */
+    allocate_cpu_queues(misc, current_cpu());
+    bhqueue = allocate_growable_queue(misc, 256);
+    deferqueue = allocate_growable_queue(misc, 64);
+    assert(bhqueue != INVALID_ADDRESS && deferqueue != INVALID_ADDRESS);
     init_clock(kh);
     init_random();
     __stack_chk_guard_init();
     start_interrupts(kh);
+    init_physpages(kh);
+
+    /* Catch kernel writes to read-only user pages, which may be shared
+       with the page cache. The other cores copy this cr0. */
+    set_page_write_protect(true);
     init_symtab(kh);
     read_kernel_syms();
     init_net(kh);
@@ -247,9 +344,10 @@ static void __attribute__((noinline)) init_service_new_stack()
     pci_discover(); // do PCI discover again for other devices
 
     /* Switch to stage3 GDT64, enable TSS and free up initial map */
-    install_gdt64_and_tss();
+    install_gdt64_and_tss(&GDT64, &TSS);
     unmap(PAGESIZE, INITIAL_MAP_SIZE - PAGESIZE, pages);
 
+    start_secondary_cores(kh);
     runloop();
 }
 
@@ -346,6 +444,12 @@ static void init_kernel_heaps()
 // init linker set
 void init_service()
 {
+    /* the boot cpu holds the kernel lock until it first goes idle */
+    cpuinfo ci = &cpuinfos[0];
+    init_cpuinfo(ci, 0);
+    ci->gdt = &GDT64;
+    ci->tss = &TSS;
+    kern_lock();
     init_kernel_heaps();
     u64 stack_size = 32*PAGESIZE;
     u64 stack_location = allocate_u64(heap_backed(&heaps), stack_size);
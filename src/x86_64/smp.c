@@ -0,0 +1,216 @@
+#include <runtime.h>
+#include <x86_64.h>
+#include <page.h>
+
+/* Secondary cores are started with INIT and SIPI broadcast through the
+   local apic. They enter the trampoline at the end of crt0.s, copied to
+   AP_BOOT_PAGE, which brings them up into long mode on the kernel page
+   tables and calls ap_entry. The number of cores isn't known ahead of
+   time; each one takes the next cpuinfo as it checks in.
+
+   All kernel code runs under the one kernel lock, taken on entry from
+   user mode or idle and dropped on the way back out, so the scheduler,
+   heaps and everything else remain single threaded. */
+
+#define AP_BOOT_PAGE 0x8000
+#define TSS_SIZE 0x68
+#define GDT_CPUID 0x38
+
+#define ICR_INIT                0x00004500 /* level assert */
+#define ICR_STARTUP             0x00004600
+#define ICR_ALL_EXCLUDING_SELF  0x000c0000
+
+/* see ap_boot_params in crt0.s */
+struct ap_boot_params {
+    u32 lock;
+    u32 cr0;
+    u32 cr3;
+    u32 cr4;
+    u32 efer;
+    u32 pad;
+    u64 entry;
+};
+
+extern void *ap_start_begin;
+extern void *ap_start_end;
+extern void *ap_boot_params;
+extern void *GDT64;
+extern u32 gdt64_size;
+
+struct cpuinfo cpuinfos[MAX_CPUS];
+volatile int total_processors = 1;
+int shootdown_vector;
+static int wakeup_vector;
+static volatile u64 kernel_lock;
+static volatile word ap_count;
+static struct ap_boot_params *ap_params;
+static kernel_heaps smp_heaps;
+
+/* The kernel finds its cpuinfo at %gs:0. User code can move the gs
+   base at will, say by loading a selector into %gs, so the entry and
+   exit paths in crt0.s swapgs on every crossing to and from user mode:
+   the kernel's base is the live one only while in the kernel, and
+   sits in KERNEL_GS_MSR, out of user reach, in between. */
+void init_cpuinfo(cpuinfo ci, int id)
+{
+    ci->self = ci;
+    ci->id = id;
+    write_msr(GS_MSR, u64_from_pointer(ci));
+    write_msr(KERNEL_GS_MSR, 0);
+}
+
+void kern_lock(void)
+{
+    cpuinfo ci = current_cpu();
+    if (ci->have_kernel_lock)
+        return;
+    while (!__sync_bool_compare_and_swap(&kernel_lock, 0, 1)) {
+        /* the holder may be waiting on us to flush */
+        do {
+            service_tlb_flush(ci);
+            kern_pause();
+        } while (kernel_lock);
+    }
+    ci->have_kernel_lock = true;
+}
+
+void kern_unlock(void)
+{
+    cpuinfo ci = current_cpu();
+    if (!ci->have_kernel_lock)
+        return;
+    ci->have_kernel_lock = false;
+    __atomic_store_n(&kernel_lock, 0, __ATOMIC_RELEASE);
+}
+
+void service_tlb_flush(cpuinfo ci)
+{
+    if (!ci->flush_pending)
+        return;
+    u64 cr3;
+    mov_from_cr("cr3", cr3);
+    mov_to_cr("cr3", cr3);
+    ci->flush_pending = false;
+}
+
+/* Called with the kernel lock held after changing or removing present
+   mappings. The other cores are either in user mode, idle or waiting
+   for the lock, and answer from any of those. */
+void tlb_shootdown(void)
+{
+    cpuinfo self = current_cpu();
+    int n = total_processors;
+    if (n < 2)
+        return;
+
+    for (int i = 0; i < n; i++) {
+        if (&cpuinfos[i] != self)
+            cpuinfos[i].flush_pending = true;
+    }
+    memory_barrier();
+    for (int i = 0; i < n; i++) {
+        if (&cpuinfos[i] != self)
+            lapic_send_ipi(cpuinfos[i].apic_id, shootdown_vector);
+    }
+    for (int i = 0; i < n; i++) {
+        while (cpuinfos[i].flush_pending)
+            kern_pause();
+    }
+}
+
+static CLOSURE_0_0(wakeup_ignore, void);
+static void wakeup_ignore(void)
+{
+    /* nothing to do; the core returns to its runloop */
+}
+
+void wakeup_cpu(cpuinfo ci)
+{
+    lapic_send_ipi(ci->apic_id, wakeup_vector);
+}
+
+static void __attribute__((noreturn)) ap_runloop(void)
+{
+    /* off the shared boot stack; let the next core in */
+    __atomic_store_n(&ap_params->lock, 0, __ATOMIC_RELEASE);
+    runloop();
+}
+
+static void __attribute__((noreturn)) ap_entry(void)
+{
+    int id = fetch_and_add((word *)&ap_count, 1) + 1;
+    if (id >= MAX_CPUS) {
+        __atomic_store_n(&ap_params->lock, 0, __ATOMIC_RELEASE);
+        while (1)
+            __asm__("hlt");
+    }
+
+    cpuinfo ci = &cpuinfos[id];
+    init_cpuinfo(ci, id);
+    kern_lock();
+
+    heap h = heap_general(smp_heaps);
+    heap pages = heap_pages(smp_heaps);
+    ci->apic_id = lapic_id();
+    ci->gdt = allocate(h, gdt64_size);
+    assert(ci->gdt != INVALID_ADDRESS);
+    runtime_memcpy(ci->gdt, &GDT64, gdt64_size);
+    *(u16 *)(ci->gdt + GDT_CPUID) = id;
+    ci->tss = allocate_zero(h, TSS_SIZE);
+    assert(ci->tss != INVALID_ADDRESS);
+    init_cpu_interrupts(ci);
+    install_gdt64_and_tss(ci->gdt, ci->tss);
+    install_idt();
+    lapic_enable_local();
+    set_syscall_handler(syscall_enter);
+    allocate_cpu_queues(h, ci);
+    ci->current_frame = ci->miscframe;
+
+    void *stack = allocate_stack(pages, KERNEL_STACK_PAGES);
+    assert(stack != INVALID_ADDRESS);
+    total_processors = id + 1;
+    switch_stack(stack, ap_runloop);
+    while (1);                  /* not reached */
+}
+
+void start_secondary_cores(kernel_heaps kh)
+{
+    heap h = heap_general(kh);
+    u64 cr0, cr3, cr4;
+
+    smp_heaps = kh;
+    cpuinfos[0].apic_id = lapic_id();
+    shootdown_vector = allocate_u64(interrupt_vectors, 1);
+    wakeup_vector = allocate_u64(interrupt_vectors, 1);
+    register_interrupt(wakeup_vector, closure(h, wakeup_ignore));
+
+    /* the trampoline loads cr3 before entering long mode */
+    mov_from_cr("cr3", cr3);
+    if (cr3 >> 32) {
+        console("page tables above 4GB; not starting secondary cores\n");
+        return;
+    }
+    mov_from_cr("cr0", cr0);
+    mov_from_cr("cr4", cr4);
+
+    /* Left mapped, as cores may check in at any point after the SIPIs. */
+    map(AP_BOOT_PAGE, AP_BOOT_PAGE, PAGESIZE, PAGE_WRITABLE, heap_pages(kh));
+    u64 start = u64_from_pointer(&ap_start_begin);
+    runtime_memcpy(pointer_from_u64(AP_BOOT_PAGE), &ap_start_begin,
+                   u64_from_pointer(&ap_start_end) - start);
+    ap_params = pointer_from_u64(AP_BOOT_PAGE + u64_from_pointer(&ap_boot_params) - start);
+    ap_params->lock = 0;
+    ap_params->cr0 = cr0;
+    ap_params->cr3 = cr3;
+    ap_params->cr4 = cr4;
+    ap_params->efer = read_msr(EFER_MSR) & ~EFER_LMA;
+    ap_params->entry = u64_from_pointer(ap_entry);
+    memory_barrier();
+
+    lapic_send_ipi(0, ICR_ALL_EXCLUDING_SELF | ICR_INIT);
+    kern_sleep(milliseconds(10));
+    for (int i = 0; i < 2; i++) {
+        lapic_send_ipi(0, ICR_ALL_EXCLUDING_SELF | ICR_STARTUP | (AP_BOOT_PAGE >> PAGELOG));
+        kern_sleep(microseconds(200));
+    }
+}
@@ -0,0 +1,12 @@
+        ;; The vdso shared object, built from src/unix/vdso_image.c by
+        ;; stage3/Makefile. It takes whole pages of the kernel's read-only
+        ;; data so that they can be mapped into the process as they are.
+
+section .rodata.vdso progbits alloc noexec nowrite align=4096
+
+global vdso_image
+global vdso_image_end
+vdso_image:
+        incbin "vdso.so"
+vdso_image_end:
+        align 4096, db 0
@@ -15,6 +15,7 @@
 
 #define FS_MSR 0xc0000100
 #define GS_MSR 0xc0000101
+#define KERNEL_GS_MSR 0xc0000102
 #define LSTAR 0xC0000082
 #define EFER_MSR 0xc0000080
 #define EFER_SCE   0x0001
@@ -66,10 +67,6 @@ static inline void disable_interrupts()
 
 typedef u64 *context;
 
-extern context running_frame;
-
-extern void * syscall_stack_top;
-
 #define BREAKPOINT_INSTRUCTION 00
 #define BREAKPOINT_WRITE 01
 #define BREAKPOINT_IO 10
@@ -126,6 +123,8 @@ static inline u64 rdtsc(void)
 }
 
 void init_clock(kernel_heaps kh);
+struct vdso_dat;
+u64 vdso_clock_init(struct vdso_dat *vd);
 boolean using_lapic_timer(void);
 void kern_sleep(timestamp delta);
 
@@ -155,11 +154,92 @@ static inline void irq_restore(u64 flags)
 }
 
 typedef struct queue *queue;
-extern queue runqueue;
 extern queue bhqueue;
+extern queue deferqueue;
+
+#define MAX_CPUS 16
+#define PAGE_MAGAZINE_SIZE 32
+
+/* Per-cpu state, found through the %gs base. Kernel code runs under a
+   single kernel lock, so only user code runs concurrently; this holds
+   what each cpu needs to enter and leave the kernel on its own. */
+typedef struct cpuinfo {
+    /* accessed from crt0.s; see CPU_* in frame.h */
+    struct cpuinfo *self;
+    context current_frame;
+    void *syscall_stack_top;
+
+    u32 id;
+    u32 apic_id;
+    boolean have_kernel_lock;
+    volatile boolean flush_pending;    /* tlb shootdown requested */
+    void *current_thread;
+    queue run_queue;            /* kernel work, run on this cpu */
+    queue thread_queue;         /* runnable threads, may be stolen */
+    context miscframe;          /* for context save on interrupt */
+    context intframe;           /* for context save on exception within interrupt */
+    context bhframe;
+    void *bh_stack_top;
+    void *gdt;
+    void *tss;
+    u64 steals;                 /* threads taken from other cpus */
+    u64 zero_window;            /* scratch mapping for zeroing pages */
+    int page_magazine_count;
+    u64 page_magazine[PAGE_MAGAZINE_SIZE]; /* zeroed physical pages */
+} *cpuinfo;
+
+extern struct cpuinfo cpuinfos[MAX_CPUS];
+extern volatile int total_processors;
+
+static inline cpuinfo current_cpu(void)
+{
+    u64 addr;
+    asm("movq %%gs:0, %0" : "=r" (addr));
+    return pointer_from_u64(addr);
+}
+
+#define running_frame (current_cpu()->current_frame)
+#define runqueue (current_cpu()->run_queue)
+
+static inline void kern_pause(void)
+{
+    asm volatile("pause");
+}
+
+extern int shootdown_vector;
+
+void init_cpuinfo(cpuinfo ci, int id);
+void kern_lock(void);
+void kern_unlock(void);
+void start_secondary_cores(kernel_heaps kh);
+void allocate_cpu_queues(heap h, cpuinfo ci);
+void schedule_thread(thunk t);
+void wakeup_cpu(cpuinfo ci);
+void tlb_shootdown(void);
+
+typedef struct physpages_stats {
+    u64 zeroed_hits;            /* faults given a pre-zeroed page */
+    u64 zeroed_misses;          /* faults that had to zero their page */
+    u64 batch_refills;          /* batches taken from the physical heap */
+    u64 idle_zeroed;            /* pages zeroed by idle cpus */
+    u64 recycled;               /* released pages kept on the free list */
+} *physpages_stats;
+
+/* kilobytes of zeroed pages kept ready for faults */
+#define PREZERO_DEFAULT_KB 2048
+
+void init_physpages(kernel_heaps kh);
+void physpages_set_zeroed_target(u64 npages);
+u64 allocate_fault_page(boolean *zeroed);
+void release_physical_pages(range r);
+boolean physpages_zero_idle(void);
+void zero_physical(u64 p, u64 length);
+void physpages_get_stats(physpages_stats s);
+void service_tlb_flush(cpuinfo ci);
 
 heap physically_backed(heap meta, heap virtual, heap physical, heap pages, u64 pagesize);
 void physically_backed_dealloc_virtual(heap h, u64 x, bytes length);
+heap physically_scattered(heap meta, heap virtual, heap physical, heap pages, u64 pagesize);
 void print_stack(context c);
 void print_frame(context f);
 
@@ -171,7 +251,9 @@ boolean enqueue(queue q, void *n);
 void *dequeue(queue q);
 void *queue_peek(queue q);
 int queue_length(queue q);
+u64 queue_high_water(queue q);
 queue allocate_queue(heap h, u64 size);
+queue allocate_growable_queue(heap h, u64 size);
 void deallocate_queue(queue q);
 
 context allocate_frame(heap h);
@@ -195,8 +277,12 @@ static inline void frame_pop(void)
     }
 
 void runloop() __attribute__((noreturn));
+void interrupt_exit(void) __attribute__((noreturn));
 void kernel_sleep();
+void kernel_wait_in_fault(volatile boolean *done);
 void process_bhqueue();
+void print_queue_stats(void);
+void process_deferqueue();
 void install_fallback_fault_handler(fault_handler h);
 
 // xxx - hide
@@ -205,10 +291,20 @@ struct queue {
     u64 write;
     u64 read;
     u64 size;
+    u64 max_size;               /* size, or infinity if growable */
+    u64 high_water;             /* most entries held at once */
     heap h;
-    void *buf[];
+    void **buf;
 };
 
 void msi_format(u32 *address, u32 *data, int vector);
 void register_interrupt(int vector, thunk t);
 extern heap interrupt_vectors;
+
+void *allocate_stack(heap pages, int npages);
+void init_cpu_interrupts(cpuinfo ci);
+void install_idt(void);
+void lapic_enable_local(void);
+u32 lapic_id(void);
+void lapic_send_ipi(u32 apic_id, u32 icr);
+void install_gdt64_and_tss(void *gdt, void *tss);
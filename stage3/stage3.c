@@ -3,22 +3,18 @@
 #include <unix.h>
 #include <gdb.h>
 #include <virtio/virtio.h>
+#include <x86_64.h>
 
-static CLOSURE_2_1(read_program_complete, void, process, tuple, buffer);
-static void read_program_complete(process kp, tuple root, buffer b)
+static void trace_program(tuple root)
 {
-    if (table_find(root, sym(trace))) {
-        rprintf("read program complete: %p ", root);
-        rprintf("gitversion: %s ", gitversion);
-
-        buffer b = allocate_buffer(transient, 64);
-        print_root(b, root);
-        buffer_print(b);
-        deallocate_buffer(b);
-        rprintf("\n");
-       
-    }
-    exec_elf(b, kp);
+    rprintf("exec program: %p ", root);
+    rprintf("gitversion: %s ", gitversion);
+
+    buffer b = allocate_buffer(transient, 64);
+    print_root(b, root);
+    buffer_print(b);
+    deallocate_buffer(b);
+    rprintf("\n");
 }
 
 static CLOSURE_0_1(read_program_fail, void, status);
@@ -37,10 +33,36 @@ void startup(kernel_heaps kh,
 	halt("unable to initialize unix instance; halt\n");
     }
     heap general = heap_general(kh);
-    buffer_handler pg = closure(general, read_program_complete, kp, root);
+
+    /* page cache limit in megabytes, 0 to disable */
+    value pc = table_find(root, sym(pagecache));
+    filesystem_set_cache_limit(fs, pc ? u64_from_value(pc) * MB : PAGECACHE_DEFAULT_LIMIT);
+
+    /* log group commit window in microseconds, 0 to write at once,
+       and the size in kilobytes at which a batch goes out early */
+    value lw = table_find(root, sym(logwindow));
+    value lb = table_find(root, sym(logbatch));
+    filesystem_set_log_commit(fs, microseconds(lw ? u64_from_value(lw) : LOG_COMMIT_DEFAULT_WINDOW_US),
+                              lb ? u64_from_value(lb) * KB : LOG_COMMIT_DEFAULT_BYTES);
+
+    /* kilobytes of pre-zeroed pages for anonymous faults, 0 to zero
+       each page as it's faulted in */
+    value pz = table_find(root, sym(prezero));
+    physpages_set_zeroed_target((pz ? u64_from_value(pz) : PREZERO_DEFAULT_KB) * KB / PAGESIZE);
+
+    /* pages mapped around an anonymous fault, and whether to back
+       aligned 2M regions of anonymous mappings with 2M pages (hugepages:0
+       to use only 4K pages) */
+    value fa = table_find(root, sym(faultaround));
+    value hp = table_find(root, sym(hugepages));
+    mmap_set_fault_policy(fa ? u64_from_value(fa) : FAULT_AROUND_DEFAULT_PAGES,
+                          hp ? u64_from_value(hp) != 0 : true);
+
     value p = table_find(root, sym(program));
     tuple pro = resolve_path(root, split(general, p, '/'));
     init_network_iface(root);
-    filesystem_read_entire(fs, pro, heap_backed(kh), pg, closure(general, read_program_fail));
+    if (table_find(root, sym(trace)))
+        trace_program(root);
+    exec_elf_file(kp, pro, closure(general, read_program_fail));
 }
 
@@ -0,0 +1,128 @@
+/* Accept-heavy server with one epoll instance per worker thread, all
+   watching the same listening socket. Drive it from the host, e.g.
+   "ab -n 20000 -c 64 http://127.0.0.1:8080/" against "make run
+   TARGET=acceptbench". Once the given number of connections have been
+   served it prints, for each worker, the connections it accepted and
+   the wakeups that found nothing to accept. The arguments are the
+   number of workers, connections to serve and "excl" to register the
+   listening socket with EPOLLEXCLUSIVE. */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define DEFAULT_WORKERS     4
+#define DEFAULT_CONNECTIONS 10000
+#define MAX_WORKERS         64
+#define PORT                8080
+
+static const char response[] =
+    "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nConnection: close\r\n\r\nok\n";
+
+struct worker {
+    pthread_t thread;
+    long accepts;
+    long empty_wakeups;
+};
+
+static struct worker workers[MAX_WORKERS];
+static int listen_fd;
+static int exclusive;
+static volatile long served;
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static void serve(int fd)
+{
+    char buf[1024];
+
+    /* the request is small enough to arrive in one piece */
+    if (read(fd, buf, sizeof(buf)) > 0)
+        write(fd, response, sizeof(response) - 1);
+    close(fd);
+    __atomic_fetch_add(&served, 1, __ATOMIC_RELAXED);
+}
+
+static void *worker_thread(void *arg)
+{
+    struct worker *w = arg;
+    struct epoll_event ev;
+
+    int epfd = epoll_create1(0);
+    if (epfd < 0)
+        fail("epoll_create1");
+    ev.events = EPOLLIN | (exclusive ? EPOLLEXCLUSIVE : 0);
+    ev.data.fd = listen_fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+        fail("epoll_ctl");
+
+    while (1) {
+        if (epoll_wait(epfd, &ev, 1, -1) < 0)
+            fail("epoll_wait");
+        int n = 0;
+        int fd;
+        while ((fd = accept(listen_fd, 0, 0)) >= 0) {
+            serve(fd);
+            n++;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            fail("accept");
+        w->accepts += n;
+        if (n == 0)
+            w->empty_wakeups++;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_in addr;
+    int nworkers = argc > 1 ? atoi(argv[1]) : DEFAULT_WORKERS;
+    long connections = argc > 2 ? atol(argv[2]) : DEFAULT_CONNECTIONS;
+    exclusive = argc > 3 && !strcmp(argv[3], "excl");
+    if (nworkers < 1 || nworkers > MAX_WORKERS || connections < 1) {
+        printf("usage: %s [workers (1-%d)] [connections] [excl]\n", argv[0], MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0)
+        fail("socket");
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(PORT);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        fail("bind");
+    if (listen(listen_fd, 128) < 0)
+        fail("listen");
+
+    for (int i = 0; i < nworkers; i++) {
+        if (pthread_create(&workers[i].thread, 0, worker_thread, &workers[i]))
+            fail("pthread_create");
+    }
+    printf("%d workers%s listening on port %d\n", nworkers,
+           exclusive ? " (EPOLLEXCLUSIVE)" : "", PORT);
+
+    while (served < connections)
+        usleep(100000);
+
+    long empty = 0;
+    for (int i = 0; i < nworkers; i++) {
+        printf("worker %2d: %8ld accepts, %8ld empty wakeups\n",
+               i, workers[i].accepts, workers[i].empty_wakeups);
+        empty += workers[i].empty_wakeups;
+    }
+    printf("%ld connections, %ld empty wakeups\n", served, empty);
+    return EXIT_SUCCESS;
+}
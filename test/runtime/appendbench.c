@@ -0,0 +1,101 @@
+/* Appends to one file in small writes and reports the throughput. The
+   manifest sets fsstats to have the kernel print how many extents the
+   file ended up in, and how many of those were grown in place, on
+   exit; set pagecache to 0 there to compare against allocating at
+   write time rather than at write-back. The disk image needs room for
+   the file, so grow it before the default 1GB run, e.g. with
+   "truncate -s 1200M output/image/disk.raw", which mkfs keeps. Run
+   with "make run TARGET=appendbench"; the arguments are the size of
+   the file in megabytes and the size of each write in bytes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MB      1024
+#define DEFAULT_WRITE   100
+#define MAX_WRITE       65536
+#define FILE_NAME       "/appendbench.dat"
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* contents are a function of the file offset */
+static void fill(char *buf, long offset, int len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = (offset + i) % 251;
+}
+
+static void check(int fd, long length, int write_size)
+{
+    char buf[MAX_WRITE], expect[MAX_WRITE];
+    if (lseek(fd, 0, SEEK_END) != length) {
+        printf("length %ld, expected %ld\n", (long)lseek(fd, 0, SEEK_END), length);
+        exit(EXIT_FAILURE);
+    }
+
+    /* a few writes from across the file, and the last one */
+    for (int i = 0; i <= 16; i++) {
+        long offset = i < 16 ? (length / 16) * i : length - write_size;
+        offset -= offset % write_size;
+        if (pread(fd, buf, write_size, offset) != write_size)
+            fail("pread");
+        fill(expect, offset, write_size);
+        if (memcmp(buf, expect, write_size)) {
+            printf("bad contents at %ld\n", offset);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char buf[MAX_WRITE];
+    long mb = argc > 1 ? atol(argv[1]) : DEFAULT_MB;
+    int write_size = argc > 2 ? atoi(argv[2]) : DEFAULT_WRITE;
+    if (mb < 1 || write_size < 1 || write_size > MAX_WRITE) {
+        printf("usage: %s [megabytes] [write size (1-%d)]\n", argv[0], MAX_WRITE);
+        exit(EXIT_FAILURE);
+    }
+
+    int fd = open(FILE_NAME, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        fail("open");
+
+    long length = mb << 20;
+    length -= length % write_size;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long offset = 0; offset < length; offset += write_size) {
+        fill(buf, offset, write_size);
+        if (write(fd, buf, write_size) != write_size)
+            fail("write");
+    }
+    double t = elapsed(&start);
+    if (fsync(fd) < 0)
+        fail("fsync");
+    double ts = elapsed(&start);
+
+    long writes = length / write_size;
+    printf("%ld appends of %d bytes: %.3f s, %.0f writes/s, %.1f MB/s\n",
+           writes, write_size, t, writes / t, length / t / (1 << 20));
+    printf("including fsync: %.3f s, %.1f MB/s\n", ts, length / ts / (1 << 20));
+
+    check(fd, length, write_size);
+    close(fd);
+    return EXIT_SUCCESS;
+}
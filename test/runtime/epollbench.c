@@ -0,0 +1,110 @@
+/* Cost of epoll_wait with a few busy connections among many idle
+   ones. Each round makes every hot socket readable, waits for the
+   events and drains them; the time per wait is reported as the number
+   of idle sockets registered grows, and should stay flat. Run with
+   "make run TARGET=epollbench"; the arguments are the number of idle
+   sockets, hot sockets and rounds per measurement. */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define DEFAULT_IDLE    4000
+#define DEFAULT_HOT     8
+#define DEFAULT_ROUNDS  10000
+#define MAX_HOT         64
+#define STEPS           4
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* register the reading end of a new socket pair */
+static void add_socket(int epfd, int id, int *rd, int *wr)
+{
+    int sv[2];
+    struct epoll_event ev;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+        fail("socketpair");
+    ev.events = EPOLLIN;
+    ev.data.u64 = id;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sv[0], &ev) < 0)
+        fail("epoll_ctl");
+    *rd = sv[0];
+    *wr = sv[1];
+}
+
+int main(int argc, char **argv)
+{
+    struct epoll_event events[MAX_HOT];
+    int hot_rd[MAX_HOT], hot_wr[MAX_HOT];
+    int idle = argc > 1 ? atoi(argv[1]) : DEFAULT_IDLE;
+    int hot = argc > 2 ? atoi(argv[2]) : DEFAULT_HOT;
+    int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+    if (idle < 0 || hot < 1 || hot > MAX_HOT || rounds < 1) {
+        printf("usage: %s [idle sockets] [hot sockets (1-%d)] [rounds]\n", argv[0], MAX_HOT);
+        exit(EXIT_FAILURE);
+    }
+
+    int epfd = epoll_create1(0);
+    if (epfd < 0)
+        fail("epoll_create1");
+    for (int i = 0; i < hot; i++)
+        add_socket(epfd, i, &hot_rd[i], &hot_wr[i]);
+
+    int registered = 0;
+    for (int step = 0; step <= STEPS; step++) {
+        /* idle sockets are never written to; both ends stay open */
+        for (; registered < (long)idle * step / STEPS; registered++) {
+            int rd, wr;
+            add_socket(epfd, MAX_HOT + registered, &rd, &wr);
+        }
+
+        struct timespec start;
+        double waiting = 0;
+        for (int r = 0; r < rounds; r++) {
+            char c = r;
+            for (int i = 0; i < hot; i++) {
+                if (write(hot_wr[i], &c, 1) != 1)
+                    fail("write");
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int n = epoll_wait(epfd, events, MAX_HOT, -1);
+            waiting += elapsed(&start);
+            if (n < 0)
+                fail("epoll_wait");
+            if (n != hot) {
+                printf("epoll_wait returned %d events, expected %d\n", n, hot);
+                exit(EXIT_FAILURE);
+            }
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.u64 >= hot) {
+                    printf("event on idle socket %ld\n", (long)events[i].data.u64 - MAX_HOT);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            for (int i = 0; i < hot; i++) {
+                if (read(hot_rd[i], &c, 1) != 1)
+                    fail("read");
+            }
+        }
+        printf("%6d idle, %d hot: %.2f us per epoll_wait\n",
+               registered, hot, waiting * 1e6 / rounds);
+    }
+    return EXIT_SUCCESS;
+}
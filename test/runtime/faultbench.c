@@ -0,0 +1,82 @@
+/* Anonymous page fault throughput: maps a region, touches every page
+   once and reports the time per page. The manifest sets faultstats to
+   print the kernel's fault latency histogram and mapping counts on
+   exit; set prezero to 0 there to compare against zeroing each page as
+   it's faulted in, and faultaround to 1 and hugepages to 0 to compare
+   against faulting in one 4K page at a time. Each pass also unmaps
+   single pages out of the middle of the region, which splits any 2M
+   page beneath them, and checks the rest is left intact. Run
+   with "make run TARGET=faultbench"; the arguments are the size of the
+   region in megabytes and the number of passes, each on a fresh
+   mapping, with a pause between them for idle zeroing to catch up. */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define DEFAULT_MB      64
+#define DEFAULT_PASSES  4
+#define PAGE_SIZE       4096
+#define HOLE_STRIDE     1024
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    long mb = argc > 1 ? atol(argv[1]) : DEFAULT_MB;
+    int passes = argc > 2 ? atoi(argv[2]) : DEFAULT_PASSES;
+    if (mb < 1 || passes < 1) {
+        printf("usage: %s [megabytes] [passes]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    long length = mb << 20;
+    long npages = length / PAGE_SIZE;
+
+    for (int pass = 0; pass < passes; pass++) {
+        char *p = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            fail("mmap");
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < npages; i++) {
+            if (p[i * PAGE_SIZE] != 0) {
+                printf("page %ld not zero\n", i);
+                exit(EXIT_FAILURE);
+            }
+            p[i * PAGE_SIZE + PAGE_SIZE - 1] = 1;
+        }
+        double t = elapsed(&start);
+        printf("pass %d: %ld pages, %.3f s, %.2f us per page\n",
+               pass, npages, t, t * 1e6 / npages);
+
+        for (long i = 1; i < npages; i += HOLE_STRIDE) {
+            if (munmap(p + i * PAGE_SIZE, PAGE_SIZE) < 0)
+                fail("munmap");
+        }
+        for (long i = 0; i < npages; i++) {
+            if (i % HOLE_STRIDE != 1 && p[i * PAGE_SIZE + PAGE_SIZE - 1] != 1) {
+                printf("page %ld lost after partial unmap\n", i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (munmap(p, length) < 0)
+            fail("munmap");
+        usleep(100000);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/* Demand-paged file mappings. A file larger than the guest's memory is
+   made by extending it with ftruncate and writing a tag into a sparse
+   set of its pages. The whole file is then mapped and only those pages
+   (and a few holes) are touched, checking that:
+   - shared and private mappings see the file contents,
+   - a store to a private mapping doesn't reach the file, and
+   - a store to a shared mapping does, once msync returns. */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILE_SIZE   (3ull << 30)
+#define TAG_STRIDE  (64ull << 20)
+#define TAG_SKEW    (5 * 4096)
+#define NTAGS       ((int)(FILE_SIZE / TAG_STRIDE))
+
+static const char *file_name = "/filemap.dat";
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static void check(int cond, const char *what, unsigned long off)
+{
+    if (!cond) {
+        printf("%s at file offset 0x%lx\n", what, off);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* tagged pages are spread unevenly across the file */
+static unsigned long tag_offset(int i)
+{
+    return i * TAG_STRIDE + (i * TAG_SKEW) % TAG_STRIDE;
+}
+
+static unsigned long tag_value(int i, int generation)
+{
+    return 0x6669656d00000000ul | (generation << 16) | i;
+}
+
+static unsigned long read_tag(int fd, int i)
+{
+    unsigned long v;
+    if (pread(fd, &v, sizeof(v), tag_offset(i)) != sizeof(v))
+        fail("pread");
+    return v;
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    int fd = open(file_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        fail("open");
+    if (ftruncate(fd, FILE_SIZE) < 0)
+        fail("ftruncate");
+    for (int i = 0; i < NTAGS; i++) {
+        unsigned long v = tag_value(i, 0);
+        if (pwrite(fd, &v, sizeof(v), tag_offset(i)) != sizeof(v))
+            fail("pwrite");
+    }
+
+    unsigned char *shared = mmap(0, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED)
+        fail("mmap shared");
+    unsigned char *private = mmap(0, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (private == MAP_FAILED)
+        fail("mmap private");
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < NTAGS; i++) {
+        unsigned long off = tag_offset(i);
+        unsigned long hole = off + TAG_STRIDE / 2;
+        check(*(unsigned long *)(shared + off) == tag_value(i, 0), "bad tag in shared mapping", off);
+        check(*(unsigned long *)(private + off) == tag_value(i, 0), "bad tag in private mapping", off);
+        check(shared[hole] == 0, "hole not zero in shared mapping", hole);
+    }
+    printf("read %d tagged pages of a %llu MB file: %.3f ms\n", NTAGS, FILE_SIZE >> 20,
+           elapsed(&start) * 1e3);
+
+    /* copy-on-write */
+    for (int i = 0; i < NTAGS; i++)
+        *(unsigned long *)(private + tag_offset(i)) = tag_value(i, 1);
+    for (int i = 0; i < NTAGS; i++) {
+        unsigned long off = tag_offset(i);
+        check(*(unsigned long *)(private + off) == tag_value(i, 1), "private store lost", off);
+        check(*(unsigned long *)(shared + off) == tag_value(i, 0), "private store in shared mapping", off);
+        check(read_tag(fd, i) == tag_value(i, 0), "private store reached file", off);
+    }
+
+    /* write through, including into a hole */
+    for (int i = 0; i < NTAGS; i++) {
+        unsigned long off = tag_offset(i);
+        *(unsigned long *)(shared + off) = tag_value(i, 2);
+        shared[off + TAG_STRIDE / 2] = 0xa5;
+    }
+    if (msync(shared, FILE_SIZE, MS_SYNC) < 0)
+        fail("msync");
+    for (int i = 0; i < NTAGS; i++) {
+        unsigned long off = tag_offset(i);
+        unsigned char c;
+        check(read_tag(fd, i) == tag_value(i, 2), "shared store not in file", off);
+        if (pread(fd, &c, 1, off + TAG_STRIDE / 2) != 1)
+            fail("pread");
+        check(c == 0xa5, "shared store to hole not in file", off + TAG_STRIDE / 2);
+    }
+
+    if (munmap(private, FILE_SIZE) < 0 || munmap(shared, FILE_SIZE) < 0)
+        fail("munmap");
+    close(fd);
+    printf("filemap test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/* Small appends with fsync from several threads at once, each to its
+   own file. Throughput depends on how many of the concurrent fsyncs
+   share a log write; compare runs with the manifest's logwindow set to
+   0 (write the log out on every flush) and left at its default. Run
+   with "make run TARGET=fsyncbench"; the arguments are the number of
+   threads and the appends made by each. */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_APPENDS 500
+#define APPEND_SIZE     128
+#define MAX_THREADS     64
+
+static int appends;
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void file_name(char *name, int len, long id)
+{
+    snprintf(name, len, "/fsyncbench.%ld", id);
+}
+
+static void *append_thread(void *arg)
+{
+    char name[32];
+    char buf[APPEND_SIZE];
+    long id = (long)arg;
+
+    file_name(name, sizeof(name), id);
+    int fd = open(name, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0)
+        fail("open");
+    memset(buf, 'a' + id % 26, sizeof(buf));
+    for (int i = 0; i < appends; i++) {
+        if (write(fd, buf, sizeof(buf)) != sizeof(buf))
+            fail("write");
+        if (fsync(fd) < 0)
+            fail("fsync");
+    }
+    close(fd);
+    return 0;
+}
+
+static void check_file(long id)
+{
+    char name[32];
+    char buf[APPEND_SIZE];
+    long expected = (long)appends * APPEND_SIZE;
+
+    file_name(name, sizeof(name), id);
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        fail("open");
+    long length = lseek(fd, 0, SEEK_END);
+    if (length != expected) {
+        printf("%s: length %ld, expected %ld\n", name, length, expected);
+        exit(EXIT_FAILURE);
+    }
+    lseek(fd, length - APPEND_SIZE, SEEK_SET);
+    if (read(fd, buf, sizeof(buf)) != sizeof(buf))
+        fail("read");
+    for (int i = 0; i < APPEND_SIZE; i++) {
+        if (buf[i] != 'a' + id % 26) {
+            printf("%s: bad contents at %ld\n", name, length - APPEND_SIZE + i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t threads[MAX_THREADS];
+    int nthreads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    appends = argc > 2 ? atoi(argv[2]) : DEFAULT_APPENDS;
+    if (nthreads < 1 || nthreads > MAX_THREADS || appends < 1) {
+        printf("usage: %s [threads (1-%d)] [appends per thread]\n", argv[0], MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < nthreads; i++) {
+        if (pthread_create(&threads[i], 0, append_thread, (void *)i))
+            fail("pthread_create");
+    }
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_join(threads[i], 0))
+            fail("pthread_join");
+    }
+    double t = elapsed(&start);
+    long total = (long)nthreads * appends;
+    printf("%d threads x %d appends of %d bytes: %.3f s, %.0f fsyncs/s\n",
+           nthreads, appends, APPEND_SIZE, t, total / t);
+
+    for (long i = 0; i < nthreads; i++)
+        check_file(i);
+    return EXIT_SUCCESS;
+}
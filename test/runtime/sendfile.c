@@ -83,6 +83,16 @@ int main(int argc, char *argv[])
     if (memcmp(buf, cmp_buf, sizeof(buf)) != 0)
         sf_err_goto(err_fop, "sendfile() failed!!\n");
 
+    /* a count running past the end of file is clipped to it */
+    off_t in_len = lseek(fd_in, 0, SEEK_END);
+    off_t off = in_len - 4;
+    ret = sendfile(fd_out, fd_in, &off, 100);
+    if (ret != 4 || off != in_len)
+        sf_err_goto(err_fop, "sendfile near EOF returned %d, offset %ld\n", ret, off);
+    ret = sendfile(fd_out, fd_in, &off, 100);
+    if (ret != 0)
+        sf_err_goto(err_fop, "sendfile at EOF returned %d\n", ret);
+
     close(fd_out);
     close(fd_in);
 
@@ -0,0 +1,103 @@
+/* Writes a file sequentially in large writes, then reads it back the
+   same way, and reports the throughput of each. The default file is
+   well beyond the page cache, so the reads come from the disk rather
+   than from cached pages. The manifest sets queuestats to have the
+   kernel print, on exit, how many requests the block queue took and
+   how many of those it merged or split on the way to the device. The
+   disk image needs room for the file, so grow it before the default
+   512MB run, e.g. with "truncate -s 700M output/image/disk.raw", which
+   mkfs keeps. Run with "make run TARGET=seqbench"; the arguments are
+   the size of the file in megabytes and the size of each read and
+   write in kilobytes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MB      512
+#define DEFAULT_KB      1024
+#define MAX_KB          16384
+#define FILE_NAME       "/seqbench.dat"
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* each 8-byte word holds its file offset, so misplaced data shows */
+static void fill(char *buf, long offset, long len)
+{
+    for (long i = 0; i < len; i += sizeof(long))
+        *(long *)(buf + i) = offset + i;
+}
+
+static void verify(char *buf, long offset, long len)
+{
+    for (long i = 0; i < len; i += sizeof(long)) {
+        if (*(long *)(buf + i) != offset + i) {
+            printf("bad contents at %ld: %ld\n", offset + i, *(long *)(buf + i));
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long mb = argc > 1 ? atol(argv[1]) : DEFAULT_MB;
+    long kb = argc > 2 ? atol(argv[2]) : DEFAULT_KB;
+    if (mb < 1 || kb < 1 || kb > MAX_KB) {
+        printf("usage: %s [megabytes] [I/O size in kilobytes (1-%d)]\n", argv[0], MAX_KB);
+        exit(EXIT_FAILURE);
+    }
+
+    long io_size = kb << 10;
+    long length = mb << 20;
+    length -= length % io_size;
+    char *buf = malloc(io_size);
+    if (!buf)
+        fail("malloc");
+
+    int fd = open(FILE_NAME, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        fail("open");
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long offset = 0; offset < length; offset += io_size) {
+        fill(buf, offset, io_size);
+        if (write(fd, buf, io_size) != io_size)
+            fail("write");
+    }
+    if (fsync(fd) < 0)
+        fail("fsync");
+    double t = elapsed(&start);
+    printf("write %ld MB in %ld KB writes, including fsync: %.3f s, %.1f MB/s\n",
+           mb, kb, t, length / t / (1 << 20));
+
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        fail("lseek");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long offset = 0; offset < length; offset += io_size) {
+        if (read(fd, buf, io_size) != io_size)
+            fail("read");
+        verify(buf, offset, io_size);
+    }
+    t = elapsed(&start);
+    printf("read %ld MB in %ld KB reads: %.3f s, %.1f MB/s\n",
+           mb, kb, t, length / t / (1 << 20));
+
+    close(fd);
+    free(buf);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* Busy threads that make no system calls, to show user code running on
+   several cpus at once. The time for a fixed amount of work per thread
+   should fall as cpus are added, up to the thread count. Run with
+   "make run TARGET=smpbench SMP=n"; the arguments are the number of
+   threads and the loop iterations, in millions, done by each. */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_THREADS 4
+#define DEFAULT_MILLIONS 500
+#define MAX_THREADS     64
+
+static long iterations;
+
+struct worker {
+    pthread_t thread;
+    int cpu;
+    unsigned long result;
+};
+
+static void fail(const char *s)
+{
+    printf("%s failed: %s (errno %d)\n", s, strerror(errno), errno);
+    exit(EXIT_FAILURE);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void *busy_thread(void *arg)
+{
+    struct worker *w = arg;
+    volatile unsigned long x = 0;
+
+    for (long i = 0; i < iterations; i++)
+        x = x * 6364136223846793005ul + 1442695040888963407ul;
+    w->result = x;
+    w->cpu = sched_getcpu();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static struct worker workers[MAX_THREADS];
+    int nthreads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    long millions = argc > 2 ? atol(argv[2]) : DEFAULT_MILLIONS;
+    if (nthreads < 1 || nthreads > MAX_THREADS || millions < 1) {
+        printf("usage: %s [threads (1-%d)] [iterations per thread, millions]\n",
+               argv[0], MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+    iterations = millions * 1000000;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&workers[i].thread, 0, busy_thread, &workers[i]))
+            fail("pthread_create");
+    }
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_join(workers[i].thread, 0))
+            fail("pthread_join");
+    }
+    double t = elapsed(&start);
+
+    unsigned long cpus = 0;
+    for (int i = 0; i < nthreads; i++) {
+        if (workers[i].result != workers[0].result) {
+            printf("thread %d: result mismatch\n", i);
+            exit(EXIT_FAILURE);
+        }
+        if (workers[i].cpu >= 0 && workers[i].cpu < 64)
+            cpus |= 1ul << workers[i].cpu;
+    }
+    printf("%d threads x %ldM iterations: %.3f s, %.1fM iterations/s on %d cpus\n",
+           nthreads, millions, t, nthreads * millions / t, __builtin_popcountl(cpus));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/* Startup latency for a large binary: the program carries BLOB_MB
+   megabytes of read-only data and reports the uptime at which main()
+   was reached, from times() in 10 ms ticks. Compare against a run with
+   pagecache:0 in the manifest, which reads the whole file in before
+   starting it. Afterwards a number of pages spread across the data,
+   given as the argument, are touched to time demand paging. Run with
+   "make run TARGET=startbench". */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/times.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BLOB_MB
+#define BLOB_MB     128
+#endif
+#define BLOB_WORDS  (BLOB_MB * 1024 * 1024 / sizeof(unsigned long))
+#define PAGE_WORDS  (4096 / sizeof(unsigned long))
+
+/* mostly zeros, which still take up space in the file */
+static const unsigned long blob[BLOB_WORDS] = {
+    [0] = 1,
+    [BLOB_WORDS / 2] = 2,
+    [BLOB_WORDS - 1] = 3,
+};
+
+int main(int argc, char **argv)
+{
+    struct tms t;
+    clock_t up = times(&t);
+    printf("main() reached at %ld ms uptime, binary carries %d MB of data\n",
+           (long)(up * 1000 / sysconf(_SC_CLK_TCK)), BLOB_MB);
+
+    long touch = argc > 1 ? atol(argv[1]) : 64;
+    if (touch < 1 || touch > BLOB_WORDS / PAGE_WORDS) {
+        printf("usage: %s [pages to touch (1-%ld)]\n", argv[0], (long)(BLOB_WORDS / PAGE_WORDS));
+        exit(EXIT_FAILURE);
+    }
+
+    struct timespec start, end;
+    unsigned long sum = 0;
+    unsigned long stride = BLOB_WORDS / touch;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < touch; i++)
+        sum += blob[i * stride + 1];
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    printf("touched %ld pages: %.1f us per page\n", touch, us / touch);
+
+    /* the touched words are all zero */
+    if (sum != 0 || blob[BLOB_WORDS / 2] != 2 || blob[BLOB_WORDS - 1] != 3) {
+        printf("bad data\n");
+        exit(EXIT_FAILURE);
+    }
+    return EXIT_SUCCESS;
+}
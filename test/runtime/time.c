@@ -3,9 +3,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
+/* clock_gettime is served by the vdso; the raw syscall should agree */
+static int
+check_clock_gettime(void)
+{
+    struct timespec prev, ts, sys;
+
+    memset(&prev, 0, sizeof(prev));
+    for (int i = 0; i < 100000; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        if (ts.tv_sec < prev.tv_sec ||
+                (ts.tv_sec == prev.tv_sec && ts.tv_nsec < prev.tv_nsec)) {
+            printf("clock_gettime: non-monotonic values\n");
+            return -1;
+        }
+        prev = ts;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    syscall(SYS_clock_gettime, CLOCK_REALTIME, &sys);
+    if (sys.tv_sec < ts.tv_sec || sys.tv_sec > ts.tv_sec + 1) {
+        printf("clock_gettime: vdso %ld, syscall %ld\n", ts.tv_sec, sys.tv_sec);
+        return -1;
+    }
+    return 0;
+}
+
 int
 main()
 {
@@ -15,6 +42,8 @@ main()
 
     memset(&tms_prev, 0, sizeof(tms_prev));
     uptime_prev = 0;
+    if (check_clock_gettime() < 0)
+        return EXIT_FAILURE;
     for (i = 0; i < 10; i++) {
         struct timeval tv;
         time_t t, t2;
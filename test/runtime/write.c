@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -319,6 +320,77 @@ void truncate_test()
     exit(EXIT_FAILURE);
 }
 
+/* Aligned O_DIRECT writes go to disk from the user pages. Mixed with
+   buffered writes through another descriptor, which leave pages in the
+   cache, reads still see what was written last. */
+#define DIRECT_SIZE (64 * 1024)
+
+static void direct_pwrite(int fd, char *expect, char *buf, size_t len, off_t offset)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = random();
+    ssize_t rv = pwrite(fd, buf, len, offset);
+    if (rv != len) {
+        printf("direct pwrite of %ld at %ld returned %ld\n", len, offset, rv);
+        perror("pwrite");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(expect + offset, buf, len);
+}
+
+void direct_write_test()
+{
+    static char expect[DIRECT_SIZE * 2 + 4096];
+    static char check[DIRECT_SIZE * 2 + 4096];
+    char *buf;
+
+    if (posix_memalign((void **)&buf, 4096, DIRECT_SIZE + 4096)) {
+        printf("posix_memalign failed\n");
+        exit(EXIT_FAILURE);
+    }
+    int fd = open("direct_file", O_CREAT | O_RDWR | O_DIRECT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        perror("open O_DIRECT");
+        exit(EXIT_FAILURE);
+    }
+    int bfd = open("direct_file", O_RDWR);
+    if (bfd < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+    memset(expect, 0, sizeof(expect));
+    direct_pwrite(fd, expect, buf, DIRECT_SIZE, 0);
+    direct_pwrite(fd, expect, buf + 512, 16 * 1024, 8192);
+    direct_pwrite(bfd, expect, buf, 100, 1000);
+    direct_pwrite(fd, expect, buf + 512, 4096, DIRECT_SIZE);
+    direct_pwrite(bfd, expect, buf + 1, 4000, DIRECT_SIZE + 100);
+    direct_pwrite(fd, expect, buf, DIRECT_SIZE, DIRECT_SIZE + 4096);
+    direct_pwrite(fd, expect, buf + 4096, 4096, 0);
+    close(fd);
+    close(bfd);
+
+    fd = open("direct_file", O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+    ssize_t rv = read(fd, check, sizeof(check));
+    if (rv != sizeof(check) || lseek(fd, 0, SEEK_END) != sizeof(check)) {
+        printf("direct file read %ld bytes, length %ld, expected %ld\n",
+               rv, lseek(fd, 0, SEEK_END), sizeof(check));
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < sizeof(check); i++) {
+        if (check[i] != expect[i]) {
+            printf("direct file: unexpected data 0x%02x at offset %d, expected 0x%02x\n",
+                   (unsigned char)check[i], i, (unsigned char)expect[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+    free(buf);
+}
+
 int main(int argc, char **argv)
 {
     setvbuf(stdout, NULL, _IOLBF, 0);
@@ -326,6 +398,7 @@ int main(int argc, char **argv)
     scatter_write_test(1 << 18, 64, 1 << 12);
     append_write_test();
     truncate_test();
+    direct_write_test();
     printf("write test passed\n");
     return EXIT_SUCCESS;
 }
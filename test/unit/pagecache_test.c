@@ -0,0 +1,204 @@
+/* Check that a file appended to through the page cache is found after
+   a crash with no more length than has been written back. The image
+   is kept in a temporary file and mounted by the test executed anew,
+   once with the appends still cached, where the file must be empty,
+   and once after the file is flushed, where its length and contents
+   must be those written. */
+
+#include <runtime.h>
+#include <tfs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CACHE_LIMIT     (4 * MB)
+#define WRITE_SIZE      1000
+#define WRITES          300
+
+static int disk;
+static char *prog;
+
+static CLOSURE_0_3(disk_read, void, void *, range, status_handler);
+static void disk_read(void *dest, range blocks, status_handler sh)
+{
+    u64 length = range_span(blocks) << SECTOR_OFFSET;
+    ssize_t rv = pread(disk, dest, length, blocks.start << SECTOR_OFFSET);
+    if (rv < 0) {
+        apply(sh, timm("result", "pread failed: %s", strerror(errno)));
+        return;
+    }
+    /* past the end of the image reads as zero */
+    if (rv < length)
+        memset(dest + rv, 0, length - rv);
+    apply(sh, STATUS_OK);
+}
+
+static CLOSURE_0_3(disk_write, void, void *, range, status_handler);
+static void disk_write(void *src, range blocks, status_handler sh)
+{
+    u64 length = range_span(blocks) << SECTOR_OFFSET;
+    if (pwrite(disk, src, length, blocks.start << SECTOR_OFFSET) != length) {
+        apply(sh, timm("result", "pwrite failed: %s", strerror(errno)));
+        return;
+    }
+    apply(sh, STATUS_OK);
+}
+
+static u8 pattern(u64 offset)
+{
+    return (offset * 7 + (offset >> 12)) & 0xff;
+}
+
+static CLOSURE_3_2(read_complete, void, u8 *, u64, u64, status, bytes);
+static void read_complete(u8 *buf, u64 length, u64 expected, status s, bytes count)
+{
+    if (!is_ok(s) || count != length) {
+        msg_err("read failed: %v, %ld bytes\n", s, count);
+        exit(EXIT_FAILURE);
+    }
+    for (u64 i = 0; i < length; i++) {
+        if (buf[i] != pattern(i)) {
+            msg_err("mismatch at offset %ld\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    exit(EXIT_SUCCESS);
+}
+
+static CLOSURE_3_2(mount_complete, void, heap, tuple, u64, filesystem, status);
+static void mount_complete(heap h, tuple root, u64 expected, filesystem fs, status s)
+{
+    if (!is_ok(s)) {
+        msg_err("mount failed: %v\n", s);
+        exit(EXIT_FAILURE);
+    }
+    tuple c = table_find(root, sym(children));
+    tuple t = c ? table_find(c, sym(test)) : 0;
+    if (!t) {
+        msg_err("file not found\n");
+        exit(EXIT_FAILURE);
+    }
+    fsfile f = fsfile_from_node(fs, t);
+    if (!f) {
+        msg_err("no fsfile\n");
+        exit(EXIT_FAILURE);
+    }
+    u64 length = fsfile_get_length(f);
+    if (length != expected) {
+        msg_err("file length %ld, expected %ld\n", length, expected);
+        exit(EXIT_FAILURE);
+    }
+    if (length == 0)
+        exit(EXIT_SUCCESS);
+    u8 *buf = allocate(h, length);
+    filesystem_read(fs, t, buf, length, 0, closure(h, read_complete, buf, length, expected));
+    msg_err("read did not complete\n");
+    exit(EXIT_FAILURE);
+}
+
+static void mount(heap h, u64 expected)
+{
+    tuple root = allocate_tuple();
+    create_filesystem(h, SECTOR_SIZE, infinity, h, closure(h, disk_read),
+                      closure(h, disk_write), root,
+                      closure(h, mount_complete, h, root, expected));
+    msg_err("mount did not complete\n");
+    exit(EXIT_FAILURE);
+}
+
+/* mount the image as it stands in a new process, as after a crash */
+static void check_mount(u64 expected)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        char fd[16], n[24];
+        snprintf(fd, sizeof(fd), "%d", disk);
+        snprintf(n, sizeof(n), "%lld", (long long)expected);
+        execl(prog, prog, "-m", fd, n, (char *)0);
+        perror("exec");
+        exit(EXIT_FAILURE);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        msg_err("mount with expected length %ld failed\n", expected);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static CLOSURE_0_1(flush_complete, void, status);
+static void flush_complete(status s)
+{
+    if (!is_ok(s)) {
+        msg_err("flush failed: %v\n", s);
+        exit(EXIT_FAILURE);
+    }
+    check_mount(WRITE_SIZE * WRITES);
+    exit(EXIT_SUCCESS);
+}
+
+static CLOSURE_1_2(build_complete, void, heap, filesystem, status);
+static void build_complete(heap h, filesystem fs, status s)
+{
+    if (!is_ok(s)) {
+        msg_err("create failed: %v\n", s);
+        exit(EXIT_FAILURE);
+    }
+    tuple root = filesystem_getroot(fs);
+    table_set(root, sym(children), allocate_tuple());
+    filesystem_write_tuple(fs, root, ignore_status);
+    if (filesystem_creat(fs, 0, "test", true) != FS_STATUS_OK) {
+        msg_err("creat failed\n");
+        exit(EXIT_FAILURE);
+    }
+    tuple t = table_find(table_find(root, sym(children)), sym(test));
+    filesystem_set_cache_limit(fs, CACHE_LIMIT);
+
+    buffer b = allocate_buffer(h, WRITE_SIZE);
+    for (u64 i = 0; i < WRITES; i++) {
+        buffer_clear(b);
+        for (u64 j = 0; j < WRITE_SIZE; j++)
+            push_u8(b, pattern(i * WRITE_SIZE + j));
+        filesystem_write(fs, t, b, i * WRITE_SIZE, ignore_io_status);
+    }
+
+    /* nothing written back yet */
+    check_mount(0);
+
+    filesystem_flush(fs, t, closure(h, flush_complete));
+    msg_err("flush did not complete\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+    prog = argv[0];
+
+    /* re-executed to mount */
+    if (argc == 4 && !strcmp(argv[1], "-m")) {
+        disk = atoi(argv[2]);
+        mount(h, atoll(argv[3]));
+    }
+
+    char name[] = "/tmp/pagecache_test.XXXXXX";
+    disk = mkstemp(name);
+    if (disk < 0) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    unlink(name);
+
+    create_filesystem(h, SECTOR_SIZE, infinity, h, closure(h, disk_read),
+                      closure(h, disk_write), allocate_tuple(),
+                      closure(h, build_complete, h));
+    msg_err("create did not complete\n");
+    exit(EXIT_FAILURE);
+}
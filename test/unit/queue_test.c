@@ -0,0 +1,117 @@
+//#define ENABLE_MSG_DEBUG
+#include <runtime.h>
+#include <x86_64.h>
+#include <stdlib.h>
+#define EXIT_FAILURE 1
+#define EXIT_SUCCESS 0
+
+#define STRESS_ITEMS (1 << 20)
+
+boolean bounded_test(heap h)
+{
+    char * msg = "";
+    queue q = allocate_queue(h, 4);
+
+    for (u64 i = 1; i <= 4; i++) {
+        if (!enqueue(q, (void *)i)) {
+            msg = "enqueue within bounds failed";
+            goto fail;
+        }
+    }
+    if (enqueue(q, (void *)5)) {
+        msg = "enqueue past bounds succeeded";
+        goto fail;
+    }
+    if (queue_length(q) != 4 || queue_peek(q) != (void *)1) {
+        msg = "length or peek mismatch";
+        goto fail;
+    }
+    for (u64 i = 1; i <= 4; i++) {
+        if (dequeue(q) != (void *)i) {
+            msg = "dequeue out of order";
+            goto fail;
+        }
+    }
+    if (dequeue(q) != 0) {
+        msg = "queue should be empty but isn't";
+        goto fail;
+    }
+    if (queue_high_water(q) != 4) {
+        msg = "high water mark mismatch";
+        goto fail;
+    }
+    deallocate_queue(q);
+    return true;
+  fail:
+    msg_err("bounded_test fail; %s\n", msg);
+    deallocate_queue(q);
+    return false;
+}
+
+/* Push a million entries through a queue that starts at two slots, in
+   bursts of random size with partial drains between them, so that it
+   grows while wrapped around. */
+boolean stress_test(heap h)
+{
+    char * msg = "";
+    queue q = allocate_growable_queue(h, 2);
+    u64 next_in = 1, next_out = 1, max = 0;
+
+    while (next_out <= STRESS_ITEMS) {
+        u64 burst = random_u64() % 4096;
+        for (u64 i = 0; i < burst && next_in <= STRESS_ITEMS; i++) {
+            if (!enqueue(q, (void *)next_in++)) {
+                msg = "enqueue on growable queue failed";
+                goto fail;
+            }
+        }
+        u64 length = next_in - next_out;
+        if (queue_length(q) != length) {
+            msg = "length mismatch";
+            goto fail;
+        }
+        if (length > max)
+            max = length;
+
+        u64 ndequeue = next_in > STRESS_ITEMS ? length : random_u64() % (length + 1);
+        for (u64 i = 0; i < ndequeue; i++) {
+            u64 v = (u64)dequeue(q);
+            msg_debug("  dequeue %ld\n", v);
+            if (v != next_out++) {
+                msg = "dequeue out of order";
+                goto fail;
+            }
+        }
+    }
+    if (dequeue(q) != 0) {
+        msg = "queue should be empty but isn't";
+        goto fail;
+    }
+    if (queue_high_water(q) != max) {
+        msg = "high water mark mismatch";
+        goto fail;
+    }
+    deallocate_queue(q);
+    return true;
+  fail:
+    msg_err("stress_test fail; %s\n", msg);
+    deallocate_queue(q);
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+
+    if (!bounded_test(h))
+        goto fail;
+
+    if (!stress_test(h))
+        goto fail;
+
+    msg_debug("queue test passed\n");
+    exit(EXIT_SUCCESS);
+  fail:
+    msg_err("queue test failed\n");
+    exit(EXIT_FAILURE);
+}
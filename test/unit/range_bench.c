@@ -0,0 +1,142 @@
+/* Compare the red-black rangemap against the sorted list it replaced.
+   Not run as part of "make test"; invoke the binary directly. */
+
+#include <runtime.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LOOKUP_COUNT 100000
+#define RANGE_UNIT 16
+
+static const int bench_sizes[] = { 10, 1000, 100000 };
+
+/* reference sorted list implementation, as previously in range.c */
+typedef struct lnode {
+    range r;
+    struct list l;
+} *lnode;
+
+static boolean list_insert(struct list *root, lnode n)
+{
+    list_foreach(root, l) {
+        lnode curr = struct_from_list(l, lnode, l);
+        if (ranges_intersect(curr->r, n->r))
+            return false;
+        if (curr->r.start > n->r.start) {
+            list_insert_before(l, &n->l);
+            return true;
+        }
+    }
+    list_insert_before(root, &n->l);
+    return true;
+}
+
+static lnode list_lookup(struct list *root, u64 point)
+{
+    list_foreach(root, i) {
+        lnode curr = struct_from_list(i, lnode, l);
+        if (point_in_range(curr->r, point))
+            return curr;
+    }
+    return INVALID_ADDRESS;
+}
+
+static u64 nsecs(timestamp t)
+{
+    return sec_from_timestamp(t) * BILLION + nsec_from_timestamp(t);
+}
+
+/* random permutation of [0, n) */
+static u64 *shuffled(heap h, int n)
+{
+    u64 *v = allocate(h, n * sizeof(u64));
+    for (int i = 0; i < n; i++)
+        v[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = random_u64() % (i + 1);
+        u64 t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+    return v;
+}
+
+static void bench_rangemap(heap h, int n, u64 *order, u64 *points)
+{
+    rangemap rm = allocate_rangemap(h);
+    rmnode nodes = allocate(h, n * sizeof(struct rmnode));
+
+    timestamp t = now();
+    for (int i = 0; i < n; i++) {
+        rmnode_init(&nodes[i], irange(order[i] * RANGE_UNIT, (order[i] + 1) * RANGE_UNIT));
+        if (!rangemap_insert(rm, &nodes[i])) {
+            msg_err("insert failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    u64 insert_ns = nsecs(now() - t);
+
+    t = now();
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        if (rangemap_lookup(rm, points[i]) == INVALID_ADDRESS) {
+            msg_err("lookup failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    u64 lookup_ns = nsecs(now() - t);
+
+    printf("  rbtree %7d nodes: insert %8lld ns/op, lookup %8lld ns/op\n", n,
+           (long long)(insert_ns / n), (long long)(lookup_ns / LOOKUP_COUNT));
+    deallocate(h, nodes, n * sizeof(struct rmnode));
+}
+
+static void bench_list(heap h, int n, u64 *order, u64 *points)
+{
+    struct list root;
+    lnode nodes = allocate(h, n * sizeof(struct lnode));
+    list_init(&root);
+
+    timestamp t = now();
+    for (int i = 0; i < n; i++) {
+        nodes[i].r = irange(order[i] * RANGE_UNIT, (order[i] + 1) * RANGE_UNIT);
+        if (!list_insert(&root, &nodes[i])) {
+            msg_err("insert failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    u64 insert_ns = nsecs(now() - t);
+
+    /* keep the list walk from dominating the run at large sizes */
+    int lookups = n > 1000 ? LOOKUP_COUNT / 100 : LOOKUP_COUNT;
+    t = now();
+    for (int i = 0; i < lookups; i++) {
+        if (list_lookup(&root, points[i]) == INVALID_ADDRESS) {
+            msg_err("lookup failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    u64 lookup_ns = nsecs(now() - t);
+
+    printf("  list   %7d nodes: insert %8lld ns/op, lookup %8lld ns/op\n", n,
+           (long long)(insert_ns / n), (long long)(lookup_ns / lookups));
+    deallocate(h, nodes, n * sizeof(struct lnode));
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+
+    printf("rangemap benchmark (random insert order, random point lookups)\n");
+    for (int i = 0; i < _countof(bench_sizes); i++) {
+        int n = bench_sizes[i];
+        u64 *order = shuffled(h, n);
+        u64 *points = allocate(h, LOOKUP_COUNT * sizeof(u64));
+        for (int j = 0; j < LOOKUP_COUNT; j++)
+            points[j] = random_u64() % (n * RANGE_UNIT);
+        bench_rangemap(h, n, order, points);
+        bench_list(h, n, order, points);
+        deallocate(h, points, LOOKUP_COUNT * sizeof(u64));
+        deallocate(h, order, n * sizeof(u64));
+    }
+    exit(EXIT_SUCCESS);
+}
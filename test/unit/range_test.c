@@ -1,5 +1,5 @@
-/* This test is only suitable for the sorted list implementation. It
-   will need doctoring if the behavior of range search, etc., changes. */
+/* The basic test depends on in-order range search results. It will
+   need doctoring if the behavior of range search, etc., changes. */
 
 //#define ENABLE_MSG_DEBUG
 #include <stdio.h>
@@ -209,6 +209,120 @@ boolean basic_test(heap h)
     return false;
 }
 
+/* validate red-black properties and ordering; returns black height or -1 */
+static int validate_subtree(rmnode n, rmnode parent)
+{
+    if (!n)
+        return 1;
+    if (n->parent != parent) {
+        msg_err("node %R: bad parent link\n", n->r);
+        return -1;
+    }
+    if (n->red && ((n->left && n->left->red) || (n->right && n->right->red))) {
+        msg_err("node %R: red node with red child\n", n->r);
+        return -1;
+    }
+    if ((n->left && n->left->r.end > n->r.start) ||
+        (n->right && n->right->r.start < n->r.end)) {
+        msg_err("node %R: ordering violated\n", n->r);
+        return -1;
+    }
+    int lh = validate_subtree(n->left, n);
+    int rh = validate_subtree(n->right, n);
+    if (lh < 0 || rh < 0)
+        return -1;
+    if (lh != rh) {
+        msg_err("node %R: black height mismatch (%d, %d)\n", n->r, lh, rh);
+        return -1;
+    }
+    return lh + (n->red ? 0 : 1);
+}
+
+static boolean validate_rangemap(rangemap rm)
+{
+    if (rm->root && rm->root->red) {
+        msg_err("red root\n");
+        return false;
+    }
+    return validate_subtree(rm->root, 0) >= 0;
+}
+
+/* Exercise insert, remove and lookup against a flat array model
+   where slot i holds the node occupying [i * unit, (i + 1) * unit). */
+static boolean random_test(heap h, int slots, int ops)
+{
+    u64 unit = 16;
+    rangemap rm = allocate_rangemap(h);
+    test_node *model = allocate(h, slots * sizeof(test_node));
+    zero(model, slots * sizeof(test_node));
+
+    for (int op = 0; op < ops; op++) {
+        int s = random_u64() % slots;
+        if (model[s]) {
+            rangemap_remove_node(rm, &model[s]->node);
+            deallocate(h, model[s], sizeof(struct test_node));
+            model[s] = 0;
+        } else {
+            test_node tn = allocate_test_node(h, irange(s * unit, (s + 1) * unit), s);
+            if (!rangemap_insert(rm, &tn->node)) {
+                msg_err("insert of %R failed\n", tn->node.r);
+                return false;
+            }
+            model[s] = tn;
+        }
+
+        /* an overlapping insert must always be refused */
+        if (model[s]) {
+            struct test_node dup;
+            rmnode_init(&dup.node, irange(s * unit + 1, s * unit + 2));
+            if (rangemap_insert(rm, &dup.node)) {
+                msg_err("overlapping insert of %R succeeded\n", dup.node.r);
+                return false;
+            }
+        }
+
+        if ((op % 64) && op != ops - 1)
+            continue;
+
+        if (!validate_rangemap(rm))
+            return false;
+
+        /* in-order walk must match the model */
+        rmnode n = rangemap_first_node(rm);
+        for (int i = 0; i < slots; i++) {
+            if (!model[i])
+                continue;
+            if (n != &model[i]->node) {
+                msg_err("walk mismatch at slot %d\n", i);
+                return false;
+            }
+            n = rangemap_next_node(rm, n);
+        }
+        if (n != INVALID_ADDRESS) {
+            msg_err("walk has extra nodes\n");
+            return false;
+        }
+
+        for (int i = 0; i < slots; i++) {
+            u64 p = i * unit + random_u64() % unit;
+            rmnode expect = model[i] ? &model[i]->node : INVALID_ADDRESS;
+            if (rangemap_lookup(rm, p) != expect) {
+                msg_err("lookup of %ld mismatch\n", p);
+                return false;
+            }
+            int j = i;
+            while (j < slots && !model[j])
+                j++;
+            expect = j < slots ? &model[j]->node : INVALID_ADDRESS;
+            if (rangemap_lookup_at_or_next(rm, p) != expect) {
+                msg_err("lookup_at_or_next of %ld mismatch\n", p);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     heap h = init_process_runtime();
@@ -216,10 +330,8 @@ int main(int argc, char **argv)
     if (!basic_test(h))
         goto fail;
 
-    /*
-      if (!random_test(h, 100, 1000))
-      goto fail;
-    */
+    if (!random_test(h, 1000, 100000))
+        goto fail;
 
     msg_debug("range test passed\n");
     exit(EXIT_SUCCESS);
@@ -0,0 +1,181 @@
+/* Throughput of the open addressing table against the chained table it
+   replaced. Not run as part of "make test"; invoke the binary directly. */
+
+#include <runtime.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int bench_sizes[] = { 100, 10000, 1000000 };
+
+/* reference chained implementation, as previously in table.c */
+typedef struct centry {
+    void *v;
+    key k;
+    void *c;
+    struct centry *next;
+} *centry;
+
+typedef struct ctable {
+    heap h;
+    int buckets;
+    int count;
+    centry *entries;
+} *ctable;
+
+static ctable allocate_ctable(heap h)
+{
+    ctable t = allocate(h, sizeof(struct ctable));
+    t->h = h;
+    t->count = 0;
+    t->buckets = 4;
+    t->entries = allocate_zero(h, t->buckets * sizeof(void *));
+    return t;
+}
+
+static void *ctable_find(ctable t, void *c)
+{
+    key k = identity_key(c);
+    for (centry i = t->entries[k & (t->buckets - 1)]; i; i = i->next) {
+        if (i->k == k && i->c == c)
+            return i->v;
+    }
+    return 0;
+}
+
+static void ctable_resize(ctable t, int buckets)
+{
+    centry *nentries = allocate_zero(t->h, buckets * sizeof(void *));
+    for (int i = 0; i < t->buckets; i++) {
+        centry j = t->entries[i];
+        while (j) {
+            centry n = j->next;
+            key km = j->k & (buckets - 1);
+            j->next = nentries[km];
+            nentries[km] = j;
+            j = n;
+        }
+    }
+    t->entries = nentries;
+    t->buckets = buckets;
+}
+
+static void ctable_set(ctable t, void *c, void *v)
+{
+    key k = identity_key(c);
+    centry *e = t->entries + (k & (t->buckets - 1));
+    for (; *e; e = &(*e)->next) {
+        if ((*e)->k == k && (*e)->c == c) {
+            if (v == 0) {
+                centry z = *e;
+                t->count--;
+                *e = (*e)->next;
+                deallocate(t->h, z, sizeof(struct centry));
+            } else {
+                (*e)->v = v;
+            }
+            return;
+        }
+    }
+    if (v != 0) {
+        centry n = allocate_zero(t->h, sizeof(struct centry));
+        n->k = k;
+        n->c = c;
+        n->v = v;
+        *e = n;
+        if (t->count++ > t->buckets)
+            ctable_resize(t, t->buckets * 2);
+    }
+}
+
+static u64 nsecs(timestamp t)
+{
+    return sec_from_timestamp(t) * BILLION + nsec_from_timestamp(t);
+}
+
+/* keys resembling aligned object pointers */
+static inline void *bench_key(u64 i)
+{
+    return pointer_from_u64(0x100000000ull + i * 64);
+}
+
+typedef void (*bench_set)(void *t, void *k, void *v);
+typedef void *(*bench_find)(void *t, void *k);
+
+static void open_set(void *t, void *k, void *v)
+{
+    table_set(t, k, v);
+}
+
+static void *open_find(void *t, void *k)
+{
+    return table_find(t, k);
+}
+
+static void chained_set(void *t, void *k, void *v)
+{
+    ctable_set(t, k, v);
+}
+
+static void *chained_find(void *t, void *k)
+{
+    return ctable_find(t, k);
+}
+
+static void bench_run(const char *name, void *tb, u64 n, bench_set set, bench_find find)
+{
+    u64 worst = 0;
+    timestamp t = now();
+    for (u64 i = 0; i < n; i++) {
+        timestamp s = now();
+        set(tb, bench_key(i), pointer_from_u64(i + 1));
+        u64 d = nsecs(now() - s);
+        if (d > worst)
+            worst = d;
+    }
+    u64 insert_ns = nsecs(now() - t);
+
+    t = now();
+    for (int pass = 0; pass < 4; pass++) {
+        for (u64 i = 0; i < n; i++) {
+            if (find(tb, bench_key(i)) != pointer_from_u64(i + 1)) {
+                msg_err("lookup failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    u64 hit_ns = nsecs(now() - t);
+
+    t = now();
+    for (u64 i = n; i < 2 * n; i++) {
+        if (find(tb, bench_key(i))) {
+            msg_err("unexpected hit\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    u64 miss_ns = nsecs(now() - t);
+
+    t = now();
+    for (u64 i = 0; i < n; i++)
+        set(tb, bench_key(i), 0);
+    u64 remove_ns = nsecs(now() - t);
+
+    printf("  %-8s %8d keys: insert %5lld ns/op (worst %8lld ns), "
+           "hit %5lld, miss %5lld, remove %5lld ns/op\n", name, (int)n,
+           (long long)(insert_ns / n), (long long)worst,
+           (long long)(hit_ns / (4 * n)), (long long)(miss_ns / n),
+           (long long)(remove_ns / n));
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+
+    /* insert times include the cost of reading the clock per insert */
+    printf("table benchmark (pointer-like keys)\n");
+    for (int i = 0; i < _countof(bench_sizes); i++) {
+        u64 n = bench_sizes[i];
+        bench_run("open", allocate_table(h, identity_key, pointer_equal), n, open_set, open_find);
+        bench_run("chained", allocate_ctable(h), n, chained_set, chained_find);
+    }
+    exit(EXIT_SUCCESS);
+}
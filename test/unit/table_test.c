@@ -140,6 +140,134 @@ static boolean one_elem_table_tests(heap h)
     return true;
 }
 
+/* Mix inserts and removals across several incremental resizes,
+   including removals from within table_foreach. */
+static boolean churn_table_tests(heap h)
+{
+    table t = allocate_table(h, identity_key, pointer_equal);
+    u64 n = TABLETEST_ELEM_COUNT * 64;
+    u64 count;
+
+    for (count = 1; count <= n; count++) {
+        table_set(t, (void *)count, (void *)count);
+        /* drop every third key shortly after it went in */
+        if (count > 8 && (count - 8) % 3 == 0)
+            table_set(t, (void *)(count - 8), 0);
+    }
+    for (count = 1; count <= n; count++) {
+        boolean removed = count <= n - 8 && count % 3 == 0;
+        void *v = table_find(t, (void *)count);
+        if (removed ? v != 0 : v != (void *)count) {
+            msg_err("element %d lookup mismatch: %p\n", count, v);
+            return false;
+        }
+    }
+
+    /* remove all odd keys while iterating */
+    u64 seen = 0;
+    table_foreach(t, k, v) {
+        if ((u64)k != (u64)v) {
+            msg_err("table_foreach() value mismatch for %d\n", (u64)k);
+            return false;
+        }
+        seen++;
+        if ((u64)k & 1)
+            table_set(t, k, 0);
+    }
+    if (seen != n - (n - 8) / 3) {
+        msg_err("table_foreach() visited %d, expected %d\n", seen, n - (n - 8) / 3);
+        return false;
+    }
+    seen = 0;
+    table_foreach(t, k, v) {
+        (void) v;
+        if ((u64)k & 1) {
+            msg_err("odd key %d survived removal\n", (u64)k);
+            return false;
+        }
+        seen++;
+    }
+    if (seen != table_elements(t)) {
+        msg_err("table_elements() %d, but iterated %d\n", table_elements(t), seen);
+        return false;
+    }
+    return true;
+}
+
+/* Delete and iterate while a resize is still migrating entries out of
+   the old slot array; each live key must be seen exactly once, and no
+   deleted key may turn up from either array. */
+static boolean migration_table_tests(heap h)
+{
+    table t = allocate_table(h, identity_key, pointer_equal);
+    u64 n = 0;
+
+    /* stop a few inserts into a migration */
+    while (!(t->old_entries && t->migrate_index > 0 &&
+             t->migrate_index < t->old_buckets / 2)) {
+        n++;
+        table_set(t, (void *)n, (void *)n);
+        if (n > TABLETEST_ELEM_COUNT * 64) {
+            msg_err("no migration in progress after %d inserts\n", n);
+            return false;
+        }
+    }
+
+    /* removes keys on both sides of the migration */
+    for (u64 k = 1; k <= n; k += 3)
+        table_set(t, (void *)k, 0);
+    if (!t->old_entries) {
+        msg_err("migration finished early\n");
+        return false;
+    }
+
+    u8 *seen = allocate_zero(h, n + 1);
+    u64 visits = 0;
+    table_foreach(t, k, v) {
+        if ((u64)k == 0 || (u64)k > n || (u64)k != (u64)v) {
+            msg_err("table_foreach() bad entry %p -> %p\n", k, v);
+            return false;
+        }
+        if (((u64)k - 1) % 3 == 0) {
+            msg_err("table_foreach() returned deleted key %d\n", (u64)k);
+            return false;
+        }
+        if (seen[(u64)k]++) {
+            msg_err("table_foreach() returned key %d twice\n", (u64)k);
+            return false;
+        }
+        visits++;
+    }
+    if (visits != table_elements(t)) {
+        msg_err("table_foreach() visited %d, table_elements() %d\n", visits,
+                table_elements(t));
+        return false;
+    }
+    for (u64 k = 1; k <= n; k++) {
+        void *v = table_find(t, (void *)k);
+        if ((k - 1) % 3 == 0 ? v != 0 : v != (void *)k) {
+            msg_err("element %d lookup mismatch during migration: %p\n", k, v);
+            return false;
+        }
+    }
+
+    /* finish the migration and check again */
+    deallocate(h, seen, n + 1);
+    u64 deleted_below = n;
+    while (t->old_entries) {
+        n++;
+        table_set(t, (void *)n, (void *)n);
+    }
+    for (u64 k = 1; k <= n; k++) {
+        void *v = table_find(t, (void *)k);
+        if (k <= deleted_below && (k - 1) % 3 == 0 ? v != 0 : v != (void *)k) {
+            msg_err("element %d lookup mismatch after migration: %p\n", k, v);
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     heap h = init_process_runtime();
@@ -160,6 +288,14 @@ int main(int argc, char **argv)
         msg_err("One-element table test failed\n");
         goto fail;
     }
+    if (!churn_table_tests(h)) {
+        msg_err("Churn table test failed\n");
+        goto fail;
+    }
+    if (!migration_table_tests(h)) {
+        msg_err("Migration table test failed\n");
+        goto fail;
+    }
     exit(EXIT_SUCCESS);
 fail:
 	exit(EXIT_FAILURE);
@@ -0,0 +1,232 @@
+//#define ENABLE_MSG_DEBUG
+#include <runtime.h>
+#include <stdlib.h>
+#define EXIT_FAILURE 1
+#define EXIT_SUCCESS 0
+
+/* Timers are set relative to now(), so each is aimed at a point in
+   simulated time and the wheel is serviced at simulated times. The
+   expiry lands a little after the aim, by however long it takes to
+   read the clock twice. */
+#define CLOCK_MARGIN    milliseconds(1)
+#define TICK            (1ull << 16)
+
+#define NTIMERS         2000
+
+typedef struct record {
+    timer t;
+    timestamp when;
+    timestamp fired;
+    int count;
+    boolean cancelled;
+} *record;
+
+static timestamp sim;
+static int fired_this_pass;
+
+static CLOSURE_1_0(record_fire, void, record);
+static void record_fire(record r)
+{
+    r->fired = sim;
+    r->count++;
+    fired_this_pass++;
+}
+
+static timer set_timer(heap h, record r, timestamp when, timestamp slack)
+{
+    r->when = when;
+    r->fired = 0;
+    r->count = 0;
+    r->cancelled = false;
+    r->t = register_timer_slack(when - now(), slack, closure(h, record_fire, r));
+    return r->t;
+}
+
+static timestamp service(timestamp here)
+{
+    sim = here;
+    fired_this_pass = 0;
+    return timer_service(here);
+}
+
+/* Returns false if any timer fired early, or failed to fire once its
+   expiry had passed. */
+static boolean check_records(struct record *records, int n, timestamp slack)
+{
+    for (int i = 0; i < n; i++) {
+        record r = &records[i];
+        if (r->cancelled) {
+            if (r->count) {
+                msg_err("cancelled timer %d fired\n", i);
+                return false;
+            }
+            continue;
+        }
+        if (r->count > 1) {
+            msg_err("timer %d fired %d times\n", i, r->count);
+            return false;
+        }
+        if (r->count && r->fired < r->when) {
+            msg_err("timer %d fired early: %T < %T\n", i, r->fired, r->when);
+            return false;
+        }
+        if (!r->count && r->when + slack + TICK + CLOCK_MARGIN <= sim) {
+            msg_err("timer %d not fired: %T, now %T\n", i, r->when, sim);
+            return false;
+        }
+        if (r->count && r->fired > r->when + slack + TICK + CLOCK_MARGIN) {
+            msg_err("timer %d fired late: %T > %T\n", i, r->fired, r->when);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Expiries from a tick up to hours out, spanning every level of the
+   wheel. The wheel is serviced at the expiry it reports, each time
+   firing at least one timer, or at random points short of it. */
+static boolean expiry_test(heap h)
+{
+    static struct record records[NTIMERS];
+    timestamp base = sim;
+
+    for (int i = 0; i < NTIMERS; i++) {
+        timestamp d = (random_u64() & MASK(16 + random_u64() % 31)) + TICK;
+        set_timer(h, &records[i], base + d, 0);
+    }
+
+    timestamp dt = service(base);
+    int wakeups = 0;
+    while (dt != infinity) {
+        boolean early = (random_u64() & 3) == 0;
+        if (early)
+            dt = random_u64() % dt;
+        dt = service(sim + dt);
+        if (!early && fired_this_pass == 0) {
+            msg_err("wakeup at %T fired no timers\n", sim);
+            return false;
+        }
+        wakeups++;
+
+        /* cancel some of what is left */
+        for (int i = random_u64() % NTIMERS, j = 0; j < 8; i = (i + 1) % NTIMERS, j++) {
+            record r = &records[i];
+            if (!r->count && !r->cancelled && (random_u64() & 7) == 0) {
+                remove_timer(r->t);
+                r->cancelled = true;
+                dt = timer_next(sim);
+            }
+        }
+        if (!check_records(records, NTIMERS, 0))
+            return false;
+    }
+    for (int i = 0; i < NTIMERS; i++) {
+        if (!records[i].cancelled && records[i].count != 1) {
+            msg_err("timer %d fired %d times\n", i, records[i].count);
+            return false;
+        }
+    }
+    msg_debug("expiry test: %d wakeups\n", wakeups);
+    return true;
+}
+
+static timer self_removing;
+
+static CLOSURE_1_0(periodic_fire, void, int *);
+static void periodic_fire(int *count)
+{
+    if (++*count == 5 && self_removing)
+        remove_timer(self_removing);
+}
+
+/* Set against the real clock, ahead of which the wheel has yet to be
+   serviced. */
+static boolean periodic_test(heap h)
+{
+    int count = 0;
+    timestamp base = now();
+    timer t = register_periodic_timer(milliseconds(10), closure(h, periodic_fire, &count));
+    service(base + seconds(1) - milliseconds(5));
+    if (count != 99) {
+        msg_err("periodic timer fired %d times, expected 99\n", count);
+        return false;
+    }
+    remove_timer(t);
+    service(sim + seconds(1));
+    if (count != 99) {
+        msg_err("periodic timer fired after removal\n");
+        return false;
+    }
+
+    /* behind the wheel from the start, so it fires on every pass */
+    count = 0;
+    self_removing = register_periodic_timer(milliseconds(10), closure(h, periodic_fire, &count));
+    service(sim + seconds(10));
+    self_removing = 0;
+    if (count != 5) {
+        msg_err("self-removing timer fired %d times, expected 5\n", count);
+        return false;
+    }
+    return true;
+}
+
+/* Timers 10us apart with half a millisecond of slack should share a
+   few wakeups, where without slack they'd need one per tick. */
+#define NCOALESCE 32
+static int coalesce_wakeups(heap h, timestamp slack)
+{
+    struct record records[NCOALESCE];
+    timestamp base = sim + milliseconds(100);
+
+    for (int i = 0; i < NCOALESCE; i++)
+        set_timer(h, &records[i], base + i * microseconds(10), slack);
+
+    int wakeups = 0;
+    timestamp dt = service(sim);
+    while (dt != infinity) {
+        dt = service(sim + dt);
+        wakeups++;
+    }
+    if (!check_records(records, NCOALESCE, slack))
+        return -1;
+    msg_debug("%d wakeups with slack %T\n", wakeups, slack);
+    return wakeups;
+}
+
+static boolean coalesce_test(heap h)
+{
+    int precise = coalesce_wakeups(h, 0);
+    int coalesced = coalesce_wakeups(h, microseconds(500));
+    if (precise < 0 || coalesced < 0)
+        return false;
+    if (precise < NCOALESCE / 2 || coalesced > 2) {
+        msg_err("%d wakeups without slack, %d with\n", precise, coalesced);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+
+    if (timer_service(now()) != infinity) {
+        msg_err("empty wheel has an expiry\n");
+        goto fail;
+    }
+
+    if (!periodic_test(h))
+        goto fail;
+
+    if (!expiry_test(h))
+        goto fail;
+
+    if (!coalesce_test(h))
+        goto fail;
+
+    msg_debug("timer test passed\n");
+    exit(EXIT_SUCCESS);
+  fail:
+    msg_err("timer test failed\n");
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,161 @@
+/* Time a mount of a filesystem whose log holds a file of many
+   extents. The file is written one sector every MIN_EXTENT_SIZE * 2
+   bytes, so that no extent can grow over the next, into an image in a
+   temporary file. It is then mounted by the benchmark executed anew,
+   so that it starts with an empty symbol table as a boot would. Not
+   run as part of "make test"; invoke the binary directly, with the
+   number of extents as the argument. */
+
+#include <runtime.h>
+#include <tfs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_EXTENTS (1024 * 1024)
+#define EXTENT_STRIDE   (MIN_EXTENT_SIZE * 2)
+
+static int disk;
+static int nextents;
+
+static CLOSURE_0_3(disk_read, void, void *, range, status_handler);
+static void disk_read(void *dest, range blocks, status_handler sh)
+{
+    u64 length = range_span(blocks) << SECTOR_OFFSET;
+    ssize_t rv = pread(disk, dest, length, blocks.start << SECTOR_OFFSET);
+    if (rv < 0) {
+        apply(sh, timm("result", "pread failed: %s", strerror(errno)));
+        return;
+    }
+    /* past the end of the image reads as zero */
+    if (rv < length)
+        memset(dest + rv, 0, length - rv);
+    apply(sh, STATUS_OK);
+}
+
+static CLOSURE_0_3(disk_write, void, void *, range, status_handler);
+static void disk_write(void *src, range blocks, status_handler sh)
+{
+    u64 length = range_span(blocks) << SECTOR_OFFSET;
+    if (pwrite(disk, src, length, blocks.start << SECTOR_OFFSET) != length) {
+        apply(sh, timm("result", "pwrite failed: %s", strerror(errno)));
+        return;
+    }
+    apply(sh, STATUS_OK);
+}
+
+static u64 nsecs(timestamp t)
+{
+    return sec_from_timestamp(t) * BILLION + nsec_from_timestamp(t);
+}
+
+static CLOSURE_2_2(build_complete, void, heap, tuple, filesystem, status);
+static void build_complete(heap h, tuple root, filesystem fs, status s)
+{
+    if (!is_ok(s)) {
+        msg_err("create failed: %v\n", s);
+        exit(EXIT_FAILURE);
+    }
+    tuple f = allocate_tuple();
+    tuple c = allocate_tuple();
+    table_set(c, sym(bench), f);
+    table_set(root, sym(children), c);
+    filesystem_write_tuple(fs, root, ignore_status);
+    allocate_fsfile(fs, f);
+
+    buffer b = allocate_buffer(h, SECTOR_SIZE);
+    for (int i = 0; i < SECTOR_SIZE; i++)
+        push_u8(b, i);
+    for (u64 i = 0; i < nextents; i++) {
+        b->start = 0;
+        filesystem_write(fs, f, b, i * EXTENT_STRIDE, ignore_io_status);
+    }
+}
+
+static CLOSURE_1_2(mount_complete, void, timestamp, filesystem, status);
+static void mount_complete(timestamp start, filesystem fs, status s)
+{
+    u64 ns = nsecs(now() - start);
+    if (!is_ok(s)) {
+        msg_err("mount failed: %v\n", s);
+        exit(EXIT_FAILURE);
+    }
+    struct extent_stats es;
+    filesystem_get_extent_stats(fs, &es);
+    if (es.extents != nextents) {
+        msg_err("mounted %ld extents, expected %d\n", es.extents, nextents);
+        exit(EXIT_FAILURE);
+    }
+    printf("mounted %d extents in %lld ms, %lld ns per extent\n", nextents,
+           (long long)(ns / MILLION), (long long)(ns / nextents));
+    exit(EXIT_SUCCESS);
+}
+
+static void mount(heap h)
+{
+    create_filesystem(h, SECTOR_SIZE, infinity, h, closure(h, disk_read),
+                      closure(h, disk_write), allocate_tuple(),
+                      closure(h, mount_complete, now()));
+    msg_err("mount did not complete\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    heap h = init_process_runtime();
+
+    /* re-executed to mount */
+    if (argc == 4 && !strcmp(argv[1], "-m")) {
+        disk = atoi(argv[2]);
+        nextents = atoi(argv[3]);
+        mount(h);
+    }
+
+    nextents = argc > 1 ? atoi(argv[1]) : DEFAULT_EXTENTS;
+    if (nextents < 1) {
+        printf("usage: %s [extents]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    char name[] = "/tmp/tlog_bench.XXXXXX";
+    disk = mkstemp(name);
+    if (disk < 0) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    unlink(name);
+
+    tuple root = allocate_tuple();
+    timestamp t = now();
+    create_filesystem(h, SECTOR_SIZE, infinity, h, closure(h, disk_read),
+                      closure(h, disk_write), allocate_tuple(),
+                      closure(h, build_complete, h, root));
+    printf("wrote %d extents in %lld ms\n", nextents, (long long)(nsecs(now() - t) / MILLION));
+
+    struct stat st;
+    fstat(disk, &st);
+    printf("image %lld MB allocated\n", (long long)(st.st_blocks * 512 / MB));
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        char fd[16], n[16];
+        snprintf(fd, sizeof(fd), "%d", disk);
+        snprintf(n, sizeof(n), "%d", nextents);
+        execl(argv[0], argv[0], "-m", fd, n, (char *)0);
+        perror("exec");
+        exit(EXIT_FAILURE);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    close(disk);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}